@@ -68,7 +68,13 @@ if test "$PHP_SWOOLE_ASYNC" != "no"; then
 
     swoole_source_file="swoole_async.cc \
         swoole_mysql.c \
+        swoole_mysql_pool.c \
+        swoole_mysql_router.c \
+        swoole_mysql_cache.c \
+        swoole_mysql_binlog.c \
         swoole_redis.c \
+        swoole_redis_cluster.c \
+        swoole_redis_cache.c \
         swoole_msgqueue.c \
         swoole_ringqueue.c \
 	swoole_channel.c \
@@ -30,6 +30,32 @@
 #define SW_REDIS_CONNECT_TIMEOUT         1.0
 #endif
 
+#define SW_MYSQL_POOL_MAX_CONNECTIONS          16
+#define SW_MYSQL_POOL_IDLE_TIMEOUT             60.0
+#define SW_MYSQL_POOL_HEALTH_CHECK_INTERVAL    30.0
+#define SW_MYSQL_POOL_TIMER_INTERVAL           1000
+/* weight of the last response time in the moving average of the latency */
+#define SW_MYSQL_POOL_LATENCY_WEIGHT           0.2
+
+#define SW_MYSQL_ROUTER_LAG_QUERY              "SHOW SLAVE STATUS"
+#define SW_MYSQL_ROUTER_LAG_CHECK_INTERVAL     5.0
+#define SW_MYSQL_ROUTER_GTID_WAIT_TIMEOUT      1.0
+
+/* LOAD DATA LOCAL INFILE, must stay below the socket output buffer size */
+#define SW_MYSQL_INFILE_PACKET_SIZE            (4 * 1024 * 1024)
+
+/* COM_STMT_SEND_LONG_DATA, each chunk must stay below max_allowed_packet */
+#define SW_MYSQL_LONG_DATA_CHUNK_SIZE          (1024 * 1024)
+
+/* memory of the result sets shared by the connections with result_cache_ttl, Swoole\Async::set(['mysql_result_cache_memory' => ...]) */
+#define SW_MYSQL_RESULT_CACHE_MEMORY           (64 * 1024 * 1024)
+
+/* the default of the server, the statements of insertBatch are split below it */
+#define SW_MYSQL_MAX_ALLOWED_PACKET            (4 * 1024 * 1024)
+
+/* Swoole\MySQL\BinlogStream registers as a replica, its server id is this plus the pid unless one is given */
+#define SW_MYSQL_BINLOG_SERVER_ID              0x7fff0000
+
 static sw_inline enum swBool_type php_swoole_is_callable(zval *callback)
 {
     if (!callback || ZVAL_IS_NULL(callback))
@@ -73,7 +99,14 @@ PHP_MINFO_FUNCTION(swoole_async);
 
 void swoole_http_client_init(int module_number);
 void swoole_redis_init(int module_number);
+void swoole_redis_cluster_init(int module_number);
 void swoole_mysql_init(int module_number);
+void swoole_mysql_pool_init(int module_number);
+void swoole_mysql_router_init(int module_number);
+void swoole_mysql_binlog_init(int module_number);
+void swoole_mysql_shutdown();
+void swoole_mysql_cache_free();
+void mysql_cache_set_memory(size_t memory);
 void swoole_mmap_init(int module_number);
 void swoole_channel_init(int module_number);
 void swoole_ringqueue_init(int module_number);
@@ -923,6 +923,11 @@ PHP_FUNCTION(swoole_async_set)
     {
         SwooleG.enable_coroutine = zval_is_true(v);
     }
+    if (php_swoole_array_get_value(vht, "mysql_result_cache_memory", v))
+    {
+        zend_long memory = zval_get_long(v);
+        mysql_cache_set_memory(memory < 0 ? 0 : (size_t) memory);
+    }
 #if defined(HAVE_REUSEPORT) && defined(HAVE_EPOLL)
     //reuse port
     if (php_swoole_array_get_value(vht, "enable_reuse_port", v))
@@ -1151,9 +1156,13 @@ PHP_MINIT_FUNCTION(swoole_async)
     swoole_http_client_init(module_number);
     swoole_async_init(module_number);
     swoole_mysql_init(module_number);
+    swoole_mysql_pool_init(module_number);
+    swoole_mysql_router_init(module_number);
+    swoole_mysql_binlog_init(module_number);
     swoole_mmap_init(module_number);
     swoole_channel_init(module_number);
     swoole_redis_init(module_number);
+    swoole_redis_cluster_init(module_number);
     swoole_ringqueue_init(module_number);
     swoole_msgqueue_init(module_number);
     swoole_memory_pool_init(module_number);
@@ -1166,6 +1175,7 @@ PHP_MINIT_FUNCTION(swoole_async)
  */
 PHP_MSHUTDOWN_FUNCTION(swoole_async)
 {
+    swoole_mysql_shutdown();
     return SUCCESS;
 }
 /* }}} */
@@ -1190,7 +1200,7 @@ PHP_MINFO_FUNCTION(swoole_async)
     php_info_print_table_row(2, "trace_log", "enabled");
 #endif
 
-    php_info_print_table_row(2, "mysqlnd", "enabled");
+    php_info_print_table_row(2, "async_mysql", "enabled");
 
     php_info_print_table_row(2, "async_redis", "enabled");
 
@@ -1207,5 +1217,6 @@ PHP_RINIT_FUNCTION(swoole_async)
 
 PHP_RSHUTDOWN_FUNCTION(swoole_async)
 {
+    swoole_mysql_cache_free();
     return SUCCESS;
 }
@@ -24,29 +24,59 @@
 #include "ext/hash/php_hash.h"
 #include "ext/hash/php_hash_sha.h"
 #include "ext/standard/php_math.h"
+#include "zend_interfaces.h"
 
 #ifdef SW_MYSQL_RSA_SUPPORT
 #include <openssl/rsa.h>
 #include <openssl/pem.h>
 #endif
 
+#ifdef SW_USE_OPENSSL
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+#endif
+
+#ifdef SW_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 static swString *mysql_request_buffer;
+static swString *mysql_statement_buffer;
+#ifdef SW_HAVE_ZLIB
+static swString *mysql_compress_buffer;
+#endif
 
 static PHP_METHOD(swoole_mysql, __construct);
 static PHP_METHOD(swoole_mysql, __destruct);
 static PHP_METHOD(swoole_mysql, connect);
-#ifdef SW_USE_MYSQLND
 static PHP_METHOD(swoole_mysql, escape);
-#endif
+static PHP_METHOD(swoole_mysql, escapeArray);
 static PHP_METHOD(swoole_mysql, query);
+static PHP_METHOD(swoole_mysql, multiQuery);
+static PHP_METHOD(swoole_mysql, waitForGtid);
+static PHP_METHOD(swoole_mysql, insertBatch);
+static PHP_METHOD(swoole_mysql, prepare);
+static PHP_METHOD(swoole_mysql, loadData);
+static PHP_METHOD(swoole_mysql, execute);
+static PHP_METHOD(swoole_mysql, closeStatement);
 static PHP_METHOD(swoole_mysql, begin);
 static PHP_METHOD(swoole_mysql, commit);
 static PHP_METHOD(swoole_mysql, rollback);
+static PHP_METHOD(swoole_mysql, ping);
+static PHP_METHOD(swoole_mysql, reset);
+static PHP_METHOD(swoole_mysql, changeUser);
 static PHP_METHOD(swoole_mysql, getState);
+static PHP_METHOD(swoole_mysql, getCacheStats);
 static PHP_METHOD(swoole_mysql, close);
 static PHP_METHOD(swoole_mysql, on);
 
-static zend_class_entry *swoole_mysql_ce;
+zend_class_entry *swoole_mysql_ce;
 static zend_object_handlers swoole_mysql_handlers;
 
 static zend_class_entry *swoole_mysql_exception_ce;
@@ -97,16 +127,65 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_rollback, 0, 0, 1)
     ZEND_ARG_INFO(0, callback)
 ZEND_END_ARG_INFO()
 
-#ifdef SW_USE_MYSQLND
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_ping, 0, 0, 1)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_changeUser, 0, 0, 3)
+    ZEND_ARG_INFO(0, user)
+    ZEND_ARG_INFO(0, password)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, database)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_escape, 0, 0, 1)
     ZEND_ARG_INFO(0, string)
     ZEND_ARG_INFO(0, flags)
 ZEND_END_ARG_INFO()
-#endif
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_escapeArray, 0, 0, 1)
+    ZEND_ARG_ARRAY_INFO(0, values, 0)
+ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_query, 0, 0, 2)
     ZEND_ARG_INFO(0, sql)
     ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_waitForGtid, 0, 0, 2)
+    ZEND_ARG_INFO(0, gtid_set)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_insertBatch, 0, 0, 4)
+    ZEND_ARG_INFO(0, table)
+    ZEND_ARG_ARRAY_INFO(0, columns, 0)
+    ZEND_ARG_INFO(0, rows)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_loadData, 0, 0, 3)
+    ZEND_ARG_INFO(0, sql)
+    ZEND_ARG_INFO(0, source)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_prepare, 0, 0, 2)
+    ZEND_ARG_INFO(0, sql)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_execute, 0, 0, 3)
+    ZEND_ARG_INFO(0, statement_id)
+    ZEND_ARG_ARRAY_INFO(0, params, 0)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_ARRAY_INFO(0, options, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_closeStatement, 0, 0, 1)
+    ZEND_ARG_INFO(0, statement_id)
 ZEND_END_ARG_INFO()
 
 static const zend_function_entry swoole_mysql_methods[] =
@@ -117,19 +196,40 @@ static const zend_function_entry swoole_mysql_methods[] =
     PHP_ME(swoole_mysql, begin, arginfo_swoole_mysql_begin, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, commit, arginfo_swoole_mysql_commit, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, rollback, arginfo_swoole_mysql_rollback, ZEND_ACC_PUBLIC)
-#ifdef SW_USE_MYSQLND
+    PHP_ME(swoole_mysql, ping, arginfo_swoole_mysql_ping, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, reset, arginfo_swoole_mysql_ping, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, changeUser, arginfo_swoole_mysql_changeUser, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, escape, arginfo_swoole_mysql_escape, ZEND_ACC_PUBLIC)
-#endif
+    PHP_ME(swoole_mysql, escapeArray, arginfo_swoole_mysql_escapeArray, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, query, arginfo_swoole_mysql_query, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, multiQuery, arginfo_swoole_mysql_query, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, waitForGtid, arginfo_swoole_mysql_waitForGtid, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, insertBatch, arginfo_swoole_mysql_insertBatch, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, loadData, arginfo_swoole_mysql_loadData, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, prepare, arginfo_swoole_mysql_prepare, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, execute, arginfo_swoole_mysql_execute, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, closeStatement, arginfo_swoole_mysql_closeStatement, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, close, arginfo_swoole_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, getState, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, getCacheStats, arginfo_swoole_void, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
     PHP_ME(swoole_mysql, on, arginfo_swoole_mysql_on, ZEND_ACC_PUBLIC)
     PHP_FE_END
 };
 
 static void mysql_client_free(mysql_client *client, zval* zobject);
 static void mysql_columns_free(mysql_client *client);
-static int mysql_query(zval *zobject, mysql_client *client, swString *sql, zval *callback);
+static void mysql_statement_free(void *data);
+static void mysql_infile_detach(mysql_client *client);
+static void mysql_infile_next(mysql_infile *infile);
+static mysql_request* mysql_long_data_detach(mysql_client *client);
+static void mysql_long_data_next(mysql_long_data *ld);
+static int mysql_long_data_start(mysql_client *client, mysql_statement *stmt, HashTable *files, mysql_request *request);
+static void mysql_big_value_free(mysql_client *client);
+static void mysql_onTrackGtids(mysql_client *client, mysql_request *request, zval *result);
+static int mysql_batch_write(zval *zobject, mysql_client *client, mysql_batch *batch, char *data, size_t length);
+#ifdef SW_USE_OPENSSL
+static void mysql_ssl_free(mysql_client *client);
+#endif
 
 static void mysql_client_free(mysql_client *client, zval* zobject)
 {
@@ -159,6 +259,28 @@ static void mysql_client_free(mysql_client *client, zval* zobject)
         efree(client->connector.database);
         client->connector.database = NULL;
     }
+    if (client->connector.local_infile_dir)
+    {
+        efree(client->connector.local_infile_dir);
+        client->connector.local_infile_dir = NULL;
+    }
+    if (client->connector.gtid)
+    {
+        zend_string_release(client->connector.gtid);
+        client->connector.gtid = NULL;
+    }
+    mysql_infile_detach(client);
+    if (client->long_data)
+    {
+        mysql_request_free(mysql_long_data_detach(client));
+    }
+    mysql_big_value_free(client);
+#ifdef SW_USE_OPENSSL
+    if (client->ssl)
+    {
+        mysql_ssl_free(client);
+    }
+#endif
     //close the connection
     client->cli->close(client->cli);
     //release client object memory
@@ -166,10 +288,239 @@ static void mysql_client_free(mysql_client *client, zval* zobject)
     efree(client->cli);
     client->cli = NULL;
     client->connected = 0;
+    // the server has released the statements of the session
+    while (client->statement_list->num > 0)
+    {
+        mysql_statement_free(swLinkedList_shift(client->statement_list));
+    }
+    if (client->statement)
+    {
+        mysql_statement_free(client->statement);
+        client->statement = NULL;
+    }
+    if (client->compress_buffer)
+    {
+        swString_free(client->compress_buffer);
+        client->compress_buffer = NULL;
+    }
+}
+
+/**
+ * the statements of the batch which will not be sent
+ */
+static void mysql_batch_drop(mysql_batch *batch)
+{
+    swString *statement;
+
+    while ((statement = swLinkedList_shift(batch->statements)))
+    {
+        swString_free(statement);
+    }
+}
+
+static void mysql_request_free(void *data)
+{
+    mysql_request *request = data;
+    if (request->callback)
+    {
+        sw_zval_free(request->callback);
+    }
+    if (request->infile_source)
+    {
+        sw_zval_free(request->infile_source);
+    }
+    zval_ptr_dtor(&request->results);
+    if (request->timer)
+    {
+        swTimer_del(&SwooleG.timer, request->timer);
+    }
+    if (request->batch && --request->batch->pending == 0)
+    {
+        if (request->batch->callback)
+        {
+            sw_zval_free(request->batch->callback);
+        }
+        if (request->batch->statements)
+        {
+            mysql_batch_drop(request->batch);
+            swLinkedList_free(request->batch->statements);
+        }
+        efree(request->batch);
+    }
+    efree(request);
+}
+
+static mysql_request* mysql_request_new(uint8_t cmd, zval *callback)
+{
+    mysql_request *request = ecalloc(1, sizeof(mysql_request));
+    request->cmd = cmd;
+    if (callback != NULL)
+    {
+        Z_TRY_ADDREF_P(callback);
+        request->callback = sw_zval_dup(callback);
+    }
+    return request;
+}
+
+/**
+ * get ready to parse the response of the request at the head of the queue
+ */
+static sw_inline void mysql_request_start(mysql_client *client, mysql_request *request)
+{
+    client->cmd = request->cmd;
+    // COM_STMT_FETCH responds with the rows of the open cursor only
+    client->state = request->cmd == SW_MYSQL_COM_STMT_FETCH ? SW_MYSQL_STATE_READ_ROW : SW_MYSQL_STATE_READ_START;
+}
+
+static void mysql_statement_close_cursor(mysql_statement *stmt)
+{
+    int i;
+    if (stmt->columns)
+    {
+        for (i = 0; i < stmt->num_column; i++)
+        {
+            if (stmt->columns[i].buffer)
+            {
+                efree(stmt->columns[i].buffer);
+            }
+        }
+        efree(stmt->columns);
+        stmt->columns = NULL;
+        stmt->num_column = 0;
+    }
+}
+
+static void mysql_statement_free(void *data)
+{
+    mysql_statement *stmt = data;
+    mysql_statement_close_cursor(stmt);
+    efree(stmt);
+}
+
+static mysql_statement* mysql_statement_find(mysql_client *client, uint32_t id)
+{
+    swLinkedList_node *node;
+    mysql_statement *stmt;
+
+    for (node = client->statement_list->head; node; node = node->next)
+    {
+        stmt = node->data;
+        if (stmt->id == id)
+        {
+            return stmt;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * aggregate the response of a statement of insertBatch, the callback gets the result of the last one
+ */
+static void mysql_batch_onResponse(zval *zobject, mysql_request *request, zval *result, ulong_t affected_rows)
+{
+    mysql_batch *batch = request->batch;
+    zval args[2];
+
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        batch->failed = 1;
+    }
+    else
+    {
+        batch->affected_rows += affected_rows;
+    }
+    // without pipelining the next statement is sent once the previous one has succeeded
+    if (batch->statements && batch->statements->num > 0)
+    {
+        swString *statement = batch->failed ? NULL : swLinkedList_shift(batch->statements);
+        if (!statement || mysql_batch_write(zobject, request->client, batch, statement->str, statement->length) < 0)
+        {
+            batch->failed = 1;
+            mysql_batch_drop(batch);
+        }
+        if (statement)
+        {
+            swString_free(statement);
+        }
+    }
+    // the request is released after its response, so the last one still holds the batch
+    if (batch->pending > 1 || !batch->callback)
+    {
+        return;
+    }
+
+    zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("affected_rows"), batch->affected_rows);
+    args[0] = *zobject;
+    ZVAL_BOOL(&args[1], !batch->failed);
+    if (sw_call_user_function_ex(EG(function_table), NULL, batch->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+}
+
+/**
+ * the connection is gone, every query still waiting for its response fails with CR_SERVER_LOST
+ */
+static void mysql_requests_fail(mysql_client *client, zval *zobject)
+{
+    mysql_request *request;
+    zval args[2];
+
+    if (client->requests->num == 0 && !client->long_data)
+    {
+        return;
+    }
+
+    zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), 2013);
+    zend_update_property_string(swoole_mysql_ce, zobject, ZEND_STRL("error"), "Lost connection to MySQL server during query");
+
+    // the statement was still waiting for its long data
+    if (client->long_data)
+    {
+        swLinkedList_append(client->requests, mysql_long_data_detach(client));
+    }
+
+    while ((request = swLinkedList_shift(client->requests)))
+    {
+        if (request->batch && !client->cli->destroyed)
+        {
+            ZVAL_FALSE(&args[1]);
+            mysql_batch_onResponse(zobject, request, &args[1], 0);
+        }
+        else if (request->handler)
+        {
+            ZVAL_FALSE(&args[1]);
+            request->handler(client, request, &args[1]);
+        }
+        else if (request->callback && !client->cli->destroyed)
+        {
+            args[0] = *zobject;
+            ZVAL_FALSE(&args[1]);
+            if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+            {
+                php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+            }
+            if (UNEXPECTED(EG(exception)))
+            {
+                zend_exception_error(EG(exception), E_ERROR);
+            }
+        }
+        mysql_request_free(request);
+    }
 }
 
 static void mysql_columns_free(mysql_client *client)
 {
+    // the columns of an open cursor belong to the statement
+    if (client->cmd == SW_MYSQL_COM_STMT_FETCH)
+    {
+        client->response.columns = NULL;
+        return;
+    }
     if (client->response.columns)
     {
         int i;
@@ -210,6 +561,8 @@ void swoole_mysql_init(int module_number)
     zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("connect_error"), ZEND_ACC_PUBLIC);
     zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("insert_id"), ZEND_ACC_PUBLIC);
     zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("affected_rows"), ZEND_ACC_PUBLIC);
+    zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("gtid"), ZEND_ACC_PUBLIC);
+    zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("tlsInfo"), ZEND_ACC_PUBLIC);
     /** event callback */
     zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("onConnect"), ZEND_ACC_PUBLIC);
     zend_declare_property_null(swoole_mysql_ce, ZEND_STRL("onClose"), ZEND_ACC_PUBLIC);
@@ -222,18 +575,56 @@ void swoole_mysql_init(int module_number)
     zend_declare_class_constant_long(swoole_mysql_ce, ZEND_STRL("STATE_CLOSED"), SW_MYSQL_STATE_CLOSED);
 
     mysql_request_buffer = swString_new(SW_BUFFER_SIZE_STD);
+    mysql_statement_buffer = swString_new(SW_BUFFER_SIZE_STD);
+#ifdef SW_HAVE_ZLIB
+    mysql_compress_buffer = swString_new(SW_BUFFER_SIZE_STD);
+#endif
 }
 
-int mysql_request_pack(swString *sql, swString *buffer)
+/**
+ * payloads of 16MB or more are split into packets with consecutive sequence ids,
+ * a packet of exactly 16MB - 1 is followed by an empty one
+ */
+int mysql_command_pack(swString *buffer, uint8_t cmd, char *data, size_t length)
 {
+    uint8_t sequence = 0;
+    size_t remaining = length + 1, packet, size;
+    char *header;
+
     swString_clear(buffer);
-    bzero(buffer->str, 5);
-    //length
-    mysql_pack_length(sql->length + 1, buffer->str);
-    //command
-    buffer->str[4] = SW_MYSQL_COM_QUERY;
-    buffer->length = 5;
-    return swString_append(buffer, sql);
+    do
+    {
+        packet = MIN(remaining, SW_MYSQL_MAX_PACKET_BODY_SIZE);
+        size = buffer->length + SW_MYSQL_PACKET_HEADER_SIZE + packet;
+        if (size > buffer->size && swString_extend(buffer, size) < 0)
+        {
+            return SW_ERR;
+        }
+        header = buffer->str + buffer->length;
+        mysql_int3store(header, packet);
+        header[3] = sequence;
+        buffer->length += SW_MYSQL_PACKET_HEADER_SIZE;
+        remaining -= packet;
+        //command
+        if (sequence++ == 0)
+        {
+            buffer->str[buffer->length++] = cmd;
+            packet--;
+        }
+        if (packet > 0)
+        {
+            memcpy(buffer->str + buffer->length, data, packet);
+            buffer->length += packet;
+            data += packet;
+        }
+    } while (remaining > 0 || buffer->length - (header - buffer->str) == SW_MYSQL_MAX_PACKET_SIZE);
+
+    return SW_OK;
+}
+
+int mysql_request_pack(swString *sql, swString *buffer)
+{
+    return mysql_command_pack(buffer, SW_MYSQL_COM_QUERY, sql->str, sql->length);
 }
 
 int mysql_prepare_pack(swString *sql, swString *buffer)
@@ -248,67 +639,488 @@ int mysql_prepare_pack(swString *sql, swString *buffer)
     return swString_append(buffer, sql);
 }
 
-int mysql_get_result(mysql_connector *connector, char *buf, int len)
+typedef size_t (*mysql_mbcharlen)(const uint8_t *s, size_t length);
+
+/**
+ * the charsets whose trailing bytes overlap ASCII, a backslash in the middle of a character is not escaped
+ */
+static size_t mysql_mbcharlen_big5(const uint8_t *s, size_t length)
 {
-    char *tmp = buf;
-    uint32_t packet_length = mysql_uint3korr(tmp);
-    if (len < SW_MYSQL_PACKET_HEADER_SIZE + packet_length)
+    if (length < 2 || s[0] < 0xa1 || s[0] > 0xf9)
     {
-        return 0;
+        return 1;
     }
-    //int packet_number = tmp[3];
-    tmp += SW_MYSQL_PACKET_HEADER_SIZE;
-
-    uint8_t opcode = *tmp;
-    tmp += 1;
+    return ((s[1] >= 0x40 && s[1] <= 0x7e) || (s[1] >= 0xa1 && s[1] <= 0xfe)) ? 2 : 1;
+}
 
-    //ERROR Packet
-    if (opcode == SW_MYSQL_PACKET_ERR)
-    {
-        swMysqlPacketDump(tmp - 5, SW_MYSQL_PACKET_HEADER_SIZE + packet_length, "Handshake ERR_Packet");
-        connector->error_code = *(uint16_t *) tmp;
-        connector->error_msg = tmp + 2;
-        connector->error_length = packet_length - 3;
-        return -1;
-    }
-    else
+static size_t mysql_mbcharlen_gbk(const uint8_t *s, size_t length)
+{
+    if (length < 2 || s[0] < 0x81 || s[0] > 0xfe)
     {
-        swMysqlPacketDump(tmp - 5, SW_MYSQL_PACKET_HEADER_SIZE + packet_length, "Handshake OK_Packet");
         return 1;
     }
+    return ((s[1] >= 0x40 && s[1] <= 0x7e) || (s[1] >= 0x80 && s[1] <= 0xfe)) ? 2 : 1;
 }
 
-static void php_swoole_sha256(const char *str, int _len, unsigned char *digest)
+static size_t mysql_mbcharlen_sjis(const uint8_t *s, size_t length)
 {
-    PHP_SHA256_CTX context;
-    PHP_SHA256Init(&context);
-    PHP_SHA256Update(&context, (unsigned char *) str, _len);
-    PHP_SHA256Final(digest, &context);
+    if (length < 2 || !((s[0] >= 0x81 && s[0] <= 0x9f) || (s[0] >= 0xe0 && s[0] <= 0xfc)))
+    {
+        return 1;
+    }
+    return ((s[1] >= 0x40 && s[1] <= 0x7e) || (s[1] >= 0x80 && s[1] <= 0xfc)) ? 2 : 1;
 }
 
-//sha256
-static void mysql_sha2_password_with_nonce(char* ret, char* nonce, char* password, size_t password_len)
+static size_t mysql_mbcharlen_gb18030(const uint8_t *s, size_t length)
 {
-    // XOR(SHA256(password), SHA256(SHA256(SHA256(password)), nonce))
-    char hashed[32], double_hashed[32];
-    php_swoole_sha256(password, password_len, (unsigned char *) hashed);
-    php_swoole_sha256(hashed, 32, (unsigned char *) double_hashed);
-    char combined[32 + SW_MYSQL_NONCE_LENGTH]; //double-hashed + nonce
-    memcpy(combined, double_hashed, 32);
-    memcpy(combined + 32, nonce, SW_MYSQL_NONCE_LENGTH);
-    char xor_bytes[32];
-    php_swoole_sha256(combined, 32 + SW_MYSQL_NONCE_LENGTH, (unsigned char *) xor_bytes);
-    int i;
-    for (i = 0; i < 32; i++)
+    if (length < 2 || s[0] < 0x81 || s[0] > 0xfe)
     {
-        hashed[i] ^= xor_bytes[i];
+        return 1;
     }
-    memcpy(ret, hashed, 32);
+    if ((s[1] >= 0x40 && s[1] <= 0x7e) || (s[1] >= 0x80 && s[1] <= 0xfe))
+    {
+        return 2;
+    }
+    if (length >= 4 && s[1] >= 0x30 && s[1] <= 0x39 && s[2] >= 0x81 && s[2] <= 0xfe && s[3] >= 0x30 && s[3] <= 0x39)
+    {
+        return 4;
+    }
+    return 1;
 }
 
-/**
- * Return: password length
- */
+static mysql_mbcharlen mysql_get_mbcharlen(uint8_t charset)
+{
+    switch (charset)
+    {
+    // big5_chinese_ci, big5_bin
+    case 1:
+    case 84:
+        return mysql_mbcharlen_big5;
+    // gbk_chinese_ci, gbk_bin
+    case 28:
+    case 87:
+        return mysql_mbcharlen_gbk;
+    // sjis_japanese_ci, sjis_bin, cp932_japanese_ci, cp932_bin
+    case 13:
+    case 88:
+    case 95:
+    case 96:
+        return mysql_mbcharlen_sjis;
+    // gb18030_chinese_ci, gb18030_bin, gb18030_unicode_520_ci
+    case 248:
+    case 249:
+    case 250:
+        return mysql_mbcharlen_gb18030;
+    default:
+        return NULL;
+    }
+}
+
+static sw_inline zend_bool mysql_escape_needed(char c, zend_bool no_backslash_escapes)
+{
+    if (no_backslash_escapes)
+    {
+        return c == '\'';
+    }
+    switch (c)
+    {
+    case '\0':
+    case '\n':
+    case '\r':
+    case '\032':
+    case '\\':
+    case '\'':
+    case '"':
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+#if defined(__AVX2__)
+#define MYSQL_ESCAPE_MATCH(v, c)  _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c))
+#endif
+
+/**
+ * the offset of the first byte to be escaped, or of the first non-ASCII byte when the charset is multibyte,
+ * the bytes are compared 32 (AVX2) or 16 (SSE2) at a time
+ */
+static size_t mysql_escape_scan(const char *str, size_t length, zend_bool no_backslash_escapes, zend_bool multibyte)
+{
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (str + i));
+        __m256i m = MYSQL_ESCAPE_MATCH(v, '\'');
+        if (!no_backslash_escapes)
+        {
+            m = _mm256_or_si256(m, _mm256_or_si256(MYSQL_ESCAPE_MATCH(v, '\\'), MYSQL_ESCAPE_MATCH(v, '"')));
+            m = _mm256_or_si256(m, _mm256_or_si256(MYSQL_ESCAPE_MATCH(v, '\0'), MYSQL_ESCAPE_MATCH(v, '\032')));
+            m = _mm256_or_si256(m, _mm256_or_si256(MYSQL_ESCAPE_MATCH(v, '\n'), MYSQL_ESCAPE_MATCH(v, '\r')));
+        }
+        uint32_t mask = (uint32_t) _mm256_movemask_epi8(m);
+        if (multibyte)
+        {
+            // the high bit of every byte
+            mask |= (uint32_t) _mm256_movemask_epi8(v);
+        }
+        if (mask)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('\''), backslash = _mm_set1_epi8('\\'), dquote = _mm_set1_epi8('"');
+    const __m128i nul = _mm_setzero_si128(), ctrl_z = _mm_set1_epi8('\032');
+    const __m128i lf = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *) (str + i));
+        __m128i m = _mm_cmpeq_epi8(v, quote);
+        if (!no_backslash_escapes)
+        {
+            m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, backslash), _mm_cmpeq_epi8(v, dquote)));
+            m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, nul), _mm_cmpeq_epi8(v, ctrl_z)));
+            m = _mm_or_si128(m, _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        }
+        uint32_t mask = (uint32_t) _mm_movemask_epi8(m);
+        if (multibyte)
+        {
+            mask |= (uint32_t) _mm_movemask_epi8(v);
+        }
+        if (mask)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; i < length; i++)
+    {
+        if (mysql_escape_needed(str[i], no_backslash_escapes) || (multibyte && (uint8_t) str[i] >= 0x80))
+        {
+            break;
+        }
+    }
+    return i;
+}
+
+/**
+ * append the string escaped in the charset of the connection, with NO_BACKSLASH_ESCAPES only the quotes are doubled
+ */
+static int mysql_escape_append(swString *buffer, const char *str, size_t length, mysql_connector *connector)
+{
+    zend_bool no_backslash_escapes = (connector->server_status & SW_MYSQL_SERVER_STATUS_NO_BACKSLASH_ESCAPES) != 0;
+    mysql_mbcharlen mbcharlen = mysql_get_mbcharlen((uint8_t) connector->character_set);
+    size_t n, size = buffer->length + length * 2 + 2;
+    char *p;
+
+    if (size > buffer->size && swString_extend(buffer, MAX(size, buffer->size * 2)) < 0)
+    {
+        return SW_ERR;
+    }
+    p = buffer->str + buffer->length;
+    while (length > 0)
+    {
+        // the bytes which need nothing are copied at once
+        n = mysql_escape_scan(str, length, no_backslash_escapes, mbcharlen != NULL);
+        memcpy(p, str, n);
+        p += n;
+        str += n;
+        length -= n;
+        if (length == 0)
+        {
+            break;
+        }
+        if (mbcharlen && (n = mbcharlen((const uint8_t *) str, length)) > 1)
+        {
+            memcpy(p, str, n);
+            p += n;
+            str += n;
+            length -= n;
+            continue;
+        }
+        if (no_backslash_escapes)
+        {
+            if (*str == '\'')
+            {
+                *p++ = '\'';
+            }
+            *p++ = *str++;
+            length--;
+            continue;
+        }
+        switch (*str)
+        {
+        case '\0':
+            *p++ = '\\';
+            *p++ = '0';
+            break;
+        case '\n':
+            *p++ = '\\';
+            *p++ = 'n';
+            break;
+        case '\r':
+            *p++ = '\\';
+            *p++ = 'r';
+            break;
+        case '\032':
+            *p++ = '\\';
+            *p++ = 'Z';
+            break;
+        case '\\':
+        case '\'':
+        case '"':
+            *p++ = '\\';
+            *p++ = *str;
+            break;
+        default:
+            *p++ = *str;
+            break;
+        }
+        str++;
+        length--;
+    }
+    buffer->length = p - buffer->str;
+    return SW_OK;
+}
+
+/**
+ * append the string as a quoted SQL literal
+ */
+static int mysql_escape_string(swString *buffer, const char *str, size_t length, mysql_connector *connector)
+{
+    if (swString_append_ptr(buffer, ZEND_STRL("'")) < 0 || mysql_escape_append(buffer, str, length, connector) < 0)
+    {
+        return SW_ERR;
+    }
+    return swString_append_ptr(buffer, ZEND_STRL("'"));
+}
+
+/**
+ * append the scalar as a SQL literal
+ */
+static int mysql_escape_value(swString *buffer, zval *value, mysql_connector *connector)
+{
+    char buf[64];
+    int n;
+
+    ZVAL_DEREF(value);
+    switch (Z_TYPE_P(value))
+    {
+    case IS_NULL:
+        return swString_append_ptr(buffer, ZEND_STRL("NULL"));
+    case IS_FALSE:
+        return swString_append_ptr(buffer, ZEND_STRL("0"));
+    case IS_TRUE:
+        return swString_append_ptr(buffer, ZEND_STRL("1"));
+    case IS_LONG:
+        n = snprintf(buf, sizeof(buf), ZEND_LONG_FMT, Z_LVAL_P(value));
+        return swString_append_ptr(buffer, buf, n);
+    case IS_DOUBLE:
+        if (!zend_finite(Z_DVAL_P(value)))
+        {
+            php_swoole_fatal_error(E_WARNING, "INF and NAN can not be inserted.");
+            return SW_ERR;
+        }
+        n = snprintf(buf, sizeof(buf), "%.17g", Z_DVAL_P(value));
+        return swString_append_ptr(buffer, buf, n);
+    case IS_STRING:
+        return mysql_escape_string(buffer, Z_STRVAL_P(value), Z_STRLEN_P(value), connector);
+    case IS_OBJECT:
+    {
+        zend_string *str = zval_get_string(value);
+        int ret = EG(exception) ? SW_ERR : mysql_escape_string(buffer, ZSTR_VAL(str), ZSTR_LEN(str), connector);
+        zend_string_release(str);
+        return ret;
+    }
+    default:
+        php_swoole_fatal_error(E_WARNING, "value of type %s can not be inserted.", zend_zval_type_name(value));
+        return SW_ERR;
+    }
+}
+
+/**
+ * append the name quoted with backticks, `db`.`table` when it is qualified
+ */
+static int mysql_escape_identifier(swString *buffer, const char *str, size_t length)
+{
+    size_t i;
+
+    if (swString_append_ptr(buffer, ZEND_STRL("`")) < 0)
+    {
+        return SW_ERR;
+    }
+    for (i = 0; i < length; i++)
+    {
+        if (str[i] == '.')
+        {
+            if (swString_append_ptr(buffer, ZEND_STRL("`.`")) < 0)
+            {
+                return SW_ERR;
+            }
+            continue;
+        }
+        if (str[i] == '`' && swString_append_ptr(buffer, ZEND_STRL("`")) < 0)
+        {
+            return SW_ERR;
+        }
+        if (swString_append_ptr(buffer, (char *) str + i, 1) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    return swString_append_ptr(buffer, ZEND_STRL("`"));
+}
+
+/**
+ * COM_STMT_EXECUTE payload after the command byte, the parameters are always bound with their types,
+ * the values of the long data parameters have been sent before
+ */
+static int mysql_execute_pack(swString *buffer, mysql_statement *stmt, HashTable *params, uint8_t flags, HashTable *long_data)
+{
+    int i = 0;
+    size_t null_offset = 9, types_offset;
+    char buf[9];
+    zval *value;
+    zend_string *str;
+
+    swString_clear(buffer);
+    if (buffer->size < 10 + stmt->param_count * 3 && swString_extend(buffer, 10 + stmt->param_count * 3) < 0)
+    {
+        return SW_ERR;
+    }
+    // int<4> stmt-id, int<1> flags, int<4> iteration-count
+    mysql_int4store(buffer->str, stmt->id);
+    buffer->str[4] = flags;
+    mysql_int4store(buffer->str + 5, 1);
+    buffer->length = 9;
+    if (stmt->param_count == 0)
+    {
+        return SW_OK;
+    }
+
+    // NULL-bitmap, int<1> new-params-bound-flag, the types of the parameters
+    types_offset = null_offset + (stmt->param_count + 7) / 8 + 1;
+    bzero(buffer->str + null_offset, types_offset - null_offset);
+    buffer->str[types_offset - 1] = 1;
+    buffer->length = types_offset + stmt->param_count * 2;
+
+    ZEND_HASH_FOREACH_VAL(params, value)
+    {
+        uint8_t type;
+        ZVAL_DEREF(value);
+        if (long_data && zend_hash_index_exists(long_data, i))
+        {
+            buffer->str[types_offset + i * 2] = SW_MYSQL_TYPE_LONG_BLOB;
+            buffer->str[types_offset + i * 2 + 1] = 0;
+            i++;
+            continue;
+        }
+        switch (Z_TYPE_P(value))
+        {
+        case IS_NULL:
+            buffer->str[null_offset + i / 8] |= 1 << (i % 8);
+            type = SW_MYSQL_TYPE_NULL;
+            break;
+        case IS_LONG:
+            type = SW_MYSQL_TYPE_LONGLONG;
+            mysql_int8store(buf, Z_LVAL_P(value));
+            swString_append_ptr(buffer, buf, 8);
+            break;
+        case IS_DOUBLE:
+            type = SW_MYSQL_TYPE_DOUBLE;
+            swString_append_ptr(buffer, (char *) &Z_DVAL_P(value), 8);
+            break;
+        case IS_FALSE:
+        case IS_TRUE:
+            type = SW_MYSQL_TYPE_TINY;
+            buf[0] = Z_TYPE_P(value) == IS_TRUE;
+            swString_append_ptr(buffer, buf, 1);
+            break;
+        default:
+            type = SW_MYSQL_TYPE_VAR_STRING;
+            str = zval_get_string(value);
+            swString_append_ptr(buffer, buf, mysql_write_lcb(buf, ZSTR_LEN(str)));
+            swString_append_ptr(buffer, ZSTR_VAL(str), ZSTR_LEN(str));
+            zend_string_release(str);
+            break;
+        }
+        buffer->str[types_offset + i * 2] = type;
+        buffer->str[types_offset + i * 2 + 1] = 0;
+        i++;
+    }
+    ZEND_HASH_FOREACH_END();
+
+    return SW_OK;
+}
+
+int mysql_get_result(mysql_connector *connector, char *buf, int len)
+{
+    char *tmp = buf;
+    uint32_t packet_length = mysql_uint3korr(tmp);
+    if (len < SW_MYSQL_PACKET_HEADER_SIZE + packet_length)
+    {
+        return 0;
+    }
+    //int packet_number = tmp[3];
+    tmp += SW_MYSQL_PACKET_HEADER_SIZE;
+
+    uint8_t opcode = *tmp;
+    tmp += 1;
+
+    //ERROR Packet
+    if (opcode == SW_MYSQL_PACKET_ERR)
+    {
+        swMysqlPacketDump(tmp - 5, SW_MYSQL_PACKET_HEADER_SIZE + packet_length, "Handshake ERR_Packet");
+        connector->error_code = *(uint16_t *) tmp;
+        connector->error_msg = tmp + 2;
+        connector->error_length = packet_length - 3;
+        return -1;
+    }
+    else
+    {
+        swMysqlPacketDump(tmp - 5, SW_MYSQL_PACKET_HEADER_SIZE + packet_length, "Handshake OK_Packet");
+        return 1;
+    }
+}
+
+static void php_swoole_sha256(const char *str, int _len, unsigned char *digest)
+{
+    PHP_SHA256_CTX context;
+    PHP_SHA256Init(&context);
+    PHP_SHA256Update(&context, (unsigned char *) str, _len);
+    PHP_SHA256Final(digest, &context);
+}
+
+//sha256
+static void mysql_sha2_password_with_nonce(char* ret, char* nonce, char* password, size_t password_len)
+{
+    // XOR(SHA256(password), SHA256(SHA256(SHA256(password)), nonce))
+    char hashed[32], double_hashed[32];
+    php_swoole_sha256(password, password_len, (unsigned char *) hashed);
+    php_swoole_sha256(hashed, 32, (unsigned char *) double_hashed);
+    char combined[32 + SW_MYSQL_NONCE_LENGTH]; //double-hashed + nonce
+    memcpy(combined, double_hashed, 32);
+    memcpy(combined + 32, nonce, SW_MYSQL_NONCE_LENGTH);
+    char xor_bytes[32];
+    php_swoole_sha256(combined, 32 + SW_MYSQL_NONCE_LENGTH, (unsigned char *) xor_bytes);
+    int i;
+    for (i = 0; i < 32; i++)
+    {
+        hashed[i] ^= xor_bytes[i];
+    }
+    memcpy(ret, hashed, 32);
+}
+
+/**
+ * Return: password length
+ */
 static int mysql_auth_encrypt_dispatch(char *buf, char *auth_plugin_name, char *password, size_t password_len, char* nonce, int *next_state)
 {
     if (!auth_plugin_name || strcasecmp("mysql_native_password", auth_plugin_name) == 0)
@@ -434,6 +1246,7 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
     tmp += (strlen(request.server_version) + 1);
     //4              connection id
     request.connection_id = *((int *) tmp);
+    connector->connection_id = request.connection_id;
     tmp += 4;
     //string[8]      auth-plugin-data-part-1
     memcpy(request.auth_plugin_data, tmp, 8);
@@ -452,6 +1265,7 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
         tmp += 1;
         //2              status flags
         memcpy(&request.status_flags, tmp, 2);
+        connector->server_status = request.status_flags;
         tmp += 2;
         //2              capability flags (upper 2 bytes)
         memcpy(((char *) (&request.capability_flags) + 2), tmp, 2);
@@ -467,9 +1281,7 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
         {
             int len = MAX(13, request.l_auth_plugin_data - 8);
             memcpy(request.auth_plugin_data + 8, tmp, len);
-#ifdef SW_MYSQL_RSA_SUPPORT
             memcpy(connector->auth_plugin_data, request.auth_plugin_data, SW_MYSQL_NONCE_LENGTH);
-#endif
             tmp += len;
         }
 
@@ -478,6 +1290,8 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
             request.auth_plugin_name = tmp;
             request.l_auth_plugin_name = MIN(strlen(tmp), len - (tmp - buf));
             swTraceLog(SW_TRACE_MYSQL_CLIENT, "use %s auth plugin", request.auth_plugin_name);
+            // COM_CHANGE_USER answers with the same plugin
+            snprintf(connector->auth_plugin_name, sizeof(connector->auth_plugin_name), "%.*s", request.l_auth_plugin_name, request.auth_plugin_name);
         }
     }
 
@@ -486,7 +1300,47 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
 
     //capability flags, CLIENT_PROTOCOL_41 always set
     value = SW_MYSQL_CLIENT_LONG_PASSWORD | SW_MYSQL_CLIENT_PROTOCOL_41 | SW_MYSQL_CLIENT_SECURE_CONNECTION
-            | SW_MYSQL_CLIENT_CONNECT_WITH_DB | SW_MYSQL_CLIENT_PLUGIN_AUTH | SW_MYSQL_CLIENT_MULTI_RESULTS;
+            | SW_MYSQL_CLIENT_CONNECT_WITH_DB | SW_MYSQL_CLIENT_PLUGIN_AUTH | SW_MYSQL_CLIENT_MULTI_RESULTS
+            | SW_MYSQL_CLIENT_LOCAL_FILES;
+    if (connector->multi_statements)
+    {
+        value |= SW_MYSQL_CLIENT_MULTI_STATEMENTS;
+    }
+    if (connector->compression)
+    {
+        if (request.capability_flags & SW_MYSQL_CLIENT_COMPRESS)
+        {
+            value |= SW_MYSQL_CLIENT_COMPRESS;
+        }
+        else
+        {
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "server does not support the compressed protocol");
+            connector->compression = 0;
+        }
+    }
+    if (request.capability_flags & SW_MYSQL_CLIENT_SESSION_TRACK)
+    {
+        value |= SW_MYSQL_CLIENT_SESSION_TRACK;
+    }
+    // no EOF_Packet after the column definitions, the rows end with an OK_Packet
+    if (request.capability_flags & SW_MYSQL_CLIENT_DEPRECATE_EOF)
+    {
+        value |= SW_MYSQL_CLIENT_DEPRECATE_EOF;
+    }
+#ifdef SW_USE_OPENSSL
+    if (connector->ssl_ctx)
+    {
+        if (!(request.capability_flags & SW_MYSQL_CLIENT_SSL))
+        {
+            connector->error_code = 2026; // CR_SSL_CONNECTION_ERROR
+            connector->error_msg = "server does not support SSL connections";
+            connector->error_length = strlen(connector->error_msg);
+            return -1;
+        }
+        value |= SW_MYSQL_CLIENT_SSL;
+    }
+#endif
+    connector->capability_flags = value;
     memcpy(tmp, &value, sizeof(value));
     tmp += 4;
 
@@ -494,7 +1348,7 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
         request.protocol_version, request.server_version, request.capability_flags, request.status_flags, value);
 
     //max-packet size
-    value = 300;
+    value = connector->max_packet_size;
     memcpy(tmp, &value, sizeof(value));
     tmp += 4;
 
@@ -548,7 +1402,8 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len)
 
     connector->packet_length = tmp - connector->buf - 4;
     mysql_pack_length(connector->packet_length, connector->buf);
-    connector->buf[3] = 1;
+    // after the SSLRequest
+    connector->buf[3] = (connector->capability_flags & SW_MYSQL_CLIENT_SSL) ? 2 : 1;
 
     swMysqlPacketDump(connector->buf, SW_MYSQL_PACKET_HEADER_SIZE + connector->packet_length, "Protocol::HandshakeResponse41");
 
@@ -605,6 +1460,9 @@ int mysql_auth_switch(mysql_connector *connector, char *buf, int len)
     // string    auth plugin data
     char auth_plugin_data[20];
     memcpy((char *)auth_plugin_data, tmp, 20);
+    // the new challenge is the one of the RSA auth
+    memcpy(connector->auth_plugin_data, auth_plugin_data, SW_MYSQL_NONCE_LENGTH);
+    snprintf(connector->auth_plugin_name, sizeof(connector->auth_plugin_name), "%s", auth_plugin_name);
 
     // create auth switch response packet
     connector->packet_length += mysql_auth_encrypt_dispatch(
@@ -666,36 +1524,65 @@ int mysql_parse_auth_signature(swString *buffer, mysql_connector *connector)
 }
 
 #ifdef SW_MYSQL_RSA_SUPPORT
-//  Caching sha2 authentication. Public key request and send encrypted password
-// http://dev.mysql.com/doc/internals/en/connection-phase-packets.html#packet-Protocol::AuthSwitchResponse
-int mysql_parse_rsa(mysql_connector *connector, char *buf, int len)
+/**
+ * the public keys of the servers by "host:port", a reconnection (or COM_CHANGE_USER) that needs
+ * the full caching_sha2_password authentication saves the round trip and the parsing of the key
+ */
+static HashTable *mysql_rsa_keys = NULL;
+
+static void mysql_rsa_key_dtor(zval *zv)
 {
-    // clear
-    connector->packet_length = 0;
-    memset(connector->buf, 0, 512);
+    RSA_free(Z_PTR_P(zv));
+}
 
-    char *tmp = buf;
+static size_t mysql_rsa_key_name(mysql_connector *connector, char *buf, size_t size)
+{
+    int n = snprintf(buf, size, "%s:%ld", connector->host, connector->port);
+    return MIN(n, size - 1);
+}
 
-    uint32_t packet_length = mysql_uint3korr(tmp);
-    //continue to wait for data
-    if (len < SW_MYSQL_PACKET_HEADER_SIZE + packet_length)
+static RSA* mysql_rsa_key_find(mysql_connector *connector)
+{
+    char name[256];
+
+    if (!mysql_rsa_keys)
     {
-        return SW_AGAIN;
+        return NULL;
     }
-    int packet_number = tmp[3];
-    tmp += SW_MYSQL_PACKET_HEADER_SIZE;
+    return zend_hash_str_find_ptr(mysql_rsa_keys, name, mysql_rsa_key_name(connector, name, sizeof(name)));
+}
 
-    int rsa_public_key_length = packet_length;
-    while (tmp[0] != 0x2d)
+static void mysql_rsa_key_add(mysql_connector *connector, RSA *public_rsa)
+{
+    char name[256];
+
+    if (!mysql_rsa_keys)
     {
-        tmp++; // ltrim
-        rsa_public_key_length--;
+        mysql_rsa_keys = pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(mysql_rsa_keys, 8, NULL, mysql_rsa_key_dtor, 1);
     }
-    char rsa_public_key[rsa_public_key_length + 1]; //rsa + '\0'
-    memcpy((char *)rsa_public_key, tmp, rsa_public_key_length);
-    rsa_public_key[rsa_public_key_length] = '\0';
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "rsa-length=%d;\nrsa-key=[%.*s]", rsa_public_key_length, rsa_public_key_length, rsa_public_key);
+    zend_hash_str_update_ptr(mysql_rsa_keys, name, mysql_rsa_key_name(connector, name, sizeof(name)), public_rsa);
+}
 
+/**
+ * the server may have another key, e.g. another server has taken over its address
+ */
+static void mysql_rsa_key_del(mysql_connector *connector)
+{
+    char name[256];
+
+    connector->rsa_key_cached = 0;
+    if (mysql_rsa_keys)
+    {
+        zend_hash_str_del(mysql_rsa_keys, name, mysql_rsa_key_name(connector, name, sizeof(name)));
+    }
+}
+
+/**
+ * the password XOR the challenge, encrypted with the public key of the server
+ */
+static int mysql_rsa_encrypt(mysql_connector *connector, RSA *public_rsa, uint8_t packet_number)
+{
     int password_len = connector->password_len + 1;
     unsigned char password[password_len];
     // copy to stack
@@ -709,28 +1596,13 @@ int mysql_parse_rsa(mysql_connector *connector, char *buf, int len)
         password[i] ^= connector->auth_plugin_data[i % SW_MYSQL_NONCE_LENGTH];
     }
 
-    // prepare RSA public key
-    BIO *bio = NULL;
-    RSA *public_rsa = NULL;
-    if (unlikely((bio = BIO_new_mem_buf((void *)rsa_public_key, -1)) == NULL))
-    {
-        swWarn("BIO_new_mem_buf publicKey error!");
-        return SW_ERR;
-    }
-    // PEM_read_bio_RSA_PUBKEY
-    ERR_clear_error();
-    if (unlikely((public_rsa = PEM_read_bio_RSA_PUBKEY(bio, NULL, NULL, NULL)) == NULL))
+    // encrypt with RSA public key
+    int rsa_len = RSA_size(public_rsa);
+    if ((size_t) rsa_len > sizeof(connector->buf) - SW_MYSQL_PACKET_HEADER_SIZE)
     {
-        ERR_load_crypto_strings();
-        char err_buf[512];
-        ERR_error_string_n(ERR_get_error(), err_buf, sizeof(err_buf));
-        swWarn("[PEM_read_bio_RSA_PUBKEY ERROR]: %s", err_buf);
-
+        swWarn("RSA key of %d bits is not supported.", rsa_len * 8);
         return SW_ERR;
     }
-    BIO_free_all(bio);
-    // encrypt with RSA public key
-    int rsa_len = RSA_size(public_rsa);
     unsigned char encrypt_msg[rsa_len];
     // RSA_public_encrypt
     ERR_clear_error();
@@ -745,7 +1617,6 @@ int mysql_parse_rsa(mysql_connector *connector, char *buf, int len)
         swWarn("[RSA_public_encrypt ERROR]: %s", err_buf);
         return SW_ERR;
     }
-    RSA_free(public_rsa);
 
     memcpy((char *)connector->buf + 4, (char *)encrypt_msg, rsa_len); // copy rsa to buf
     connector->packet_length = rsa_len;
@@ -753,2254 +1624,5439 @@ int mysql_parse_rsa(mysql_connector *connector, char *buf, int len)
     // 3 for packet length
     mysql_pack_length(connector->packet_length, connector->buf);
     // 1 packet number
-    connector->buf[3] = packet_number + 1;
+    connector->buf[3] = packet_number;
 
     return SW_OK;
 }
-#endif
 
-static int mysql_parse_prepare_result(mysql_client *client, char *buf, size_t n_buf)
+//  Caching sha2 authentication. Public key request and send encrypted password
+// http://dev.mysql.com/doc/internals/en/connection-phase-packets.html#packet-Protocol::AuthSwitchResponse
+int mysql_parse_rsa(mysql_connector *connector, char *buf, int len)
 {
-    // not COM_STMT_PREPARE_OK packet
-    if ((uint8_t) buf[4] != SW_MYSQL_PACKET_OK || client->cmd != SW_MYSQL_COM_STMT_PREPARE || client->response.packet_length < 12)
+    // clear
+    connector->packet_length = 0;
+    memset(connector->buf, 0, 512);
+
+    char *tmp = buf;
+
+    uint32_t packet_length = mysql_uint3korr(tmp);
+    //continue to wait for data
+    if (len < SW_MYSQL_PACKET_HEADER_SIZE + packet_length)
     {
-        return SW_ERR;
+        return SW_AGAIN;
     }
+    int packet_number = tmp[3];
+    tmp += SW_MYSQL_PACKET_HEADER_SIZE;
 
-    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "COM_STMT_PREPARE_OK_Packet");
+    int rsa_public_key_length = packet_length;
+    while (tmp[0] != 0x2d)
+    {
+        tmp++; // ltrim
+        rsa_public_key_length--;
+    }
+    char rsa_public_key[rsa_public_key_length + 1]; //rsa + '\0'
+    memcpy((char *)rsa_public_key, tmp, rsa_public_key_length);
+    rsa_public_key[rsa_public_key_length] = '\0';
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "rsa-length=%d;\nrsa-key=[%.*s]", rsa_public_key_length, rsa_public_key_length, rsa_public_key);
 
-    // skip the packet header
-    buf += SW_MYSQL_PACKET_HEADER_SIZE;
+    // prepare RSA public key
+    BIO *bio = NULL;
+    RSA *public_rsa = NULL;
+    if (unlikely((bio = BIO_new_mem_buf((void *)rsa_public_key, -1)) == NULL))
+    {
+        swWarn("BIO_new_mem_buf publicKey error!");
+        return SW_ERR;
+    }
+    // PEM_read_bio_RSA_PUBKEY
+    ERR_clear_error();
+    if (unlikely((public_rsa = PEM_read_bio_RSA_PUBKEY(bio, NULL, NULL, NULL)) == NULL))
+    {
+        ERR_load_crypto_strings();
+        char err_buf[512];
+        ERR_error_string_n(ERR_get_error(), err_buf, sizeof(err_buf));
+        swWarn("[PEM_read_bio_RSA_PUBKEY ERROR]: %s", err_buf);
+        BIO_free_all(bio);
+        return SW_ERR;
+    }
+    BIO_free_all(bio);
 
-    mysql_statement *stmt = emalloc(sizeof(mysql_statement));
-    // status (1) -- [00] OK
-    buf += 1;
+    if (mysql_rsa_encrypt(connector, public_rsa, packet_number + 1) < 0)
+    {
+        RSA_free(public_rsa);
+        return SW_ERR;
+    }
+    mysql_rsa_key_add(connector, public_rsa);
 
-    // statement_id (4) -- statement-id
-    stmt->id = mysql_uint4korr(buf);
-    buf += 4;
+    return SW_OK;
+}
+#endif
 
-    // num_columns (2) -- number of columns
-    stmt->field_count = mysql_uint2korr(buf);
-    buf += 2;
+#ifdef SW_USE_OPENSSL
+/**
+ * the contexts by their options, and the sessions by "host:port" and context, a reconnection resumes
+ * the session of the previous one instead of the full TLS handshake
+ */
+static HashTable *mysql_ssl_contexts = NULL;
+static HashTable *mysql_ssl_sessions = NULL;
 
-    // num_params (2) -- number of params
-    stmt->unreaded_param_count = stmt->param_count = mysql_uint2korr(buf);
-    buf += 2;
+static void mysql_ssl_context_dtor(zval *zv)
+{
+    SSL_CTX_free(Z_PTR_P(zv));
+}
 
-    // reserved_1 (1) -- [00] filler
-    buf += 1;
+static void mysql_ssl_session_dtor(zval *zv)
+{
+    SSL_SESSION_free(Z_PTR_P(zv));
+}
 
-    // warning_count (2) -- number of warnings
-    stmt->warning_count = mysql_uint2korr(buf);
-    stmt->result = NULL;
-    stmt->buffer = NULL;
-    client->statement = stmt;
-    stmt->client = client;
+static size_t mysql_ssl_session_name(mysql_connector *connector, char *buf, size_t size)
+{
+    int n = snprintf(buf, size, "%s:%ld@%p", connector->host, connector->port, (void *) connector->ssl_ctx);
+    return MIN(n, size - 1);
+}
 
-    MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+static SSL_SESSION* mysql_ssl_session_find(mysql_connector *connector)
+{
+    char name[256];
 
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "stmt_id=%u, field_count=%u, param_count=%u, warning_count=%u.", stmt->id,
-            stmt->field_count, stmt->param_count, stmt->warning_count);
+    if (!mysql_ssl_sessions)
+    {
+        return NULL;
+    }
+    return zend_hash_str_find_ptr(mysql_ssl_sessions, name, mysql_ssl_session_name(connector, name, sizeof(name)));
+}
 
-    return SW_OK;
+static void mysql_ssl_session_del(mysql_connector *connector)
+{
+    char name[256];
+
+    if (mysql_ssl_sessions)
+    {
+        zend_hash_str_del(mysql_ssl_sessions, name, mysql_ssl_session_name(connector, name, sizeof(name)));
+    }
 }
 
-static zend_string* mysql_decode_big_data(mysql_big_data_info *mbdi)
+/**
+ * with TLS 1.3 the tickets come after the handshake, the last one is kept
+ */
+static int mysql_ssl_onNewSession(SSL *ssl, SSL_SESSION *session)
 {
-    // through ext_packet_num to calc read_n += ?
-    mbdi->ext_header_len = SW_MYSQL_PACKET_HEADER_SIZE * (((mbdi->len - mbdi->currrent_packet_remaining_size) / SW_MYSQL_MAX_PACKET_BODY_SIZE) + 1);
-    if (mbdi->ext_header_len + mbdi->len > mbdi->remaining_size)
+    mysql_client *client = SSL_get_app_data(ssl);
+    char name[256];
+
+    if (!client || !client->connector.host)
     {
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "big packet need %lu, but only %lu", mbdi->ext_header_len + mbdi->len, mbdi->remaining_size);
-        return NULL;
+        return 0;
     }
-    else
+    if (!mysql_ssl_sessions)
     {
-        // optimization: allocate a complete piece of memory at once
-        zend_string* zstring = zend_string_alloc(mbdi->len, 0);;
-        size_t write_s = 0, write_n = 0;
-        char *read_p, *write_p;
-        read_p = mbdi->read_p;
-        write_p = ZSTR_VAL(zstring);
-        // copy the remaining data of the current packet
-        write_s = mbdi->currrent_packet_remaining_size;
-        memcpy(write_p, read_p, write_s);
-        read_p += write_s;
-        write_p += write_s;
-        write_n += write_s;
-        while (write_n < mbdi->len) // copy the next... packet
-        {
-            uint32_t _packet_len = mysql_uint3korr(read_p);
-            mbdi->ext_packet_len += _packet_len;
-            write_s = MIN(_packet_len, mbdi->len - write_n);
-            memcpy(write_p, read_p + SW_MYSQL_PACKET_HEADER_SIZE, write_s);
-            read_p += SW_MYSQL_PACKET_HEADER_SIZE + write_s;
-            write_p += write_s;
-            write_n += write_s;
-        }
-        ZSTR_VAL(zstring)[mbdi->len] = '\0';
-        SW_ASSERT(ZSTR_VAL(zstring) + mbdi->len == write_p);
-        return zstring;
+        mysql_ssl_sessions = pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(mysql_ssl_sessions, 8, NULL, mysql_ssl_session_dtor, 1);
     }
+    zend_hash_str_update_ptr(mysql_ssl_sessions, name, mysql_ssl_session_name(&client->connector, name, sizeof(name)), session);
+    return 1;
 }
 
-static ssize_t mysql_decode_row(mysql_client *client, char *buf, uint32_t packet_length, size_t n_buf)
+static void mysql_ssl_error_string(char *buf, size_t size, const char *what)
 {
-    int i;
-    int tmp_len;
-    ulong_t len;
-    char nul;
-    mysql_row row;
-    char value_buffer[32];
-    char *error;
-    ssize_t read_n = 0;
-    zend_string *zstring = NULL;
-    zval *result_array = client->response.result_array;
-    zval *row_array = sw_malloc_zval();
+    unsigned long error = ERR_get_error();
+    snprintf(buf, size, "%s: %s", what, error ? ERR_reason_error_string(error) : "unknown error");
+    ERR_clear_error();
+}
 
-    bzero(&row, sizeof(row));
-    array_init(row_array);
+/**
+ * ssl_cert_file, ssl_key_file, ssl_cafile, ssl_capath and ssl_verify_peer of the connect options
+ */
+static SSL_CTX* mysql_ssl_context_get(HashTable *_ht, char *error, size_t size)
+{
+    zval *value;
+    const char *cert_file = NULL, *key_file = NULL, *cafile = NULL, *capath = NULL;
+    zend_bool verify_peer = 0;
+    char name[PATH_MAX * 4 + 8];
+    size_t length;
+    SSL_CTX *ctx;
 
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "mysql_decode_row begin, num_column=%ld, packet_length=%u.", client->response.num_column, packet_length);
+    if (php_swoole_array_get_value(_ht, "ssl_cert_file", value) && Z_TYPE_P(value) == IS_STRING)
+    {
+        cert_file = Z_STRVAL_P(value);
+    }
+    if (php_swoole_array_get_value(_ht, "ssl_key_file", value) && Z_TYPE_P(value) == IS_STRING)
+    {
+        key_file = Z_STRVAL_P(value);
+    }
+    if (php_swoole_array_get_value(_ht, "ssl_cafile", value) && Z_TYPE_P(value) == IS_STRING)
+    {
+        cafile = Z_STRVAL_P(value);
+    }
+    if (php_swoole_array_get_value(_ht, "ssl_capath", value) && Z_TYPE_P(value) == IS_STRING)
+    {
+        capath = Z_STRVAL_P(value);
+    }
+    if (php_swoole_array_get_value(_ht, "ssl_verify_peer", value))
+    {
+        verify_peer = zval_is_true(value);
+    }
 
-    mysql_field *field = NULL;
+    length = MIN(snprintf(name, sizeof(name), "%s|%s|%s|%s|%d", cert_file ? cert_file : "", key_file ? key_file : "",
+            cafile ? cafile : "", capath ? capath : "", verify_peer), sizeof(name) - 1);
+    if (mysql_ssl_contexts && (ctx = zend_hash_str_find_ptr(mysql_ssl_contexts, name, length)))
+    {
+        return ctx;
+    }
 
-    for (i = 0; i < client->response.num_column; i++)
+    ERR_clear_error();
+    if (!(ctx = SSL_CTX_new(SSLv23_client_method())))
     {
-        tmp_len = mysql_length_coded_binary(&buf[read_n], &len, &nul, packet_length - read_n);
-        if (tmp_len == -1)
-        {
-            swWarn("mysql response parse error: bad lcb, tmp_len=%d", tmp_len);
-            read_n = -SW_MYSQL_ERR_BAD_LCB;
-            goto _error;
-        }
-        read_n += tmp_len;
+        mysql_ssl_error_string(error, size, "SSL_CTX_new failed");
+        return NULL;
+    }
+    SSL_CTX_set_options(ctx, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3 | SSL_OP_NO_TLSv1 | SSL_OP_NO_TLSv1_1);
+    // the sessions are kept by mysql_ssl_onNewSession
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, mysql_ssl_onNewSession);
 
-        // WARNING: data may be longer than single packet (0x00fffff => 16M)
-        if (unlikely(len > packet_length - read_n))
+    if (verify_peer)
+    {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+        if ((cafile || capath) ? !SSL_CTX_load_verify_locations(ctx, cafile, capath) : !SSL_CTX_set_default_verify_paths(ctx))
         {
-            mysql_big_data_info mbdi = { len, n_buf - read_n, packet_length - read_n, buf + read_n, 0, 0 };
-            if ((zstring = mysql_decode_big_data(&mbdi)))
-            {
-                read_n += mbdi.ext_header_len;
-                packet_length += mbdi.ext_header_len + mbdi.ext_packet_len;
-            }
-            else
-            {
-                read_n = SW_AGAIN;
-                goto _error;
-            }
+            mysql_ssl_error_string(error, size, "failed to load the CA certificates");
+            SSL_CTX_free(ctx);
+            return NULL;
         }
+    }
+    else
+    {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+    }
+    if (cert_file && SSL_CTX_use_certificate_chain_file(ctx, cert_file) != 1)
+    {
+        mysql_ssl_error_string(error, size, "failed to load the certificate");
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    if (key_file && (SSL_CTX_use_PrivateKey_file(ctx, key_file, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(ctx) != 1))
+    {
+        mysql_ssl_error_string(error, size, "failed to load the private key");
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
 
-        field = &client->response.columns[i];
-
-        if (nul == 1)
-        {
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "column#%d: name=%.*s, type=null", i, field->name_length, field->name);
-            add_assoc_null(row_array, field->name);
-            continue;
-        }
+    if (!mysql_ssl_contexts)
+    {
+        mysql_ssl_contexts = pemalloc(sizeof(HashTable), 1);
+        zend_hash_init(mysql_ssl_contexts, 4, NULL, mysql_ssl_context_dtor, 1);
+    }
+    zend_hash_str_update_ptr(mysql_ssl_contexts, name, length, ctx);
+    return ctx;
+}
 
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "column#%d: name=%.*s, type=%d, value=%.*s, len=%lu", i, field->name_length, field->name, field->type, (int) len, buf + read_n, len);
+/**
+ * SSLRequest, the first 32 bytes of the HandshakeResponse with CLIENT_SSL, the rest of it is sent over TLS
+ */
+static int mysql_ssl_start(mysql_client *client, uint8_t next_state)
+{
+    mysql_connector *connector = &client->connector;
+    char request[SW_MYSQL_PACKET_HEADER_SIZE + 32];
+    SSL_SESSION *session;
+    static char error[256];
 
-        switch (field->type)
+    mysql_pack_length(32, request);
+    request[3] = 1;
+    memcpy(request + SW_MYSQL_PACKET_HEADER_SIZE, connector->buf + SW_MYSQL_PACKET_HEADER_SIZE, 32);
+    if (client->cli->send(client->cli, request, sizeof(request), 0) < 0)
+    {
+        connector->error_code = errno;
+        connector->error_msg = strerror(errno);
+        connector->error_length = strlen(connector->error_msg);
+        return SW_ERR;
+    }
+
+    ERR_clear_error();
+    if (!(client->ssl = SSL_new(connector->ssl_ctx)) || !SSL_set_fd(client->ssl, client->fd))
+    {
+        mysql_ssl_error_string(error, sizeof(error), "SSL_new failed");
+        goto _error;
+    }
+    SSL_set_app_data(client->ssl, client);
+    SSL_set_connect_state(client->ssl);
+#ifdef SSL_OP_ENABLE_KTLS
+    if (connector->ssl_ktls)
+    {
+        SSL_set_options(client->ssl, SSL_OP_ENABLE_KTLS);
+    }
+#endif
+    // SNI and the name of the certificate, not for the unix sockets, an IP address is not sent as SNI
+    if (connector->host[0] != '/')
+    {
+        struct in6_addr addr;
+        zend_bool is_ip = inet_pton(AF_INET, connector->host, &addr) == 1 || inet_pton(AF_INET6, connector->host, &addr) == 1;
+        if (!is_ip)
         {
-        case SW_MYSQL_TYPE_NULL:
-            add_assoc_null(row_array, field->name);
-            break;
-        /* String */
-        case SW_MYSQL_TYPE_TINY_BLOB:
-        case SW_MYSQL_TYPE_MEDIUM_BLOB:
-        case SW_MYSQL_TYPE_LONG_BLOB:
-        case SW_MYSQL_TYPE_BLOB:
-        case SW_MYSQL_TYPE_DECIMAL:
-        case SW_MYSQL_TYPE_NEWDECIMAL:
-        case SW_MYSQL_TYPE_BIT:
-        case SW_MYSQL_TYPE_STRING:
-        case SW_MYSQL_TYPE_VAR_STRING:
-        case SW_MYSQL_TYPE_VARCHAR:
-        case SW_MYSQL_TYPE_NEWDATE:
-        /* Date Time */
-        case SW_MYSQL_TYPE_TIME:
-        case SW_MYSQL_TYPE_YEAR:
-        case SW_MYSQL_TYPE_TIMESTAMP:
-        case SW_MYSQL_TYPE_DATETIME:
-        case SW_MYSQL_TYPE_DATE:
-        case SW_MYSQL_TYPE_JSON:
-            if (unlikely(zstring))
-            {
-                zval _zdata, *zdata = &_zdata;
-                ZVAL_STR(zdata, zstring);
-                add_assoc_zval(row_array, field->name, zdata);
-                zstring = NULL;
-            }
-            else
-            {
-                add_assoc_stringl(row_array, field->name, buf + read_n, len);
-            }
-            break;
-        /* Integer */
-        case SW_MYSQL_TYPE_TINY:
-        case SW_MYSQL_TYPE_SHORT:
-        case SW_MYSQL_TYPE_INT24:
-        case SW_MYSQL_TYPE_LONG:
-            if(client->connector.strict_type)
-            {
-                memcpy(value_buffer, buf + read_n, len);
-                value_buffer[len] = 0;
-                if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
-                {
-                    row.uint = strtoul(value_buffer, &error, 10);
-                    if (*error != '\0')
-                    {
-                        read_n = -SW_MYSQL_ERR_CONVLONG;
-                        goto _error;
-                    }
-                    add_assoc_long(row_array, field->name, row.uint);
-                }
-                else
-                {
-                    row.sint = strtol(value_buffer, &error, 10);
-                    if (*error != '\0')
-                    {
-                        read_n = -SW_MYSQL_ERR_CONVLONG;
-                        goto _error;
-                    }
-                    add_assoc_long(row_array, field->name, row.sint);
-                }
-            }
-            else
-            {
-                add_assoc_stringl(row_array, field->name, buf + read_n, len);
-            }
-            break;
-        case SW_MYSQL_TYPE_LONGLONG:
-            if(client->connector.strict_type) {
-                memcpy(value_buffer, buf + read_n, len);
-                value_buffer[len] = 0;
-                if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
-                {
-                    row.ubigint = strtoull(value_buffer, &error, 10);
-                    if (*error != '\0') {
-                        read_n = -SW_MYSQL_ERR_CONVLONGLONG;
-                        goto _error;
-                    }
-                    if (unlikely(row.ubigint > ZEND_LONG_MAX))
-                    {
-                        goto _longlongstring;
-                    }
-                    add_assoc_long(row_array, field->name, row.ubigint);
-                }
-                else
-                {
-                    row.sbigint = strtoll(value_buffer, &error, 10);
-                    if (*error != '\0') {
-                        read_n = -SW_MYSQL_ERR_CONVLONGLONG;
-                        goto _error;
-                    }
-                    add_assoc_long(row_array, field->name, row.sbigint);
-                }
-            }
-            else
+            SSL_set_tlsext_host_name(client->ssl, connector->host);
+        }
+        if (connector->ssl_verify_peer)
+        {
+            if (is_ip)
             {
-                _longlongstring:
-                add_assoc_stringl(row_array, field->name, buf + read_n, len);
-            }
-            break;
-        case SW_MYSQL_TYPE_FLOAT:
-            if(client->connector.strict_type) {
-                memcpy(value_buffer, buf + read_n, len);
-                value_buffer[len] = 0;
-                row.mdouble = strtod(value_buffer, &error);
-                if (*error != '\0') {
-                    read_n = -SW_MYSQL_ERR_CONVFLOAT;
-                    goto _error;
-                }
-                add_assoc_double(row_array, field->name, row.mdouble);
+                X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(client->ssl), connector->host);
             }
             else
             {
-                add_assoc_stringl(row_array, field->name, buf + read_n, len);
+                SSL_set1_host(client->ssl, connector->host);
             }
-            break;
+        }
+    }
+    if ((session = mysql_ssl_session_find(connector)))
+    {
+        SSL_set_session(client->ssl, session);
+    }
 
-        case SW_MYSQL_TYPE_DOUBLE:
-            if(client->connector.strict_type) {
-                memcpy(value_buffer, buf + read_n, len);
-                value_buffer[len] = 0;
-                row.mdouble = strtod(value_buffer, &error);
-                if (*error != '\0') {
-                    read_n = -SW_MYSQL_ERR_CONVDOUBLE;
-                    goto _error;
-                }
-                add_assoc_double(row_array, field->name, row.mdouble);
+    client->ssl_next_state = next_state;
+    client->handshake = SW_MYSQL_HANDSHAKE_WAIT_TLS;
+    return SW_OK;
+
+    _error:
+    connector->error_code = 2026; // CR_SSL_CONNECTION_ERROR
+    connector->error_msg = error;
+    connector->error_length = strlen(error);
+    return SW_ERR;
+}
+
+static void mysql_ssl_info(mysql_client *client)
+{
+    zval info;
+
+    array_init(&info);
+    add_assoc_string_ex(&info, ZEND_STRL("version"), (char *) SSL_get_version(client->ssl));
+    add_assoc_string_ex(&info, ZEND_STRL("cipher"), (char *) SSL_get_cipher_name(client->ssl));
+    add_assoc_bool_ex(&info, ZEND_STRL("session_reused"), SSL_session_reused(client->ssl));
+    add_assoc_bool_ex(&info, ZEND_STRL("ktls_send"), client->ktls_send);
+    add_assoc_bool_ex(&info, ZEND_STRL("ktls_recv"), client->ktls_recv);
+    zend_update_property(swoole_mysql_ce, client->object, ZEND_STRL("tlsInfo"), &info);
+    zval_ptr_dtor(&info);
+}
+
+/**
+ * a step of the TLS handshake, on the events of the socket
+ */
+static int mysql_ssl_handshake(mysql_client *client)
+{
+    mysql_connector *connector = &client->connector;
+    swConnection *_socket;
+    static char error[512];
+    int ret;
+
+    ERR_clear_error();
+    ret = SSL_connect(client->ssl);
+    if (ret != 1)
+    {
+        switch (SSL_get_error(client->ssl, ret))
+        {
+        case SSL_ERROR_WANT_READ:
+            SwooleG.main_reactor->set(SwooleG.main_reactor, client->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ);
+            return SW_OK;
+        case SSL_ERROR_WANT_WRITE:
+            SwooleG.main_reactor->set(SwooleG.main_reactor, client->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ | SW_EVENT_WRITE);
+            return SW_OK;
+        default:
+            if (SSL_get_verify_result(client->ssl) != X509_V_OK)
+            {
+                snprintf(error, sizeof(error), "TLS handshake failed: %s", X509_verify_cert_error_string(SSL_get_verify_result(client->ssl)));
+                ERR_clear_error();
             }
             else
             {
-                add_assoc_stringl(row_array, field->name, buf + read_n, len);
+                mysql_ssl_error_string(error, sizeof(error), "TLS handshake failed");
             }
-            break;
-
-        default:
-            swWarn("unknown field type[%d].", field->type);
-            read_n = SW_ERR;
-            _error:
-            zval_ptr_dtor(row_array);
-            efree(row_array);
-            return read_n;
+            // the session may be the cause
+            mysql_ssl_session_del(connector);
+            connector->error_code = 2026; // CR_SSL_CONNECTION_ERROR
+            connector->error_msg = error;
+            connector->error_length = strlen(error);
+            swoole_mysql_onConnect(client);
+            return SW_OK;
         }
-        read_n += len;
     }
+    SwooleG.main_reactor->set(SwooleG.main_reactor, client->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ);
 
-    add_next_index_zval(result_array, row_array);
+#ifdef BIO_get_ktls_send
+    client->ktls_send = BIO_get_ktls_send(SSL_get_wbio(client->ssl)) ? 1 : 0;
+    client->ktls_recv = BIO_get_ktls_recv(SSL_get_rbio(client->ssl)) ? 1 : 0;
+#endif
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "TLS established, version=%s, cipher=%s, reused=%d, ktls_send=%d, ktls_recv=%d",
+            SSL_get_version(client->ssl), SSL_get_cipher_name(client->ssl), SSL_session_reused(client->ssl), client->ktls_send, client->ktls_recv);
 
-    efree(row_array);
+    // the records of the handshake go through OpenSSL, those of the reactor only when the kernel does not encrypt them
+    client->cli->socket->ssl = client->ssl;
+    _socket = swReactor_get(SwooleG.main_reactor, client->fd);
+    _socket->ssl = client->ktls_send ? NULL : client->ssl;
+    mysql_ssl_info(client);
 
-    return read_n;
+    // the rest of the HandshakeResponse
+    if (client->cli->send(client->cli, connector->buf, connector->packet_length + SW_MYSQL_PACKET_HEADER_SIZE, 0) < 0)
+    {
+        connector->error_code = errno;
+        connector->error_msg = strerror(errno);
+        connector->error_length = strlen(connector->error_msg);
+        swoole_mysql_onConnect(client);
+        return SW_OK;
+    }
+    client->handshake = client->ssl_next_state;
+    return SW_OK;
 }
 
-static int mysql_decode_datetime(char *buf, char *result)
+static ssize_t mysql_ssl_recv(mysql_client *client, void *buf, size_t length)
 {
-    uint16_t y = 0;
-    uint8_t M = 0, d = 0, h = 0, m = 0, s = 0, n;
+    int n;
 
-    n = *(uint8_t *) (buf);
-    if (n != 0)
+    ERR_clear_error();
+    n = SSL_read(client->ssl, buf, length);
+    if (n > 0)
     {
-        y = *(uint16_t *) (buf + 1);
-        M = *(uint8_t *) (buf + 3);
-        d = *(uint8_t *) (buf + 4);
-        if (n > 4)
+        return n;
+    }
+    switch (SSL_get_error(client->ssl, n))
+    {
+    case SSL_ERROR_WANT_READ:
+    case SSL_ERROR_WANT_WRITE:
+        errno = EAGAIN;
+        return SW_ERR;
+    case SSL_ERROR_ZERO_RETURN:
+        return 0;
+    case SSL_ERROR_SYSCALL:
+        if (errno == 0)
         {
-            h = *(uint8_t *) (buf + 5);
-            m = *(uint8_t *) (buf + 6);
-            s = *(uint8_t *) (buf + 7);
+            return 0;
         }
+        return SW_ERR;
+    default:
+        swWarn("SSL_read() failed: %s", ERR_reason_error_string(ERR_get_error()));
+        errno = ECONNRESET;
+        return SW_ERR;
     }
-    snprintf(result, DATETIME_MAX_SIZE, "%04d-%02d-%02d %02d:%02d:%02d", y, M, d, h, m, s);
-
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n=%d", n);
-
-    return n;
 }
 
-static int mysql_decode_time(char *buf, char *result)
+/**
+ * close_notify, without waiting for the one of the server
+ */
+static void mysql_ssl_free(mysql_client *client)
 {
-    uint8_t h = 0, m = 0, s = 0;
+    swConnection *_socket;
 
-    uint8_t n = *(uint8_t *) (buf);
-    if (n != 0)
+    if (client->handshake == SW_MYSQL_HANDSHAKE_COMPLETED)
     {
-        h = *(uint8_t *) (buf + 6);
-        m = *(uint8_t *) (buf + 7);
-        s = *(uint8_t *) (buf + 8);
+        SSL_shutdown(client->ssl);
+    }
+    ERR_clear_error();
+    SSL_free(client->ssl);
+    client->ssl = NULL;
+    client->ktls_send = 0;
+    client->ktls_recv = 0;
+    client->cli->socket->ssl = NULL;
+    _socket = swReactor_get(SwooleG.main_reactor, client->fd);
+    if (_socket)
+    {
+        _socket->ssl = NULL;
     }
-
-    snprintf(result, DATETIME_MAX_SIZE, "%02d:%02d:%02d", h, m, s);
-
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n=%d", n);
-
-    return n;
 }
+#endif
 
-static int mysql_decode_date(char *buf, char *result)
+/**
+ * the public keys and the TLS contexts with their sessions are kept by the process for the reconnections
+ */
+void swoole_mysql_shutdown()
 {
-    uint8_t M = 0, d = 0, n;
-    uint16_t y = 0;
-
-    n = *(uint8_t *) (buf);
-    if (n != 0)
+#ifdef SW_MYSQL_RSA_SUPPORT
+    if (mysql_rsa_keys)
     {
-        y = *(uint16_t *) (buf + 1);
-        M = *(uint8_t *) (buf + 3);
-        d = *(uint8_t *) (buf + 4);
+        zend_hash_destroy(mysql_rsa_keys);
+        pefree(mysql_rsa_keys, 1);
+        mysql_rsa_keys = NULL;
     }
-    snprintf(result, DATETIME_MAX_SIZE, "%04d-%02d-%02d", y, M, d);
-
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n=%d", n);
+#endif
+#ifdef SW_USE_OPENSSL
+    // the sessions are named after their contexts
+    if (mysql_ssl_sessions)
+    {
+        zend_hash_destroy(mysql_ssl_sessions);
+        pefree(mysql_ssl_sessions, 1);
+        mysql_ssl_sessions = NULL;
+    }
+    if (mysql_ssl_contexts)
+    {
+        zend_hash_destroy(mysql_ssl_contexts);
+        pefree(mysql_ssl_contexts, 1);
+        mysql_ssl_contexts = NULL;
+    }
+#endif
+}
 
-    return n;
+/**
+ * all the data received after the handshake comes through here
+ */
+static ssize_t mysql_client_recv(mysql_client *client, void *buf, size_t length)
+{
+#ifdef SW_USE_OPENSSL
+    if (client->ssl)
+    {
+        // the kernel has decrypted the records, unless the next one is not application data, e.g. a TLS 1.3 ticket
+        if (client->ktls_recv && SSL_pending(client->ssl) == 0)
+        {
+            ssize_t n = recv(client->fd, buf, length, 0);
+            if (!(n < 0 && errno == EIO))
+            {
+                return n;
+            }
+        }
+        return mysql_ssl_recv(client, buf, length);
+    }
+#endif
+    return recv(client->fd, buf, length, 0);
 }
 
-static void mysql_decode_year(char *buf, char *result)
+/**
+ * caching_sha2_password asks for the full authentication, the password is encrypted with the public key of the server,
+ * which is asked for unless it is known from a previous connection
+ * @return the next handshake state
+ */
+static int mysql_auth_full(mysql_connector *connector, uint8_t packet_number)
 {
-    uint16_t y = *(uint16_t *) (buf);
-    snprintf(result, DATETIME_MAX_SIZE, "%04d", y);
+#ifdef SW_USE_OPENSSL
+    // the channel is encrypted, the password is sent as it is
+    if (connector->ssl_ctx && connector->password_len < sizeof(connector->buf) - SW_MYSQL_PACKET_HEADER_SIZE)
+    {
+        connector->packet_length = connector->password_len + 1;
+        mysql_pack_length(connector->packet_length, connector->buf);
+        connector->buf[3] = packet_number;
+        memcpy(connector->buf + SW_MYSQL_PACKET_HEADER_SIZE, connector->password, connector->password_len);
+        connector->buf[SW_MYSQL_PACKET_HEADER_SIZE + connector->password_len] = '\0';
+        return SW_MYSQL_HANDSHAKE_WAIT_RESULT;
+    }
+#endif
+#ifdef SW_MYSQL_RSA_SUPPORT
+    RSA *public_rsa = mysql_rsa_key_find(connector);
+    if (public_rsa && mysql_rsa_encrypt(connector, public_rsa, packet_number) == SW_OK)
+    {
+        connector->rsa_key_cached = 1;
+        return SW_MYSQL_HANDSHAKE_WAIT_RESULT;
+    }
+#endif
+    connector->packet_length = 1;
+    mysql_pack_length(connector->packet_length, connector->buf);
+    connector->buf[3] = packet_number;
+    connector->buf[4] = SW_MYSQL_AUTH_SIGNATURE_RSA_PREPARED;
+    return SW_MYSQL_HANDSHAKE_WAIT_RSA;
 }
 
-static ssize_t mysql_decode_row_prepare(mysql_client *client, char *buf, uint32_t packet_length, size_t n_buf)
+/**
+ * COM_CHANGE_USER, the auth-response is computed with the challenge and the plugin of the handshake
+ */
+static int mysql_change_user_pack(mysql_connector *connector, swString *buffer)
 {
-    int i;
-    int tmp_len;
-    ulong_t len = 0;
-    char nul;
-    ssize_t read_n = 0;
+    char auth[32];
+    char charset[2] = { connector->character_set, 0 };
+    char *auth_plugin_name = connector->auth_plugin_name[0] ? connector->auth_plugin_name : NULL;
+    int next_state;
+    uint8_t auth_len = 0;
 
-    unsigned int null_count = ((client->response.num_column + 9) / 8) + 1;
-    buf += null_count;
-    packet_length -= null_count;
+    swString_clear(buffer);
+    buffer->length = SW_MYSQL_PACKET_HEADER_SIZE;
+    buffer->str[buffer->length++] = SW_MYSQL_COM_CHANGE_USER;
 
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "null_count=%u", null_count);
+    if (connector->password_len > 0)
+    {
+        auth_len = mysql_auth_encrypt_dispatch(auth, auth_plugin_name, connector->password, connector->password_len, connector->auth_plugin_data, &next_state);
+    }
+    //string[NUL]    user
+    if (swString_append_ptr(buffer, connector->user, connector->user_len + 1) < 0
+            //1              length of auth-response, string[$len] auth-response
+            || swString_append_ptr(buffer, (char *) &auth_len, 1) < 0 || swString_append_ptr(buffer, auth, auth_len) < 0
+            //string[NUL]    schema-name
+            || swString_append_ptr(buffer, connector->database, connector->database_len + 1) < 0
+            //2              character set
+            || swString_append_ptr(buffer, charset, sizeof(charset)) < 0
+            //string[NUL]    auth plugin name
+            || swString_append_ptr(buffer, connector->auth_plugin_name, strlen(connector->auth_plugin_name) + 1) < 0)
+    {
+        return SW_ERR;
+    }
+    mysql_pack_length(buffer->length - SW_MYSQL_PACKET_HEADER_SIZE, buffer->str);
+    buffer->str[3] = 0;
 
-    char datetime_buffer[DATETIME_MAX_SIZE];
-    mysql_row row;
+    swMysqlPacketDump(buffer->str, buffer->length, "COM_CHANGE_USER");
 
-    zval *result_array = client->response.result_array;
-    zval *row_array = sw_malloc_zval();
-    array_init(row_array);
+    return SW_OK;
+}
 
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "mysql_decode_row begin, num_column=%ld, packet_length=%u.", client->response.num_column, packet_length);
+/**
+ * the packets of COM_CHANGE_USER before its OK or ERR packet: an auth switch request,
+ * the result of the fast authentication of caching_sha2_password or the RSA public key
+ */
+static int mysql_change_user_auth(mysql_client *client, char *p, size_t n_buf)
+{
+    mysql_connector *connector = &client->connector;
+    uint8_t packet_number = p[3];
 
-    mysql_field *field = NULL;
-    for (i = 0; i < client->response.num_column; i++)
+    if ((uint8_t) p[4] == SW_MYSQL_PACKET_EOF)
     {
-        field = &client->response.columns[i];
-        /* to check Null-Bitmap @see https://dev.mysql.com/doc/internals/en/null-bitmap.html */
-        if (((buf - null_count + 1)[((i + 2) / 8)] & (0x01 << ((i + 2) % 8))) != 0)
+        if (mysql_auth_switch(connector, p, n_buf) < 0)
         {
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s is null", field->name);
-            add_assoc_null(row_array, field->name);
-            continue;
+            return SW_ERR;
         }
-
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "column#%d: name=%s, type=%d, size=%lu", i, field->name, field->type, field->length);
-
-        switch (field->type)
+    }
+    else if (client->response.packet_length < 2)
+    {
+        return SW_ERR;
+    }
+    else if ((uint8_t) p[5] == SW_MYSQL_AUTH_SIGNATURE_SUCCESS)
+    {
+        // the OK packet follows
+        return SW_OK;
+    }
+    else if ((uint8_t) p[5] == SW_MYSQL_AUTH_SIGNATURE_FULL_AUTH_REQUIRED)
+    {
+        mysql_auth_full(connector, packet_number + 1);
+    }
+    else
+    {
+#ifdef SW_MYSQL_RSA_SUPPORT
+        if (mysql_parse_rsa(connector, p, n_buf) != SW_OK)
         {
-        /* Date Time */
-        case SW_MYSQL_TYPE_TIME:
-            len = mysql_decode_time(buf + read_n, datetime_buffer) + 1;
-            add_assoc_stringl(row_array, field->name, datetime_buffer, 8);
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
-            break;
-
-        case SW_MYSQL_TYPE_YEAR:
-            mysql_decode_year(buf + read_n, datetime_buffer);
-            add_assoc_stringl(row_array, field->name, datetime_buffer, 4);
-            len = 2;
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
-            break;
-
-        case SW_MYSQL_TYPE_DATE:
-            len = mysql_decode_date(buf + read_n, datetime_buffer) + 1;
-            add_assoc_stringl(row_array, field->name, datetime_buffer, 10);
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
-            break;
-
-        case SW_MYSQL_TYPE_TIMESTAMP:
-        case SW_MYSQL_TYPE_DATETIME:
-            len = mysql_decode_datetime(buf + read_n, datetime_buffer) + 1;
-            add_assoc_stringl(row_array, field->name, datetime_buffer, 19);
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
-            break;
-
-        case SW_MYSQL_TYPE_NULL:
-            add_assoc_null(row_array, field->name);
-            break;
-
-        /* String */
-        case SW_MYSQL_TYPE_TINY_BLOB:
-        case SW_MYSQL_TYPE_MEDIUM_BLOB:
-        case SW_MYSQL_TYPE_LONG_BLOB:
-        case SW_MYSQL_TYPE_BLOB:
-        case SW_MYSQL_TYPE_DECIMAL:
-        case SW_MYSQL_TYPE_NEWDECIMAL:
-        case SW_MYSQL_TYPE_BIT:
-        case SW_MYSQL_TYPE_JSON:
-        case SW_MYSQL_TYPE_STRING:
-        case SW_MYSQL_TYPE_VAR_STRING:
-        case SW_MYSQL_TYPE_VARCHAR:
-        case SW_MYSQL_TYPE_NEWDATE:
-            tmp_len = mysql_length_coded_binary(&buf[read_n], &len, &nul, packet_length - read_n);
-            if (tmp_len == -1)
-            {
-                swWarn("mysql response parse error: bad lcb, tmp_len=%d", tmp_len);
-                read_n = -SW_MYSQL_ERR_BAD_LCB;
-                goto _error;
-            }
-            read_n += tmp_len;
-            // WARNING: data may be longer than single packet (0x00fffff => 16M)
-            if (unlikely(len > packet_length - read_n))
-            {
-                zend_string *zstring;
-                mysql_big_data_info mbdi = { len, n_buf - read_n, packet_length - read_n, buf + read_n, 0, 0 };
-                if ((zstring = mysql_decode_big_data(&mbdi)))
-                {
-                    zval _zdata, *zdata = &_zdata;
-                    ZVAL_STR(zdata, zstring);
-                    add_assoc_zval(row_array, field->name, zdata);
-                    read_n += mbdi.ext_header_len;
-                    packet_length += mbdi.ext_header_len + mbdi.ext_packet_len;
-                }
-                else
-                {
-                    read_n = SW_AGAIN;
-                    goto _error;
-                }
-            }
-            else
-            {
-                add_assoc_stringl(row_array, field->name, buf + read_n, len);
-            }
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "len=%lu, %s=%.*s", len, field->name, (int) len, buf + read_n);
-            break;
-
-        /* Integer */
-        case SW_MYSQL_TYPE_TINY:
-            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
-            {
-                row.utiny = *(uint8_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.utiny);
-                len = sizeof(row.utiny);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%u", field->name, row.utiny);
-            }
-            else
-            {
-                row.stiny = *(int8_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.stiny);
-                len = sizeof(row.stiny);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%d", field->name, row.stiny);
-            }
-            break;
-
-        case SW_MYSQL_TYPE_SHORT:
-            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
-            {
-                row.small = *(uint16_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.small);
-                len = sizeof(row.small);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%u", field->name, row.small);
-            }
-            else
-            {
-                row.ssmall = *(int16_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.ssmall);
-                len = sizeof(row.ssmall);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%d", field->name, row.ssmall);
-            }
-            break;
-
-        case SW_MYSQL_TYPE_INT24:
-        case SW_MYSQL_TYPE_LONG:
-            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
-            {
-                row.uint = *(uint32_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.uint);
-                len = sizeof(row.uint);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%u", field->name, row.uint);
-            }
-            else
-            {
-                row.sint = *(int32_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.sint);
-                len = sizeof(row.sint);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%d", field->name, row.sint);
-            }
-            break;
-
-        case SW_MYSQL_TYPE_LONGLONG:
-            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
-            {
-                row.ubigint = *(uint64_t *) (buf + read_n);
-                add_assoc_ulong_safe(row_array, field->name, row.ubigint);
-                len = sizeof(row.ubigint);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%llu", field->name, row.ubigint);
-            }
-            else
-            {
-                row.sbigint = *(int64_t *) (buf + read_n);
-                add_assoc_long(row_array, field->name, row.sbigint);
-                len = sizeof(row.sbigint);
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%lld", field->name, row.sbigint);
-            }
-            break;
-
-        case SW_MYSQL_TYPE_FLOAT:
-            row.mfloat = *(float *) (buf + read_n);
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%.7f", field->name, row.mfloat);
-            row.mdouble = _php_math_round(row.mfloat, 5, PHP_ROUND_HALF_DOWN);
-            add_assoc_double(row_array, field->name, row.mdouble);
-            len = sizeof(row.mfloat);
-            break;
-
-        case SW_MYSQL_TYPE_DOUBLE:
-            row.mdouble = *(double *) (buf + read_n);
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%.16f", field->name, row.mdouble);
-            add_assoc_double(row_array, field->name, row.mdouble);
-            len = sizeof(row.mdouble);
-            break;
-
-        default:
-            swWarn("unknown field type[%d].", field->type);
-            read_n = SW_ERR;
-            _error:
-            zval_ptr_dtor(row_array);
-            efree(row_array);
-            return read_n;
+            return SW_ERR;
         }
-        read_n += len;
+#else
+        swWarn("MySQL8 RSA-Auth need enable OpenSSL!");
+        return SW_ERR;
+#endif
     }
-
-    add_next_index_zval(result_array, row_array);
-
-    efree(row_array);
-
-    return read_n + null_count;
+    return mysql_client_send(client, connector->buf, SW_MYSQL_PACKET_HEADER_SIZE + connector->packet_length);
 }
 
-static sw_inline int mysql_read_eof(mysql_client *client, char *buf, int n_buf)
+static int mysql_parse_prepare_result(mysql_client *client, char *buf, size_t n_buf)
 {
-    // not EOF packet
-    if ((uint8_t) buf[4] != SW_MYSQL_PACKET_EOF || client->response.packet_length > SW_MYSQL_PACKET_EOF_MAX_SIZE)
+    // not COM_STMT_PREPARE_OK packet
+    if ((uint8_t) buf[4] != SW_MYSQL_PACKET_OK || client->cmd != SW_MYSQL_COM_STMT_PREPARE || client->response.packet_length < 12)
     {
         return SW_ERR;
     }
 
-    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "EOF_Packet");
-
-    // EOF_Packet = Packet header (4 bytes) + 0xFE + warning(2byte) + status(2byte)
+    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "COM_STMT_PREPARE_OK_Packet");
 
-    // skip packet header
+    // skip the packet header
     buf += SW_MYSQL_PACKET_HEADER_SIZE;
 
-    // int<1>	header	[fe] EOF header
+    mysql_statement *stmt = ecalloc(1, sizeof(mysql_statement));
+    // status (1) -- [00] OK
     buf += 1;
 
-    // int<2>	warnings	number of warnings
-    client->response.warnings = mysql_uint2korr(buf);
+    // statement_id (4) -- statement-id
+    stmt->id = mysql_uint4korr(buf);
+    buf += 4;
+
+    // num_columns (2) -- number of columns
+    stmt->field_count = mysql_uint2korr(buf);
     buf += 2;
 
-    // int<2>	status_flags	Status Flags
-    client->response.status_code = mysql_uint2korr(buf);
+    // num_params (2) -- number of params
+    stmt->unreaded_param_count = stmt->param_count = mysql_uint2korr(buf);
+    buf += 2;
+
+    // reserved_1 (1) -- [00] filler
+    buf += 1;
+
+    // warning_count (2) -- number of warnings
+    stmt->warning_count = mysql_uint2korr(buf);
+    stmt->result = NULL;
+    stmt->buffer = NULL;
+    client->statement = stmt;
+    stmt->client = client;
+
     MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
 
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "EOF_Packet, warnings=%u, status_code=%u", client->response.warnings, client->response.status_code);
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "stmt_id=%u, field_count=%u, param_count=%u, warning_count=%u.", stmt->id,
+            stmt->field_count, stmt->param_count, stmt->warning_count);
 
     return SW_OK;
 }
 
-static sw_inline int mysql_read_err(mysql_client *client, char *buf, int n_buf)
+static zend_string* mysql_decode_big_data(mysql_big_data_info *mbdi)
 {
-    // not ERR packet
-    if ((uint8_t) buf[4] != SW_MYSQL_PACKET_ERR)
-    {
-        return SW_ERR;
+    // through ext_packet_num to calc read_n += ?
+    mbdi->ext_header_len = SW_MYSQL_PACKET_HEADER_SIZE * (((mbdi->len - mbdi->currrent_packet_remaining_size) / SW_MYSQL_MAX_PACKET_BODY_SIZE) + 1);
+    if (mbdi->ext_header_len + mbdi->len > mbdi->remaining_size)
+    {
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "big packet need %lu, but only %lu", mbdi->ext_header_len + mbdi->len, mbdi->remaining_size);
+        return NULL;
     }
-
-    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "ERR_Packet");
-
-    client->response.response_type = SW_MYSQL_PACKET_ERR;
-
-    // ERR Packet = Packet header (4 bytes) + ERR Payload
-
-    // skip packet header
-    buf += SW_MYSQL_PACKET_HEADER_SIZE;
-
-    // int<1>	header	[ff] header of the ERR packet
-    buf += 1;
-
-    // int<2>	error_code	error-code
-    client->response.error_code = mysql_uint2korr(buf);
-    buf += 2;
-
-    // string[1]	sql_state_marker	# marker of the SQL State
-    buf += 1;
-
-    // string[5]	sql_state	SQL State
-    memcpy(client->response.status_msg, buf, 5);
-    buf += 5;
-
-    // string<EOF>	error_message	human readable error message
-    client->response.server_msg = buf;
-    client->response.l_server_msg = client->response.packet_length - 9;
-    MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
-
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "ERR_Packet, error_code=%u, status_msg=%s", client->response.error_code, client->response.status_msg);
-
-    return SW_OK;
-}
-
-static sw_inline int mysql_read_ok(mysql_client *client, char *buf, int n_buf)
-{
-    int ret;
-    char nul;
-
-    if ((uint8_t) buf[4] != SW_MYSQL_PACKET_OK || client->cmd == SW_MYSQL_COM_STMT_PREPARE)
+    else
     {
-        return SW_ERR;
+        // optimization: allocate a complete piece of memory at once
+        zend_string* zstring = zend_string_alloc(mbdi->len, 0);;
+        size_t write_s = 0, write_n = 0;
+        char *read_p, *write_p;
+        read_p = mbdi->read_p;
+        write_p = ZSTR_VAL(zstring);
+        // copy the remaining data of the current packet
+        write_s = mbdi->currrent_packet_remaining_size;
+        memcpy(write_p, read_p, write_s);
+        read_p += write_s;
+        write_p += write_s;
+        write_n += write_s;
+        while (write_n < mbdi->len) // copy the next... packet
+        {
+            uint32_t _packet_len = mysql_uint3korr(read_p);
+            mbdi->ext_packet_len += _packet_len;
+            write_s = MIN(_packet_len, mbdi->len - write_n);
+            memcpy(write_p, read_p + SW_MYSQL_PACKET_HEADER_SIZE, write_s);
+            read_p += SW_MYSQL_PACKET_HEADER_SIZE + write_s;
+            write_p += write_s;
+            write_n += write_s;
+        }
+        ZSTR_VAL(zstring)[mbdi->len] = '\0';
+        SW_ASSERT(ZSTR_VAL(zstring) + mbdi->len == write_p);
+        return zstring;
     }
-
-    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "OK_Packet");
-
-    // skip packet header
-    buf += SW_MYSQL_PACKET_HEADER_SIZE;
-    n_buf -= SW_MYSQL_PACKET_HEADER_SIZE;
-
-    // int<1>	header	[00] or [fe] the OK packet header
-    buf += 1;
-    n_buf -= 1;
-
-    // int<lenenc>	affected_rows	affected rows
-    ret = mysql_length_coded_binary(buf, &client->response.affected_rows, &nul, n_buf);
-    n_buf -= ret;
-    buf += ret;
-
-    // int<lenenc>	last_insert_id	last insert-id
-    ret = mysql_length_coded_binary(buf, &client->response.insert_id, &nul, n_buf);
-    n_buf -= ret;
-    buf += ret;
-
-    // int<2>	status_flags	Status Flags
-    client->response.status_code = mysql_uint2korr(buf);
-    buf += 2;
-
-    // int<2>	warnings	number of warnings
-    client->response.warnings = mysql_uint2korr(buf);
-
-    MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
-
-    swTraceLog(
-        SW_TRACE_MYSQL_CLIENT, "OK_Packet, affected_rows=%lu, insert_id=%lu, status_flags=%u, warnings=%u",
-        client->response.affected_rows, client->response.insert_id, client->response.status_code, client->response.warnings
-    );
-
-    return SW_OK;
 }
 
-static sw_inline int mysql_ensure_packet(char *buf, int n_buf)
+static void mysql_big_value_packet_end(mysql_big_value *bv)
 {
-    if (n_buf < SW_MYSQL_PACKET_HEADER_SIZE)
+    if (bv->packet_full)
     {
-        return SW_ERR;
+        bv->header_length = 0;
     }
-
-    uint32_t packet_length = mysql_uint3korr(buf);
-
-    // Ensure that we've received the complete packet
-    if (n_buf < SW_MYSQL_PACKET_HEADER_SIZE + packet_length)
+    else
     {
-        return SW_ERR;
+        bv->complete = 1;
     }
-
-    return SW_OK;
 }
 
-static sw_inline int mysql_read_params(mysql_client *client)
+static void mysql_big_value_header(mysql_big_value *bv)
 {
-    while (1)
+    bv->packet_remaining = mysql_uint3korr(bv->header);
+    bv->packet_full = bv->packet_remaining == SW_MYSQL_MAX_PACKET_BODY_SIZE;
+    if (bv->packet_remaining == 0)
     {
-        swString *buffer = MYSQL_RESPONSE_BUFFER;
-        char *p = buffer->str + buffer->offset;
-        size_t n_buf = buffer->length - buffer->offset;
-
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "n_buf=%zu, length=%u.", (uintmax_t) n_buf, client->response.packet_length);
+        mysql_big_value_packet_end(bv);
+    }
+}
 
-        // Ensure that we've received the complete packet
-        if (mysql_ensure_packet(p, n_buf) == SW_ERR)
-        {
-            return SW_AGAIN;
-        }
+/**
+ * take the buffered part of the value, then the buffer only keeps what is before the value,
+ * the rest of the row (without its packet headers) and the following responses
+ */
+static void mysql_big_value_start(mysql_client *client, char *p, ulong_t len, uint32_t packet_remaining)
+{
+    swString *buffer = client->buffer;
+    mysql_big_value *bv = ecalloc(1, sizeof(mysql_big_value));
+    char *end = buffer->str + buffer->length;
+    char *w = p;
+    size_t n;
 
-        client->response.packet_length = mysql_uint3korr(p);
-        client->response.packet_number = p[3];
+    bv->value = zend_string_alloc(len, 0);
+    bv->offset = p - buffer->str;
+    bv->packet_remaining = packet_remaining;
+    bv->packet_full = 1;
+    bv->header_length = sizeof(bv->header);
 
-        if (client->statement->unreaded_param_count > 0)
+    while (p < end && !bv->complete)
+    {
+        if (bv->header_length < sizeof(bv->header))
         {
-            // Read and ignore parameter field. Sentence from MySQL source:
-            // skip parameters data: we don't support it yet
-            buffer->offset += (SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length);
-            client->statement->unreaded_param_count--;
-
-            swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "Protocol::ParameterDefinition");
-
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "read param, count=%d.", client->statement->unreaded_param_count);
-
+            n = MIN(sizeof(bv->header) - bv->header_length, end - p);
+            memcpy(bv->header + bv->header_length, p, n);
+            bv->header_length += n;
+            p += n;
+            if (bv->header_length == sizeof(bv->header))
+            {
+                mysql_big_value_header(bv);
+            }
             continue;
         }
+        if (bv->filled < len)
+        {
+            n = MIN(MIN(bv->packet_remaining, len - bv->filled), end - p);
+            memcpy(ZSTR_VAL(bv->value) + bv->filled, p, n);
+            bv->filled += n;
+        }
         else
         {
-            return mysql_read_eof(client, p, n_buf);
+            n = MIN(bv->packet_remaining, end - p);
+            memmove(w, p, n);
+            w += n;
+            bv->tail_length += n;
+        }
+        p += n;
+        bv->packet_remaining -= n;
+        if (bv->packet_remaining == 0)
+        {
+            mysql_big_value_packet_end(bv);
         }
     }
+    memmove(w, p, end - p);
+    buffer->length = (w - buffer->str) + (end - p);
+    client->big_value = bv;
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "big value of %lu bytes, %ju already received.", len, (uintmax_t) bv->filled);
 }
 
 /**
- * @var char*    p      => packet beginning point
- * @var size_t   n_buf  => remaining buffer length
- * @var ssize_t  read_n => already read buffer len
+ * receive the rest of the value into its string, then the rest of its row into the buffer
+ * @return the same as recv()
  */
-static sw_inline int mysql_read_rows(mysql_client *client)
+static ssize_t mysql_big_value_recv(mysql_client *client)
 {
-    swString *buffer = MYSQL_RESPONSE_BUFFER;
-    char *p = buffer->str + buffer->offset;
-    size_t n_buf = buffer->length - buffer->offset;
-    ssize_t read_n = 0;
-
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n_buf=%ju", (uintmax_t) n_buf);
+    mysql_big_value *bv = client->big_value;
+    swString *buffer = client->buffer;
+    ssize_t n;
 
-    //RecordSet parse
-    while (n_buf > 0)
+    if (bv->header_length < sizeof(bv->header))
     {
-        // Ensure that we've received the complete packet
-        if (mysql_ensure_packet(p, n_buf) == SW_ERR)
-        {
-            return SW_AGAIN;
-        }
-
-        client->response.packet_length = mysql_uint3korr(p);
-        client->response.packet_number = p[3];
-
-        //RecordSet end
-        if (mysql_read_eof(client, p, n_buf) == SW_OK)
+        n = mysql_client_recv(client, bv->header + bv->header_length, sizeof(bv->header) - bv->header_length);
+        if (n > 0)
         {
-            mysql_columns_free(client);
-            return SW_OK;
-        }
-        // ERR Instead of EOF
-        // @see: https://dev.mysql.com/doc/internals/en/err-instead-of-eof.html
-        else if (mysql_read_err(client, p, n_buf) == SW_OK)
-        {
-            mysql_columns_free(client);
-            return SW_OK;
+            bv->header_length += n;
+            if (bv->header_length == sizeof(bv->header))
+            {
+                mysql_big_value_header(bv);
+            }
         }
-
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "record size=%d", client->response.packet_length);
-
-        // ProtocolBinary::ResultSetRow
-        swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length , "ProtocolBinary::ResultSetRow");
-
-
-        if (client->cmd == SW_MYSQL_COM_STMT_EXECUTE)
+        return n;
+    }
+    if (bv->filled < ZSTR_LEN(bv->value))
+    {
+        n = mysql_client_recv(client, ZSTR_VAL(bv->value) + bv->filled, MIN(bv->packet_remaining, ZSTR_LEN(bv->value) - bv->filled));
+        if (n <= 0)
         {
-            // for execute
-            read_n = mysql_decode_row_prepare(
-                client,
-                p + SW_MYSQL_PACKET_HEADER_SIZE,
-                client->response.packet_length,
-                n_buf - SW_MYSQL_PACKET_HEADER_SIZE
-            );
+            return n;
         }
-        else
+        bv->filled += n;
+    }
+    else
+    {
+        if (buffer->length == buffer->size && swString_extend(buffer, buffer->size * 2) < 0)
         {
-            // for query
-            read_n = mysql_decode_row(
-                client,
-                p + SW_MYSQL_PACKET_HEADER_SIZE,
-                client->response.packet_length,
-                n_buf - SW_MYSQL_PACKET_HEADER_SIZE
-            );
+            errno = ENOMEM;
+            return -1;
         }
-
-        if (unlikely(read_n < 0))
+        n = mysql_client_recv(client, buffer->str + buffer->length, MIN(bv->packet_remaining, buffer->size - buffer->length));
+        if (n <= 0)
         {
-            // TODO: handle all decode error here
-            if (read_n == SW_AGAIN)
-            {
-                return SW_AGAIN;
-            }
-            mysql_columns_free(client);
-            return read_n;
+            return n;
         }
-
-        // next row
-        p += SW_MYSQL_PACKET_HEADER_SIZE + read_n;
-        n_buf -= SW_MYSQL_PACKET_HEADER_SIZE + read_n;
-        buffer->offset += SW_MYSQL_PACKET_HEADER_SIZE + read_n;
-        client->response.num_row++;
+        buffer->length += n;
+        bv->tail_length += n;
     }
-
-    // missing eof or err packet
-    return SW_AGAIN;
+    bv->packet_remaining -= n;
+    if (bv->packet_remaining == 0)
+    {
+        mysql_big_value_packet_end(bv);
+    }
+    return n;
 }
 
-static int mysql_decode_field(char *buf, int len, mysql_field *col)
+static void mysql_big_value_free(mysql_client *client)
 {
-    int i;
-    ulong_t size;
-    char nul;
-    char *wh;
-    int tmp_len;
-
-    /**
-     * string buffer
-     */
-    char *_buffer = (char*) emalloc(len);
-    if (!_buffer)
+    if (client->big_value)
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
+        zend_string_release(client->big_value->value);
+        efree(client->big_value);
+        client->big_value = NULL;
     }
-    col->buffer = _buffer;
-
-    wh = buf;
+}
 
-    i = 0;
+/**
+ * decode a value longer than the rest of its packet: it is reassembled from the buffer once received,
+ * otherwise the rest of it is received straight into its string (except with the compressed protocol)
+ * @return SW_OK with the string, SW_AGAIN to wait for more data, SW_ERR on a malformed row
+ */
+static int mysql_decode_big_value(mysql_client *client, char *buf, ssize_t *read_n, uint32_t *packet_length, size_t n_buf, ulong_t *len, zend_string **zstring)
+{
+    mysql_big_value *bv = client->big_value;
+    char *p = buf + *read_n;
 
-    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-    if (tmp_len == -1)
+    if (!bv || p - client->buffer->str != bv->offset)
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
-    }
-    i += tmp_len;
-    if (i + size > len)
-    {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        mysql_big_data_info mbdi = { *len, n_buf - *read_n, *packet_length - *read_n, p, 0, 0 };
+        if ((*zstring = mysql_decode_big_data(&mbdi)))
+        {
+            *read_n += mbdi.ext_header_len;
+            *packet_length += mbdi.ext_header_len + mbdi.ext_packet_len;
+            return SW_OK;
+        }
+        if (bv || client->compress_buffer)
+        {
+            return SW_AGAIN;
+        }
+        mysql_big_value_start(client, p, *len, *packet_length - *read_n);
+        bv = client->big_value;
     }
-    col->catalog_length = size;
-    col->catalog = _buffer;
-    _buffer += (size + 1);
-    memcpy(col->catalog, &buf[i], size);
-    col->catalog[size] = '\0';
-    wh += size + 1;
-    i += size;
-
-    /* n (Length Coded String)    db */
-    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-    if (tmp_len == -1)
+    if (!bv->complete)
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
+        return SW_AGAIN;
     }
-    i += tmp_len;
-    if (i + size > len)
+    if (bv->filled < *len)
     {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        swWarn("mysql response parse error: the row ends within a value of %lu bytes.", *len);
+        mysql_big_value_free(client);
+        return SW_ERR;
     }
-    col->db_length = size;
-    col->db = _buffer;
-    _buffer += (size + 1);
-    memcpy(col->db, &buf[i], size);
-    col->db[size] = '\0';
-    wh += size + 1;
-    i += size;
+    ZSTR_VAL(bv->value)[*len] = '\0';
+    *zstring = bv->value;
+    // the rest of the row follows in the buffer as a single packet
+    *packet_length = *read_n + bv->tail_length;
+    *len = 0;
+    efree(bv);
+    client->big_value = NULL;
+    return SW_OK;
+}
 
-    /* n (Length Coded String)    table */
-    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-    if (tmp_len == -1)
+/**
+ * the powers of ten that are exact in a double
+ */
+static const double mysql_pow10[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * parse the decimal integer of a text column in place, the value is not NUL-terminated,
+ * returns 1 when it does not fit in a zend_long
+ */
+static sw_inline int mysql_parse_long(const char *p, size_t len, zend_long *value)
+{
+    const char *end = p + len, *last;
+    zend_bool negative = 0;
+    uint64_t n = 0;
+    uint32_t d;
+
+    if (len > 0 && *p == '-')
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
+        negative = 1;
+        p++;
     }
-    i += tmp_len;
-    if (i + size > len)
+    if (p == end)
     {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        return SW_ERR;
     }
-    col->table_length = size;
-    col->table = _buffer;
-    _buffer += (size + 1);
-    memcpy(col->table, &buf[i], size);
-    col->table[size] = '\0';
-    wh += size + 1;
-    i += size;
-
-    /* n (Length Coded String)    org_table */
-    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-    if (tmp_len == -1)
+    // ZEROFILL columns
+    while (*p == '0' && p < end - 1)
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
+        p++;
     }
-    i += tmp_len;
-    if (i + size > len)
+    if (end - p > 20)
     {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        return 1;
     }
-    col->org_table_length = size;
-    col->org_table = _buffer;
-    _buffer += (size + 1);
-    memcpy(col->org_table, &buf[i], size);
-    col->org_table[size] = '\0';
-    wh += size + 1;
-    i += size;
-
-    /* n (Length Coded String)    name */
-    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-    if (tmp_len == -1)
+    // 19 digits can not overflow
+    last = end - p == 20 ? end - 1 : end;
+    for (; p < last; p++)
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
+        d = (uint8_t) *p - '0';
+        if (d > 9)
+        {
+            return SW_ERR;
+        }
+        n = n * 10 + d;
     }
-    i += tmp_len;
-    if (i + size > len)
+    if (p < end)
     {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        d = (uint8_t) *p - '0';
+        if (d > 9)
+        {
+            return SW_ERR;
+        }
+        if (n > (UINT64_MAX - d) / 10)
+        {
+            return 1;
+        }
+        n = n * 10 + d;
     }
-    col->name_length = size;
-    col->name = _buffer;
-    _buffer += (size + 1);
-    memcpy(col->name, &buf[i], size);
-    col->name[size] = '\0';
-    wh += size + 1;
-    i += size;
 
-    /* n (Length Coded String)    org_name */
-    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-    if (tmp_len == -1)
+    if (negative)
     {
-        return -SW_MYSQL_ERR_BAD_LCB;
+        if (n > (uint64_t) ZEND_LONG_MAX + 1)
+        {
+            return 1;
+        }
+        *value = (zend_long) (0 - n);
     }
-    i += tmp_len;
-    if (i + size > len)
+    else
     {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        if (n > ZEND_LONG_MAX)
+        {
+            return 1;
+        }
+        *value = (zend_long) n;
     }
-    col->org_name_length = size;
-    col->org_name = _buffer;
-    _buffer += (size + 1);
-    memcpy(col->org_name, &buf[i], size);
-    col->org_name[size] = '\0';
-    wh += size + 1;
-    i += size;
+    return SW_OK;
+}
 
-    /* check len */
-    if (i + 13 > len)
+/**
+ * parse the decimal number of a text column in place,
+ * the mantissa and the scale are exact in a double for the common values, the others go to zend_strtod
+ */
+static sw_inline int mysql_parse_double(const char *p, size_t len, double *value)
+{
+    const char *start = p, *end = p + len, *endptr;
+    zend_bool negative = 0;
+    uint64_t mantissa = 0;
+    uint32_t d, digits = 0, scale = 0;
+    char buf[64], *str;
+    int ret;
+
+    if (len > 0 && (*p == '-' || *p == '+'))
     {
-        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        negative = *p == '-';
+        p++;
     }
-
-    /* (filler) */
-    i += 1;
-
-    /* charset */
-    col->charsetnr = mysql_uint2korr(&buf[i]);
-    i += 2;
-
-    /* length */
-    col->length = mysql_uint4korr(&buf[i]);
-    i += 4;
-
-    /* type */
-    col->type = (enum mysql_field_types) (uchar)buf[i];
-    i += 1;
-
-    /* flags */
-    col->flags = mysql_uint2korr(&buf[i]);
-    i += 2;
-
-    /* decimals */
-    col->decimals = buf[i];
-    i += 1;
-
-    /* filler */
-    i += 2;
-
-    /* default - a priori facultatif */
-    if (len - i > 0)
+    for (; p < end && (d = (uint8_t) *p - '0') <= 9; p++, digits++)
     {
-        tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
-        if (tmp_len == -1)
+        mantissa = mantissa * 10 + d;
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && (d = (uint8_t) *p - '0') <= 9; p++, digits++, scale++)
         {
-            return -SW_MYSQL_ERR_BAD_LCB;
+            mantissa = mantissa * 10 + d;
         }
-        i += tmp_len;
-        if (i + size > len)
+    }
+    if (p == end && digits > 0 && digits <= 19 && mantissa <= (1ULL << 53) && scale < sizeof(mysql_pow10) / sizeof(mysql_pow10[0]))
+    {
+        *value = (double) mantissa / mysql_pow10[scale];
+        if (negative)
         {
-            return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+            *value = -*value;
         }
-        col->def_length = size;
-        col->def = _buffer;
-        //_buffer += (size + 1);
-        memcpy(col->def, &buf[i], size);
-        col->def[size] = '\0';
-        wh += size + 1;
-        i += size;
+        return SW_OK;
     }
-    else
+
+    // exponent or too many digits
+    str = len < sizeof(buf) ? buf : emalloc(len + 1);
+    memcpy(str, start, len);
+    str[len] = '\0';
+    *value = zend_strtod(str, &endptr);
+    ret = len > 0 && endptr == str + len ? SW_OK : SW_ERR;
+    if (str != buf)
     {
-        col->def = NULL;
-        col->def_length = 0;
+        efree(str);
     }
+    return ret;
+}
 
-    /* set write pointer */
-    return wh - buf;
+static sw_inline int64_t mysql_days_from_civil(int y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t) (y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t) era * 146097 + doe - 719468;
 }
 
-static int mysql_read_columns(mysql_client *client)
+/**
+ * 'YYYY-MM-DD hh:mm:ss[.ffffff]' as a unix timestamp, the value is taken as UTC,
+ * a float when there are fractional seconds, zero dates are kept as strings
+ */
+static sw_inline int mysql_parse_datetime(const char *p, size_t len, zval *zvalue)
 {
-    swString *buffer = MYSQL_RESPONSE_BUFFER;
-    char *p = buffer->str + buffer->offset;
-    size_t n_buf = buffer->length - buffer->offset;
-    int ret;
+    static const char format[] = "0000-00-00 00:00:00";
+    uint32_t v[6] = { 0 }, d, i, k = 0, usec = 0, scale = 0;
 
-    for (; client->response.index_column < client->response.num_column; client->response.index_column++)
+    if (len < sizeof(format) - 1 || (len > sizeof(format) - 1 && (p[sizeof(format) - 1] != '.' || len > sizeof(format) + 6)))
     {
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "index_index_column=%ld, n_buf=%zu.", client->response.index_column, (uintmax_t) n_buf);
-
-        // Ensure that we've received the complete packet
-        if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+        return SW_ERR;
+    }
+    for (i = 0; i < sizeof(format) - 1; i++)
+    {
+        if (format[i] != '0')
         {
-            return SW_AGAIN;
+            if (p[i] != format[i])
+            {
+                return SW_ERR;
+            }
+            k++;
+            continue;
         }
-
-        client->response.packet_length = mysql_uint3korr(p);
-        client->response.packet_number = p[3];
-
-        swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "Protocol::ColumnDefinition");
-
-        // skip the packet header
-        p += SW_MYSQL_PACKET_HEADER_SIZE;
-        n_buf -= SW_MYSQL_PACKET_HEADER_SIZE;
-
-        ret = mysql_decode_field(p, client->response.packet_length, &client->response.columns[client->response.index_column]);
-        if (ret > 0)
+        d = (uint8_t) p[i] - '0';
+        if (d > 9)
         {
-            p += client->response.packet_length;
-            n_buf -= client->response.packet_length;
-            buffer->offset += (SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length);
+            return SW_ERR;
         }
-        else
+        v[k] = v[k] * 10 + d;
+    }
+    for (i = sizeof(format); i < len; i++, scale++)
+    {
+        d = (uint8_t) p[i] - '0';
+        if (d > 9)
         {
-            swWarn("mysql_decode_field failed, code=%d.", ret);
-            return ret < 0 ? ret : SW_ERR;
+            return SW_ERR;
         }
+        usec = usec * 10 + d;
     }
-
-    // Ensure that we've received the complete EOF_Packet
-    if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+    if (v[1] < 1 || v[1] > 12 || v[2] < 1 || v[2] > 31)
     {
-        return SW_AGAIN;
+        return SW_ERR;
     }
 
-    client->response.packet_length = mysql_uint3korr(p);
-    client->response.packet_number = p[3];
-
-    if (mysql_read_eof(client, p, n_buf) != SW_OK)
+    int64_t timestamp = mysql_days_from_civil(v[0], v[1], v[2]) * 86400 + v[3] * 3600 + v[4] * 60 + v[5];
+    if (usec > 0)
     {
-        swWarn("unexpected mysql non-eof packet.");
-        return SW_ERR;
+        ZVAL_DOUBLE(zvalue, timestamp + usec / mysql_pow10[scale]);
     }
-
-    if (client->cmd != SW_MYSQL_COM_STMT_PREPARE)
+    else
     {
-        if (!client->response.result_array)
-        {
-            client->response.result_array = sw_malloc_zval();;
-            array_init(client->response.result_array);
-        }
+        ZVAL_LONG(zvalue, timestamp);
     }
-
-    p += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
-    n_buf -= SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
-    buffer->offset += p - (buffer->str + buffer->offset);
-
     return SW_OK;
 }
 
-// this function is used to check if multi responses has received over.
-int mysql_is_over(mysql_client *client)
+static ssize_t mysql_decode_row(mysql_client *client, char *buf, uint32_t packet_length, size_t n_buf)
 {
-    swString *buffer = MYSQL_RESPONSE_BUFFER;
-    char *p;
-    off_t remaining_size;
-    uint32_t packet_length;
+    int i;
+    int ret;
+    int tmp_len;
+    ulong_t len;
+    char nul;
+    zend_long lval;
+    double dval;
+    zval zvalue;
+    ssize_t read_n = 0;
+    zend_string *zstring = NULL;
+    zval *result_array = client->response.result_array;
+    zval *row_array = sw_malloc_zval();
 
-    if (buffer->length < client->want_length)
-    {
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "want=%ju, but only=%ju", (uintmax_t) client->want_length, (uintmax_t) buffer->length);
-        return SW_AGAIN;
-    }
-    remaining_size = buffer->length - client->check_offset; // remaining buffer size
-    while (remaining_size > 0) // if false: have already check all of the data
-    {
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "check packet from %jd, remaining=%jd", (intmax_t) client->check_offset, (intmax_t) remaining_size);
-        p = buffer->str + client->check_offset; // where to start checking now
-        if (unlikely(buffer->length < client->check_offset + SW_MYSQL_PACKET_HEADER_SIZE))
-        {
-            client->want_length = client->check_offset + SW_MYSQL_PACKET_HEADER_SIZE;
-            break; // header incomplete
-        }
-        packet_length = mysql_uint3korr(p); // parse packet length
-        // add header
-        p += SW_MYSQL_PACKET_HEADER_SIZE;
-        remaining_size -= SW_MYSQL_PACKET_HEADER_SIZE;
-        if (remaining_size < packet_length) // packet is incomplete
-        {
-            client->want_length = client->check_offset + SW_MYSQL_PACKET_HEADER_SIZE + packet_length;
-            break;
-        }
-
-        client->check_offset += (SW_MYSQL_PACKET_HEADER_SIZE + packet_length); // add header length + packet length
-        if (client->check_offset >= buffer->length) // if false: more packets exist, skip the current one
-        {
-            swTraceLog(SW_TRACE_MYSQL_CLIENT, "check the last packet, length=%u", packet_length);
-            switch ((uint8_t) p[0])
-            {
-            case SW_MYSQL_PACKET_EOF: // eof
-            {
-                // +type +warning
-                p += 3;
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "meet eof packet and flag=%d", mysql_uint2korr(p));
-                goto _check_flag;
-            }
-            case SW_MYSQL_PACKET_OK: // ok
-            {
-                ulong_t val = 0;
-                char nul;
-                int retcode;
-                off_t temp_remaining_len = remaining_size;
+    array_init(row_array);
 
-                // +type
-                p++;
-                temp_remaining_len--;
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "mysql_decode_row begin, num_column=%ld, packet_length=%u.", client->response.num_column, packet_length);
 
-                retcode = mysql_length_coded_binary(p, &val, &nul, temp_remaining_len); // affect rows
-                p += retcode;
-                temp_remaining_len -= retcode;
+    mysql_field *field = NULL;
 
-                retcode = mysql_length_coded_binary(p, &val, &nul, temp_remaining_len); // insert id
-                p += retcode;
-                temp_remaining_len -= retcode;
+    for (i = 0; i < client->response.num_column; i++)
+    {
+        tmp_len = mysql_length_coded_binary(&buf[read_n], &len, &nul, packet_length - read_n);
+        if (tmp_len == -1)
+        {
+            swWarn("mysql response parse error: bad lcb, tmp_len=%d", tmp_len);
+            read_n = -SW_MYSQL_ERR_BAD_LCB;
+            goto _error;
+        }
+        read_n += tmp_len;
 
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "meet ok packet");
-                _check_flag:
-                if ((mysql_uint2korr(p) & SW_MYSQL_SERVER_MORE_RESULTS_EXISTS) == 0)
-                {
-                    _over:
-                    swTraceLog(SW_TRACE_MYSQL_CLIENT, "packet over on=%jd", (intmax_t) client->check_offset);
-                    client->want_length = 0;
-                    client->check_offset = 0;
-                    return SW_OK;
-                }
-                break;
-            }
-            case SW_MYSQL_PACKET_ERR: // response type = error
+        // WARNING: data may be longer than single packet (0x00fffff => 16M)
+        if (unlikely(len > packet_length - read_n))
+        {
+            if ((ret = mysql_decode_big_value(client, buf, &read_n, &packet_length, n_buf, &len, &zstring)) != SW_OK)
             {
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "meet error packet");
-                goto _over;
-            }
+                read_n = ret;
+                goto _error;
             }
         }
 
-        // not complete and without remaining data
-        remaining_size -= packet_length;
-        if (remaining_size <= 0)
+        field = &client->response.columns[i];
+
+        if (nul == 1)
         {
-            break; // again
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "column#%d: name=%.*s, type=null", i, field->name_length, field->name);
+            add_assoc_null(row_array, field->name);
+            continue;
         }
-    }
-
-    return SW_AGAIN;
-}
-
-
-int mysql_response(mysql_client *client)
-{
-    swString *buffer = MYSQL_RESPONSE_BUFFER;
-
-    char *p;
-    int ret;
-    char nul;
-    size_t n_buf;
 
-    while ((n_buf = buffer->length - buffer->offset) > 0)
-    {
-        p = buffer->str + buffer->offset;
-        swTraceLog(SW_TRACE_MYSQL_CLIENT, "client->state=%d, n_buf=%zu.", client->state, n_buf);
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "column#%d: name=%.*s, type=%d, value=%.*s, len=%lu", i, field->name_length, field->name, field->type, (int) len, buf + read_n, len);
 
-        switch (client->state)
+        switch (field->type)
         {
-        case SW_MYSQL_STATE_READ_START:
-            // Ensure that we've received the complete packet
-            if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+        case SW_MYSQL_TYPE_NULL:
+            add_assoc_null(row_array, field->name);
+            break;
+        case SW_MYSQL_TYPE_DECIMAL:
+        case SW_MYSQL_TYPE_NEWDECIMAL:
+            if (client->connector.decimal_as_float && !zstring && mysql_parse_double(buf + read_n, len, &dval) == SW_OK)
             {
-                return SW_AGAIN;
+                add_assoc_double(row_array, field->name, dval);
+                break;
             }
-
-            client->response.packet_length = mysql_uint3korr(p);
-            client->response.packet_number = p[3];
-            client->response.response_type = p[4];
-
-            /* error */
-            if (mysql_read_err(client, p, n_buf) == SW_OK)
+            goto _string;
+        case SW_MYSQL_TYPE_TIMESTAMP:
+        case SW_MYSQL_TYPE_DATETIME:
+            if (client->connector.datetime_as_timestamp && !zstring && mysql_parse_datetime(buf + read_n, len, &zvalue) == SW_OK)
             {
-                client->state = SW_MYSQL_STATE_READ_END;
-                return SW_OK;
+                add_assoc_zval(row_array, field->name, &zvalue);
+                break;
             }
-            /* eof */
-            else if (mysql_read_eof(client, p, n_buf) == SW_OK)
+            goto _string;
+        /* String */
+        case SW_MYSQL_TYPE_TINY_BLOB:
+        case SW_MYSQL_TYPE_MEDIUM_BLOB:
+        case SW_MYSQL_TYPE_LONG_BLOB:
+        case SW_MYSQL_TYPE_BLOB:
+        case SW_MYSQL_TYPE_BIT:
+        case SW_MYSQL_TYPE_STRING:
+        case SW_MYSQL_TYPE_VAR_STRING:
+        case SW_MYSQL_TYPE_VARCHAR:
+        case SW_MYSQL_TYPE_NEWDATE:
+        /* Date Time */
+        case SW_MYSQL_TYPE_TIME:
+        case SW_MYSQL_TYPE_YEAR:
+        case SW_MYSQL_TYPE_DATE:
+        case SW_MYSQL_TYPE_JSON:
+            _string:
+            if (unlikely(zstring))
             {
-                client->state = SW_MYSQL_STATE_READ_END;
-                return SW_OK;
+                zval _zdata, *zdata = &_zdata;
+                ZVAL_STR(zdata, zstring);
+                add_assoc_zval(row_array, field->name, zdata);
+                zstring = NULL;
             }
-            /* ok */
-            else if (mysql_read_ok(client, p, n_buf) == SW_OK)
+            else
             {
-                client->state = SW_MYSQL_STATE_READ_END;
-                return SW_OK;
+                add_assoc_stringl(row_array, field->name, buf + read_n, len);
             }
-            /* COM_STMT_PREPARE_OK */
-            else if (mysql_parse_prepare_result(client, p, n_buf) == SW_OK)
+            break;
+        /* Integer */
+        case SW_MYSQL_TYPE_TINY:
+        case SW_MYSQL_TYPE_SHORT:
+        case SW_MYSQL_TYPE_INT24:
+        case SW_MYSQL_TYPE_LONG:
+        case SW_MYSQL_TYPE_LONGLONG:
+            if (client->connector.strict_type)
             {
-                client->response.num_column = client->statement->field_count;
-                if (client->response.num_column > 0)
-                {
-                    client->response.columns = ecalloc(client->response.num_column, sizeof(mysql_field));
-                }
-                if (client->statement->param_count > 0)
-                {
-                    client->state = SW_MYSQL_STATE_READ_PARAM;
-                }
-                else if (client->statement->field_count > 0)
-                {
-                    client->state = SW_MYSQL_STATE_READ_FIELD;
-                }
-                else
+                switch (mysql_parse_long(buf + read_n, len, &lval))
                 {
-                    return SW_OK;
+                case SW_OK:
+                    add_assoc_long(row_array, field->name, lval);
+                    break;
+                case SW_ERR:
+                    read_n = field->type == SW_MYSQL_TYPE_LONGLONG ? -SW_MYSQL_ERR_CONVLONGLONG : -SW_MYSQL_ERR_CONVLONG;
+                    goto _error;
+                default:
+                    // BIGINT UNSIGNED above ZEND_LONG_MAX
+                    add_assoc_stringl(row_array, field->name, buf + read_n, len);
+                    break;
                 }
-                break;
             }
-            /* result set */
             else
             {
-                swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "ResultSet");
-
-                //Protocol::LengthEncodedInteger
-                ret = mysql_length_coded_binary(p + SW_MYSQL_PACKET_HEADER_SIZE, &client->response.num_column, &nul, n_buf - SW_MYSQL_PACKET_HEADER_SIZE);
-                if (ret < 0)
-                {
-                    return SW_ERR;
-                }
-                buffer->offset += (SW_MYSQL_PACKET_HEADER_SIZE + ret);
-
-                swTraceLog(SW_TRACE_MYSQL_CLIENT, "ResultSet_Packet: num_of_fields=%lu.", client->response.num_column);
-
-                // easy to the safe side: but under what circumstances would num_column will be 0 in result set?
-                if (client->response.num_column > 0)
-                {
-                    client->response.columns = ecalloc(client->response.num_column, sizeof(mysql_field));
-                }
-
-                client->state = SW_MYSQL_STATE_READ_FIELD;
-                break;
-            }
-
-        /* data of fields */
-        case SW_MYSQL_STATE_READ_FIELD:
-            if ((ret = mysql_read_columns(client)) < 0)
-            {
-                return ret;
+                add_assoc_stringl(row_array, field->name, buf + read_n, len);
             }
-            else
+            break;
+        case SW_MYSQL_TYPE_FLOAT:
+        case SW_MYSQL_TYPE_DOUBLE:
+            if (client->connector.strict_type)
             {
-                if (client->cmd == SW_MYSQL_COM_STMT_PREPARE)
+                if (mysql_parse_double(buf + read_n, len, &dval) < 0)
                 {
-                    mysql_columns_free(client);
-                    return SW_OK;
+                    read_n = field->type == SW_MYSQL_TYPE_FLOAT ? -SW_MYSQL_ERR_CONVFLOAT : -SW_MYSQL_ERR_CONVDOUBLE;
+                    goto _error;
                 }
-                client->state = SW_MYSQL_STATE_READ_ROW;
-                break;
-            }
-
-        /* data of rows */
-        case SW_MYSQL_STATE_READ_ROW:
-            if ((ret = mysql_read_rows(client)) < 0)
-            {
-                return ret;
-            }
-            else
-            {
-                client->state = SW_MYSQL_STATE_READ_END;
-                return SW_OK;
-            }
-
-        /* prepare statment params */
-        case SW_MYSQL_STATE_READ_PARAM:
-            if ((ret = mysql_read_params(client)) < 0)
-            {
-                return ret;
-            }
-            else if (client->statement->field_count > 0)
-            {
-                client->state = SW_MYSQL_STATE_READ_FIELD;
-                continue;
+                add_assoc_double(row_array, field->name, dval);
             }
             else
             {
-                mysql_columns_free(client);
-                return SW_OK;
+                add_assoc_stringl(row_array, field->name, buf + read_n, len);
             }
+            break;
 
         default:
-            return SW_ERR;
+            swWarn("unknown field type[%d].", field->type);
+            read_n = SW_ERR;
+            _error:
+            zval_ptr_dtor(row_array);
+            efree(row_array);
+            return read_n;
+        }
+        read_n += len;
+    }
+
+    add_next_index_zval(result_array, row_array);
+
+    efree(row_array);
+
+    return read_n;
+}
+
+static int mysql_decode_datetime(char *buf, char *result)
+{
+    uint16_t y = 0;
+    uint8_t M = 0, d = 0, h = 0, m = 0, s = 0, n;
+
+    n = *(uint8_t *) (buf);
+    if (n != 0)
+    {
+        y = *(uint16_t *) (buf + 1);
+        M = *(uint8_t *) (buf + 3);
+        d = *(uint8_t *) (buf + 4);
+        if (n > 4)
+        {
+            h = *(uint8_t *) (buf + 5);
+            m = *(uint8_t *) (buf + 6);
+            s = *(uint8_t *) (buf + 7);
         }
     }
+    snprintf(result, DATETIME_MAX_SIZE, "%04d-%02d-%02d %02d:%02d:%02d", y, M, d, h, m, s);
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n=%d", n);
+
+    return n;
+}
+
+static int mysql_decode_time(char *buf, char *result)
+{
+    uint8_t h = 0, m = 0, s = 0;
+
+    uint8_t n = *(uint8_t *) (buf);
+    if (n != 0)
+    {
+        h = *(uint8_t *) (buf + 6);
+        m = *(uint8_t *) (buf + 7);
+        s = *(uint8_t *) (buf + 8);
+    }
+
+    snprintf(result, DATETIME_MAX_SIZE, "%02d:%02d:%02d", h, m, s);
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n=%d", n);
+
+    return n;
+}
+
+static int mysql_decode_date(char *buf, char *result)
+{
+    uint8_t M = 0, d = 0, n;
+    uint16_t y = 0;
+
+    n = *(uint8_t *) (buf);
+    if (n != 0)
+    {
+        y = *(uint16_t *) (buf + 1);
+        M = *(uint8_t *) (buf + 3);
+        d = *(uint8_t *) (buf + 4);
+    }
+    snprintf(result, DATETIME_MAX_SIZE, "%04d-%02d-%02d", y, M, d);
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n=%d", n);
+
+    return n;
+}
+
+static void mysql_decode_year(char *buf, char *result)
+{
+    uint16_t y = *(uint16_t *) (buf);
+    snprintf(result, DATETIME_MAX_SIZE, "%04d", y);
+}
+
+static ssize_t mysql_decode_row_prepare(mysql_client *client, char *buf, uint32_t packet_length, size_t n_buf)
+{
+    int i;
+    int tmp_len;
+    ulong_t len = 0;
+    char nul;
+    ssize_t read_n = 0;
+
+    unsigned int null_count = ((client->response.num_column + 9) / 8) + 1;
+    buf += null_count;
+    packet_length -= null_count;
+    n_buf -= null_count;
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "null_count=%u", null_count);
+
+    char datetime_buffer[DATETIME_MAX_SIZE];
+    mysql_row row;
+    double dval;
+    zval zvalue;
+
+    zval *result_array = client->response.result_array;
+    zval *row_array = sw_malloc_zval();
+    array_init(row_array);
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "mysql_decode_row begin, num_column=%ld, packet_length=%u.", client->response.num_column, packet_length);
+
+    mysql_field *field = NULL;
+    for (i = 0; i < client->response.num_column; i++)
+    {
+        field = &client->response.columns[i];
+        /* to check Null-Bitmap @see https://dev.mysql.com/doc/internals/en/null-bitmap.html */
+        if (((buf - null_count + 1)[((i + 2) / 8)] & (0x01 << ((i + 2) % 8))) != 0)
+        {
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s is null", field->name);
+            add_assoc_null(row_array, field->name);
+            continue;
+        }
+
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "column#%d: name=%s, type=%d, size=%lu", i, field->name, field->type, field->length);
+
+        switch (field->type)
+        {
+        /* Date Time */
+        case SW_MYSQL_TYPE_TIME:
+            len = mysql_decode_time(buf + read_n, datetime_buffer) + 1;
+            add_assoc_stringl(row_array, field->name, datetime_buffer, 8);
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
+            break;
+
+        case SW_MYSQL_TYPE_YEAR:
+            mysql_decode_year(buf + read_n, datetime_buffer);
+            add_assoc_stringl(row_array, field->name, datetime_buffer, 4);
+            len = 2;
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
+            break;
+
+        case SW_MYSQL_TYPE_DATE:
+            len = mysql_decode_date(buf + read_n, datetime_buffer) + 1;
+            add_assoc_stringl(row_array, field->name, datetime_buffer, 10);
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
+            break;
+
+        case SW_MYSQL_TYPE_TIMESTAMP:
+        case SW_MYSQL_TYPE_DATETIME:
+            len = mysql_decode_datetime(buf + read_n, datetime_buffer) + 1;
+            if (client->connector.datetime_as_timestamp && mysql_parse_datetime(datetime_buffer, 19, &zvalue) == SW_OK)
+            {
+                add_assoc_zval(row_array, field->name, &zvalue);
+                break;
+            }
+            add_assoc_stringl(row_array, field->name, datetime_buffer, 19);
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%s", field->name, datetime_buffer);
+            break;
+
+        case SW_MYSQL_TYPE_NULL:
+            add_assoc_null(row_array, field->name);
+            break;
+
+        /* String */
+        case SW_MYSQL_TYPE_TINY_BLOB:
+        case SW_MYSQL_TYPE_MEDIUM_BLOB:
+        case SW_MYSQL_TYPE_LONG_BLOB:
+        case SW_MYSQL_TYPE_BLOB:
+        case SW_MYSQL_TYPE_DECIMAL:
+        case SW_MYSQL_TYPE_NEWDECIMAL:
+        case SW_MYSQL_TYPE_BIT:
+        case SW_MYSQL_TYPE_JSON:
+        case SW_MYSQL_TYPE_STRING:
+        case SW_MYSQL_TYPE_VAR_STRING:
+        case SW_MYSQL_TYPE_VARCHAR:
+        case SW_MYSQL_TYPE_NEWDATE:
+            tmp_len = mysql_length_coded_binary(&buf[read_n], &len, &nul, packet_length - read_n);
+            if (tmp_len == -1)
+            {
+                swWarn("mysql response parse error: bad lcb, tmp_len=%d", tmp_len);
+                read_n = -SW_MYSQL_ERR_BAD_LCB;
+                goto _error;
+            }
+            read_n += tmp_len;
+            // WARNING: data may be longer than single packet (0x00fffff => 16M)
+            if (unlikely(len > packet_length - read_n))
+            {
+                zend_string *zstring;
+                int ret = mysql_decode_big_value(client, buf, &read_n, &packet_length, n_buf, &len, &zstring);
+                if (ret == SW_OK)
+                {
+                    zval _zdata, *zdata = &_zdata;
+                    ZVAL_STR(zdata, zstring);
+                    add_assoc_zval(row_array, field->name, zdata);
+                }
+                else
+                {
+                    read_n = ret;
+                    goto _error;
+                }
+            }
+            else if ((field->type == SW_MYSQL_TYPE_DECIMAL || field->type == SW_MYSQL_TYPE_NEWDECIMAL)
+                    && client->connector.decimal_as_float && mysql_parse_double(buf + read_n, len, &dval) == SW_OK)
+            {
+                add_assoc_double(row_array, field->name, dval);
+            }
+            else
+            {
+                add_assoc_stringl(row_array, field->name, buf + read_n, len);
+            }
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "len=%lu, %s=%.*s", len, field->name, (int) len, buf + read_n);
+            break;
+
+        /* Integer */
+        case SW_MYSQL_TYPE_TINY:
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                row.utiny = *(uint8_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.utiny);
+                len = sizeof(row.utiny);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%u", field->name, row.utiny);
+            }
+            else
+            {
+                row.stiny = *(int8_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.stiny);
+                len = sizeof(row.stiny);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%d", field->name, row.stiny);
+            }
+            break;
+
+        case SW_MYSQL_TYPE_SHORT:
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                row.small = *(uint16_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.small);
+                len = sizeof(row.small);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%u", field->name, row.small);
+            }
+            else
+            {
+                row.ssmall = *(int16_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.ssmall);
+                len = sizeof(row.ssmall);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%d", field->name, row.ssmall);
+            }
+            break;
+
+        case SW_MYSQL_TYPE_INT24:
+        case SW_MYSQL_TYPE_LONG:
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                row.uint = *(uint32_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.uint);
+                len = sizeof(row.uint);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%u", field->name, row.uint);
+            }
+            else
+            {
+                row.sint = *(int32_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.sint);
+                len = sizeof(row.sint);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%d", field->name, row.sint);
+            }
+            break;
+
+        case SW_MYSQL_TYPE_LONGLONG:
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                row.ubigint = *(uint64_t *) (buf + read_n);
+                add_assoc_ulong_safe(row_array, field->name, row.ubigint);
+                len = sizeof(row.ubigint);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%llu", field->name, row.ubigint);
+            }
+            else
+            {
+                row.sbigint = *(int64_t *) (buf + read_n);
+                add_assoc_long(row_array, field->name, row.sbigint);
+                len = sizeof(row.sbigint);
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%lld", field->name, row.sbigint);
+            }
+            break;
+
+        case SW_MYSQL_TYPE_FLOAT:
+            row.mfloat = *(float *) (buf + read_n);
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%.7f", field->name, row.mfloat);
+            row.mdouble = _php_math_round(row.mfloat, 5, PHP_ROUND_HALF_DOWN);
+            add_assoc_double(row_array, field->name, row.mdouble);
+            len = sizeof(row.mfloat);
+            break;
+
+        case SW_MYSQL_TYPE_DOUBLE:
+            row.mdouble = *(double *) (buf + read_n);
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "%s=%.16f", field->name, row.mdouble);
+            add_assoc_double(row_array, field->name, row.mdouble);
+            len = sizeof(row.mdouble);
+            break;
+
+        default:
+            swWarn("unknown field type[%d].", field->type);
+            read_n = SW_ERR;
+            _error:
+            zval_ptr_dtor(row_array);
+            efree(row_array);
+            return read_n;
+        }
+        read_n += len;
+    }
+
+    add_next_index_zval(result_array, row_array);
+
+    efree(row_array);
+
+    return read_n + null_count;
+}
+
+static void mysql_parse_ok(mysql_client *client, char *buf);
+
+/**
+ * the packet with the 0xfe header at the end of the rows, an OK_Packet once CLIENT_DEPRECATE_EOF is negotiated
+ */
+static sw_inline int mysql_read_eof(mysql_client *client, char *buf, int n_buf)
+{
+    if (client->connector.capability_flags & SW_MYSQL_CLIENT_DEPRECATE_EOF)
+    {
+        mysql_parse_ok(client, buf);
+        return SW_OK;
+    }
+
+    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "EOF_Packet");
+
+    // EOF_Packet = Packet header (4 bytes) + 0xFE + warning(2byte) + status(2byte)
+
+    // skip packet header
+    buf += SW_MYSQL_PACKET_HEADER_SIZE;
+
+    // int<1>	header	[fe] EOF header
+    buf += 1;
+
+    // int<2>	warnings	number of warnings
+    client->response.warnings = mysql_uint2korr(buf);
+    buf += 2;
+
+    // int<2>	status_flags	Status Flags
+    client->response.status_code = mysql_uint2korr(buf);
+    MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "EOF_Packet, warnings=%u, status_code=%u", client->response.warnings, client->response.status_code);
+
+    return SW_OK;
+}
+
+static sw_inline int mysql_read_err(mysql_client *client, char *buf, int n_buf)
+{
+    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "ERR_Packet");
+
+    client->response.response_type = SW_MYSQL_PACKET_ERR;
+
+    // ERR Packet = Packet header (4 bytes) + ERR Payload
+
+    // skip packet header
+    buf += SW_MYSQL_PACKET_HEADER_SIZE;
+
+    // int<1>	header	[ff] header of the ERR packet
+    buf += 1;
+
+    // int<2>	error_code	error-code
+    client->response.error_code = mysql_uint2korr(buf);
+    buf += 2;
+
+    // string[1]	sql_state_marker	# marker of the SQL State
+    buf += 1;
+
+    // string[5]	sql_state	SQL State
+    memcpy(client->response.status_msg, buf, 5);
+    buf += 5;
+
+    // string<EOF>	error_message	human readable error message
+    client->response.server_msg = buf;
+    client->response.l_server_msg = client->response.packet_length - 9;
+    MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "ERR_Packet, error_code=%u, status_msg=%s", client->response.error_code, client->response.status_msg);
+
+    return SW_OK;
+}
+
+/**
+ * the session state changes of the OK packet, only the GTIDs and the current schema are kept
+ */
+static void mysql_read_session_state(mysql_client *client, char *buf, char *end)
+{
+    ulong_t length, l_gtid, l_schema;
+    uint8_t type;
+    char nul, *gtid;
+    int ret;
+
+    // string<lenenc>	session_state_info	Session State Information
+    ret = mysql_length_coded_binary(buf, &length, &nul, end - buf);
+    if (ret < 0 || buf + ret + length > end)
+    {
+        return;
+    }
+    buf += ret;
+    end = buf + length;
+
+    while (buf < end)
+    {
+        // int<1>	type	type of data, then string<lenenc>	data	data of the changed session info
+        type = (uint8_t) *buf++;
+        ret = mysql_length_coded_binary(buf, &length, &nul, end - buf);
+        if (ret < 0 || buf + ret + length > end)
+        {
+            return;
+        }
+        buf += ret;
+        // int<1> encoding specification, then string<lenenc> of the GTID set
+        if (type == SW_MYSQL_SESSION_TRACK_GTIDS && length > 1)
+        {
+            gtid = buf + 1;
+            ret = mysql_length_coded_binary(gtid, &l_gtid, &nul, length - 1);
+            if (ret > 0 && l_gtid > 0 && gtid + ret + l_gtid <= buf + length)
+            {
+                client->response.gtid = gtid + ret;
+                client->response.l_gtid = l_gtid;
+            }
+        }
+        // string<lenenc> of the new schema, USE changes the key of the cached results
+        else if (type == SW_MYSQL_SESSION_TRACK_SCHEMA && length > 0)
+        {
+            ret = mysql_length_coded_binary(buf, &l_schema, &nul, length);
+            if (ret > 0 && buf + ret + l_schema <= buf + length)
+            {
+                if (client->connector.database)
+                {
+                    efree(client->connector.database);
+                }
+                client->connector.database = estrndup(buf + ret, l_schema);
+                client->connector.database_len = l_schema;
+            }
+        }
+        buf += length;
+    }
+}
+
+/**
+ * the OK_Packet, with the [00] header or with the [fe] one at the end of the rows
+ */
+static void mysql_parse_ok(mysql_client *client, char *buf)
+{
+    int ret;
+    char nul;
+    char *end = buf + SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+    int n_buf = client->response.packet_length;
+
+    swMysqlPacketDump(buf, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "OK_Packet");
+
+    // skip packet header
+    buf += SW_MYSQL_PACKET_HEADER_SIZE;
+
+    // int<1>	header	[00] or [fe] the OK packet header
+    buf += 1;
+    n_buf -= 1;
+
+    // int<lenenc>	affected_rows	affected rows
+    ret = mysql_length_coded_binary(buf, &client->response.affected_rows, &nul, n_buf);
+    n_buf -= ret;
+    buf += ret;
+
+    // int<lenenc>	last_insert_id	last insert-id
+    ret = mysql_length_coded_binary(buf, &client->response.insert_id, &nul, n_buf);
+    n_buf -= ret;
+    buf += ret;
+
+    // int<2>	status_flags	Status Flags
+    client->response.status_code = mysql_uint2korr(buf);
+    buf += 2;
+
+    // int<2>	warnings	number of warnings
+    client->response.warnings = mysql_uint2korr(buf);
+    buf += 2;
+
+    if ((client->connector.capability_flags & SW_MYSQL_CLIENT_SESSION_TRACK) && buf < end)
+    {
+        ulong_t l_info;
+        // string<lenenc>	info	human readable status information
+        ret = mysql_length_coded_binary(buf, &l_info, &nul, end - buf);
+        if (ret > 0 && buf + ret + l_info < end && (client->response.status_code & SW_MYSQL_SERVER_SESSION_STATE_CHANGED))
+        {
+            mysql_read_session_state(client, buf + ret + l_info, end);
+        }
+    }
+
+    MYSQL_RESPONSE_BUFFER->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+
+    swTraceLog(
+        SW_TRACE_MYSQL_CLIENT, "OK_Packet, affected_rows=%lu, insert_id=%lu, status_flags=%u, warnings=%u",
+        client->response.affected_rows, client->response.insert_id, client->response.status_code, client->response.warnings
+    );
+}
+
+static sw_inline int mysql_ensure_packet(char *buf, int n_buf)
+{
+    if (n_buf < SW_MYSQL_PACKET_HEADER_SIZE)
+    {
+        return SW_ERR;
+    }
+
+    uint32_t packet_length = mysql_uint3korr(buf);
+
+    // Ensure that we've received the complete packet
+    if (n_buf < SW_MYSQL_PACKET_HEADER_SIZE + packet_length)
+    {
+        return SW_ERR;
+    }
+
+    return SW_OK;
+}
+
+static sw_inline int mysql_read_params(mysql_client *client)
+{
+    swString *buffer = MYSQL_RESPONSE_BUFFER;
+    char *p;
+    size_t n_buf;
+
+    while (1)
+    {
+        p = buffer->str + buffer->offset;
+        n_buf = buffer->length - buffer->offset;
+
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "n_buf=%zu, length=%u.", (uintmax_t) n_buf, client->response.packet_length);
+
+        // no EOF_Packet after the parameters
+        if (client->statement->unreaded_param_count == 0 && (client->connector.capability_flags & SW_MYSQL_CLIENT_DEPRECATE_EOF))
+        {
+            return SW_OK;
+        }
+
+        // Ensure that we've received the complete packet
+        if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+        {
+            return SW_AGAIN;
+        }
+
+        client->response.packet_length = mysql_uint3korr(p);
+        client->response.packet_number = p[3];
+
+        if (client->statement->unreaded_param_count > 0)
+        {
+            // Read and ignore parameter field. Sentence from MySQL source:
+            // skip parameters data: we don't support it yet
+            buffer->offset += (SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length);
+            client->statement->unreaded_param_count--;
+
+            swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "Protocol::ParameterDefinition");
+
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "read param, count=%d.", client->statement->unreaded_param_count);
+
+            continue;
+        }
+        else if ((uint8_t) p[4] != SW_MYSQL_PACKET_EOF)
+        {
+            swWarn("unexpected mysql non-eof packet.");
+            return SW_ERR;
+        }
+        else
+        {
+            return mysql_read_eof(client, p, n_buf);
+        }
+    }
+}
+
+/**
+ * @var char*    p      => packet beginning point
+ * @var size_t   n_buf  => remaining buffer length
+ * @var ssize_t  read_n => already read buffer len
+ */
+static sw_inline int mysql_read_rows(mysql_client *client)
+{
+    swString *buffer = MYSQL_RESPONSE_BUFFER;
+    char *p = buffer->str + buffer->offset;
+    size_t n_buf = buffer->length - buffer->offset;
+    ssize_t read_n = 0;
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "n_buf=%ju", (uintmax_t) n_buf);
+
+    //RecordSet parse
+    while (n_buf > 0)
+    {
+        if (client->big_value)
+        {
+            // the packets of the row are no longer in the buffer as they were received
+            if (!client->big_value->complete)
+            {
+                return SW_AGAIN;
+            }
+        }
+        // Ensure that we've received the complete packet
+        else if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+        {
+            return SW_AGAIN;
+        }
+
+        client->response.packet_length = mysql_uint3korr(p);
+        client->response.packet_number = p[3];
+
+        /**
+         * each packet is classified once by its first byte: a text row starts with a length, [fe] only for
+         * the values of 16M and more, so in a full packet, and [ff] never, a binary row starts with [00]
+         */
+        if (!client->big_value && client->response.packet_length < SW_MYSQL_MAX_PACKET_BODY_SIZE)
+        {
+            //RecordSet end
+            if ((uint8_t) p[4] == SW_MYSQL_PACKET_EOF)
+            {
+                mysql_read_eof(client, p, n_buf);
+                mysql_columns_free(client);
+                return SW_OK;
+            }
+            // ERR Instead of EOF
+            // @see: https://dev.mysql.com/doc/internals/en/err-instead-of-eof.html
+            else if ((uint8_t) p[4] == SW_MYSQL_PACKET_ERR)
+            {
+                mysql_read_err(client, p, n_buf);
+                mysql_columns_free(client);
+                return SW_OK;
+            }
+        }
+
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "record size=%d", client->response.packet_length);
+
+        // ProtocolBinary::ResultSetRow
+        swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length , "ProtocolBinary::ResultSetRow");
+
+
+        if (client->cmd == SW_MYSQL_COM_STMT_EXECUTE || client->cmd == SW_MYSQL_COM_STMT_FETCH)
+        {
+            // for execute
+            read_n = mysql_decode_row_prepare(
+                client,
+                p + SW_MYSQL_PACKET_HEADER_SIZE,
+                client->response.packet_length,
+                n_buf - SW_MYSQL_PACKET_HEADER_SIZE
+            );
+        }
+        else
+        {
+            // for query
+            read_n = mysql_decode_row(
+                client,
+                p + SW_MYSQL_PACKET_HEADER_SIZE,
+                client->response.packet_length,
+                n_buf - SW_MYSQL_PACKET_HEADER_SIZE
+            );
+        }
+
+        if (unlikely(read_n < 0))
+        {
+            // TODO: handle all decode error here
+            if (read_n == SW_AGAIN)
+            {
+                return SW_AGAIN;
+            }
+            mysql_columns_free(client);
+            return read_n;
+        }
+
+        // next row
+        p += SW_MYSQL_PACKET_HEADER_SIZE + read_n;
+        n_buf -= SW_MYSQL_PACKET_HEADER_SIZE + read_n;
+        buffer->offset += SW_MYSQL_PACKET_HEADER_SIZE + read_n;
+        client->response.num_row++;
+    }
+
+    // missing eof or err packet
+    return SW_AGAIN;
+}
+
+static int mysql_decode_field(char *buf, int len, mysql_field *col)
+{
+    int i;
+    ulong_t size;
+    char nul;
+    char *wh;
+    int tmp_len;
+
+    /**
+     * string buffer
+     */
+    char *_buffer = (char*) emalloc(len);
+    if (!_buffer)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    col->buffer = _buffer;
+
+    wh = buf;
+
+    i = 0;
+
+    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+    if (tmp_len == -1)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    i += tmp_len;
+    if (i + size > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+    col->catalog_length = size;
+    col->catalog = _buffer;
+    _buffer += (size + 1);
+    memcpy(col->catalog, &buf[i], size);
+    col->catalog[size] = '\0';
+    wh += size + 1;
+    i += size;
+
+    /* n (Length Coded String)    db */
+    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+    if (tmp_len == -1)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    i += tmp_len;
+    if (i + size > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+    col->db_length = size;
+    col->db = _buffer;
+    _buffer += (size + 1);
+    memcpy(col->db, &buf[i], size);
+    col->db[size] = '\0';
+    wh += size + 1;
+    i += size;
+
+    /* n (Length Coded String)    table */
+    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+    if (tmp_len == -1)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    i += tmp_len;
+    if (i + size > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+    col->table_length = size;
+    col->table = _buffer;
+    _buffer += (size + 1);
+    memcpy(col->table, &buf[i], size);
+    col->table[size] = '\0';
+    wh += size + 1;
+    i += size;
+
+    /* n (Length Coded String)    org_table */
+    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+    if (tmp_len == -1)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    i += tmp_len;
+    if (i + size > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+    col->org_table_length = size;
+    col->org_table = _buffer;
+    _buffer += (size + 1);
+    memcpy(col->org_table, &buf[i], size);
+    col->org_table[size] = '\0';
+    wh += size + 1;
+    i += size;
+
+    /* n (Length Coded String)    name */
+    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+    if (tmp_len == -1)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    i += tmp_len;
+    if (i + size > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+    col->name_length = size;
+    col->name = _buffer;
+    _buffer += (size + 1);
+    memcpy(col->name, &buf[i], size);
+    col->name[size] = '\0';
+    wh += size + 1;
+    i += size;
+
+    /* n (Length Coded String)    org_name */
+    tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+    if (tmp_len == -1)
+    {
+        return -SW_MYSQL_ERR_BAD_LCB;
+    }
+    i += tmp_len;
+    if (i + size > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+    col->org_name_length = size;
+    col->org_name = _buffer;
+    _buffer += (size + 1);
+    memcpy(col->org_name, &buf[i], size);
+    col->org_name[size] = '\0';
+    wh += size + 1;
+    i += size;
+
+    /* check len */
+    if (i + 13 > len)
+    {
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
+
+    /* (filler) */
+    i += 1;
+
+    /* charset */
+    col->charsetnr = mysql_uint2korr(&buf[i]);
+    i += 2;
+
+    /* length */
+    col->length = mysql_uint4korr(&buf[i]);
+    i += 4;
+
+    /* type */
+    col->type = (enum mysql_field_types) (uchar)buf[i];
+    i += 1;
+
+    /* flags */
+    col->flags = mysql_uint2korr(&buf[i]);
+    i += 2;
+
+    /* decimals */
+    col->decimals = buf[i];
+    i += 1;
+
+    /* filler */
+    i += 2;
+
+    /* default - a priori facultatif */
+    if (len - i > 0)
+    {
+        tmp_len = mysql_length_coded_binary(&buf[i], &size, &nul, len - i);
+        if (tmp_len == -1)
+        {
+            return -SW_MYSQL_ERR_BAD_LCB;
+        }
+        i += tmp_len;
+        if (i + size > len)
+        {
+            return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+        }
+        col->def_length = size;
+        col->def = _buffer;
+        //_buffer += (size + 1);
+        memcpy(col->def, &buf[i], size);
+        col->def[size] = '\0';
+        wh += size + 1;
+        i += size;
+    }
+    else
+    {
+        col->def = NULL;
+        col->def_length = 0;
+    }
+
+    /* set write pointer */
+    return wh - buf;
+}
+
+static int mysql_read_columns(mysql_client *client)
+{
+    swString *buffer = MYSQL_RESPONSE_BUFFER;
+    char *p = buffer->str + buffer->offset;
+    size_t n_buf = buffer->length - buffer->offset;
+    int ret;
+
+    for (; client->response.index_column < client->response.num_column; client->response.index_column++)
+    {
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "index_index_column=%ld, n_buf=%zu.", client->response.index_column, (uintmax_t) n_buf);
+
+        // Ensure that we've received the complete packet
+        if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+        {
+            return SW_AGAIN;
+        }
+
+        client->response.packet_length = mysql_uint3korr(p);
+        client->response.packet_number = p[3];
+
+        swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "Protocol::ColumnDefinition");
+
+        // skip the packet header
+        p += SW_MYSQL_PACKET_HEADER_SIZE;
+        n_buf -= SW_MYSQL_PACKET_HEADER_SIZE;
+
+        ret = mysql_decode_field(p, client->response.packet_length, &client->response.columns[client->response.index_column]);
+        if (ret > 0)
+        {
+            p += client->response.packet_length;
+            n_buf -= client->response.packet_length;
+            buffer->offset += (SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length);
+        }
+        else
+        {
+            swWarn("mysql_decode_field failed, code=%d.", ret);
+            return ret < 0 ? ret : SW_ERR;
+        }
+    }
+
+    /**
+     * the rows follow the column definitions without an EOF_Packet,
+     * but an opened cursor is still reported by the OK_Packet with SERVER_STATUS_CURSOR_EXISTS
+     */
+    zend_bool deprecate_eof = client->connector.capability_flags & SW_MYSQL_CLIENT_DEPRECATE_EOF;
+    zend_bool cursor = client->cmd == SW_MYSQL_COM_STMT_EXECUTE && client->requests->head
+            && ((mysql_request *) client->requests->head->data)->fetch_size > 0;
+    if (!deprecate_eof || cursor)
+    {
+        // Ensure that we've received the complete EOF_Packet
+        if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+        {
+            return SW_AGAIN;
+        }
+
+        client->response.packet_length = mysql_uint3korr(p);
+        client->response.packet_number = p[3];
+
+        if ((uint8_t) p[4] == SW_MYSQL_PACKET_EOF)
+        {
+            mysql_read_eof(client, p, n_buf);
+        }
+        // no cursor has been opened, the binary rows follow
+        else if (!deprecate_eof)
+        {
+            swWarn("unexpected mysql non-eof packet.");
+            return SW_ERR;
+        }
+    }
+
+    if (client->cmd != SW_MYSQL_COM_STMT_PREPARE)
+    {
+        if (!client->response.result_array)
+        {
+            client->response.result_array = sw_malloc_zval();;
+            array_init(client->response.result_array);
+        }
+    }
+
+    return SW_OK;
+}
+
+int mysql_response(mysql_client *client)
+{
+    swString *buffer = MYSQL_RESPONSE_BUFFER;
+
+    char *p;
+    int ret;
+    char nul;
+    size_t n_buf;
+
+    while ((n_buf = buffer->length - buffer->offset) > 0)
+    {
+        p = buffer->str + buffer->offset;
+        swTraceLog(SW_TRACE_MYSQL_CLIENT, "client->state=%d, n_buf=%zu.", client->state, n_buf);
+
+        switch (client->state)
+        {
+        case SW_MYSQL_STATE_READ_START:
+            // Ensure that we've received the complete packet
+            if (mysql_ensure_packet(p, n_buf) == SW_ERR)
+            {
+                if (client->hooks.onEvent)
+                {
+                    mysql_buffer_compact(buffer);
+                }
+                return SW_AGAIN;
+            }
+
+            client->response.packet_length = mysql_uint3korr(p);
+            client->response.packet_number = p[3];
+            client->response.response_type = p[4];
+
+            /* binlog events, each one in an OK packet, the stream only ends with an error */
+            if (client->hooks.onEvent && (client->cmd == SW_MYSQL_COM_BINLOG_DUMP || client->cmd == SW_MYSQL_COM_BINLOG_DUMP_GTID)
+                    && (client->event_continued || (uint8_t) p[4] == SW_MYSQL_PACKET_OK))
+            {
+                char *data = p + SW_MYSQL_PACKET_HEADER_SIZE;
+                size_t length = client->response.packet_length;
+                if (!client->event_continued)
+                {
+                    data++;
+                    length--;
+                }
+                client->event_continued = client->response.packet_length == SW_MYSQL_MAX_PACKET_BODY_SIZE;
+                buffer->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+                client->hooks.onEvent(client, data, length, client->event_continued);
+                // the stream never ends, the buffer must not grow with it
+                if (buffer->offset == buffer->length)
+                {
+                    swString_clear(buffer);
+                }
+                continue;
+            }
+            /* authentication of COM_CHANGE_USER */
+            else if (client->cmd == SW_MYSQL_COM_CHANGE_USER
+                    && ((uint8_t) p[4] == SW_MYSQL_PACKET_EOF || (uint8_t) p[4] == SW_MYSQL_AUTH_SIGNATURE))
+            {
+                if (mysql_change_user_auth(client, p, n_buf) < 0)
+                {
+                    return SW_ERR;
+                }
+                buffer->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+                continue;
+            }
+            /* error */
+            else if ((uint8_t) p[4] == SW_MYSQL_PACKET_ERR)
+            {
+                mysql_read_err(client, p, n_buf);
+                client->state = SW_MYSQL_STATE_READ_END;
+                return SW_OK;
+            }
+            /* eof */
+            else if ((uint8_t) p[4] == SW_MYSQL_PACKET_EOF && client->response.packet_length < SW_MYSQL_MAX_PACKET_BODY_SIZE)
+            {
+                mysql_read_eof(client, p, n_buf);
+                client->state = SW_MYSQL_STATE_READ_END;
+                return SW_OK;
+            }
+            /* ok */
+            else if ((uint8_t) p[4] == SW_MYSQL_PACKET_OK && client->cmd != SW_MYSQL_COM_STMT_PREPARE)
+            {
+                mysql_parse_ok(client, p);
+                client->state = SW_MYSQL_STATE_READ_END;
+                return SW_OK;
+            }
+            /* LOAD DATA LOCAL INFILE request, the client sends the file */
+            else if ((uint8_t) p[4] == SW_MYSQL_PACKET_LOCAL_INFILE && client->cmd == SW_MYSQL_COM_QUERY)
+            {
+                swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "LOCAL INFILE Request");
+                client->infile = ecalloc(1, sizeof(mysql_infile));
+                client->infile->client = client;
+                client->infile->fd = -1;
+                client->infile->filename = estrndup(p + SW_MYSQL_PACKET_HEADER_SIZE + 1, client->response.packet_length - 1);
+                client->infile->sequence = client->response.packet_number + 1;
+                buffer->offset += SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length;
+                client->state = SW_MYSQL_STATE_LOCAL_INFILE;
+                return SW_AGAIN;
+            }
+            /* COM_STMT_PREPARE_OK */
+            else if (mysql_parse_prepare_result(client, p, n_buf) == SW_OK)
+            {
+                client->response.num_column = client->statement->field_count;
+                if (client->response.num_column > 0)
+                {
+                    client->response.columns = ecalloc(client->response.num_column, sizeof(mysql_field));
+                }
+                if (client->statement->param_count > 0)
+                {
+                    client->state = SW_MYSQL_STATE_READ_PARAM;
+                }
+                else if (client->statement->field_count > 0)
+                {
+                    client->state = SW_MYSQL_STATE_READ_FIELD;
+                }
+                else
+                {
+                    return SW_OK;
+                }
+                break;
+            }
+            /* result set */
+            else
+            {
+                swMysqlPacketDump(p, SW_MYSQL_PACKET_HEADER_SIZE + client->response.packet_length, "ResultSet");
+
+                //Protocol::LengthEncodedInteger
+                ret = mysql_length_coded_binary(p + SW_MYSQL_PACKET_HEADER_SIZE, &client->response.num_column, &nul, n_buf - SW_MYSQL_PACKET_HEADER_SIZE);
+                if (ret < 0)
+                {
+                    return SW_ERR;
+                }
+                buffer->offset += (SW_MYSQL_PACKET_HEADER_SIZE + ret);
+
+                swTraceLog(SW_TRACE_MYSQL_CLIENT, "ResultSet_Packet: num_of_fields=%lu.", client->response.num_column);
+
+                // easy to the safe side: but under what circumstances would num_column will be 0 in result set?
+                if (client->response.num_column > 0)
+                {
+                    client->response.columns = ecalloc(client->response.num_column, sizeof(mysql_field));
+                }
+
+                client->state = SW_MYSQL_STATE_READ_FIELD;
+                break;
+            }
+
+        /* data of fields */
+        case SW_MYSQL_STATE_READ_FIELD:
+            if ((ret = mysql_read_columns(client)) < 0)
+            {
+                return ret;
+            }
+            else
+            {
+                if (client->cmd == SW_MYSQL_COM_STMT_PREPARE)
+                {
+                    mysql_columns_free(client);
+                    return SW_OK;
+                }
+                // the cursor is open, the rows will be sent by COM_STMT_FETCH
+                if (client->cmd == SW_MYSQL_COM_STMT_EXECUTE && (client->response.status_code & SW_MYSQL_SERVER_STATUS_CURSOR_EXISTS))
+                {
+                    client->state = SW_MYSQL_STATE_READ_END;
+                    return SW_OK;
+                }
+                client->state = SW_MYSQL_STATE_READ_ROW;
+                break;
+            }
+
+        /* data of rows */
+        case SW_MYSQL_STATE_READ_ROW:
+            if (client->cmd == SW_MYSQL_COM_STMT_FETCH && !client->response.columns)
+            {
+                mysql_request *request = client->requests->head->data;
+                // a set of rows, without the column definitions
+                client->response.response_type = SW_MYSQL_PACKET_EOF;
+                client->response.columns = request->statement->columns;
+                client->response.num_column = request->statement->num_column;
+                client->response.result_array = sw_malloc_zval();
+                array_init(client->response.result_array);
+            }
+            if ((ret = mysql_read_rows(client)) < 0)
+            {
+                return ret;
+            }
+            else
+            {
+                client->state = SW_MYSQL_STATE_READ_END;
+                return SW_OK;
+            }
+
+        /* prepare statment params */
+        case SW_MYSQL_STATE_READ_PARAM:
+            if ((ret = mysql_read_params(client)) < 0)
+            {
+                return ret;
+            }
+            else if (client->statement->field_count > 0)
+            {
+                client->state = SW_MYSQL_STATE_READ_FIELD;
+                continue;
+            }
+            else
+            {
+                mysql_columns_free(client);
+                return SW_OK;
+            }
+
+        /* the response comes after the data of the file */
+        case SW_MYSQL_STATE_LOCAL_INFILE:
+            return SW_AGAIN;
+
+        default:
+            return SW_ERR;
+        }
+    }
+
+    return SW_AGAIN;
+}
+
+#ifdef SW_HAVE_ZLIB
+/**
+ * every compressed packet starts with its compressed length, its sequence id and its length before compression,
+ * a zero length before compression means that the payload is not compressed
+ */
+static int mysql_compress_pack(swString *buffer, char *data, size_t length, uint8_t *sequence)
+{
+    size_t n, size;
+    uLongf zlength;
+    char *header, *payload;
+
+    swString_clear(buffer);
+    do
+    {
+        n = MIN(length, SW_MYSQL_MAX_PACKET_BODY_SIZE);
+        size = buffer->length + SW_MYSQL_COMPRESSED_HEADER_SIZE + compressBound(n);
+        if (size > buffer->size && swString_extend(buffer, size) < 0)
+        {
+            return SW_ERR;
+        }
+        header = buffer->str + buffer->length;
+        payload = header + SW_MYSQL_COMPRESSED_HEADER_SIZE;
+        zlength = compressBound(n);
+        if (n < SW_MYSQL_MIN_COMPRESS_LENGTH
+                || compress((Bytef *) payload, &zlength, (Bytef *) data, n) != Z_OK || zlength >= n)
+        {
+            memcpy(payload, data, n);
+            mysql_int3store(header, n);
+            mysql_int3store(header + 4, 0);
+            zlength = n;
+        }
+        else
+        {
+            mysql_int3store(header, zlength);
+            mysql_int3store(header + 4, n);
+        }
+        header[3] = (*sequence)++;
+        buffer->length += SW_MYSQL_COMPRESSED_HEADER_SIZE + zlength;
+        data += n;
+        length -= n;
+    } while (length > 0);
+
+    return SW_OK;
+}
+
+/**
+ * inflate every complete compressed packet of the input into the output,
+ * the protocol packets in the output are then parsed as usual
+ */
+static int mysql_decompress(mysql_client *client, swString *input, swString *output)
+{
+    char *p;
+    uint32_t zlength, length;
+    uLongf n;
+
+    while (input->length - input->offset >= SW_MYSQL_COMPRESSED_HEADER_SIZE)
+    {
+        p = input->str + input->offset;
+        zlength = mysql_uint3korr(p);
+        length = mysql_uint3korr(p + 4);
+        if (input->length - input->offset < SW_MYSQL_COMPRESSED_HEADER_SIZE + zlength)
+        {
+            break;
+        }
+        client->compress_sequence = p[3] + 1;
+        p += SW_MYSQL_COMPRESSED_HEADER_SIZE;
+        if (length == 0)
+        {
+            if (swString_append_ptr(output, p, zlength) < 0)
+            {
+                return SW_ERR;
+            }
+        }
+        else
+        {
+            if (output->size - output->length < length && swString_extend(output, output->length + length) < 0)
+            {
+                return SW_ERR;
+            }
+            n = length;
+            if (uncompress((Bytef *) output->str + output->length, &n, (Bytef *) p, zlength) != Z_OK || n != length)
+            {
+                swWarn("uncompress() failed, the compressed packet is broken.");
+                return SW_ERR;
+            }
+            output->length += length;
+        }
+        input->offset += SW_MYSQL_COMPRESSED_HEADER_SIZE + zlength;
+    }
+    mysql_buffer_compact(input);
+
+    return SW_OK;
+}
+#endif
+
+/**
+ * the compressed sequence starts again with each command, unless the data goes on with the exchange of the last one
+ */
+static int mysql_client_write(mysql_client *client, char *data, size_t length, uint8_t *sequence)
+{
+#ifdef SW_HAVE_ZLIB
+    if (client->compress_buffer)
+    {
+        if (mysql_compress_pack(mysql_compress_buffer, data, length, sequence) < 0)
+        {
+            return SW_ERR;
+        }
+        data = mysql_compress_buffer->str;
+        length = mysql_compress_buffer->length;
+    }
+#endif
+    return SwooleG.main_reactor->write(SwooleG.main_reactor, client->fd, data, length);
+}
+
+/**
+ * all the data sent after the handshake goes through here
+ */
+int mysql_client_send(mysql_client *client, char *data, size_t length)
+{
+    uint8_t sequence = 0;
+    return mysql_client_write(client, data, length, &sequence);
+}
+
+/**
+ * the connection sending KILL QUERY for a query which has timed out
+ */
+typedef struct
+{
+    zval _object;
+    char sql[32];
+    int length;
+} mysql_killer;
+
+static void mysql_killer_free(void *data)
+{
+    mysql_killer *killer = data;
+    zval_ptr_dtor(&killer->_object);
+    efree(killer);
+}
+
+static void mysql_killer_onResponse(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_killer *killer = request->data;
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        swWarn("%s failed.", killer->sql);
+    }
+    sw_zend_call_method_with_0_params(&killer->_object, swoole_mysql_ce, NULL, "close", NULL);
+}
+
+static void mysql_killer_onConnect(mysql_client *client, int success)
+{
+    mysql_killer *killer = client->hooks.data;
+    if (!success)
+    {
+        swWarn("failed to connect to send %s.", killer->sql);
+        return;
+    }
+    if (mysql_send_internal(&killer->_object, client, SW_MYSQL_COM_QUERY, killer->sql, killer->length, mysql_killer_onResponse, killer) < 0)
+    {
+        sw_zend_call_method_with_0_params(&killer->_object, swoole_mysql_ce, NULL, "close", NULL);
+    }
+}
+
+static void mysql_killer_onClose(mysql_client *client)
+{
+    mysql_killer *killer = client->hooks.data;
+    bzero(&client->hooks, sizeof(client->hooks));
+    // we are still in the call stack of the connection object
+    SwooleG.main_reactor->defer(SwooleG.main_reactor, mysql_killer_free, killer);
+}
+
+/**
+ * KILL QUERY from a new connection with the same server config, the connection itself is kept
+ */
+static int mysql_kill_query(zval *zobject, mysql_client *client)
+{
+    zval *server_info = sw_zend_read_property(swoole_mysql_ce, zobject, ZEND_STRL("serverInfo"), 1);
+    zval retval, zcallback;
+    mysql_client *kclient;
+
+    if (!server_info || Z_TYPE_P(server_info) != IS_ARRAY)
+    {
+        return SW_ERR;
+    }
+
+    mysql_killer *killer = ecalloc(1, sizeof(mysql_killer));
+    killer->length = snprintf(killer->sql, sizeof(killer->sql), "KILL QUERY %u", client->connector.connection_id);
+
+    object_init_ex(&killer->_object, swoole_mysql_ce);
+    sw_zend_call_method_with_0_params(&killer->_object, swoole_mysql_ce, NULL, "__construct", NULL);
+    kclient = swoole_get_object(&killer->_object);
+    kclient->hooks.data = killer;
+    kclient->hooks.onConnect = mysql_killer_onConnect;
+    kclient->hooks.onClose = mysql_killer_onClose;
+
+    ZVAL_NULL(&retval);
+    ZVAL_NULL(&zcallback);
+    zend_call_method_with_2_params(&killer->_object, swoole_mysql_ce, NULL, "connect", &retval, server_info, &zcallback);
+    if (Z_TYPE(retval) == IS_FALSE || UNEXPECTED(EG(exception)))
+    {
+        bzero(&kclient->hooks, sizeof(kclient->hooks));
+        mysql_killer_free(killer);
+        return SW_ERR;
+    }
+    zval_ptr_dtor(&retval);
+    return SW_OK;
+}
+
+/**
+ * the callback gets false with ETIMEDOUT, the response which comes later is discarded
+ */
+static void mysql_request_onTimeout(swTimer *timer, swTimer_node *tnode)
+{
+    mysql_request *request = tnode->data;
+    mysql_client *client = request->client;
+    zval *zobject = client->object;
+    zval *callback = request->callback;
+    zval args[2];
+
+    // the query is being executed by the server, not waiting behind another one
+    zend_bool running = client->requests->head && client->requests->head->data == request;
+
+    request->timer = NULL;
+    request->callback = NULL;
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "query of mysql connection#%d timed out after %.3fs", client->fd, request->timeout);
+
+    Z_TRY_ADDREF_P(zobject);
+    zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), ETIMEDOUT);
+    zend_update_property_string(swoole_mysql_ce, zobject, ZEND_STRL("error"), "query timed out");
+    args[0] = *zobject;
+    ZVAL_FALSE(&args[1]);
+    if (sw_call_user_function_ex(EG(function_table), NULL, callback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    sw_zval_free(callback);
+
+    // the callback may have closed the connection
+    if (running && client->cli && client->connected && swLinkedList_find(client->requests, request))
+    {
+        if (!client->connector.kill_on_timeout || mysql_kill_query(zobject, client) < 0)
+        {
+            sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
+        }
+    }
+    zval_ptr_dtor(zobject);
+}
+
+/**
+ * whether a new request can be sent now
+ */
+static int mysql_client_writable(mysql_client *client)
+{
+    if (!client->cli)
+    {
+        SwooleG.error = SW_ERROR_CLIENT_NO_CONNECTION;
+        php_swoole_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
+        return SW_ERR;
+    }
+    if (!client->connected)
+    {
+        SwooleG.error = SW_ERROR_CLIENT_NO_CONNECTION;
+        php_swoole_error(E_WARNING, "mysql client is not connected to server.");
+        return SW_ERR;
+    }
+    if (client->state != SW_MYSQL_STATE_QUERY && !client->connector.pipeline)
+    {
+        php_swoole_fatal_error(E_WARNING, "mysql client is waiting response, cannot send new sql query.");
+        return SW_ERR;
+    }
+
+    // responses of the pipelined queries may be still in the buffer
+    if (client->buffer && client->requests->num == 0)
+    {
+        swString_clear(client->buffer);
+    }
+    return SW_OK;
+}
+
+/**
+ * send the packets of the request, which have been packed already
+ */
+static int mysql_send_packed_request(zval *zobject, mysql_client *client, mysql_request *request, char *data, size_t length)
+{
+    if (mysql_client_send(client, data, length) < 0)
+    {
+        //connection is closed
+        if (swConnection_error(errno) == SW_CLOSE)
+        {
+            zend_update_property_bool(swoole_mysql_ce, zobject, ZEND_STRL("connected"), 0);
+            zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), 2013);
+            zend_update_property_string(swoole_mysql_ce, zobject, ZEND_STRL("error"), "Lost connection to MySQL server during query");
+        }
+        mysql_request_free(request);
+        return SW_ERR;
+    }
+
+    swLinkedList_append(client->requests, request);
+    if (client->requests->num == 1)
+    {
+        mysql_request_start(client, request);
+    }
+
+    request->client = client;
+    if (request->timeout <= 0)
+    {
+        request->timeout = client->connector.query_timeout;
+    }
+    // the internal requests and the cursors have no deadline
+    if (request->timeout > 0 && request->callback && request->fetch_size == 0)
+    {
+        request->timer = swTimer_add(&SwooleG.timer, (long) (request->timeout * 1000), 0, request, mysql_request_onTimeout);
+    }
+    return SW_OK;
+}
+
+static int mysql_send_request(zval *zobject, mysql_client *client, mysql_request *request, char *data, size_t length)
+{
+    if (mysql_client_writable(client) < 0 || mysql_command_pack(mysql_request_buffer, request->cmd, data, length) < 0)
+    {
+        mysql_request_free(request);
+        return SW_ERR;
+    }
+    if (client->connector.result_cache_ttl > 0 && (request->cmd == SW_MYSQL_COM_QUERY || request->cmd == SW_MYSQL_COM_STMT_PREPARE))
+    {
+        mysql_cache_track_session(&client->connector, data, length);
+    }
+    //send query
+    return mysql_send_packed_request(zobject, client, request, mysql_request_buffer->str, mysql_request_buffer->length);
+}
+
+int mysql_send_command(zval *zobject, mysql_client *client, uint8_t cmd, char *data, size_t length, zval *callback)
+{
+    return mysql_send_request(zobject, client, mysql_request_new(cmd, callback), data, length);
+}
+
+int mysql_send_internal(zval *zobject, mysql_client *client, uint8_t cmd, char *data, size_t length, mysql_request_handler handler, void *handler_data)
+{
+    mysql_request *request = mysql_request_new(cmd, NULL);
+    request->handler = handler;
+    request->data = handler_data;
+    return mysql_send_request(zobject, client, request, data, length);
+}
+
+static int mysql_stmt_fetch(zval *zobject, mysql_client *client, mysql_statement *stmt, uint32_t fetch_size, zval *callback)
+{
+    char buf[8];
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_STMT_FETCH, callback);
+
+    request->statement = stmt;
+    request->fetch_size = fetch_size;
+    // int<4> stmt-id, int<4> num rows
+    mysql_int4store(buf, stmt->id);
+    mysql_int4store(buf + 4, fetch_size);
+
+    return mysql_send_request(zobject, client, request, buf, sizeof(buf));
+}
+
+int mysql_query(zval *zobject, mysql_client *client, swString *sql, zval *callback)
+{
+    return mysql_send_command(zobject, client, SW_MYSQL_COM_QUERY, sql->str, sql->length, callback);
+}
+
+/**
+ * WAIT_FOR_EXECUTED_GTID_SET, the handler gets 0 once the server has executed the GTID set, 1 on the timeout
+ */
+int mysql_wait_gtid(zval *zobject, mysql_client *client, zend_string *gtid, double timeout, mysql_request_handler handler, void *handler_data)
+{
+    swString *sql = swString_new(SW_BUFFER_SIZE_STD);
+    char buf[32];
+    int ret;
+
+    swString_append_ptr(sql, ZEND_STRL("SELECT WAIT_FOR_EXECUTED_GTID_SET("));
+    if (mysql_escape_string(sql, ZSTR_VAL(gtid), ZSTR_LEN(gtid), &client->connector) < 0)
+    {
+        swString_free(sql);
+        return SW_ERR;
+    }
+    swString_append_ptr(sql, buf, snprintf(buf, sizeof(buf), ", %.3f)", timeout));
+    ret = mysql_send_internal(zobject, client, SW_MYSQL_COM_QUERY, sql->str, sql->length, handler, handler_data);
+    swString_free(sql);
+    return ret;
+}
+
+zend_bool mysql_gtid_reached(zval *result)
+{
+    zval *row, *value;
+
+    if (Z_TYPE_P(result) != IS_ARRAY || !(row = zend_hash_index_find(Z_ARRVAL_P(result), 0)) || Z_TYPE_P(row) != IS_ARRAY)
+    {
+        return 0;
+    }
+    zend_hash_internal_pointer_reset(Z_ARRVAL_P(row));
+    value = zend_hash_get_current_data(Z_ARRVAL_P(row));
+    return value && Z_TYPE_P(value) != IS_NULL && zval_get_long(value) == 0;
+}
+
+#ifdef SW_MYSQL_DEBUG
+
+void mysql_client_info(mysql_client *client)
+{
+    printf("\n" SW_START_LINE
+        "\nmysql_client\nbuffer->offset=%jd\nbuffer->length=%ju\nstatus=%u\n"
+        "packet_length=%u\npacket_number=%u\n"
+        "insert_id=%lu\naffected_rows=%lu\n"
+        "warnings=%u\n" SW_END_LINE,
+        (intmax_t) client->buffer->offset, (uintmax_t) client->buffer->length,
+        client->response.status_code,
+        client->response.packet_length, client->response.packet_number,
+        client->response.insert_id, client->response.affected_rows,
+        client->response.warnings
+    );
+    if (client->response.num_column)
+    {
+        int i;
+        for (i = 0; i < client->response.num_column; i++)
+        {
+            mysql_column_info(&client->response.columns[i]);
+        }
+    }
+}
+
+void mysql_column_info(mysql_field *field)
+{
+    printf("\n" SW_START_LINE
+        "\nname=%s, table=%s, db=%s\n"
+        "name_length=%d, table_length=%d, db_length=%d\n"
+        "catalog=%s, default_value=%s\n"
+        "length=%ld, type=%d\n" SW_END_LINE,
+        field->name, field->table, field->db,
+        field->name_length, field->table_length, field->db_length,
+        field->catalog, field->def,
+        field->length, field->type
+   );
+}
+
+#endif
+
+static PHP_METHOD(swoole_mysql, __construct)
+{
+    mysql_client *client = emalloc(sizeof(mysql_client));
+
+    bzero(client, sizeof(mysql_client));
+    client->requests = swLinkedList_new(0, mysql_request_free);
+    client->statement_list = swLinkedList_new(0, mysql_statement_free);
+    swoole_set_object(getThis(), client);
+}
+
+static PHP_METHOD(swoole_mysql, connect)
+{
+    zval *server_info;
+    zval *callback;
+    char buf[2048];
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "az", &server_info, &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (client->cli)
+    {
+        php_swoole_error(E_WARNING, "The mysql client is already connected server.");
+        RETURN_FALSE;
+    }
+
+    HashTable *_ht = Z_ARRVAL_P(server_info);
+    zval *value;
+    zend_string *str_host = NULL;
+    zend_string *str_user = NULL;
+    zend_string *str_password = NULL;
+    zend_string *str_database = NULL;
+    zend_string *str_charset = NULL;
+    zend_bool _retval = SW_TRUE;
+
+    mysql_connector *connector = &client->connector;
+
+    if (php_swoole_array_get_value(_ht, "host", value))
+    {
+        str_host = zval_get_string(value);
+        connector->host = ZSTR_VAL(str_host);
+        connector->host_len = ZSTR_LEN(str_host);
+    }
+    else
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "HOST parameter is required.", 11);
+        RETURN_FALSE;
+    }
+    if (php_swoole_array_get_value(_ht, "port", value))
+    {
+        connector->port = zval_get_long(value);
+    }
+    else
+    {
+        connector->port = SW_MYSQL_DEFAULT_PORT;
+    }
+    if (php_swoole_array_get_value(_ht, "user", value))
+    {
+        str_user = zval_get_string(value);
+        connector->user = ZSTR_VAL(str_user);
+        connector->user_len = ZSTR_LEN(str_user);
+    }
+    else
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "USER parameter is required.", 11);
+        _retval = SW_FALSE;
+        goto _return;
+    }
+    if (php_swoole_array_get_value(_ht, "password", value))
+    {
+        str_password = zval_get_string(value);
+        connector->password = ZSTR_VAL(str_password);
+        connector->password_len = ZSTR_LEN(str_password);
+    }
+    else
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "PASSWORD parameter is required.", 11);
+        _retval = SW_FALSE;
+        goto _return;
+    }
+    if (php_swoole_array_get_value(_ht, "database", value))
+    {
+        str_database = zval_get_string(value);
+        connector->database = ZSTR_VAL(str_database);
+        connector->database_len = ZSTR_LEN(str_database);
+    }
+    else
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "DATABASE parameter is required.", 11);
+        _retval = SW_FALSE;
+        goto _return;
+    }
+    if (php_swoole_array_get_value(_ht, "timeout", value))
+    {
+        connector->timeout = zval_get_double(value);
+    }
+    else
+    {
+        connector->timeout = SW_MYSQL_CONNECT_TIMEOUT;
+    }
+    if (php_swoole_array_get_value(_ht, "charset", value))
+    {
+        str_charset = zval_get_string(value);
+        connector->character_set = mysql_get_charset(ZSTR_VAL(str_charset));
+        if (connector->character_set < 0)
+        {
+            snprintf(buf, sizeof(buf), "unknown charset [%s].", ZSTR_VAL(str_charset));
+            zend_throw_exception(swoole_mysql_exception_ce, buf, 11);
+            _retval = SW_FALSE;
+            goto _return;
+        }
+    }
+    //use the server default charset.
+    else
+    {
+        connector->character_set = 0;
+    }
+
+    if (php_swoole_array_get_value(_ht, "strict_type", value))
+    {
+        connector->strict_type = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "fetch_mode", value))
+    {
+        connector->fetch_mode = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "decimal_as_float", value))
+    {
+        connector->decimal_as_float = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "datetime_as_timestamp", value))
+    {
+        connector->datetime_as_timestamp = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "pipeline", value))
+    {
+        connector->pipeline = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "multi_statements", value))
+    {
+        connector->multi_statements = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "track_gtids", value))
+    {
+        connector->track_gtids = zval_is_true(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "query_timeout", value))
+    {
+        connector->query_timeout = zval_get_double(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "result_cache_ttl", value))
+    {
+        connector->result_cache_ttl = zval_get_double(value);
+    }
+
+    if (php_swoole_array_get_value(_ht, "kill_on_timeout", value))
+    {
+        connector->kill_on_timeout = zval_is_true(value);
+    }
+    else
+    {
+        connector->kill_on_timeout = 1;
+    }
+
+    if (php_swoole_array_get_value(_ht, "max_allowed_packet", value))
+    {
+        connector->max_packet_size = zval_get_long(value);
+    }
+    if (connector->max_packet_size <= 0)
+    {
+        connector->max_packet_size = SW_MYSQL_MAX_ALLOWED_PACKET;
+    }
+
+    // true, or the directory the files must be in
+    if (php_swoole_array_get_value(_ht, "local_infile", value))
+    {
+        if (Z_TYPE_P(value) == IS_STRING)
+        {
+            char path[PATH_MAX];
+            if (!realpath(Z_STRVAL_P(value), path))
+            {
+                php_swoole_fatal_error(E_WARNING, "local_infile directory '%s' does not exist.", Z_STRVAL_P(value));
+            }
+            else
+            {
+                connector->local_infile = 1;
+                connector->local_infile_dir = estrdup(path);
+            }
+        }
+        else
+        {
+            connector->local_infile = zval_is_true(value);
+        }
+    }
+
+    if (php_swoole_array_get_value(_ht, "compression", value))
+    {
+#ifdef SW_HAVE_ZLIB
+        connector->compression = zval_is_true(value);
+#else
+        if (zval_is_true(value))
+        {
+            php_swoole_fatal_error(E_WARNING, "the compressed protocol requires zlib support.");
+        }
+#endif
+    }
+
+#ifdef SW_USE_OPENSSL
+    connector->ssl_ctx = NULL;
+    connector->ssl_verify_peer = 0;
+    connector->ssl_ktls = 1;
+#endif
+    if (php_swoole_array_get_value(_ht, "ssl", value) && zval_is_true(value))
+    {
+#ifdef SW_USE_OPENSSL
+        if (!(connector->ssl_ctx = mysql_ssl_context_get(_ht, buf, sizeof(buf))))
+        {
+            zend_throw_exception(swoole_mysql_exception_ce, buf, 11);
+            _retval = SW_FALSE;
+            goto _return;
+        }
+        if (php_swoole_array_get_value(_ht, "ssl_verify_peer", value))
+        {
+            connector->ssl_verify_peer = zval_is_true(value);
+        }
+        if (php_swoole_array_get_value(_ht, "ssl_ktls", value))
+        {
+            connector->ssl_ktls = zval_is_true(value);
+        }
+#else
+        zend_throw_exception(swoole_mysql_exception_ce, "SSL connections require openssl support.", 11);
+        _retval = SW_FALSE;
+        goto _return;
+#endif
+    }
+
+    swClient *cli = emalloc(sizeof(swClient));
+    int type = SW_SOCK_TCP;
+
+    if (strncasecmp(connector->host, ZEND_STRL("unix:/")) == 0)
+    {
+        connector->host = connector->host + 5;
+        connector->host_len = connector->host_len - 5;
+        type = SW_SOCK_UNIX_STREAM;
+    }
+    else if (strchr(connector->host, ':'))
+    {
+        type = SW_SOCK_TCP6;
+    }
+
+    php_swoole_check_reactor();
+    if (!swReactor_isset_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL))
+    {
+        swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ, swoole_mysql_onRead);
+        swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL | SW_EVENT_WRITE, swoole_mysql_onWrite);
+        swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL | SW_EVENT_ERROR, swoole_mysql_onError);
+    }
+    //create socket
+    if (swClient_create(cli, type, 0) < 0)
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "swClient_create failed.", 1);
+        _retval = SW_FALSE;
+        goto _return;
+    }
+    //tcp nodelay
+    if (type != SW_SOCK_UNIX_STREAM)
+    {
+        int tcp_nodelay = 1;
+        if (setsockopt(cli->socket->fd, IPPROTO_TCP, TCP_NODELAY, (const void *) &tcp_nodelay, sizeof(int)) != 0)
+        {
+            php_swoole_sys_error(E_WARNING, "setsockopt(%d, IPPROTO_TCP, TCP_NODELAY) failed.", cli->socket->fd);
+        }
+    }
+    //connect to mysql server
+    int ret = cli->connect(cli, connector->host, connector->port, connector->timeout, 1);
+    if ((ret < 0 && errno == EINPROGRESS) || ret == 0)
+    {
+        if (connector->timeout > 0)
+        {
+            cli->timer = swTimer_add(&SwooleG.timer, (long) (connector->timeout * 1000), 0, client, swoole_mysql_onTimeout);
+            cli->timeout = connector->timeout;
+        }
+        if (SwooleG.main_reactor->add(SwooleG.main_reactor, cli->socket->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_WRITE) < 0)
+        {
+            _retval = SW_FALSE;
+            goto _return;
+        }
+    }
+    else
+    {
+        snprintf(buf, sizeof(buf), "connect to mysql server[%s:%ld] failed.", connector->host, connector->port);
+        zend_throw_exception(swoole_mysql_exception_ce, buf, 2);
+        _retval = SW_FALSE;
+        goto _return;
+    }
+
+    zend_update_property(swoole_mysql_ce, getThis(), ZEND_STRL("onConnect"), callback);
+    zend_update_property(swoole_mysql_ce, getThis(), ZEND_STRL("serverInfo"), server_info);
+    zend_update_property_null(swoole_mysql_ce, getThis(), ZEND_STRL("tlsInfo"));
+    zend_update_property_long(swoole_mysql_ce, getThis(), ZEND_STRL("sock"), cli->socket->fd);
+
+    client->buffer = swString_new(SW_BUFFER_SIZE_BIG);
+    client->fd = cli->socket->fd;
+    client->object = getThis();
+    client->cli = cli;
+
+    connector->host = estrndup(connector->host, connector->host_len);
+    connector->user = estrndup(connector->user, connector->user_len);
+    connector->password = estrndup(connector->password, connector->password_len);
+    connector->database = estrndup(connector->database, connector->database_len);
+
+    sw_copy_to_stack(client->object, client->_object);
+    Z_TRY_ADDREF_P(client->object);
+
+    swConnection *_socket = swReactor_get(SwooleG.main_reactor, cli->socket->fd);
+    _socket->object = client;
+    _socket->active = 0;
+
+    _return:
+    if (str_host)
+    {
+        zend_string_release(str_host);
+    }
+    if (str_user)
+    {
+        zend_string_release(str_user);
+    }
+    if (str_password)
+    {
+        zend_string_release(str_password);
+    }
+    if (str_database)
+    {
+        zend_string_release(str_database);
+    }
+    if (str_charset)
+    {
+        zend_string_release(str_charset);
+    }
+    RETURN_BOOL(_retval);
+}
+
+static PHP_METHOD(swoole_mysql, query)
+{
+    zval *callback;
+    swString sql;
+    double timeout = 0;
+    bzero(&sql, sizeof(sql));
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz|d", &sql.str, &sql.length, &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    if (sql.length <= 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    mysql_cache_flight *flight = NULL;
+    /**
+     * the result set comes from the cache, or from the same query sent by another connection,
+     * never inside a transaction, however it has been started
+     */
+    zend_bool in_transaction = client->transaction || (client->connector.server_status & SW_MYSQL_SERVER_STATUS_IN_TRANS)
+            || !(client->connector.server_status & SW_MYSQL_SERVER_STATUS_AUTOCOMMIT);
+    if (client->connector.result_cache_ttl > 0 && client->connected && !in_transaction
+            && mysql_cache_lookup(getThis(), client, sql.str, sql.length, callback, &flight) == SW_OK)
+    {
+        RETURN_TRUE;
+    }
+
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_QUERY, callback);
+    request->timeout = timeout;
+    if (flight)
+    {
+        request->handler = mysql_cache_onResponse;
+        request->data = flight;
+    }
+    if (mysql_send_request(getThis(), client, request, sql.str, sql.length) < 0)
+    {
+        if (flight)
+        {
+            mysql_cache_flight_free(flight);
+        }
+        RETURN_FALSE;
+    }
+    RETURN_TRUE;
+}
+
+/**
+ * the callback gets an array with the result of every statement, in order
+ */
+static PHP_METHOD(swoole_mysql, multiQuery)
+{
+    zval *callback;
+    swString sql;
+    double timeout = 0;
+    bzero(&sql, sizeof(sql));
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz|d", &sql.str, &sql.length, &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    if (sql.length <= 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_QUERY, callback);
+    request->multi = 1;
+    request->timeout = timeout;
+    SW_CHECK_RETURN(mysql_send_request(getThis(), client, request, sql.str, sql.length));
+}
+
+static void mysql_onWaitForGtid(mysql_client *client, mysql_request *request, zval *result)
+{
+    zval *callback = request->data;
+    zval args[2];
+
+    if (client->cli && !client->cli->destroyed)
+    {
+        args[0] = *client->object;
+        ZVAL_BOOL(&args[1], mysql_gtid_reached(result));
+        if (sw_call_user_function_ex(EG(function_table), NULL, callback, NULL, 2, args, 0, NULL) != SUCCESS)
+        {
+            php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+        }
+        if (UNEXPECTED(EG(exception)))
+        {
+            zend_exception_error(EG(exception), E_ERROR);
+        }
+    }
+    sw_zval_free(callback);
+}
+
+/**
+ * the callback gets true once the server has executed the GTID set, e.g. the gtid property of the primary connection
+ */
+static PHP_METHOD(swoole_mysql, waitForGtid)
+{
+    zend_string *gtid;
+    zval *callback;
+    double timeout = 1;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "Sz|d", &gtid, &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    Z_TRY_ADDREF_P(callback);
+    callback = sw_zval_dup(callback);
+    if (mysql_wait_gtid(getThis(), client, gtid, timeout, mysql_onWaitForGtid, callback) < 0)
+    {
+        sw_zval_free(callback);
+        RETURN_FALSE;
+    }
+    RETURN_TRUE;
+}
+
+/**
+ * the statement is built in the request buffer, after the room for the packet header and the command
+ */
+static int mysql_batch_begin(swString *prefix)
+{
+    swString_clear(mysql_request_buffer);
+    mysql_request_buffer->length = SW_MYSQL_PACKET_HEADER_SIZE + 1;
+    return swString_append(mysql_request_buffer, prefix);
+}
+
+static int mysql_batch_write(zval *zobject, mysql_client *client, mysql_batch *batch, char *data, size_t length)
+{
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_QUERY, NULL);
+
+    request->batch = batch;
+    batch->pending++;
+    return mysql_send_packed_request(zobject, client, request, data, length);
+}
+
+/**
+ * without the pipeline option, a statement is kept until the previous one has responded
+ */
+static int mysql_batch_send(zval *zobject, mysql_client *client, mysql_batch *batch)
+{
+    char *header = mysql_request_buffer->str;
+    swString *statement;
+
+    mysql_int3store(header, mysql_request_buffer->length - SW_MYSQL_PACKET_HEADER_SIZE);
+    header[3] = 0;
+    header[4] = SW_MYSQL_COM_QUERY;
+
+    // a statement in flight holds the batch besides insertBatch itself
+    if (!client->connector.pipeline && batch->pending > 1)
+    {
+        if (!(statement = swString_dup(mysql_request_buffer->str, mysql_request_buffer->length)))
+        {
+            return SW_ERR;
+        }
+        if (!batch->statements)
+        {
+            batch->statements = swLinkedList_new(0, NULL);
+        }
+        swLinkedList_append(batch->statements, statement);
+        return SW_OK;
+    }
+    return mysql_batch_write(zobject, client, batch, mysql_request_buffer->str, mysql_request_buffer->length);
+}
+
+/**
+ * the rows are split into INSERT statements that fit in a packet below max_allowed_packet,
+ * the statements are pipelined with the pipeline option, otherwise they are sent one after another,
+ * the callback gets the sum of the affected rows
+ */
+static PHP_METHOD(swoole_mysql, insertBatch)
+{
+    char *table;
+    size_t table_len;
+    zval *columns, *rows, *callback, *value, *row;
+    zend_object_iterator *iterator = NULL;
+    HashPosition position;
+    uint32_t num_columns, num_rows = 0, index = 0, sent = 0;
+    int ret = SW_OK;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sazz", &table, &table_len, &columns, &rows, &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    num_columns = zend_hash_num_elements(Z_ARRVAL_P(columns));
+    if (table_len == 0 || num_columns == 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "table and columns can not be empty.");
+        RETURN_FALSE;
+    }
+    if (Z_TYPE_P(rows) != IS_ARRAY && !(Z_TYPE_P(rows) == IS_OBJECT && instanceof_function(Z_OBJCE_P(rows), zend_ce_traversable)))
+    {
+        php_swoole_fatal_error(E_WARNING, "rows must be an array or Traversable.");
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+    if (mysql_client_writable(client) < 0)
+    {
+        RETURN_FALSE;
+    }
+
+    // every statement is sent in a single packet
+    size_t limit = MIN((size_t) client->connector.max_packet_size, SW_MYSQL_MAX_PACKET_BODY_SIZE);
+
+    swString *prefix = swString_new(SW_BUFFER_SIZE_STD);
+    swString *values = swString_new(SW_BUFFER_SIZE_STD);
+
+    swString_append_ptr(prefix, ZEND_STRL("INSERT INTO "));
+    mysql_escape_identifier(prefix, table, table_len);
+    swString_append_ptr(prefix, ZEND_STRL(" ("));
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(columns), value)
+    {
+        zend_string *column = zval_get_string(value);
+        if (index++ > 0)
+        {
+            swString_append_ptr(prefix, ZEND_STRL(","));
+        }
+        mysql_escape_identifier(prefix, ZSTR_VAL(column), ZSTR_LEN(column));
+        zend_string_release(column);
+    }
+    ZEND_HASH_FOREACH_END();
+    swString_append_ptr(prefix, ZEND_STRL(") VALUES "));
+
+    mysql_batch *batch = ecalloc(1, sizeof(mysql_batch));
+    Z_TRY_ADDREF_P(callback);
+    batch->callback = sw_zval_dup(callback);
+    // held until all the statements have been sent
+    batch->pending = 1;
+
+    mysql_batch_begin(prefix);
+
+    if (Z_TYPE_P(rows) == IS_ARRAY)
+    {
+        zend_hash_internal_pointer_reset_ex(Z_ARRVAL_P(rows), &position);
+    }
+    else
+    {
+        iterator = Z_OBJCE_P(rows)->get_iterator(Z_OBJCE_P(rows), rows, 0);
+        if (!iterator || EG(exception))
+        {
+            ret = SW_ERR;
+            goto _free;
+        }
+        if (iterator->funcs->rewind)
+        {
+            iterator->funcs->rewind(iterator);
+        }
+    }
+
+    for (index = 0; ; index++)
+    {
+        if (iterator)
+        {
+            if (EG(exception) || iterator->funcs->valid(iterator) != SUCCESS)
+            {
+                break;
+            }
+            row = iterator->funcs->get_current_data(iterator);
+        }
+        else
+        {
+            row = zend_hash_get_current_data_ex(Z_ARRVAL_P(rows), &position);
+        }
+        if (!row || EG(exception))
+        {
+            break;
+        }
+        ZVAL_DEREF(row);
+        if (Z_TYPE_P(row) != IS_ARRAY || zend_hash_num_elements(Z_ARRVAL_P(row)) != num_columns)
+        {
+            php_swoole_fatal_error(E_WARNING, "row#%u must be an array of %u values.", index, num_columns);
+            ret = SW_ERR;
+            break;
+        }
+
+        swString_clear(values);
+        swString_append_ptr(values, ZEND_STRL("("));
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(row), value)
+        {
+            if (values->length > 1)
+            {
+                swString_append_ptr(values, ZEND_STRL(","));
+            }
+            if (mysql_escape_value(values, value, &client->connector) < 0)
+            {
+                ret = SW_ERR;
+                break;
+            }
+        }
+        ZEND_HASH_FOREACH_END();
+        if (ret < 0)
+        {
+            break;
+        }
+        swString_append_ptr(values, ZEND_STRL(")"));
+
+        // the row does not fit in the statement, send it and start the next one
+        if (num_rows > 0 && mysql_request_buffer->length - SW_MYSQL_PACKET_HEADER_SIZE + 1 + values->length > limit)
+        {
+            if (mysql_batch_send(getThis(), client, batch) < 0)
+            {
+                ret = SW_ERR;
+                break;
+            }
+            sent++;
+            num_rows = 0;
+            mysql_batch_begin(prefix);
+        }
+        if (num_rows == 0 && mysql_request_buffer->length - SW_MYSQL_PACKET_HEADER_SIZE + values->length > limit)
+        {
+            php_swoole_fatal_error(E_WARNING, "row#%u exceeds max_allowed_packet(%d).", index, client->connector.max_packet_size);
+            ret = SW_ERR;
+            break;
+        }
+        if (num_rows > 0)
+        {
+            swString_append_ptr(mysql_request_buffer, ZEND_STRL(","));
+        }
+        swString_append(mysql_request_buffer, values);
+        num_rows++;
+
+        if (iterator)
+        {
+            iterator->funcs->move_forward(iterator);
+        }
+        else
+        {
+            zend_hash_move_forward_ex(Z_ARRVAL_P(rows), &position);
+        }
+    }
+
+    if (EG(exception))
+    {
+        ret = SW_ERR;
+    }
+    if (ret == SW_OK && num_rows > 0)
+    {
+        if (mysql_batch_send(getThis(), client, batch) < 0)
+        {
+            ret = SW_ERR;
+        }
+        else
+        {
+            sent++;
+        }
+    }
+    else if (ret == SW_OK && sent == 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "no rows to insert.");
+        ret = SW_ERR;
+    }
+
+    _free:
+    if (iterator)
+    {
+        zend_iterator_dtor(iterator);
+    }
+    swString_free(prefix);
+    swString_free(values);
+
+    // the statements already sent still respond, the callback gets false
+    if (ret < 0)
+    {
+        batch->failed = 1;
+    }
+    if (sent == 0)
+    {
+        sw_zval_free(batch->callback);
+        efree(batch);
+        RETURN_FALSE;
+    }
+    batch->pending--;
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_mysql, loadData)
+{
+    zval *source;
+    zval *callback;
+    char *sql;
+    size_t sql_len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "szz", &sql, &sql_len, &source, &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!(Z_TYPE_P(source) == IS_OBJECT && instanceof_function(Z_OBJCE_P(source), zend_ce_iterator))
+            && !php_swoole_is_callable(source))
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    if (sql_len <= 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    // the data of the LOCAL INFILE request comes from the source instead of the file
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_QUERY, callback);
+    Z_TRY_ADDREF_P(source);
+    request->infile_source = sw_zval_dup(source);
+    SW_CHECK_RETURN(mysql_send_request(getThis(), client, request, sql, sql_len));
+}
+
+static PHP_METHOD(swoole_mysql, prepare)
+{
+    zval *callback;
+    char *sql;
+    size_t sql_len;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz", &sql, &sql_len, &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    if (sql_len <= 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    SW_CHECK_RETURN(mysql_send_command(getThis(), client, SW_MYSQL_COM_STMT_PREPARE, sql, sql_len, callback));
+}
+
+static PHP_METHOD(swoole_mysql, execute)
+{
+    zend_long id;
+    zval *params;
+    zval *callback;
+    zval *options = NULL;
+    zval *value;
+    uint32_t fetch_size = 0;
+    HashTable *long_data = NULL;
+    zend_string *key;
+    zend_ulong index;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "laz|a", &id, &params, &callback, &options) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    mysql_statement *stmt = client->statement_list ? mysql_statement_find(client, id) : NULL;
+    if (!stmt)
+    {
+        php_swoole_fatal_error(E_WARNING, "statement#" ZEND_LONG_FMT " does not exist.", id);
+        RETURN_FALSE;
+    }
+    if (stmt->columns)
+    {
+        php_swoole_fatal_error(E_WARNING, "statement#" ZEND_LONG_FMT " has an open cursor.", id);
+        RETURN_FALSE;
+    }
+    if (php_swoole_array_length(params) != stmt->param_count)
+    {
+        php_swoole_fatal_error(E_WARNING, "statement#" ZEND_LONG_FMT " expects %d parameters, %d given.", id, stmt->param_count, php_swoole_array_length(params));
+        RETURN_FALSE;
+    }
+
+    if (options && php_swoole_array_get_value(Z_ARRVAL_P(options), "fetch_size", value))
+    {
+        fetch_size = MAX(0, zval_get_long(value));
+    }
+
+    // the file path or the file stream of the parameters, by their index
+    if (options && php_swoole_array_get_value(Z_ARRVAL_P(options), "long_data", value) && Z_TYPE_P(value) == IS_ARRAY
+            && zend_hash_num_elements(Z_ARRVAL_P(value)) > 0)
+    {
+        long_data = Z_ARRVAL_P(value);
+        ZEND_HASH_FOREACH_KEY(long_data, index, key)
+        {
+            if (key)
+            {
+                php_swoole_fatal_error(E_WARNING, "the long data must be indexed by the parameter number.");
+                RETURN_FALSE;
+            }
+            if (index >= stmt->param_count)
+            {
+                php_swoole_fatal_error(E_WARNING, "statement#" ZEND_LONG_FMT " has no parameter#" ZEND_ULONG_FMT ".", id, index);
+                RETURN_FALSE;
+            }
+        }
+        ZEND_HASH_FOREACH_END();
+        if (client->long_data)
+        {
+            php_swoole_fatal_error(E_WARNING, "the long data of another statement is being sent.");
+            RETURN_FALSE;
+        }
+    }
+
+    // a read-only cursor keeps the rows on the server, they are fetched fetch_size by fetch_size
+    if (mysql_execute_pack(mysql_statement_buffer, stmt, Z_ARRVAL_P(params), fetch_size > 0 ? SW_MYSQL_CURSOR_TYPE_READ_ONLY : SW_MYSQL_CURSOR_TYPE_NO_CURSOR, long_data) < 0)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_STMT_EXECUTE, callback);
+    if (fetch_size > 0)
+    {
+        request->statement = stmt;
+        request->fetch_size = fetch_size;
+    }
+    if (long_data)
+    {
+        SW_CHECK_RETURN(mysql_long_data_start(client, stmt, long_data, request));
+    }
+    SW_CHECK_RETURN(mysql_send_request(getThis(), client, request, mysql_statement_buffer->str, mysql_statement_buffer->length));
+}
+
+static PHP_METHOD(swoole_mysql, closeStatement)
+{
+    zend_long id;
+    char buf[4];
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "l", &id) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client || !client->cli)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_statement *stmt = mysql_statement_find(client, id);
+    if (!stmt)
+    {
+        RETURN_FALSE;
+    }
+    if (stmt->columns)
+    {
+        php_swoole_fatal_error(E_WARNING, "statement#" ZEND_LONG_FMT " has an open cursor.", id);
+        RETURN_FALSE;
+    }
+
+    swLinkedList_remove_node(client->statement_list, swLinkedList_find(client->statement_list, stmt));
+    mysql_statement_free(stmt);
+
+    // COM_STMT_CLOSE has no response
+    mysql_int4store(buf, (uint32_t) id);
+    if (mysql_command_pack(mysql_request_buffer, SW_MYSQL_COM_STMT_CLOSE, buf, sizeof(buf)) < 0)
+    {
+        RETURN_FALSE;
+    }
+    SW_CHECK_RETURN(mysql_client_send(client, mysql_request_buffer->str, mysql_request_buffer->length));
+}
+
+static PHP_METHOD(swoole_mysql, begin)
+{
+    zval *callback;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+    if (client->transaction)
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "There is already an active transaction.", 21);
+        RETURN_FALSE;
+    }
+
+    swString sql;
+    bzero(&sql, sizeof(sql));
+    swString_append_ptr(&sql, ZEND_STRL("START TRANSACTION"));
+    if (mysql_query(getThis(), client, &sql, callback) < 0)
+    {
+        RETURN_FALSE;
+    }
+    else
+    {
+        client->transaction = 1;
+        RETURN_TRUE;
+    }
+}
+
+static PHP_METHOD(swoole_mysql, commit)
+{
+    zval *callback;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+    if (!client->transaction)
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "There is no active transaction.", 22);
+        RETURN_FALSE;
+    }
+
+    swString sql;
+    bzero(&sql, sizeof(sql));
+    swString_append_ptr(&sql, ZEND_STRL("COMMIT"));
+    if (mysql_query(getThis(), client, &sql, callback) < 0)
+    {
+        RETURN_FALSE;
+    }
+    else
+    {
+        client->transaction = 0;
+        RETURN_TRUE;
+    }
+}
+
+static PHP_METHOD(swoole_mysql, rollback)
+{
+    zval *callback;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+    if (!client->transaction)
+    {
+        zend_throw_exception(swoole_mysql_exception_ce, "There is no active transaction.", 22);
+        RETURN_FALSE;
+    }
 
-    return SW_AGAIN;
-}
-
-static int mysql_query(zval *zobject, mysql_client *client, swString *sql, zval *callback)
-{
-    if (!client->cli)
+    swString sql;
+    bzero(&sql, sizeof(sql));
+    swString_append_ptr(&sql, ZEND_STRL("ROLLBACK"));
+    if (mysql_query(getThis(), client, &sql, callback) < 0)
     {
-        SwooleG.error = SW_ERROR_CLIENT_NO_CONNECTION;
-        php_swoole_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
-        return SW_ERR;
+        RETURN_FALSE;
     }
-    if (!client->connected)
+    else
     {
-        SwooleG.error = SW_ERROR_CLIENT_NO_CONNECTION;
-        php_swoole_error(E_WARNING, "mysql client is not connected to server.");
-        return SW_ERR;
+        client->transaction = 0;
+        RETURN_TRUE;
     }
-    if (client->state != SW_MYSQL_STATE_QUERY)
+}
+
+static PHP_METHOD(swoole_mysql, ping)
+{
+    zval *callback;
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
     {
-        php_swoole_fatal_error(E_WARNING, "mysql client is waiting response, cannot send new sql query.");
-        return SW_ERR;
+        RETURN_FALSE;
     }
 
-    if (client->buffer)
+    if (!php_swoole_is_callable(callback))
     {
-        swString_clear(client->buffer);
+        RETURN_FALSE;
     }
 
-    if (callback != NULL)
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
-        Z_TRY_ADDREF_P(callback);
-        client->callback = sw_zval_dup(callback);
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
     }
 
-    client->cmd = SW_MYSQL_COM_QUERY;
+    SW_CHECK_RETURN(mysql_send_command(getThis(), client, SW_MYSQL_COM_PING, NULL, 0, callback));
+}
 
-    if (mysql_request_pack(sql, mysql_request_buffer) < 0)
-    {
-        return SW_ERR;
-    }
-    //send query
-    if (SwooleG.main_reactor->write(SwooleG.main_reactor, client->fd, mysql_request_buffer->str, mysql_request_buffer->length) < 0)
+/**
+ * COM_RESET_CONNECTION or COM_CHANGE_USER, which clear the state of the session
+ */
+typedef struct
+{
+    zval *callback;
+    /* the credentials of the connection before COM_CHANGE_USER, they are restored if it fails */
+    char *user;
+    char *password;
+    char *database;
+    size_t user_len;
+    size_t password_len;
+    size_t database_len;
+} mysql_session_change;
+
+static void mysql_session_change_swap(mysql_connector *connector, mysql_session_change *change)
+{
+    char *user = connector->user, *password = connector->password, *database = connector->database;
+    size_t user_len = connector->user_len, password_len = connector->password_len, database_len = connector->database_len;
+
+    connector->user = change->user;
+    connector->user_len = change->user_len;
+    connector->password = change->password;
+    connector->password_len = change->password_len;
+    connector->database = change->database;
+    connector->database_len = change->database_len;
+
+    change->user = user;
+    change->user_len = user_len;
+    change->password = password;
+    change->password_len = password_len;
+    change->database = database;
+    change->database_len = database_len;
+}
+
+static void mysql_session_change_free(mysql_session_change *change)
+{
+    if (change->user)
     {
-        //connection is closed
-        if (swConnection_error(errno) == SW_CLOSE)
-        {
-            zend_update_property_bool(swoole_mysql_ce, zobject, ZEND_STRL("connected"), 0);
-            zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), 2013);
-            zend_update_property_string(swoole_mysql_ce, zobject, ZEND_STRL("error"), "Lost connection to MySQL server during query");
-        }
-        return SW_ERR;
+        efree(change->user);
+        efree(change->password);
+        efree(change->database);
     }
-    else
+    efree(change);
+}
+
+/**
+ * the connection config used by KILL QUERY follows the user of the session
+ */
+static void mysql_server_info_update(zval *zobject, mysql_connector *connector)
+{
+    zval *server_info = sw_zend_read_property(swoole_mysql_ce, zobject, ZEND_STRL("serverInfo"), 1);
+    zval info;
+
+    if (!server_info || Z_TYPE_P(server_info) != IS_ARRAY)
     {
-        client->state = SW_MYSQL_STATE_READ_START;
-        return SW_OK;
+        return;
     }
+    ZVAL_DUP(&info, server_info);
+    add_assoc_stringl(&info, "user", connector->user, connector->user_len);
+    add_assoc_stringl(&info, "password", connector->password, connector->password_len);
+    add_assoc_stringl(&info, "database", connector->database, connector->database_len);
+    zend_update_property(swoole_mysql_ce, zobject, ZEND_STRL("serverInfo"), &info);
+    zval_ptr_dtor(&info);
 }
 
-#ifdef SW_MYSQL_DEBUG
-
-void mysql_client_info(mysql_client *client)
+static void mysql_session_callback(mysql_client *client, zval *callback, zend_bool result)
 {
-    printf("\n" SW_START_LINE
-        "\nmysql_client\nbuffer->offset=%jd\nbuffer->length=%ju\nstatus=%u\n"
-        "packet_length=%u\npacket_number=%u\n"
-        "insert_id=%lu\naffected_rows=%lu\n"
-        "warnings=%u\n" SW_END_LINE,
-        (intmax_t) client->buffer->offset, (uintmax_t) client->buffer->length,
-        client->response.status_code,
-        client->response.packet_length, client->response.packet_number,
-        client->response.insert_id, client->response.affected_rows,
-        client->response.warnings
-    );
-    if (client->response.num_column)
+    zval args[2];
+
+    if (client->cli && !client->cli->destroyed)
     {
-        int i;
-        for (i = 0; i < client->response.num_column; i++)
+        args[0] = *client->object;
+        ZVAL_BOOL(&args[1], result);
+        if (sw_call_user_function_ex(EG(function_table), NULL, callback, NULL, 2, args, 0, NULL) != SUCCESS)
         {
-            mysql_column_info(&client->response.columns[i]);
+            php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+        }
+        if (UNEXPECTED(EG(exception)))
+        {
+            zend_exception_error(EG(exception), E_ERROR);
         }
     }
+    sw_zval_free(callback);
 }
 
-void mysql_column_info(mysql_field *field)
+static void mysql_onSessionTracked(mysql_client *client, mysql_request *request, zval *result)
 {
-    printf("\n" SW_START_LINE
-        "\nname=%s, table=%s, db=%s\n"
-        "name_length=%d, table_length=%d, db_length=%d\n"
-        "catalog=%s, default_value=%s\n"
-        "length=%ld, type=%d\n" SW_END_LINE,
-        field->name, field->table, field->db,
-        field->name_length, field->table_length, field->db_length,
-        field->catalog, field->def,
-        field->length, field->type
-   );
+    mysql_onTrackGtids(client, request, result);
+    mysql_session_callback(client, request->data, 1);
 }
 
-#endif
-
-static PHP_METHOD(swoole_mysql, __construct)
+static void mysql_onSessionChange(mysql_client *client, mysql_request *request, zval *result)
 {
-    mysql_client *client = emalloc(sizeof(mysql_client));
+    mysql_session_change *change = request->data;
+    zval *callback = change->callback;
+    zend_bool success = Z_TYPE_P(result) != IS_FALSE;
 
-    bzero(client, sizeof(mysql_client));
-    swoole_set_object(getThis(), client);
+    if (change->user)
+    {
+        if (success)
+        {
+            mysql_server_info_update(client->object, &client->connector);
+        }
+        else
+        {
+#ifdef SW_MYSQL_RSA_SUPPORT
+            if (client->connector.rsa_key_cached)
+            {
+                mysql_rsa_key_del(&client->connector);
+            }
+#endif
+            mysql_session_change_swap(&client->connector, change);
+        }
+    }
+    mysql_session_change_free(change);
+
+    if (success)
+    {
+        // the server has released the statements and rolled back the transaction of the session
+        while (client->statement_list->num > 0)
+        {
+            mysql_statement_free(swLinkedList_shift(client->statement_list));
+        }
+        client->transaction = 0;
+        // the session variables are back to their global values
+        if (client->connector.track_gtids && client->cli && !client->cli->destroyed)
+        {
+            static char sql[] = "SET SESSION session_track_gtids = OWN_GTID";
+            if (mysql_send_internal(client->object, client, SW_MYSQL_COM_QUERY, sql, sizeof(sql) - 1, mysql_onSessionTracked, callback) == SW_OK)
+            {
+                return;
+            }
+        }
+    }
+    mysql_session_callback(client, callback, success);
 }
 
-static PHP_METHOD(swoole_mysql, connect)
+/**
+ * COM_RESET_CONNECTION, the session is cleared without authenticating again
+ */
+static PHP_METHOD(swoole_mysql, reset)
 {
-    zval *server_info;
     zval *callback;
-    char buf[2048];
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "az", &server_info, &callback) == FAILURE)
+    if (!php_swoole_is_callable(callback))
     {
         RETURN_FALSE;
     }
 
     mysql_client *client = swoole_get_object(getThis());
-    if (client->cli)
+    if (!client)
     {
-        php_swoole_error(E_WARNING, "The mysql client is already connected server.");
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
         RETURN_FALSE;
     }
 
-    HashTable *_ht = Z_ARRVAL_P(server_info);
-    zval *value;
-    zend_string *str_host = NULL;
-    zend_string *str_user = NULL;
-    zend_string *str_password = NULL;
-    zend_string *str_database = NULL;
-    zend_string *str_charset = NULL;
-    zend_bool _retval = SW_TRUE;
-
-    mysql_connector *connector = &client->connector;
-
-    if (php_swoole_array_get_value(_ht, "host", value))
+    mysql_session_change *change = ecalloc(1, sizeof(mysql_session_change));
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_RESET_CONNECTION, NULL);
+    Z_TRY_ADDREF_P(callback);
+    change->callback = sw_zval_dup(callback);
+    request->handler = mysql_onSessionChange;
+    request->data = change;
+    if (mysql_send_request(getThis(), client, request, NULL, 0) < 0)
     {
-        str_host = zval_get_string(value);
-        connector->host = ZSTR_VAL(str_host);
-        connector->host_len = ZSTR_LEN(str_host);
+        sw_zval_free(change->callback);
+        mysql_session_change_free(change);
+        RETURN_FALSE;
     }
-    else
+    RETURN_TRUE;
+}
+
+/**
+ * COM_CHANGE_USER, the session is cleared and authenticated as another user on the same connection,
+ * the database of the connection is kept when it is not given
+ */
+static PHP_METHOD(swoole_mysql, changeUser)
+{
+    char *user, *password, *database = NULL;
+    size_t user_len, password_len, database_len = 0;
+    zval *callback;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "ssz|s", &user, &user_len, &password, &password_len, &callback, &database, &database_len) == FAILURE)
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "HOST parameter is required.", 11);
         RETURN_FALSE;
     }
-    if (php_swoole_array_get_value(_ht, "port", value))
+
+    if (!php_swoole_is_callable(callback))
     {
-        connector->port = zval_get_long(value);
+        RETURN_FALSE;
     }
-    else
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
-        connector->port = SW_MYSQL_DEFAULT_PORT;
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
     }
-    if (php_swoole_array_get_value(_ht, "user", value))
+    if (mysql_client_writable(client) < 0)
     {
-        str_user = zval_get_string(value);
-        connector->user = ZSTR_VAL(str_user);
-        connector->user_len = ZSTR_LEN(str_user);
+        RETURN_FALSE;
     }
-    else
+    // the packets of the authentication would need their own compressed sequence
+    if (client->compress_buffer)
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "USER parameter is required.", 11);
-        _retval = SW_FALSE;
-        goto _return;
+        php_swoole_error(E_WARNING, "changeUser is not supported with the compressed protocol.");
+        RETURN_FALSE;
     }
-    if (php_swoole_array_get_value(_ht, "password", value))
+
+    mysql_connector *connector = &client->connector;
+    mysql_session_change *change = ecalloc(1, sizeof(mysql_session_change));
+    change->user = estrndup(user, user_len);
+    change->user_len = user_len;
+    change->password = estrndup(password, password_len);
+    change->password_len = password_len;
+    if (database)
     {
-        str_password = zval_get_string(value);
-        connector->password = ZSTR_VAL(str_password);
-        connector->password_len = ZSTR_LEN(str_password);
+        change->database = estrndup(database, database_len);
+        change->database_len = database_len;
     }
     else
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "PASSWORD parameter is required.", 11);
-        _retval = SW_FALSE;
-        goto _return;
+        change->database = estrndup(connector->database, connector->database_len);
+        change->database_len = connector->database_len;
     }
-    if (php_swoole_array_get_value(_ht, "database", value))
+    mysql_session_change_swap(connector, change);
+    connector->rsa_key_cached = 0;
+
+    if (mysql_change_user_pack(connector, mysql_request_buffer) < 0)
     {
-        str_database = zval_get_string(value);
-        connector->database = ZSTR_VAL(str_database);
-        connector->database_len = ZSTR_LEN(str_database);
+        mysql_session_change_swap(connector, change);
+        mysql_session_change_free(change);
+        RETURN_FALSE;
     }
-    else
+
+    mysql_request *request = mysql_request_new(SW_MYSQL_COM_CHANGE_USER, NULL);
+    Z_TRY_ADDREF_P(callback);
+    change->callback = sw_zval_dup(callback);
+    request->handler = mysql_onSessionChange;
+    request->data = change;
+    if (mysql_send_packed_request(getThis(), client, request, mysql_request_buffer->str, mysql_request_buffer->length) < 0)
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "DATABASE parameter is required.", 11);
-        _retval = SW_FALSE;
-        goto _return;
+        mysql_session_change_swap(connector, change);
+        sw_zval_free(change->callback);
+        mysql_session_change_free(change);
+        RETURN_FALSE;
     }
-    if (php_swoole_array_get_value(_ht, "timeout", value))
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_mysql, __destruct)
+{
+    SW_PREVENT_USER_DESTRUCT();
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
-        connector->timeout = zval_get_double(value);
+        return;
     }
-    else
+    if (client->state != SW_MYSQL_STATE_CLOSED && client->cli)
     {
-        connector->timeout = SW_MYSQL_CONNECT_TIMEOUT;
+        zval *zobject = getThis();
+        client->cli->destroyed = 1;
+        sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
     }
-    if (php_swoole_array_get_value(_ht, "charset", value))
+    //release buffer memory
+    if (client->buffer)
     {
-        str_charset = zval_get_string(value);
-        connector->character_set = mysql_get_charset(ZSTR_VAL(str_charset));
-        if (connector->character_set < 0)
-        {
-            snprintf(buf, sizeof(buf), "unknown charset [%s].", ZSTR_VAL(str_charset));
-            zend_throw_exception(swoole_mysql_exception_ce, buf, 11);
-            _retval = SW_FALSE;
-            goto _return;
-        }
+        swString_free(client->buffer);
     }
-    //use the server default charset.
-    else
+    swLinkedList_free(client->requests);
+    swLinkedList_free(client->statement_list);
+    efree(client);
+    swoole_set_object(getThis(), NULL);
+}
+
+static PHP_METHOD(swoole_mysql, close)
+{
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
-        connector->character_set = 0;
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
     }
 
-    if (php_swoole_array_get_value(_ht, "strict_type", value))
+    if (!client->cli)
     {
-        connector->strict_type = zval_is_true(value);
+        RETURN_FALSE;
     }
 
-    if (php_swoole_array_get_value(_ht, "fetch_mode", value))
+    if (client->cli->socket->closing)
     {
-        connector->fetch_mode = zval_is_true(value);
+        swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_CLOSING, "The mysql connection[%d] is closing.", client->fd);
+        RETURN_FALSE;
     }
 
-    swClient *cli = emalloc(sizeof(swClient));
-    int type = SW_SOCK_TCP;
+    zend_update_property_bool(swoole_mysql_ce, getThis(), ZEND_STRL("connected"), 0);
+    SwooleG.main_reactor->del(SwooleG.main_reactor, client->fd);
 
-    if (strncasecmp(connector->host, ZEND_STRL("unix:/")) == 0)
-    {
-        connector->host = connector->host + 5;
-        connector->host_len = connector->host_len - 5;
-        type = SW_SOCK_UNIX_STREAM;
-    }
-    else if (strchr(connector->host, ':'))
-    {
-        type = SW_SOCK_TCP6;
-    }
+    swConnection *socket = swReactor_get(SwooleG.main_reactor, client->fd);
+    bzero(socket, sizeof(swConnection));
+    socket->removed = 1;
 
-    php_swoole_check_reactor();
-    if (!swReactor_isset_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL))
-    {
-        swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ, swoole_mysql_onRead);
-        swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL | SW_EVENT_WRITE, swoole_mysql_onWrite);
-        swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_MYSQL | SW_EVENT_ERROR, swoole_mysql_onError);
-    }
-    //create socket
-    if (swClient_create(cli, type, 0) < 0)
-    {
-        zend_throw_exception(swoole_mysql_exception_ce, "swClient_create failed.", 1);
-        _retval = SW_FALSE;
-        goto _return;
-    }
-    //tcp nodelay
-    if (type != SW_SOCK_UNIX_STREAM)
+    zend_bool is_destroyed = client->cli->destroyed;
+
+    zval *retval = NULL;
+    zval args[1];
+    zval *object = getThis();
+    client->cli->socket->closing = 1;
+    client->connected = 0;
+    mysql_requests_fail(client, object);
+    if (client->onClose)
     {
-        int tcp_nodelay = 1;
-        if (setsockopt(cli->socket->fd, IPPROTO_TCP, TCP_NODELAY, (const void *) &tcp_nodelay, sizeof(int)) != 0)
+        args[0] = *object;
+        if (sw_call_user_function_ex(EG(function_table), NULL, client->onClose, &retval, 1, args, 0, NULL) != SUCCESS)
         {
-            php_swoole_sys_error(E_WARNING, "setsockopt(%d, IPPROTO_TCP, TCP_NODELAY) failed.", cli->socket->fd);
+            php_swoole_fatal_error(E_WARNING, "swoole_mysql onClose callback error.");
         }
-    }
-    //connect to mysql server
-    int ret = cli->connect(cli, connector->host, connector->port, connector->timeout, 1);
-    if ((ret < 0 && errno == EINPROGRESS) || ret == 0)
-    {
-        if (connector->timeout > 0)
+        if (UNEXPECTED(EG(exception)))
         {
-            cli->timer = swTimer_add(&SwooleG.timer, (long) (connector->timeout * 1000), 0, client, swoole_mysql_onTimeout);
-            cli->timeout = connector->timeout;
+            zend_exception_error(EG(exception), E_ERROR);
         }
-        if (SwooleG.main_reactor->add(SwooleG.main_reactor, cli->socket->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_WRITE) < 0)
+        if (retval)
         {
-            _retval = SW_FALSE;
-            goto _return;
+            zval_ptr_dtor(retval);
         }
     }
-    else
-    {
-        snprintf(buf, sizeof(buf), "connect to mysql server[%s:%ld] failed.", connector->host, connector->port);
-        zend_throw_exception(swoole_mysql_exception_ce, buf, 2);
-        _retval = SW_FALSE;
-        goto _return;
-    }
-
-    zend_update_property(swoole_mysql_ce, getThis(), ZEND_STRL("onConnect"), callback);
-    zend_update_property(swoole_mysql_ce, getThis(), ZEND_STRL("serverInfo"), server_info);
-    zend_update_property_long(swoole_mysql_ce, getThis(), ZEND_STRL("sock"), cli->socket->fd);
-
-    client->buffer = swString_new(SW_BUFFER_SIZE_BIG);
-    client->fd = cli->socket->fd;
-    client->object = getThis();
-    client->cli = cli;
-
-    connector->host = estrndup(connector->host, connector->host_len);
-    connector->user = estrndup(connector->user, connector->user_len);
-    connector->password = estrndup(connector->password, connector->password_len);
-    connector->database = estrndup(connector->database, connector->database_len);
-
-    sw_copy_to_stack(client->object, client->_object);
-    Z_TRY_ADDREF_P(client->object);
-
-    swConnection *_socket = swReactor_get(SwooleG.main_reactor, cli->socket->fd);
-    _socket->object = client;
-    _socket->active = 0;
-
-    _return:
-    if (str_host)
-    {
-        zend_string_release(str_host);
-    }
-    if (str_user)
-    {
-        zend_string_release(str_user);
-    }
-    if (str_password)
-    {
-        zend_string_release(str_password);
-    }
-    if (str_database)
+    mysql_client_free(client, getThis());
+    if (client->hooks.onClose)
     {
-        zend_string_release(str_database);
+        client->hooks.onClose(client);
     }
-    if (str_charset)
+    if (!is_destroyed)
     {
-        zend_string_release(str_charset);
+        zval_ptr_dtor(object);
     }
-    RETURN_BOOL(_retval);
 }
 
-static PHP_METHOD(swoole_mysql, query)
+static PHP_METHOD(swoole_mysql, on)
 {
-    zval *callback;
-    swString sql;
-    bzero(&sql, sizeof(sql));
+    char *name;
+    size_t len;
+    zval *cb;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz", &sql.str, &sql.length, &callback) == FAILURE)
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz", &name, &len, &cb) == FAILURE)
     {
         RETURN_FALSE;
     }
 
-    if (!php_swoole_is_callable(callback))
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
         RETURN_FALSE;
     }
 
-    if (sql.length <= 0)
+    if (strncasecmp("close", name, len) == 0)
     {
-        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        zend_update_property(swoole_mysql_ce, getThis(), ZEND_STRL("onClose"), cb);
+        client->onClose = sw_zend_read_property(swoole_mysql_ce, getThis(), ZEND_STRL("onClose"), 0);
+        sw_copy_to_stack(client->onClose, client->_onClose);
+    }
+    else
+    {
+        php_swoole_error(E_WARNING, "Unknown event type[%s]", name);
         RETURN_FALSE;
     }
+    RETURN_TRUE;
+}
 
+static PHP_METHOD(swoole_mysql, getState)
+{
     mysql_client *client = swoole_get_object(getThis());
     if (!client)
     {
         php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
         RETURN_FALSE;
     }
+    RETURN_LONG(client->state);
+}
 
-    SW_CHECK_RETURN(mysql_query(getThis(), client, &sql, callback));
+static PHP_METHOD(swoole_mysql, getCacheStats)
+{
+    mysql_cache_stats(return_value);
 }
 
-static PHP_METHOD(swoole_mysql, begin)
+static void swoole_mysql_onTimeout(swTimer *timer, swTimer_node *tnode)
 {
-    zval *callback;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    mysql_client *client = tnode->data;
+    client->connector.error_code = ETIMEDOUT;
+    client->connector.error_msg = strerror(client->connector.error_code);
+    client->connector.error_length = strlen(client->connector.error_msg);
+    swoole_mysql_onConnect(client);
+}
+
+static int swoole_mysql_onError(swReactor *reactor, swEvent *event)
+{
+    swClient *cli = event->socket->object;
+    if (cli && cli->socket && cli->socket->active)
     {
-        RETURN_FALSE;
+        mysql_client *client = event->socket->object;
+        if (!client)
+        {
+            close(event->fd);
+            return SW_ERR;
+        }
+        zval *zobject = client->object;
+        sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
+        return SW_OK;
+    }
+    else
+    {
+        return swoole_mysql_onWrite(reactor, event);
     }
+}
 
-    if (!php_swoole_is_callable(callback))
+static void mysql_onTrackGtids(mysql_client *client, mysql_request *request, zval *result)
+{
+    if (Z_TYPE_P(result) == IS_FALSE && client->cli && !client->cli->destroyed)
     {
-        RETURN_FALSE;
+        php_swoole_error(E_WARNING, "failed to enable session_track_gtids, the GTIDs are not tracked.");
     }
+}
 
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+static void swoole_mysql_onConnect(mysql_client *client)
+{
+    zval *zobject = client->object;
+    zval *zcallback = sw_zend_read_property(swoole_mysql_ce, zobject, ZEND_STRL("onConnect"), 0);
+
+    zval args[2];
+
+    if (client->cli->timer)
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+        swTimer_del(&SwooleG.timer, client->cli->timer);
+        client->cli->timer = NULL;
     }
-    if (client->transaction)
+
+    if (client->connector.error_code > 0)
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "There is already an active transaction.", 21);
-        RETURN_FALSE;
+        zend_update_property_stringl(swoole_mysql_ce, zobject, ZEND_STRL("connect_error"), client->connector.error_msg, client->connector.error_length);
+        zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("connect_errno"), client->connector.error_code);
+        ZVAL_FALSE(&args[1]);
+    }
+    else
+    {
+        zend_update_property_bool(swoole_mysql_ce, zobject, ZEND_STRL("connected"), 1);
+        ZVAL_TRUE(&args[1]);
+        client->connected = 1;
+        // sent before the first query of the user, the responses come back in order
+        if (client->connector.track_gtids)
+        {
+            static char sql[] = "SET SESSION session_track_gtids = OWN_GTID";
+            mysql_send_internal(zobject, client, SW_MYSQL_COM_QUERY, sql, sizeof(sql) - 1, mysql_onTrackGtids, NULL);
+        }
+    }
+
+    args[0] = *zobject;
+
+    if (client->hooks.onConnect)
+    {
+        client->hooks.onConnect(client, client->connector.error_code == 0);
+    }
+    else if (sw_call_user_function_ex(EG(function_table), NULL, zcallback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_mysql onConnect handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    if (client->connector.error_code > 0)
+    {
+        //close
+        sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
+    }
+}
+
+static int swoole_mysql_onWrite(swReactor *reactor, swEvent *event)
+{
+    if (event->socket->active)
+    {
+        mysql_client *client = event->socket->object;
+#ifdef SW_USE_OPENSSL
+        if (client && client->handshake == SW_MYSQL_HANDSHAKE_WAIT_TLS)
+        {
+            return mysql_ssl_handshake(client);
+        }
+#endif
+        int ret = swReactor_onWrite(SwooleG.main_reactor, event);
+        // the previous packet of the file has been sent, go on with the next one
+        if (client && client->infile && client->infile->waiting && swBuffer_empty(event->socket->out_buffer))
+        {
+            client->infile->waiting = 0;
+            mysql_infile_next(client->infile);
+        }
+        else if (client && client->long_data && client->long_data->waiting && swBuffer_empty(event->socket->out_buffer))
+        {
+            mysql_long_data_next(client->long_data);
+        }
+        return ret;
+    }
+
+    socklen_t len = sizeof(SwooleG.error);
+    if (getsockopt(event->fd, SOL_SOCKET, SO_ERROR, &SwooleG.error, &len) < 0)
+    {
+        swWarn("getsockopt(%d) failed. Error: %s[%d]", event->fd, strerror(errno), errno);
+        return SW_ERR;
     }
 
-    swString sql;
-    bzero(&sql, sizeof(sql));
-    swString_append_ptr(&sql, ZEND_STRL("START TRANSACTION"));
-    if (mysql_query(getThis(), client, &sql, callback) < 0)
+    mysql_client *client = event->socket->object;
+    //success
+    if (SwooleG.error == 0)
     {
-        RETURN_FALSE;
+        //listen read event
+        SwooleG.main_reactor->set(SwooleG.main_reactor, event->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ);
+        //connected
+        event->socket->active = 1;
+        client->handshake = SW_MYSQL_HANDSHAKE_WAIT_REQUEST;
     }
     else
     {
-        client->transaction = 1;
-        RETURN_TRUE;
+        client->connector.error_code = SwooleG.error;
+        client->connector.error_msg = strerror(SwooleG.error);
+        client->connector.error_length = strlen(client->connector.error_msg);
+        swoole_mysql_onConnect(client);
     }
+    return SW_OK;
 }
 
-static PHP_METHOD(swoole_mysql, commit)
+static int swoole_mysql_onHandShake(mysql_client *client)
 {
-    zval *callback;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    swString *buffer = client->buffer;
+    swClient *cli = client->cli;
+    mysql_connector *connector = &client->connector;
+
+#ifdef SW_USE_OPENSSL
+    if (client->handshake == SW_MYSQL_HANDSHAKE_WAIT_TLS)
     {
-        RETURN_FALSE;
+        return mysql_ssl_handshake(client);
+    }
+#endif
+    int n = cli->recv(cli, buffer->str + buffer->length, buffer->size - buffer->length, 0);
+    if (n < 0)
+    {
+        switch (swConnection_error(errno))
+        {
+        case SW_ERROR:
+            swSysError("Read from socket[%d] failed.", cli->socket->fd);
+            return SW_ERR;
+        case SW_CLOSE:
+            goto system_call_error;
+        case SW_WAIT:
+            return SW_OK;
+        default:
+            return SW_ERR;
+        }
+    }
+    else if (n == 0)
+    {
+        errno = ECONNRESET;
+        goto system_call_error;
     }
 
-    if (!php_swoole_is_callable(callback))
+    buffer->length += n;
+
+    int ret = 0;
+
+    _again:
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "handshake on %d", client->handshake);
+    if (client->switch_check)
     {
-        RETURN_FALSE;
+        // after handshake we need check if server request us to switch auth type first
+        goto _check_switch;
     }
 
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+    switch(client->handshake)
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+    case SW_MYSQL_HANDSHAKE_WAIT_REQUEST:
+    {
+        client->switch_check = 1;
+        ret = mysql_handshake(connector, buffer->str, buffer->length);
+
+        if (ret < 0)
+        {
+            goto _error;
+        }
+        else if (ret > 0)
+        {
+#ifdef SW_USE_OPENSSL
+            // the HandshakeResponse is sent once TLS is established
+            if (connector->ssl_ctx)
+            {
+                if (mysql_ssl_start(client, ret) < 0)
+                {
+                    goto _error;
+                }
+                swString_clear(buffer);
+                return mysql_ssl_handshake(client);
+            }
+#endif
+            _send:
+            if (cli->send(cli, connector->buf, connector->packet_length + 4, 0) < 0)
+            {
+                system_call_error: connector->error_code = errno;
+                connector->error_msg = strerror(errno);
+                connector->error_length = strlen(connector->error_msg);
+                swoole_mysql_onConnect(client);
+                return SW_OK;
+            }
+            else
+            {
+                // clear for the new packet
+                swString_clear(buffer);
+                // mysql_handshake will return the next state flag
+                client->handshake = ret;
+            }
+        }
+        break;
     }
-    if (!client->transaction)
+    case SW_MYSQL_HANDSHAKE_WAIT_SWITCH:
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "There is no active transaction.", 22);
-        RETURN_FALSE;
+        _check_switch:
+        client->switch_check = 0;
+        int next_state;
+        // handle auth switch request
+        switch (next_state = mysql_auth_switch(connector, buffer->str, buffer->length))
+        {
+        case SW_AGAIN:
+            return SW_OK;
+        case SW_ERR:
+            // not the switch packet, go to the next
+            goto _again;
+        default:
+            ret = next_state;
+            goto _send;
+        }
+        break;
     }
+    case SW_MYSQL_HANDSHAKE_WAIT_SIGNATURE:
+    {
+        switch (mysql_parse_auth_signature(buffer, connector))
+        {
+        case SW_MYSQL_AUTH_SIGNATURE_SUCCESS:
+        {
+            client->handshake = SW_MYSQL_HANDSHAKE_WAIT_RESULT;
+            break;
+        }
+        case SW_MYSQL_AUTH_SIGNATURE_FULL_AUTH_REQUIRED:
+        {
+            // send the encrypted password, or ask for the RSA public key and wait for it
+            ret = mysql_auth_full(connector, connector->buf[3]); // handshake = ret
+            goto _send;
+        }
+        default:
+        {
+            goto _error;
+        }
+        }
 
-    swString sql;
-    bzero(&sql, sizeof(sql));
-    swString_append_ptr(&sql, ZEND_STRL("COMMIT"));
-    if (mysql_query(getThis(), client, &sql, callback) < 0)
+        // may be more packets
+        if (buffer->offset < buffer->length)
+        {
+            goto _again;
+        }
+        else
+        {
+            swString_clear(buffer);
+        }
+        break;
+    }
+    case SW_MYSQL_HANDSHAKE_WAIT_RSA:
     {
-        RETURN_FALSE;
+        // encode by RSA
+#ifdef SW_MYSQL_RSA_SUPPORT
+        switch (mysql_parse_rsa(connector, SW_STRINGCVL(buffer)))
+        {
+        case SW_AGAIN:
+            return SW_OK;
+        case SW_OK:
+            ret = SW_MYSQL_HANDSHAKE_WAIT_RESULT; // handshake = ret
+            goto _send;
+        default:
+            goto _error;
+        }
+#else
+        connector->error_code = -1;
+        connector->error_msg = "MySQL8 RSA-Auth need enable OpenSSL!";
+        connector->error_length = strlen(connector->error_msg);
+        swoole_mysql_onConnect(client);
+        return SW_OK;
+#endif
+        break;
     }
-    else
+    default:
     {
-        client->transaction = 0;
-        RETURN_TRUE;
+        ret = mysql_get_result(connector, SW_STRINGCVL(buffer));
+        if (ret < 0)
+        {
+            _error:
+#ifdef SW_MYSQL_RSA_SUPPORT
+            if (connector->rsa_key_cached)
+            {
+                mysql_rsa_key_del(connector);
+            }
+#endif
+            swoole_mysql_onConnect(client);
+        }
+        else if (ret > 0)
+        {
+            swString_clear(buffer);
+            client->handshake = SW_MYSQL_HANDSHAKE_COMPLETED;
+#ifdef SW_HAVE_ZLIB
+            // everything after the authentication result is compressed
+            if (connector->compression)
+            {
+                client->compress_buffer = swString_new(SW_BUFFER_SIZE_BIG);
+            }
+#endif
+            swoole_mysql_onConnect(client);
+        }
+        // else recv again
     }
+    }
+
+    return SW_OK;
 }
 
-static PHP_METHOD(swoole_mysql, rollback)
+static void mysql_infile_free(mysql_infile *infile)
 {
-    zval *callback;
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    if (infile->fd >= 0)
     {
-        RETURN_FALSE;
+        close(infile->fd);
     }
-
-    if (!php_swoole_is_callable(callback))
+    if (infile->source)
     {
-        RETURN_FALSE;
+        sw_zval_free(infile->source);
     }
-
-
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+    if (infile->buffer)
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+        efree(infile->buffer);
     }
-    if (!client->transaction)
+    efree(infile->filename);
+    efree(infile);
+}
+
+/**
+ * a read in flight releases the infile when it completes
+ */
+static void mysql_infile_detach(mysql_client *client)
+{
+    mysql_infile *infile = client->infile;
+    if (!infile)
     {
-        zend_throw_exception(swoole_mysql_exception_ce, "There is no active transaction.", 22);
-        RETURN_FALSE;
+        return;
     }
-
-    swString sql;
-    bzero(&sql, sizeof(sql));
-    swString_append_ptr(&sql, ZEND_STRL("ROLLBACK"));
-    if (mysql_query(getThis(), client, &sql, callback) < 0)
+    client->infile = NULL;
+    if (infile->pending)
     {
-        RETURN_FALSE;
+        infile->client = NULL;
     }
     else
     {
-        client->transaction = 0;
-        RETURN_TRUE;
+        mysql_infile_free(infile);
     }
 }
 
-static PHP_METHOD(swoole_mysql, __destruct)
+static void mysql_infile_error(mysql_infile *infile, uint16_t code, const char *format, ...)
 {
-    SW_PREVENT_USER_DESTRUCT();
+    va_list args;
+    va_start(args, format);
+    vsnprintf(infile->error_msg, sizeof(infile->error_msg), format, args);
+    va_end(args);
+    infile->error_code = code;
+}
 
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
-    {
-        return;
-    }
-    if (client->state != SW_MYSQL_STATE_CLOSED && client->cli)
-    {
-        zval *zobject = getThis();
-        client->cli->destroyed = 1;
-        sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
-    }
-    //release buffer memory
-    if (client->buffer)
+static int mysql_infile_write(mysql_infile *infile, size_t length)
+{
+    mysql_pack_length(length, infile->buffer);
+    infile->buffer[3] = infile->sequence++;
+    // the compressed sequence goes on from the LOCAL INFILE request of the server
+    return mysql_client_write(infile->client, infile->buffer, SW_MYSQL_PACKET_HEADER_SIZE + length, &infile->client->compress_sequence);
+}
+
+static void mysql_infile_finish(mysql_infile *infile)
+{
+    if (infile->fd >= 0)
     {
-        swString_free(client->buffer);
+        close(infile->fd);
+        infile->fd = -1;
     }
-    efree(client);
-    swoole_set_object(getThis(), NULL);
+    // an empty packet ends the data, then the server responds to the query
+    mysql_infile_write(infile, 0);
+    infile->client->state = SW_MYSQL_STATE_READ_START;
 }
 
-static PHP_METHOD(swoole_mysql, close)
+/**
+ * the next packet is only read once the socket has sent the previous one
+ */
+static void mysql_infile_continue(mysql_infile *infile)
 {
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+    if (!swBuffer_empty(infile->client->cli->socket->out_buffer))
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+        infile->waiting = 1;
+        return;
     }
+    mysql_infile_next(infile);
+}
 
-    if (!client->cli)
+static void mysql_infile_onRead(swAio_event *event)
+{
+    mysql_infile *infile = event->object;
+
+    infile->pending = 0;
+    if (!infile->client)
     {
-        RETURN_FALSE;
+        mysql_infile_free(infile);
+        return;
     }
-
-    if (client->cli->socket->closing)
+    if (event->ret < 0)
     {
-        swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_CLOSING, "The mysql connection[%d] is closing.", client->fd);
-        RETURN_FALSE;
+        mysql_infile_error(infile, 2, "failed to read the file '%s', Error: %s[%d]", infile->filename, strerror(event->error), event->error);
+        mysql_infile_finish(infile);
+        return;
     }
+    if (event->ret == 0)
+    {
+        mysql_infile_finish(infile);
+        return;
+    }
+    infile->offset += event->ret;
+    // the connection is broken, it will be closed by the reactor
+    if (mysql_infile_write(infile, event->ret) < 0)
+    {
+        return;
+    }
+    mysql_infile_continue(infile);
+}
 
-    zend_update_property_bool(swoole_mysql_ce, getThis(), ZEND_STRL("connected"), 0);
-    SwooleG.main_reactor->del(SwooleG.main_reactor, client->fd);
-
-    swConnection *socket = swReactor_get(SwooleG.main_reactor, client->fd);
-    bzero(socket, sizeof(swConnection));
-    socket->removed = 1;
-
-    zend_bool is_destroyed = client->cli->destroyed;
+/**
+ * @return the next chunk of the PHP source, NULL at the end of the data
+ */
+static zend_string* mysql_infile_source_read(mysql_infile *infile)
+{
+    zval *source = infile->source;
+    zend_string *chunk = NULL;
 
-    zval *retval = NULL;
-    zval args[1];
-    zval *object = getThis();
-    if (client->onClose)
+    if (Z_TYPE_P(source) == IS_OBJECT && instanceof_function(Z_OBJCE_P(source), zend_ce_iterator))
     {
-        client->cli->socket->closing = 1;
-        args[0] = *object;
-        if (sw_call_user_function_ex(EG(function_table), NULL, client->onClose, &retval, 1, args, 0, NULL) != SUCCESS)
+        zval retval;
+        zend_call_method_with_0_params(source, Z_OBJCE_P(source), NULL, "valid", &retval);
+        if (zend_is_true(&retval) && !EG(exception))
         {
-            php_swoole_fatal_error(E_WARNING, "swoole_mysql onClose callback error.");
+            zval_ptr_dtor(&retval);
+            zend_call_method_with_0_params(source, Z_OBJCE_P(source), NULL, "current", &retval);
+            chunk = zval_get_string(&retval);
+            zend_call_method_with_0_params(source, Z_OBJCE_P(source), NULL, "next", NULL);
         }
-        if (UNEXPECTED(EG(exception)))
+        zval_ptr_dtor(&retval);
+    }
+    else
+    {
+        zval *retval = NULL;
+        if (sw_call_user_function_ex(EG(function_table), NULL, source, &retval, 0, NULL, 0, NULL) != SUCCESS)
         {
-            zend_exception_error(EG(exception), E_ERROR);
+            php_swoole_fatal_error(E_WARNING, "swoole_mysql local infile handler error.");
         }
         if (retval)
         {
+            if (Z_TYPE_P(retval) != IS_NULL && Z_TYPE_P(retval) != IS_FALSE)
+            {
+                chunk = zval_get_string(retval);
+                // an empty string is the end of the data as well
+                if (ZSTR_LEN(chunk) == 0)
+                {
+                    zend_string_release(chunk);
+                    chunk = NULL;
+                }
+            }
             zval_ptr_dtor(retval);
         }
     }
-    mysql_client_free(client, getThis());
-    if (!is_destroyed)
+    if (UNEXPECTED(EG(exception)))
     {
-        zval_ptr_dtor(object);
+        zend_exception_error(EG(exception), E_ERROR);
     }
+    return chunk;
 }
 
-static PHP_METHOD(swoole_mysql, on)
+static void mysql_infile_onDefer(void *data)
 {
-    char *name;
-    size_t len;
-    zval *cb;
+    mysql_infile *infile = data;
+    zend_string *chunk;
+    size_t offset, n;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz", &name, &len, &cb) == FAILURE)
+    infile->pending = 0;
+    if (!infile->client)
     {
-        RETURN_FALSE;
+        mysql_infile_free(infile);
+        return;
     }
-
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+    // the source may close the connection
+    infile->pending = 1;
+    chunk = mysql_infile_source_read(infile);
+    infile->pending = 0;
+    if (!infile->client)
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+        if (chunk)
+        {
+            zend_string_release(chunk);
+        }
+        mysql_infile_free(infile);
+        return;
+    }
+    if (!chunk)
+    {
+        mysql_infile_finish(infile);
+        return;
     }
+    for (offset = 0; offset < ZSTR_LEN(chunk); offset += n)
+    {
+        n = MIN(ZSTR_LEN(chunk) - offset, SW_MYSQL_INFILE_PACKET_SIZE);
+        memcpy(infile->buffer + SW_MYSQL_PACKET_HEADER_SIZE, ZSTR_VAL(chunk) + offset, n);
+        if (mysql_infile_write(infile, n) < 0)
+        {
+            zend_string_release(chunk);
+            return;
+        }
+    }
+    zend_string_release(chunk);
+    mysql_infile_continue(infile);
+}
 
-    if (strncasecmp("close", name, len) == 0)
+static void mysql_infile_next(mysql_infile *infile)
+{
+    infile->waiting = 0;
+    if (infile->source)
     {
-        zend_update_property(swoole_mysql_ce, getThis(), ZEND_STRL("onClose"), cb);
-        client->onClose = sw_zend_read_property(swoole_mysql_ce, getThis(), ZEND_STRL("onClose"), 0);
-        sw_copy_to_stack(client->onClose, client->_onClose);
+        // do not starve the other connections of the event loop
+        infile->pending = 1;
+        SwooleG.main_reactor->defer(SwooleG.main_reactor, mysql_infile_onDefer, infile);
+        return;
     }
-    else
+
+    swAio_event ev;
+    bzero(&ev, sizeof(ev));
+    ev.fd = infile->fd;
+    ev.buf = infile->buffer + SW_MYSQL_PACKET_HEADER_SIZE;
+    ev.type = SW_AIO_READ;
+    ev.nbytes = SW_MYSQL_INFILE_PACKET_SIZE;
+    ev.offset = infile->offset;
+    ev.object = infile;
+    ev.handler = swAio_handler_read;
+    ev.callback = mysql_infile_onRead;
+
+    if (swAio_dispatch(&ev) < 0)
     {
-        php_swoole_error(E_WARNING, "Unknown event type[%s]", name);
-        RETURN_FALSE;
+        mysql_infile_error(infile, 2, "failed to read the file '%s'", infile->filename);
+        mysql_infile_finish(infile);
+        return;
     }
-    RETURN_TRUE;
+    infile->pending = 1;
 }
 
-static PHP_METHOD(swoole_mysql, getState)
+static int mysql_infile_allowed(mysql_connector *connector, char *filename)
 {
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+    char path[PATH_MAX];
+    size_t length;
+
+    if (!connector->local_infile_dir)
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+        return SW_TRUE;
     }
-    RETURN_LONG(client->state);
+    if (!realpath(filename, path))
+    {
+        return SW_FALSE;
+    }
+    length = strlen(connector->local_infile_dir);
+    return strncmp(path, connector->local_infile_dir, length) == 0 && (path[length] == '/' || connector->local_infile_dir[length - 1] == '/');
 }
 
-static void swoole_mysql_onTimeout(swTimer *timer, swTimer_node *tnode)
+/**
+ * the file comes from the PHP source of loadData(), otherwise it is read from the disk
+ * if the local_infile option allows it
+ */
+static void mysql_infile_start(mysql_client *client)
 {
-    mysql_client *client = tnode->data;
-    client->connector.error_code = ETIMEDOUT;
-    client->connector.error_msg = strerror(client->connector.error_code);
-    client->connector.error_length = strlen(client->connector.error_msg);
-    swoole_mysql_onConnect(client);
+    mysql_infile *infile = client->infile;
+    mysql_request *request = client->requests->head->data;
+
+    infile->started = 1;
+    infile->buffer = emalloc(SW_MYSQL_PACKET_HEADER_SIZE + SW_MYSQL_INFILE_PACKET_SIZE);
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "LOCAL INFILE request of '%s'", infile->filename);
+
+    if (request->infile_source)
+    {
+        infile->source = request->infile_source;
+        request->infile_source = NULL;
+    }
+    else if (!client->connector.local_infile || !mysql_infile_allowed(&client->connector, infile->filename))
+    {
+        mysql_infile_error(infile, 2068, "LOAD DATA LOCAL INFILE file request rejected due to restrictions on access.");
+        mysql_infile_finish(infile);
+        return;
+    }
+    else if ((infile->fd = open(infile->filename, O_RDONLY)) < 0)
+    {
+        mysql_infile_error(infile, 2, "failed to open the file '%s', Error: %s[%d]", infile->filename, strerror(errno), errno);
+        mysql_infile_finish(infile);
+        return;
+    }
+    mysql_infile_next(infile);
 }
 
-static int swoole_mysql_onError(swReactor *reactor, swEvent *event)
+/**
+ * COM_STMT_SEND_LONG_DATA: int<1> command, int<4> stmt-id, int<2> param-id, then the data
+ */
+#define SW_MYSQL_LONG_DATA_HEADER_SIZE   (SW_MYSQL_PACKET_HEADER_SIZE + 7)
+
+static void mysql_long_data_free(mysql_long_data *ld)
 {
-    swClient *cli = event->socket->object;
-    if (cli && cli->socket && cli->socket->active)
+    uint16_t i;
+    for (i = 0; i < ld->num_params; i++)
     {
-        mysql_client *client = event->socket->object;
-        if (!client)
+        if (ld->params[i].fd >= 0)
         {
-            close(event->fd);
-            return SW_ERR;
+            close(ld->params[i].fd);
         }
-        zval *zobject = client->object;
-        sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
-        return SW_OK;
     }
-    else
+    if (ld->request)
     {
-        return swoole_mysql_onWrite(reactor, event);
+        mysql_request_free(ld->request);
+    }
+    if (ld->execute)
+    {
+        swString_free(ld->execute);
+    }
+    if (ld->buffer)
+    {
+        efree(ld->buffer);
     }
+    efree(ld->params);
+    efree(ld);
 }
 
-static void swoole_mysql_onConnect(mysql_client *client)
+/**
+ * @return the COM_STMT_EXECUTE request which has not been sent, a read in flight releases the rest when it completes
+ */
+static mysql_request* mysql_long_data_detach(mysql_client *client)
 {
-    zval *zobject = client->object;
-    zval *zcallback = sw_zend_read_property(swoole_mysql_ce, zobject, ZEND_STRL("onConnect"), 0);
-
-    zval args[2];
-
-    if (client->cli->timer)
-    {
-        swTimer_del(&SwooleG.timer, client->cli->timer);
-        client->cli->timer = NULL;
-    }
+    mysql_long_data *ld = client->long_data;
+    mysql_request *request = ld->request;
 
-    if (client->connector.error_code > 0)
+    client->long_data = NULL;
+    ld->request = NULL;
+    if (ld->pending)
     {
-        zend_update_property_stringl(swoole_mysql_ce, zobject, ZEND_STRL("connect_error"), client->connector.error_msg, client->connector.error_length);
-        zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("connect_errno"), client->connector.error_code);
-        ZVAL_FALSE(&args[1]);
+        ld->client = NULL;
     }
     else
     {
-        zend_update_property_bool(swoole_mysql_ce, zobject, ZEND_STRL("connected"), 1);
-        ZVAL_TRUE(&args[1]);
-        client->connected = 1;
+        mysql_long_data_free(ld);
     }
+    return request;
+}
 
-    args[0] = *zobject;
+/**
+ * the server drops the data it has received for the statement, the callback gets false
+ */
+static void mysql_long_data_abort(mysql_long_data *ld, const char *format, ...)
+{
+    mysql_client *client = ld->client;
+    zval *zobject = client->object;
+    mysql_request *request;
+    char error[256];
+    char buf[4];
+    zval args[2];
+    va_list va;
+
+    va_start(va, format);
+    vsnprintf(error, sizeof(error), format, va);
+    va_end(va);
 
-    if (sw_call_user_function_ex(EG(function_table), NULL, zcallback, NULL, 2, args, 0, NULL) != SUCCESS)
+    mysql_int4store(buf, ld->stmt_id);
+    request = mysql_long_data_detach(client);
+    mysql_send_internal(zobject, client, SW_MYSQL_COM_STMT_RESET, buf, sizeof(buf), NULL, NULL);
+
+    Z_TRY_ADDREF_P(zobject);
+    zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), 2);
+    zend_update_property_string(swoole_mysql_ce, zobject, ZEND_STRL("error"), error);
+    args[0] = *zobject;
+    ZVAL_FALSE(&args[1]);
+    if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, NULL, 2, args, 0, NULL) != SUCCESS)
     {
-        php_swoole_fatal_error(E_WARNING, "swoole_mysql onConnect handler error.");
+        php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
     }
     if (UNEXPECTED(EG(exception)))
     {
         zend_exception_error(EG(exception), E_ERROR);
     }
-    if (client->connector.error_code > 0)
+    mysql_request_free(request);
+    zval_ptr_dtor(zobject);
+}
+
+/**
+ * all the data has been sent, the statement can be executed
+ */
+static void mysql_long_data_finish(mysql_long_data *ld)
+{
+    mysql_client *client = ld->client;
+    swString *execute = ld->execute;
+
+    if (mysql_client_writable(client) < 0)
     {
-        //close
-        sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
+        mysql_long_data_abort(ld, "the connection is not available.");
+        return;
     }
+    ld->execute = NULL;
+    mysql_send_request(client->object, client, mysql_long_data_detach(client), execute->str, execute->length);
+    swString_free(execute);
 }
 
-static int swoole_mysql_onWrite(swReactor *reactor, swEvent *event)
+static int mysql_long_data_write(mysql_long_data *ld, size_t length)
 {
-    if (event->socket->active)
+    char *p = ld->buffer;
+
+    mysql_pack_length(SW_MYSQL_LONG_DATA_HEADER_SIZE - SW_MYSQL_PACKET_HEADER_SIZE + length, p);
+    p[3] = 0;
+    p[4] = SW_MYSQL_COM_STMT_SEND_LONG_DATA;
+    mysql_int4store(p + 5, ld->stmt_id);
+    mysql_int2store(p + 9, ld->params[ld->index].id);
+    return mysql_client_send(ld->client, ld->buffer, SW_MYSQL_LONG_DATA_HEADER_SIZE + length);
+}
+
+static void mysql_long_data_onRead(swAio_event *event)
+{
+    mysql_long_data *ld = event->object;
+    mysql_long_data_param *param = &ld->params[ld->index];
+
+    ld->pending = 0;
+    if (!ld->client)
+    {
+        mysql_long_data_free(ld);
+        return;
+    }
+    if (event->ret < 0)
     {
-        return swReactor_onWrite(SwooleG.main_reactor, event);
+        mysql_long_data_abort(ld, "failed to read the long data of parameter#%u, Error: %s[%d]", param->id, strerror(event->error), event->error);
+        return;
     }
-
-    socklen_t len = sizeof(SwooleG.error);
-    if (getsockopt(event->fd, SOL_SOCKET, SO_ERROR, &SwooleG.error, &len) < 0)
+    if (event->ret == 0 && param->sent)
     {
-        swWarn("getsockopt(%d) failed. Error: %s[%d]", event->fd, strerror(errno), errno);
-        return SW_ERR;
+        close(param->fd);
+        param->fd = -1;
+        ld->index++;
+        mysql_long_data_next(ld);
+        return;
+    }
+    param->offset += event->ret;
+    param->sent = 1;
+    // the connection is broken, it will be closed by the reactor
+    if (mysql_long_data_write(ld, event->ret) < 0)
+    {
+        return;
     }
+    // the next chunk is only read once the socket has sent this one
+    if (!swBuffer_empty(ld->client->cli->socket->out_buffer))
+    {
+        ld->waiting = 1;
+        return;
+    }
+    mysql_long_data_next(ld);
+}
 
-    mysql_client *client = event->socket->object;
-    //success
-    if (SwooleG.error == 0)
+static void mysql_long_data_next(mysql_long_data *ld)
+{
+    mysql_long_data_param *param;
+    swAio_event ev;
+
+    ld->waiting = 0;
+    if (ld->index == ld->num_params)
     {
-        //listen read event
-        SwooleG.main_reactor->set(SwooleG.main_reactor, event->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ);
-        //connected
-        event->socket->active = 1;
-        client->handshake = SW_MYSQL_HANDSHAKE_WAIT_REQUEST;
+        mysql_long_data_finish(ld);
+        return;
     }
-    else
+    param = &ld->params[ld->index];
+
+    bzero(&ev, sizeof(ev));
+    ev.fd = param->fd;
+    ev.buf = ld->buffer + SW_MYSQL_LONG_DATA_HEADER_SIZE;
+    ev.type = SW_AIO_READ;
+    ev.nbytes = SW_MYSQL_LONG_DATA_CHUNK_SIZE;
+    ev.offset = param->offset;
+    ev.object = ld;
+    ev.handler = swAio_handler_read;
+    ev.callback = mysql_long_data_onRead;
+
+    if (swAio_dispatch(&ev) < 0)
     {
-        client->connector.error_code = SwooleG.error;
-        client->connector.error_msg = strerror(SwooleG.error);
-        client->connector.error_length = strlen(client->connector.error_msg);
-        swoole_mysql_onConnect(client);
+        mysql_long_data_abort(ld, "failed to read the long data of parameter#%u.", param->id);
+        return;
     }
-    return SW_OK;
+    ld->pending = 1;
 }
 
-static int swoole_mysql_onHandShake(mysql_client *client)
+/**
+ * the files are read from the disk asynchronously and sent chunk by chunk, before COM_STMT_EXECUTE,
+ * a stream must have a file descriptor, it is read from its current position
+ */
+static int mysql_long_data_start(mysql_client *client, mysql_statement *stmt, HashTable *files, mysql_request *request)
 {
-    swString *buffer = client->buffer;
-    swClient *cli = client->cli;
-    mysql_connector *connector = &client->connector;
+    mysql_long_data *ld;
+    mysql_long_data_param *param;
+    zend_ulong index;
+    zval *file;
+    php_stream *stream;
+    zend_string *path;
+    int fd;
 
-    int n = cli->recv(cli, buffer->str + buffer->length, buffer->size - buffer->length, 0);
-    if (n < 0)
+    if (mysql_client_writable(client) < 0)
     {
-        switch (swConnection_error(errno))
+        mysql_request_free(request);
+        return SW_ERR;
+    }
+
+    ld = ecalloc(1, sizeof(mysql_long_data));
+    ld->request = request;
+    ld->params = ecalloc(zend_hash_num_elements(files), sizeof(mysql_long_data_param));
+
+    ZEND_HASH_FOREACH_NUM_KEY_VAL(files, index, file)
+    {
+        param = &ld->params[ld->num_params++];
+        param->id = index;
+        param->fd = -1;
+        ZVAL_DEREF(file);
+        if (Z_TYPE_P(file) == IS_RESOURCE)
         {
-        case SW_ERROR:
-            swSysError("Read from socket[%d] failed.", cli->socket->fd);
-            return SW_ERR;
-        case SW_CLOSE:
-            goto system_call_error;
-        case SW_WAIT:
-            return SW_OK;
-        default:
-            return SW_ERR;
+            php_stream_from_zval_no_verify(stream, file);
+            if (!stream || php_stream_cast(stream, PHP_STREAM_AS_FD | PHP_STREAM_CAST_INTERNAL, (void **) &fd, 0) != SUCCESS
+                    || (param->fd = dup(fd)) < 0)
+            {
+                php_swoole_fatal_error(E_WARNING, "the stream of parameter#" ZEND_ULONG_FMT " has no file descriptor.", index);
+                mysql_long_data_free(ld);
+                return SW_ERR;
+            }
+            param->offset = php_stream_tell(stream);
+        }
+        else
+        {
+            path = zval_get_string(file);
+            if ((param->fd = open(ZSTR_VAL(path), O_RDONLY)) < 0)
+            {
+                php_swoole_sys_error(E_WARNING, "failed to open the file '%s' of parameter#" ZEND_ULONG_FMT ".", ZSTR_VAL(path), index);
+                zend_string_release(path);
+                mysql_long_data_free(ld);
+                return SW_ERR;
+            }
+            zend_string_release(path);
         }
     }
-    else if (n == 0)
-    {
-        errno = ECONNRESET;
-        goto system_call_error;
-    }
+    ZEND_HASH_FOREACH_END();
 
-    buffer->length += n;
+    ld->client = client;
+    ld->stmt_id = stmt->id;
+    ld->execute = swString_new(mysql_statement_buffer->length);
+    swString_append_ptr(ld->execute, mysql_statement_buffer->str, mysql_statement_buffer->length);
+    ld->buffer = emalloc(SW_MYSQL_LONG_DATA_HEADER_SIZE + SW_MYSQL_LONG_DATA_CHUNK_SIZE);
+    client->long_data = ld;
 
-    int ret = 0;
+    mysql_long_data_next(ld);
+    return SW_OK;
+}
 
-    _again:
-    swTraceLog(SW_TRACE_MYSQL_CLIENT, "handshake on %d", client->handshake);
-    if (client->switch_check)
+/**
+ * @return whether the consumer wants more rows, it stops the cursor by returning false
+ */
+static zend_bool mysql_cursor_callback(zval *zobject, zval *callback, zval *result)
+{
+    zval args[2];
+    zval *retval = NULL;
+    zend_bool more = 1;
+
+    args[0] = *zobject;
+    args[1] = *result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, callback, &retval, 2, args, 0, NULL) != SUCCESS)
     {
-        // after handshake we need check if server request us to switch auth type first
-        goto _check_switch;
+        php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
     }
-
-    switch(client->handshake)
+    if (UNEXPECTED(EG(exception)))
     {
-    case SW_MYSQL_HANDSHAKE_WAIT_REQUEST:
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    if (retval)
     {
-        client->switch_check = 1;
-        ret = mysql_handshake(connector, buffer->str, buffer->length);
+        more = Z_TYPE_P(retval) != IS_FALSE;
+        zval_ptr_dtor(retval);
+    }
+    return more;
+}
 
-        if (ret < 0)
-        {
-            goto _error;
-        }
-        else if (ret > 0)
+/**
+ * the callback of a cursor receives every batch of rows, then true once all the rows have been fetched,
+ * or false on error
+ */
+static void mysql_cursor_onResponse(zval *zobject, mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_statement *stmt = request->statement;
+    zend_bool done = 1;
+    zend_bool more;
+    zval zvalue;
+
+    if (Z_TYPE_P(result) == IS_ARRAY)
+    {
+        if (request->cmd == SW_MYSQL_COM_STMT_EXECUTE)
         {
-            _send:
-            if (cli->send(cli, connector->buf, connector->packet_length + 4, 0) < 0)
-            {
-                system_call_error: connector->error_code = errno;
-                connector->error_msg = strerror(errno);
-                connector->error_length = strlen(connector->error_msg);
-                swoole_mysql_onConnect(client);
-                return SW_OK;
-            }
-            else
+            if (client->response.status_code & SW_MYSQL_SERVER_STATUS_CURSOR_EXISTS)
             {
-                // clear for the new packet
-                swString_clear(buffer);
-                // mysql_handshake will return the next state flag
-                client->handshake = ret;
+                // the columns are only sent with the execution
+                stmt->columns = client->response.columns;
+                stmt->num_column = client->response.num_column;
+                client->response.columns = NULL;
+                if (mysql_stmt_fetch(zobject, client, stmt, request->fetch_size, request->callback) == SW_OK)
+                {
+                    return;
+                }
+                mysql_statement_close_cursor(stmt);
+                zval_ptr_dtor(result);
+                ZVAL_FALSE(result);
             }
         }
-        break;
-    }
-    case SW_MYSQL_HANDSHAKE_WAIT_SWITCH:
-    {
-        _check_switch:
-        client->switch_check = 0;
-        int next_state;
-        // handle auth switch request
-        switch (next_state = mysql_auth_switch(connector, buffer->str, buffer->length))
+        else
         {
-        case SW_AGAIN:
-            return SW_OK;
-        case SW_ERR:
-            // not the switch packet, go to the next
-            goto _again;
-        default:
-            ret = next_state;
-            goto _send;
+            done = !(client->response.status_code & SW_MYSQL_SERVER_STATUS_CURSOR_EXISTS)
+                    || (client->response.status_code & SW_MYSQL_SERVER_STATUS_LAST_ROW_SENT);
         }
-        break;
     }
-    case SW_MYSQL_HANDSHAKE_WAIT_SIGNATURE:
+
+    more = mysql_cursor_callback(zobject, request->callback, result);
+    // closed in the callback, the statements are gone
+    if (!client->cli)
     {
-        switch (mysql_parse_auth_signature(buffer, connector))
-        {
-        case SW_MYSQL_AUTH_SIGNATURE_SUCCESS:
-        {
-            client->handshake = SW_MYSQL_HANDSHAKE_WAIT_RESULT;
-            break;
-        }
-        case SW_MYSQL_AUTH_SIGNATURE_FULL_AUTH_REQUIRED:
+        return;
+    }
+    if (done)
+    {
+        if (request->cmd == SW_MYSQL_COM_STMT_FETCH)
         {
-            // send response and wait RSA public key
-            ret = SW_MYSQL_HANDSHAKE_WAIT_RSA; // handshake = ret
-            goto _send;
+            mysql_statement_close_cursor(stmt);
         }
-        default:
+        if (Z_TYPE_P(result) == IS_ARRAY && more)
         {
-            goto _error;
-        }
+            ZVAL_TRUE(&zvalue);
+            mysql_cursor_callback(zobject, request->callback, &zvalue);
         }
+    }
+    else if (!more)
+    {
+        char buf[4];
+        mysql_statement_close_cursor(stmt);
+        mysql_int4store(buf, stmt->id);
+        mysql_send_command(zobject, client, SW_MYSQL_COM_STMT_RESET, buf, sizeof(buf), NULL);
+    }
+    else if (mysql_stmt_fetch(zobject, client, stmt, request->fetch_size, request->callback) < 0)
+    {
+        mysql_statement_close_cursor(stmt);
+        ZVAL_FALSE(&zvalue);
+        mysql_cursor_callback(zobject, request->callback, &zvalue);
+    }
+}
 
-        // may be more packets
-        if (buffer->offset < buffer->length)
+/**
+ * the result of the response that has been parsed, the result set is moved out of the response
+ */
+static zval* mysql_response_result(mysql_client *client, zval *zobject, mysql_request *request)
+{
+    zval *result = sw_malloc_zval();
+
+    //OK
+    if (client->response.response_type == SW_MYSQL_PACKET_OK)
+    {
+        if (request && request->cmd == SW_MYSQL_COM_STMT_PREPARE && client->statement)
         {
-            goto _again;
+            // the result of COM_STMT_PREPARE is the statement id
+            ZVAL_LONG(result, client->statement->id);
+            swLinkedList_append(client->statement_list, client->statement);
+            client->statement = NULL;
         }
         else
         {
-            swString_clear(buffer);
+            ZVAL_TRUE(result);
         }
-        break;
     }
-    case SW_MYSQL_HANDSHAKE_WAIT_RSA:
+    //ERROR
+    else if (client->response.response_type == SW_MYSQL_PACKET_ERR)
     {
-        // encode by RSA
-#ifdef SW_MYSQL_RSA_SUPPORT
-        switch (mysql_parse_rsa(connector, SW_STRINGCVL(buffer)))
-        {
-        case SW_AGAIN:
-            return SW_OK;
-        case SW_OK:
-            ret = SW_MYSQL_HANDSHAKE_WAIT_RESULT; // handshake = ret
-            goto _send;
-        default:
-            goto _error;
-        }
-#else
-        connector->error_code = -1;
-        connector->error_msg = "MySQL8 RSA-Auth need enable OpenSSL!";
-        connector->error_length = strlen(connector->error_msg);
-        swoole_mysql_onConnect(client);
-        return SW_OK;
-#endif
-        break;
+        ZVAL_FALSE(result);
+        zend_update_property_stringl(swoole_mysql_ce, zobject, ZEND_STRL("error"), client->response.server_msg, client->response.l_server_msg);
+        zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), client->response.error_code);
     }
-    default:
+    //ResultSet
+    else if (client->response.result_array)
     {
-        ret = mysql_get_result(connector, SW_STRINGCVL(buffer));
-        if (ret < 0)
-        {
-            _error:
-            swoole_mysql_onConnect(client);
-        }
-        else if (ret > 0)
+        efree(result);
+        result = client->response.result_array;
+    }
+    else
+    {
+        ZVAL_TRUE(result);
+    }
+
+    // ERR instead of EOF drops the rows received so far
+    if (client->response.result_array && result != client->response.result_array)
+    {
+        sw_zval_free(client->response.result_array);
+    }
+    client->response.result_array = NULL;
+
+    return result;
+}
+
+/**
+ * keep one result of a request that has more than one,
+ * multiQuery gets all of them, the others get the first one or the error
+ */
+static void mysql_request_add_result(mysql_request *request, zval *result)
+{
+    if (request->multi)
+    {
+        if (Z_TYPE(request->results) == IS_UNDEF)
         {
-            swString_clear(buffer);
-            client->handshake = SW_MYSQL_HANDSHAKE_COMPLETED;
-            swoole_mysql_onConnect(client);
+            array_init(&request->results);
         }
-        // else recv again
+        add_next_index_zval(&request->results, result);
     }
+    else if (Z_TYPE(request->results) == IS_UNDEF || Z_TYPE_P(result) == IS_FALSE)
+    {
+        zval_ptr_dtor(&request->results);
+        ZVAL_COPY_VALUE(&request->results, result);
     }
-
-    return SW_OK;
+    else
+    {
+        zval_ptr_dtor(result);
+    }
+    efree(result);
 }
 
 static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
@@ -3011,19 +7067,37 @@ static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
         return swoole_mysql_onHandShake(client);
     }
 
-    int sock = event->fd;
     int ret;
 
     zval *zobject = client->object;
     swString *buffer = client->buffer;
+    // with the compressed protocol the socket data is inflated into the buffer
+    swString *recv_buffer = client->compress_buffer ? client->compress_buffer : buffer;
 
     zval args[2];
     zval *callback = NULL;
     zval *result = NULL;
+    mysql_request *request = NULL;
 
     while(1)
     {
-        ret = recv(sock, buffer->str + buffer->length, buffer->size - buffer->length, 0);
+        if (client->big_value && !client->big_value->complete)
+        {
+            // the rest of a value spanning several packets, without growing and copying the buffer
+            ret = mysql_big_value_recv(client);
+            if (ret > 0)
+            {
+                if (client->big_value->complete)
+                {
+                    goto parse_response;
+                }
+                continue;
+            }
+        }
+        else
+        {
+            ret = mysql_client_recv(client, recv_buffer->str + recv_buffer->length, recv_buffer->size - recv_buffer->length);
+        }
         if (ret < 0)
         {
             if (errno == EINTR)
@@ -3058,73 +7132,166 @@ static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
         }
         else
         {
-            buffer->length += ret;
+            recv_buffer->length += ret;
+#ifdef SW_HAVE_ZLIB
+            if (client->compress_buffer && mysql_decompress(client, client->compress_buffer, buffer) < 0)
+            {
+                php_swoole_fatal_error(E_WARNING, "failed to decompress the response of mysql connection#%d.", client->fd);
+                sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
+                return SW_OK;
+            }
+#endif
             //recv again
-            if (buffer->length == buffer->size)
+            if (recv_buffer->length == recv_buffer->size)
             {
-                if (swString_extend(buffer, buffer->size * 2) < 0)
+                if (swString_extend(recv_buffer, recv_buffer->size * 2) < 0)
                 {
                     php_swoole_fatal_error(E_ERROR, "malloc failed.");
                     reactor->del(SwooleG.main_reactor, event->fd);
                 }
                 continue;
             }
+#ifdef SW_USE_OPENSSL
+            // decrypted data left in the SSL object, the socket will not be readable for it
+            if (client->ssl && SSL_pending(client->ssl) > 0)
+            {
+                continue;
+            }
+#endif
 
             parse_response:
             if (mysql_response(client) < 0)
             {
+                if (client->state == SW_MYSQL_STATE_LOCAL_INFILE && !client->infile->started)
+                {
+                    mysql_infile_start(client);
+                }
                 return SW_OK;
             }
 
             zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("affected_rows"), client->response.affected_rows);
             zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("insert_id"), client->response.insert_id);
-            client->state = SW_MYSQL_STATE_QUERY;
 
-            //OK
-            if (client->response.response_type == SW_MYSQL_PACKET_OK)
+            if (client->response.response_type != SW_MYSQL_PACKET_ERR)
             {
-                result = sw_malloc_zval();
-                ZVAL_TRUE(result);
+                client->connector.server_status = client->response.status_code;
             }
-            //ERROR
-            else if (client->response.response_type == SW_MYSQL_PACKET_ERR)
+            if (client->response.l_gtid > 0)
             {
-                result = sw_malloc_zval();
-                ZVAL_FALSE(result);
+                if (client->connector.gtid)
+                {
+                    zend_string_release(client->connector.gtid);
+                }
+                client->connector.gtid = zend_string_init(client->response.gtid, client->response.l_gtid, 0);
+                zend_update_property_stringl(swoole_mysql_ce, zobject, ZEND_STRL("gtid"), client->response.gtid, client->response.l_gtid);
+            }
+
+            request = client->requests->head ? client->requests->head->data : NULL;
+            result = mysql_response_result(client, zobject, request);
+
+            // every statement of a multi-statement query or a CALL has its own result
+            if (request && client->response.response_type != SW_MYSQL_PACKET_ERR
+                    && (client->response.status_code & SW_MYSQL_SERVER_MORE_RESULTS_EXISTS))
+            {
+                mysql_request_add_result(request, result);
+                result = NULL;
+                bzero(&client->response, sizeof(client->response));
+                client->state = SW_MYSQL_STATE_READ_START;
+                mysql_buffer_compact(buffer);
+                goto parse_response;
+            }
 
-                zend_update_property_stringl(swoole_mysql_ce, zobject, ZEND_STRL("error"), client->response.server_msg, client->response.l_server_msg);
-                zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), client->response.error_code);
+            // responses always come back in the order the queries were sent
+            swLinkedList_shift(client->requests);
+            if (client->requests->num > 0)
+            {
+                mysql_request_start(client, client->requests->head->data);
             }
-            //ResultSet
             else
             {
-                result = client->response.result_array;
+                client->state = SW_MYSQL_STATE_QUERY;
             }
 
-            args[0] = *zobject;
-            args[1] = *result;
-            callback = client->callback;
-            if (sw_call_user_function_ex(EG(function_table), NULL, callback, NULL, 2, args, 0, NULL) != SUCCESS)
+            if (request && (request->multi || Z_TYPE(request->results) != IS_UNDEF))
             {
-                php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
-                reactor->del(SwooleG.main_reactor, event->fd);
+                mysql_request_add_result(request, result);
+                result = sw_malloc_zval();
+                ZVAL_COPY_VALUE(result, &request->results);
+                ZVAL_UNDEF(&request->results);
             }
-            if (UNEXPECTED(EG(exception)))
+
+            // the data could not be sent, the server has loaded what it got
+            if (client->infile)
             {
-                zend_exception_error(EG(exception), E_ERROR);
+                if (client->infile->error_code && Z_TYPE_P(result) != IS_FALSE)
+                {
+                    zval_ptr_dtor(result);
+                    ZVAL_FALSE(result);
+                    zend_update_property_string(swoole_mysql_ce, zobject, ZEND_STRL("error"), client->infile->error_msg);
+                    zend_update_property_long(swoole_mysql_ce, zobject, ZEND_STRL("errno"), client->infile->error_code);
+                }
+                mysql_infile_detach(client);
+            }
+
+            if (request && request->fetch_size > 0)
+            {
+                mysql_cursor_onResponse(zobject, client, request, result);
+            }
+            else if (request && request->batch)
+            {
+                mysql_batch_onResponse(zobject, request, result, client->response.affected_rows);
+            }
+            else if (request && request->handler)
+            {
+                request->handler(client, request, result);
+            }
+            else
+            {
+                args[0] = *zobject;
+                args[1] = *result;
+                callback = request ? request->callback : NULL;
+                if (callback && sw_call_user_function_ex(EG(function_table), NULL, callback, NULL, 2, args, 0, NULL) != SUCCESS)
+                {
+                    php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+                    reactor->del(SwooleG.main_reactor, event->fd);
+                }
+                if (UNEXPECTED(EG(exception)))
+                {
+                    zend_exception_error(EG(exception), E_ERROR);
+                }
             }
             if (result)
             {
                 sw_zval_free(result);
             }
             //free callback object
-            sw_zval_free(callback);
+            if (request)
+            {
+                mysql_request_free(request);
+            }
             swConnection *_socket = swReactor_get(SwooleG.main_reactor, event->fd);
             if (_socket->object)
             {
-                //clear buffer
-                swString_clear(client->buffer);
+                int error = client->response.response_type == SW_MYSQL_PACKET_ERR;
                 bzero(&client->response, sizeof(client->response));
+                if (client->hooks.onResponse)
+                {
+                    client->hooks.onResponse(client, error);
+                }
+                if (client->requests->num == 0)
+                {
+                    //clear buffer
+                    swString_clear(client->buffer);
+                }
+                else
+                {
+                    // drop the consumed response, the pipelined ones may be already received
+                    mysql_buffer_compact(client->buffer);
+                    if (client->buffer->length > 0)
+                    {
+                        goto parse_response;
+                    }
+                }
             }
             return SW_OK;
         }
@@ -3132,7 +7299,6 @@ static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
     return SW_OK;
 }
 
-#ifdef SW_USE_MYSQLND
 static PHP_METHOD(swoole_mysql, escape)
 {
     swString str;
@@ -3156,33 +7322,57 @@ static PHP_METHOD(swoole_mysql, escape)
         php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
         RETURN_FALSE;
     }
+    // the charset and NO_BACKSLASH_ESCAPES are those of the server
     if (!client->cli)
     {
         php_swoole_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
         RETURN_FALSE;
     }
 
-    char *newstr = safe_emalloc(2, str.length + 1, 1);
-    if (newstr == NULL)
+    swString_clear(mysql_request_buffer);
+    if (mysql_escape_append(mysql_request_buffer, str.str, str.length, &client->connector) < 0)
+    {
+        RETURN_FALSE;
+    }
+    RETURN_STRINGL(mysql_request_buffer->str, mysql_request_buffer->length);
+}
+
+/**
+ * the values of a row as the quoted SQL literals separated by commas, e.g. for VALUES (...)
+ */
+static PHP_METHOD(swoole_mysql, escapeArray)
+{
+    zval *values, *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a", &values) == FAILURE)
     {
-        php_swoole_fatal_error(E_ERROR, "emalloc(%ld) failed.", str.length + 1);
         RETURN_FALSE;
     }
 
-    const MYSQLND_CHARSET* cset = mysqlnd_find_charset_nr(client->connector.character_set);
-    if (cset == NULL)
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
-        php_swoole_fatal_error(E_ERROR, "unknown mysql charset[%d].", client->connector.character_set);
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
         RETURN_FALSE;
     }
-    int newstr_len = mysqlnd_cset_escape_slashes(cset, newstr, str.str, str.length);
-    if (newstr_len < 0)
+    if (!client->cli)
     {
-        php_swoole_fatal_error(E_ERROR, "mysqlnd_cset_escape_slashes() failed.");
+        php_swoole_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
         RETURN_FALSE;
     }
-    RETVAL_STRINGL(newstr, newstr_len);
-    efree(newstr);
-    return;
+
+    swString_clear(mysql_request_buffer);
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(values), value)
+    {
+        if (mysql_request_buffer->length > 0 && swString_append_ptr(mysql_request_buffer, ZEND_STRL(", ")) < 0)
+        {
+            RETURN_FALSE;
+        }
+        if (mysql_escape_value(mysql_request_buffer, value, &client->connector) < 0)
+        {
+            RETURN_FALSE;
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+    RETURN_STRINGL(mysql_request_buffer->str, mysql_request_buffer->length);
 }
-#endif
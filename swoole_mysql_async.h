@@ -21,12 +21,8 @@
 
 BEGIN_EXTERN_C()
 
-#ifdef SW_USE_MYSQLND
-#include "ext/mysqlnd/mysqlnd.h"
-#include "ext/mysqlnd/mysqlnd_charset.h"
-#endif
-
 #ifdef SW_USE_OPENSSL
+#include <openssl/ssl.h>
 #ifndef OPENSSL_NO_RSA
 #define SW_MYSQL_RSA_SUPPORT
 #endif
@@ -67,6 +63,8 @@ enum mysql_command
     SW_MYSQL_COM_SET_OPTION,
     SW_MYSQL_COM_STMT_FETCH,
     SW_MYSQL_COM_DAEMON,
+    SW_MYSQL_COM_BINLOG_DUMP_GTID,
+    SW_MYSQL_COM_RESET_CONNECTION,
     SW_MYSQL_COM_END
 };
 
@@ -78,6 +76,7 @@ enum mysql_handshake_state
     SW_MYSQL_HANDSHAKE_WAIT_RSA,
     SW_MYSQL_HANDSHAKE_WAIT_RESULT,
     SW_MYSQL_HANDSHAKE_COMPLETED,
+    SW_MYSQL_HANDSHAKE_WAIT_TLS, /* SSLRequest has been sent, the TLS handshake goes on */
 };
 
 enum mysql_auth_signature
@@ -102,6 +101,7 @@ enum mysql_read_state
     SW_MYSQL_STATE_READ_PARAM,
     SW_MYSQL_STATE_READ_END,
     SW_MYSQL_STATE_CLOSED,
+    SW_MYSQL_STATE_LOCAL_INFILE,
 };
 
 enum mysql_error_code
@@ -155,6 +155,9 @@ enum mysql_field_types
     SW_MYSQL_TYPE_NEWDATE,
     SW_MYSQL_TYPE_VARCHAR,
     SW_MYSQL_TYPE_BIT,
+    SW_MYSQL_TYPE_TIMESTAMP2, /* only in the binlog */
+    SW_MYSQL_TYPE_DATETIME2,
+    SW_MYSQL_TYPE_TIME2,
     SW_MYSQL_TYPE_JSON = 245,
     SW_MYSQL_TYPE_NEWDECIMAL = 246,
     SW_MYSQL_TYPE_ENUM = 247,
@@ -232,6 +235,17 @@ enum mysql_server_status_flags
     SW_MYSQL_SERVER_SESSION_STATE_CHANGED = 0x4000 // connection state information has changed
 };
 
+// ref: https://dev.mysql.com/doc/dev/mysql-server/latest/page_protocol_basic_ok_packet.html
+enum mysql_session_state_type
+{
+    SW_MYSQL_SESSION_TRACK_SYSTEM_VARIABLES = 0,
+    SW_MYSQL_SESSION_TRACK_SCHEMA,
+    SW_MYSQL_SESSION_TRACK_STATE_CHANGE,
+    SW_MYSQL_SESSION_TRACK_GTIDS,
+    SW_MYSQL_SESSION_TRACK_TRANSACTION_CHARACTERISTICS,
+    SW_MYSQL_SESSION_TRACK_TRANSACTION_STATE,
+};
+
 typedef struct
 {
     int packet_length;
@@ -258,6 +272,18 @@ typedef struct
     char *database;
     zend_bool strict_type;
     zend_bool fetch_mode;
+    zend_bool decimal_as_float; /* DECIMAL columns as float instead of string, precision may be lost */
+    zend_bool datetime_as_timestamp; /* DATETIME and TIMESTAMP columns as unix timestamp, taken as UTC */
+    zend_bool pipeline;
+    zend_bool compression; /* cleared in the handshake when the server does not support it */
+    zend_bool multi_statements;
+    double query_timeout;
+    zend_bool kill_on_timeout; /* KILL QUERY on another connection, otherwise the connection is closed */
+    zend_bool track_gtids; /* session_track_gtids = OWN_GTID, the OK packets of the commits carry their GTID */
+    double result_cache_ttl; /* the result sets of the SELECT queries are shared through the cache for that long */
+    zend_bool temporary_tables; /* the session may have created temporary tables, its queries are not cached */
+    zend_bool local_infile;
+    char *local_infile_dir; /* the files sent by LOAD DATA LOCAL INFILE must be in it */
 
     size_t host_len;
     size_t user_len;
@@ -269,12 +295,20 @@ typedef struct
     swTimer_node *timer;
 
     int capability_flags;
-    int max_packet_size;
+    int max_packet_size; /* max_allowed_packet of the server */
+    uint16_t server_status; /* status flags of the handshake, then of the last response */
+    uint32_t connection_id; /* thread id of the connection on the server, for KILL QUERY */
+    zend_string *gtid; /* the last GTID tracked by the session */
     char character_set;
     int packet_length;
     char buf[512];
+    char auth_plugin_data[SW_MYSQL_NONCE_LENGTH]; // challenge data of the last auth exchange, for RSA auth and COM_CHANGE_USER
+    char auth_plugin_name[32];
+    zend_bool rsa_key_cached; /* the password has been encrypted with the known public key of the server */
 #ifdef SW_USE_OPENSSL
-    char auth_plugin_data[SW_MYSQL_NONCE_LENGTH]; // save challenge data for RSA auth
+    SSL_CTX *ssl_ctx; /* shared by the connections with the same TLS options, NULL without TLS */
+    zend_bool ssl_verify_peer;
+    zend_bool ssl_ktls; /* the kernel encrypts and decrypts the records when it can */
 #endif
 
     uint16_t error_code;
@@ -334,6 +368,9 @@ typedef struct
     zval *object;
     swString *buffer; /* save the mysql multi responses data */
     zval *result; /* save the zval array result */
+    /* columns of the open cursor, COM_STMT_FETCH does not send them again */
+    mysql_field *columns;
+    ulong_t num_column;
 } mysql_statement;
 
 typedef struct
@@ -353,9 +390,125 @@ typedef struct
     uint16_t l_server_msg;
     ulong_t affected_rows;
     ulong_t insert_id;
+    char *gtid; /* session state of the OK packet */
+    uint16_t l_gtid;
     zval *result_array;
 } mysql_response_t;
 
+/**
+ * the statements of insertBatch, the callback is called once all of them have responded
+ */
+typedef struct
+{
+    zval *callback;
+    uint32_t pending; /* the requests still referencing the batch */
+    ulong_t affected_rows;
+    zend_bool failed;
+    swLinkedList *statements; /* the packets waiting for the response of the previous statement, without pipelining */
+} mysql_batch;
+
+struct _mysql_client;
+struct _mysql_request;
+
+/**
+ * the response of a request sent by the extension itself, instead of a user callback
+ */
+typedef void (*mysql_request_handler)(struct _mysql_client *client, struct _mysql_request *request, zval *result);
+
+typedef struct _mysql_request
+{
+    uint8_t cmd;
+    zval *callback;
+    mysql_statement *statement; /* the statement of the cursor, for COM_STMT_EXECUTE and COM_STMT_FETCH */
+    uint32_t fetch_size; /* rows per COM_STMT_FETCH, 0 means no cursor */
+    zval *infile_source; /* callable or Iterator providing the data of LOAD DATA LOCAL INFILE */
+    uint8_t multi; /* deliver every result set, not only the first one */
+    zval results; /* the results received so far, when the server sends more than one */
+    mysql_batch *batch;
+    mysql_request_handler handler;
+    void *data; /* of the handler */
+    struct _mysql_client *client;
+    double timeout; /* seconds, 0 means the query_timeout of the connection */
+    swTimer_node *timer;
+} mysql_request;
+
+/**
+ * the data of LOAD DATA LOCAL INFILE is sent one packet at a time
+ */
+typedef struct
+{
+    struct _mysql_client *client; /* NULL once the connection is closed */
+    char *filename; /* requested by the server */
+    int fd;
+    zval *source;
+    off_t offset;
+    char *buffer; /* packet header + data */
+    uint8_t sequence;
+    uint8_t started :1;
+    uint8_t pending :1; /* an AIO read or a deferred read is in flight */
+    uint8_t waiting :1; /* for the socket output buffer to drain */
+    uint16_t error_code;
+    char error_msg[256];
+} mysql_infile;
+
+/**
+ * a parameter of COM_STMT_EXECUTE bound to a file, sent with COM_STMT_SEND_LONG_DATA
+ */
+typedef struct
+{
+    uint16_t id;
+    int fd;
+    off_t offset;
+    uint8_t sent :1; /* at least one chunk, an empty file is sent as an empty chunk */
+} mysql_long_data_param;
+
+/**
+ * the long data is sent one chunk at a time, then the statement is executed
+ */
+typedef struct
+{
+    struct _mysql_client *client; /* NULL once the connection is closed */
+    mysql_request *request; /* COM_STMT_EXECUTE */
+    swString *execute; /* payload of COM_STMT_EXECUTE, without the long data parameters */
+    uint32_t stmt_id;
+    mysql_long_data_param *params;
+    uint16_t num_params;
+    uint16_t index; /* of the parameter being sent */
+    char *buffer; /* packet header + command + stmt-id + param-id + data */
+    uint8_t pending :1; /* an AIO read is in flight */
+    uint8_t waiting :1; /* for the socket output buffer to drain */
+} mysql_long_data;
+
+/**
+ * a column value spanning several packets, the part not yet buffered is received straight into its string
+ */
+typedef struct
+{
+    zend_string *value;
+    size_t filled;
+    off_t offset; /* of the value in the response buffer */
+    uint32_t packet_remaining; /* body bytes of the current packet */
+    char header[4]; /* int<3> payload_length + int<1> sequence_id */
+    uint8_t header_length; /* received of the next packet header */
+    uint8_t packet_full :1; /* the row goes on in the next packet */
+    uint8_t complete :1; /* the last packet of the row has been received */
+    size_t tail_length; /* rest of the row, appended to the buffer without its packet headers */
+} mysql_big_value;
+
+/**
+ * callbacks of the internal owner of a connection (e.g. Swoole\MySQL\Pool),
+ * they are called in addition to the user callbacks
+ */
+typedef struct
+{
+    void *data;
+    void (*onConnect)(struct _mysql_client *client, int success);
+    void (*onResponse)(struct _mysql_client *client, int error);
+    void (*onClose)(struct _mysql_client *client);
+    /* the payload of a packet of the binlog stream, more is set when the event goes on in the next packet */
+    void (*onEvent)(struct _mysql_client *client, char *data, size_t length, int more);
+} mysql_client_hooks;
+
 typedef struct _mysql_client
 {
 #ifdef SW_COROUTINE
@@ -370,32 +523,141 @@ typedef struct _mysql_client
     uint8_t handshake;
     uint8_t cmd; /* help with judging to do what in callback */
     swString *buffer; /* save the mysql responses data */
+    swString *compress_buffer; /* compressed frames from the server, only used with the compressed protocol */
+    uint8_t compress_sequence; /* after the one of the last compressed frame received, the data of LOAD DATA LOCAL goes on with it */
     swClient *cli;
     zval *object;
-    zval *callback;
     zval *onClose;
     int fd;
     uint32_t transaction :1;
     uint32_t connected :1;
+    uint32_t event_continued :1; /* the binlog event goes on in the next packet */
+#ifdef SW_USE_OPENSSL
+    SSL *ssl;
+    uint32_t ktls_send :1; /* the reactor writes plain data to the socket, the kernel encrypts it */
+    uint32_t ktls_recv :1;
+    uint8_t ssl_next_state; /* the handshake state once TLS is established */
+#endif
 
     mysql_connector connector;
     mysql_statement *statement;
     swLinkedList *statement_list;
+    swLinkedList *requests; /* in-flight requests, in the order they were sent */
 
     swTimer_node *timer;
 
     zval _object;
     zval _onClose;
 
-    size_t want_length;
-    off_t check_offset;
     mysql_response_t response; /* single response */
 
     // for stored procedure
     zval* tmp_result;
 
+    mysql_client_hooks hooks;
+
+    mysql_infile *infile;
+    mysql_long_data *long_data;
+    mysql_big_value *big_value;
+
 } mysql_client;
 
+enum mysql_pool_connection_state
+{
+    SW_MYSQL_POOL_CONNECTING = 0,
+    SW_MYSQL_POOL_IDLE,
+    SW_MYSQL_POOL_BUSY,
+    SW_MYSQL_POOL_CLOSED,
+};
+
+struct _mysql_pool;
+
+typedef struct
+{
+    zval _object; /* the Swoole\MySQL object */
+    mysql_client *client;
+    struct _mysql_pool *pool;
+    uint8_t state;
+    uint8_t checking; /* COM_PING health check in flight */
+
+    double created_at;
+    double last_used;
+    double last_checked;
+    double sent_at; /* of the request in flight, for the latency */
+    zend_string *gtid; /* the last GTID of the connection seen by the pool */
+    uint64_t query_count;
+    uint64_t error_count;
+} mysql_pool_connection;
+
+typedef struct
+{
+    struct _mysql_pool *pool;
+    zend_string *sql;
+    zval *callback;
+    swTimer_node *timer;
+    zend_bool transaction; /* START TRANSACTION, the connection is held until the commit or the rollback */
+    zend_string *gtid; /* the query waits for the GTID set to be executed by the server */
+} mysql_pool_waiter;
+
+typedef struct _mysql_pool
+{
+    zval *object;
+    zval _object;
+    zval config; /* server config, passed to Swoole\MySQL->connect() */
+
+    uint32_t min;
+    uint32_t max;
+    double idle_timeout;
+    double wait_timeout;
+    double health_check_interval;
+
+    swLinkedList *connections;
+    swLinkedList *idle_connections;
+    swLinkedList *waiters;
+    swTimer_node *timer;
+    uint32_t connecting;
+    uint8_t closed;
+
+    double latency; /* moving average of the response time */
+    double lag; /* replication lag measured by the lag query, -1 when unknown */
+    zend_string *lag_query;
+    double lag_check_interval;
+    double lag_checked_at;
+
+    zend_string *gtid; /* the last GTID of the writes through the pool */
+    double gtid_wait_timeout;
+    struct _mysql_pool *fallback; /* runs the queries of which the GTID was not reached in time */
+
+    uint64_t query_count;
+    uint64_t wait_count;
+    uint64_t wait_timeout_count;
+    uint64_t connect_count;
+    uint64_t connect_failure_count;
+    uint64_t close_count;
+    uint64_t gtid_wait_count;
+    uint64_t gtid_timeout_count;
+} mysql_pool;
+
+/**
+ * Swoole\MySQL\Router, a pool of the primary and one pool per replica
+ */
+typedef struct
+{
+    zval *object;
+    zval _object;
+    zval primary;
+    zval replicas;
+
+    double max_latency;
+    double max_lag;
+    zend_bool read_your_writes; /* the replicas wait for the last GTID of the primary */
+    uint8_t closed;
+
+    uint64_t read_count;
+    uint64_t write_count;
+    uint64_t fallback_count;
+} mysql_router;
+
 #define SW_MYSQL_NOT_NULL_FLAG               1
 #define SW_MYSQL_PRI_KEY_FLAG                2
 #define SW_MYSQL_UNIQUE_KEY_FLAG             4
@@ -416,6 +678,7 @@ typedef struct _mysql_client
 
 #define SW_MYSQL_PACKET_OK   0x0
 #define SW_MYSQL_PACKET_NULL 0xfb
+#define SW_MYSQL_PACKET_LOCAL_INFILE 0xfb
 #define SW_MYSQL_PACKET_EOF  0xfe
 #define SW_MYSQL_PACKET_ERR  0xff
 
@@ -425,6 +688,15 @@ typedef struct _mysql_client
 #define SW_MYSQL_MAX_PACKET_BODY_SIZE 0x00ffffff
 #define SW_MYSQL_MAX_PACKET_SIZE      (SW_MYSQL_PACKET_HEADER_SIZE + SW_MYSQL_MAX_PACKET_BODY_SIZE)
 
+/* int<3> compressed_length + int<1> sequence_id + int<3> uncompressed_length */
+#define SW_MYSQL_COMPRESSED_HEADER_SIZE  7
+/* COM_STMT_EXECUTE flags */
+#define SW_MYSQL_CURSOR_TYPE_NO_CURSOR   0x00
+#define SW_MYSQL_CURSOR_TYPE_READ_ONLY   0x01
+
+/* smaller payloads are sent as is, the same as libmysqlclient */
+#define SW_MYSQL_MIN_COMPRESS_LENGTH     50
+
 #define mysql_uint2korr(A)  (uint16_t) (((uint16_t) ((zend_uchar) (A)[0])) +\
                                ((uint16_t) ((zend_uchar) (A)[1]) << 8))
 #define mysql_uint3korr(A)  (uint32_t) (((uint32_t) ((zend_uchar) (A)[0])) +\
@@ -477,7 +749,7 @@ typedef struct _mysql_client
                 mysql_int4store((T),def_temp); \
                 mysql_int4store((T+4),def_temp2); } while (0)
 
-#define MYSQL_RESPONSE_BUFFER  (client->cmd == SW_MYSQL_COM_STMT_EXECUTE ? client->statement->buffer : client->buffer)
+#define MYSQL_RESPONSE_BUFFER  (client->buffer)
 
 int mysql_get_result(mysql_connector *connector, char *buf, int len);
 int mysql_get_charset(char *name);
@@ -485,10 +757,30 @@ int mysql_handshake(mysql_connector *connector, char *buf, int len);
 int mysql_parse_auth_signature(swString *buffer, mysql_connector *connector);
 int mysql_parse_rsa(mysql_connector *connector, char *buf, int len);
 int mysql_auth_switch(mysql_connector *connector, char *buf, int len);
+int mysql_command_pack(swString *buffer, uint8_t cmd, char *data, size_t length);
 int mysql_request_pack(swString *sql, swString *buffer);
 int mysql_prepare_pack(swString *sql, swString *buffer);
 int mysql_response(mysql_client *client);
-int mysql_is_over(mysql_client *client);
+int mysql_client_send(mysql_client *client, char *data, size_t length);
+int mysql_send_command(zval *zobject, mysql_client *client, uint8_t cmd, char *data, size_t length, zval *callback);
+int mysql_query(zval *zobject, mysql_client *client, swString *sql, zval *callback);
+int mysql_send_internal(zval *zobject, mysql_client *client, uint8_t cmd, char *data, size_t length, mysql_request_handler handler, void *handler_data);
+int mysql_wait_gtid(zval *zobject, mysql_client *client, zend_string *gtid, double timeout, mysql_request_handler handler, void *handler_data);
+zend_bool mysql_gtid_reached(zval *result);
+
+typedef struct _mysql_cache_flight mysql_cache_flight;
+
+int mysql_cache_lookup(zval *zobject, mysql_client *client, char *sql, size_t length, zval *callback, mysql_cache_flight **flight);
+void mysql_cache_flight_free(mysql_cache_flight *flight);
+void mysql_cache_onResponse(mysql_client *client, mysql_request *request, zval *result);
+void mysql_cache_stats(zval *return_value);
+void mysql_cache_track_session(mysql_connector *connector, char *sql, size_t length);
+
+int mysql_pool_query(mysql_pool *pool, zend_string *sql, zval *callback, double timeout, zend_bool transaction, zend_string *gtid);
+uint32_t mysql_pool_load(mysql_pool *pool);
+
+extern zend_class_entry *swoole_mysql_ce;
+extern zend_class_entry *swoole_mysql_pool_ce;
 
 #ifdef SW_MYSQL_DEBUG
 void mysql_client_info(mysql_client *client);
@@ -522,6 +814,20 @@ static sw_inline void mysql_pack_length(int length, char *buf)
     buf[0] = length;
 }
 
+static sw_inline void mysql_buffer_compact(swString *buffer)
+{
+    if (buffer->offset > 0)
+    {
+        size_t remaining = buffer->length - buffer->offset;
+        if (remaining > 0)
+        {
+            memmove(buffer->str, buffer->str + buffer->offset, remaining);
+        }
+        buffer->length = remaining;
+        buffer->offset = 0;
+    }
+}
+
 static sw_inline int mysql_length_coded_binary(char *m, ulong_t *r, char *nul, uint32_t len)
 {
     if (len < 1)
@@ -572,25 +878,27 @@ static sw_inline int mysql_length_coded_binary(char *m, ulong_t *r, char *nul, u
 
 static sw_inline int mysql_write_lcb(char *p, long val)
 {
-    if (val <= 250)
+    if (val < 251)
     {
         mysql_int1store(p, val);
         return 1;
     }
     else if (val <= 0xffff)
     {
-        mysql_int2store(p, val);
-        return 2;
+        mysql_int1store(p, 252);
+        mysql_int2store(p + 1, val);
+        return 3;
     }
     else if (val <= 0xffffff)
     {
-        mysql_int3store(p, val);
-        return 3;
+        mysql_int1store(p, 253);
+        mysql_int3store(p + 1, val);
+        return 4;
     }
     else
     {
         mysql_int1store(p, 254);
-        mysql_int8store(p, val);
+        mysql_int8store(p + 1, val);
         return 9;
     }
 }
@@ -0,0 +1,2129 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole_async.h"
+#include "swoole_mysql_async.h"
+
+enum mysql_binlog_event_type
+{
+    SW_BINLOG_QUERY_EVENT = 2,
+    SW_BINLOG_ROTATE_EVENT = 4,
+    SW_BINLOG_FORMAT_DESCRIPTION_EVENT = 15,
+    SW_BINLOG_XID_EVENT = 16,
+    SW_BINLOG_TABLE_MAP_EVENT = 19,
+    SW_BINLOG_WRITE_ROWS_EVENT_V1 = 23,
+    SW_BINLOG_UPDATE_ROWS_EVENT_V1 = 24,
+    SW_BINLOG_DELETE_ROWS_EVENT_V1 = 25,
+    SW_BINLOG_HEARTBEAT_LOG_EVENT = 27,
+    SW_BINLOG_WRITE_ROWS_EVENT = 30,
+    SW_BINLOG_UPDATE_ROWS_EVENT = 31,
+    SW_BINLOG_DELETE_ROWS_EVENT = 32,
+    SW_BINLOG_GTID_LOG_EVENT = 33,
+    SW_BINLOG_ANONYMOUS_GTID_LOG_EVENT = 34,
+};
+
+/* optional metadata of TABLE_MAP_EVENT */
+enum mysql_binlog_table_metadata
+{
+    SW_BINLOG_METADATA_SIGNEDNESS = 1,
+    SW_BINLOG_METADATA_COLUMN_NAME = 4,
+};
+
+#define SW_BINLOG_EVENT_HEADER_SIZE   19
+#define SW_BINLOG_CHECKSUM_SIZE       4
+/* COM_BINLOG_DUMP_GTID, the GTID set is sent */
+#define SW_BINLOG_THROUGH_GTID        0x04
+
+/**
+ * the GTIDs of a server, as intervals of transaction numbers
+ */
+typedef struct
+{
+    int64_t start;
+    int64_t end; /* inclusive */
+} mysql_binlog_interval;
+
+typedef struct
+{
+    uint8_t uuid[16];
+    uint32_t num;
+    uint32_t size;
+    mysql_binlog_interval *intervals; /* sorted and disjoint */
+} mysql_binlog_sid;
+
+/**
+ * the columns of a table, sent before the rows of each transaction
+ */
+typedef struct
+{
+    zend_string *schema;
+    zend_string *table;
+    uint32_t num_columns;
+    uint8_t *types;
+    uint16_t *meta;
+    zend_bool *unsigned_flags;
+    zend_string **names; /* NULL unless binlog_row_metadata is FULL */
+    zend_bool skip; /* not in the tables of the stream */
+} mysql_binlog_table;
+
+typedef struct
+{
+    zval *object;
+    zval _object;
+    zval connection; /* the Swoole\MySQL object, UNDEF until it is started */
+    mysql_client *client; /* NULL once the connection is closed */
+    zval config;
+    zval *callback;
+
+    uint32_t server_id;
+    double heartbeat_period;
+    uint32_t batch_size;
+    zval tables; /* "schema.table" or "schema.*", UNDEF for all of them */
+
+    // the checkpoint, where the last delivered transaction ends
+    zend_string *file;
+    uint64_t position;
+    HashTable *gtid_set; /* NULL unless the stream started from a GTID set */
+
+    // the transaction being received
+    uint8_t uuid[16];
+    int64_t gno; /* 0 without a GTID */
+    zval changes;
+    uint32_t num_changes;
+
+    HashTable *tables_map; /* table id => mysql_binlog_table */
+    swString *event; /* an event spanning several packets */
+    uint8_t table_id_size;
+    uint8_t checksum :1;
+    uint8_t started :1;
+    uint8_t stopped :1;
+    uint8_t deferred :1;
+
+    zval ready; /* the batches waiting for the next tick, false once the stream has failed */
+} mysql_binlog;
+
+static PHP_METHOD(swoole_mysql_binlog, __construct);
+static PHP_METHOD(swoole_mysql_binlog, __destruct);
+static PHP_METHOD(swoole_mysql_binlog, start);
+static PHP_METHOD(swoole_mysql_binlog, stop);
+static PHP_METHOD(swoole_mysql_binlog, getPosition);
+
+static zend_class_entry *swoole_mysql_binlog_ce;
+static zend_object_handlers swoole_mysql_binlog_handlers;
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_void, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_binlog_construct, 0, 0, 1)
+    ZEND_ARG_ARRAY_INFO(0, config, 0)
+    ZEND_ARG_ARRAY_INFO(0, options, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_binlog_start, 0, 0, 1)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry swoole_mysql_binlog_methods[] =
+{
+    PHP_ME(swoole_mysql_binlog, __construct, arginfo_swoole_mysql_binlog_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_binlog, __destruct, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_binlog, start, arginfo_swoole_mysql_binlog_start, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_binlog, stop, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_binlog, getPosition, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+static void mysql_binlog_onConnect(mysql_client *client, int success);
+static void mysql_binlog_onClose(mysql_client *client);
+static void mysql_binlog_onEvent(mysql_client *client, char *data, size_t length, int more);
+
+void swoole_mysql_binlog_init(int module_number)
+{
+    SW_INIT_CLASS_ENTRY(swoole_mysql_binlog, "Swoole\\MySQL\\BinlogStream", "swoole_mysql_binlog_stream", NULL, swoole_mysql_binlog_methods);
+    SW_SET_CLASS_SERIALIZABLE(swoole_mysql_binlog, zend_class_serialize_deny, zend_class_unserialize_deny);
+    SW_SET_CLASS_CLONEABLE(swoole_mysql_binlog, sw_zend_class_clone_deny);
+    SW_SET_CLASS_UNSET_PROPERTY_HANDLER(swoole_mysql_binlog, sw_zend_class_unset_property_deny);
+
+    zend_declare_property_long(swoole_mysql_binlog_ce, ZEND_STRL("errCode"), 0, ZEND_ACC_PUBLIC);
+    zend_declare_property_string(swoole_mysql_binlog_ce, ZEND_STRL("errMsg"), "", ZEND_ACC_PUBLIC);
+}
+
+static void mysql_binlog_sid_dtor(zval *zv)
+{
+    mysql_binlog_sid *sid = Z_PTR_P(zv);
+    if (sid->intervals)
+    {
+        efree(sid->intervals);
+    }
+    efree(sid);
+}
+
+static void mysql_binlog_table_dtor(zval *zv)
+{
+    mysql_binlog_table *table = Z_PTR_P(zv);
+    uint32_t i;
+
+    zend_string_release(table->schema);
+    zend_string_release(table->table);
+    if (table->types)
+    {
+        efree(table->types);
+        efree(table->meta);
+        efree(table->unsigned_flags);
+    }
+    if (table->names)
+    {
+        for (i = 0; i < table->num_columns; i++)
+        {
+            if (table->names[i])
+            {
+                zend_string_release(table->names[i]);
+            }
+        }
+        efree(table->names);
+    }
+    efree(table);
+}
+
+/**
+ * add the transactions start..end, the intervals stay sorted and merged
+ */
+static void mysql_binlog_sid_add(mysql_binlog_sid *sid, int64_t start, int64_t end)
+{
+    uint32_t i;
+
+    for (i = 0; i < sid->num && sid->intervals[i].end + 1 < start; i++);
+
+    if (i < sid->num && sid->intervals[i].start <= end + 1)
+    {
+        sid->intervals[i].start = MIN(sid->intervals[i].start, start);
+        sid->intervals[i].end = MAX(sid->intervals[i].end, end);
+        while (i + 1 < sid->num && sid->intervals[i + 1].start <= sid->intervals[i].end + 1)
+        {
+            sid->intervals[i].end = MAX(sid->intervals[i].end, sid->intervals[i + 1].end);
+            memmove(&sid->intervals[i + 1], &sid->intervals[i + 2], (sid->num - i - 2) * sizeof(mysql_binlog_interval));
+            sid->num--;
+        }
+        return;
+    }
+    if (sid->num == sid->size)
+    {
+        sid->size = sid->size ? sid->size * 2 : 4;
+        sid->intervals = erealloc(sid->intervals, sid->size * sizeof(mysql_binlog_interval));
+    }
+    memmove(&sid->intervals[i + 1], &sid->intervals[i], (sid->num - i) * sizeof(mysql_binlog_interval));
+    sid->intervals[i].start = start;
+    sid->intervals[i].end = end;
+    sid->num++;
+}
+
+static mysql_binlog_sid* mysql_binlog_sid_get(HashTable *set, uint8_t *uuid)
+{
+    mysql_binlog_sid *sid = zend_hash_str_find_ptr(set, (char *) uuid, 16);
+    if (!sid)
+    {
+        sid = ecalloc(1, sizeof(mysql_binlog_sid));
+        memcpy(sid->uuid, uuid, 16);
+        zend_hash_str_add_ptr(set, (char *) uuid, 16, sid);
+    }
+    return sid;
+}
+
+static int mysql_binlog_parse_uuid(const char *p, const char *end, uint8_t *uuid)
+{
+    int i, n = 0, high = -1, v;
+
+    for (i = 0; i < 36; i++)
+    {
+        if (p + i >= end)
+        {
+            return SW_ERR;
+        }
+        if (i == 8 || i == 13 || i == 18 || i == 23)
+        {
+            if (p[i] != '-')
+            {
+                return SW_ERR;
+            }
+            continue;
+        }
+        if (!isxdigit((unsigned char) p[i]))
+        {
+            return SW_ERR;
+        }
+        v = isdigit((unsigned char) p[i]) ? p[i] - '0' : (tolower((unsigned char) p[i]) - 'a' + 10);
+        if (high < 0)
+        {
+            high = v;
+        }
+        else
+        {
+            uuid[n++] = (high << 4) | v;
+            high = -1;
+        }
+    }
+    return SW_OK;
+}
+
+/**
+ * "uuid:1-5:7,uuid:1-3", as in gtid_executed, the tagged GTIDs are not supported
+ */
+static int mysql_binlog_parse_gtid_set(HashTable *set, const char *p, size_t length)
+{
+    const char *end = p + length;
+    uint8_t uuid[16];
+    mysql_binlog_sid *sid;
+    char *q;
+    int64_t start, stop;
+
+    while (p < end)
+    {
+        if (isspace((unsigned char) *p) || *p == ',')
+        {
+            p++;
+            continue;
+        }
+        if (mysql_binlog_parse_uuid(p, end, uuid) < 0)
+        {
+            return SW_ERR;
+        }
+        p += 36;
+        sid = mysql_binlog_sid_get(set, uuid);
+        while (p < end && *p == ':')
+        {
+            p++;
+            if (p >= end || !isdigit((unsigned char) *p))
+            {
+                return SW_ERR;
+            }
+            start = stop = ZEND_STRTOL(p, &q, 10);
+            p = q;
+            if (p < end && *p == '-')
+            {
+                p++;
+                if (p >= end || !isdigit((unsigned char) *p))
+                {
+                    return SW_ERR;
+                }
+                stop = ZEND_STRTOL(p, &q, 10);
+                p = q;
+            }
+            if (start <= 0 || stop < start)
+            {
+                return SW_ERR;
+            }
+            mysql_binlog_sid_add(sid, start, stop);
+        }
+    }
+    return SW_OK;
+}
+
+static zend_string* mysql_binlog_gtid_set_string(HashTable *set)
+{
+    static const char hex[] = "0123456789abcdef";
+    mysql_binlog_sid *sid;
+    swString *buffer = swString_new(SW_BUFFER_SIZE_STD);
+    char buf[64];
+    uint32_t i;
+    zend_string *str;
+
+    ZEND_HASH_FOREACH_PTR(set, sid)
+    {
+        if (sid->num == 0)
+        {
+            continue;
+        }
+        if (buffer->length > 0)
+        {
+            swString_append_ptr(buffer, ZEND_STRL(","));
+        }
+        for (i = 0; i < 16; i++)
+        {
+            if (i == 4 || i == 6 || i == 8 || i == 10)
+            {
+                swString_append_ptr(buffer, ZEND_STRL("-"));
+            }
+            buf[0] = hex[sid->uuid[i] >> 4];
+            buf[1] = hex[sid->uuid[i] & 0xf];
+            swString_append_ptr(buffer, buf, 2);
+        }
+        for (i = 0; i < sid->num; i++)
+        {
+            if (sid->intervals[i].start == sid->intervals[i].end)
+            {
+                swString_append_ptr(buffer, buf, snprintf(buf, sizeof(buf), ":%" PRId64, sid->intervals[i].start));
+            }
+            else
+            {
+                swString_append_ptr(buffer, buf, snprintf(buf, sizeof(buf), ":%" PRId64 "-%" PRId64, sid->intervals[i].start, sid->intervals[i].end));
+            }
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+
+    str = zend_string_init(buffer->str, buffer->length, 0);
+    swString_free(buffer);
+    return str;
+}
+
+/**
+ * int<8> n_sids, then for each: uuid<16>, int<8> n_intervals, [int<8> start, int<8> end (exclusive)]
+ */
+static void mysql_binlog_gtid_set_encode(HashTable *set, swString *buffer)
+{
+    mysql_binlog_sid *sid;
+    char buf[16];
+    uint32_t i;
+    uint64_t n = 0;
+
+    ZEND_HASH_FOREACH_PTR(set, sid)
+    {
+        n += sid->num > 0;
+    }
+    ZEND_HASH_FOREACH_END();
+    mysql_int8store(buf, n);
+    swString_append_ptr(buffer, buf, 8);
+
+    ZEND_HASH_FOREACH_PTR(set, sid)
+    {
+        if (sid->num == 0)
+        {
+            continue;
+        }
+        swString_append_ptr(buffer, (char *) sid->uuid, 16);
+        mysql_int8store(buf, (uint64_t) sid->num);
+        swString_append_ptr(buffer, buf, 8);
+        for (i = 0; i < sid->num; i++)
+        {
+            mysql_int8store(buf, (uint64_t) sid->intervals[i].start);
+            mysql_int8store(buf + 8, (uint64_t) sid->intervals[i].end + 1);
+            swString_append_ptr(buffer, buf, 16);
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+}
+
+static void mysql_binlog_position(mysql_binlog *binlog, zval *zposition)
+{
+    array_init(zposition);
+    if (binlog->file)
+    {
+        add_assoc_str_ex(zposition, ZEND_STRL("file"), zend_string_copy(binlog->file));
+    }
+    else
+    {
+        add_assoc_null_ex(zposition, ZEND_STRL("file"));
+    }
+    add_assoc_long_ex(zposition, ZEND_STRL("position"), binlog->position);
+    if (binlog->gtid_set)
+    {
+        add_assoc_str_ex(zposition, ZEND_STRL("gtid"), mysql_binlog_gtid_set_string(binlog->gtid_set));
+    }
+    else
+    {
+        add_assoc_null_ex(zposition, ZEND_STRL("gtid"));
+    }
+}
+
+static void mysql_binlog_close(mysql_binlog *binlog)
+{
+    if (binlog->client && binlog->client->connected)
+    {
+        sw_zend_call_method_with_0_params(&binlog->connection, swoole_mysql_ce, NULL, "close", NULL);
+    }
+}
+
+static void mysql_binlog_onDefer(void *data)
+{
+    mysql_binlog *binlog = data;
+    zval *zobject = binlog->object;
+    zval ready, *batch;
+    zval args[2];
+
+    binlog->deferred = 0;
+    if (binlog->stopped)
+    {
+        mysql_binlog_close(binlog);
+    }
+    ZVAL_COPY_VALUE(&ready, &binlog->ready);
+    array_init(&binlog->ready);
+
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(ready), batch)
+    {
+        // stopped by the callback of the previous batch
+        if (binlog->stopped && Z_TYPE_P(batch) != IS_FALSE)
+        {
+            break;
+        }
+        args[0] = *zobject;
+        args[1] = *batch;
+        if (sw_call_user_function_ex(EG(function_table), NULL, binlog->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+        {
+            php_swoole_fatal_error(E_WARNING, "swoole_mysql_binlog_stream callback handler error.");
+        }
+        if (UNEXPECTED(EG(exception)))
+        {
+            zend_exception_error(EG(exception), E_ERROR);
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+    zval_ptr_dtor(&ready);
+
+    // the last reference may be gone, nothing is touched afterwards
+    zval_ptr_dtor(zobject);
+}
+
+/**
+ * the callbacks are never called while the response is being parsed, they may stop the stream
+ */
+static void mysql_binlog_deliver(mysql_binlog *binlog, zval *batch)
+{
+    add_next_index_zval(&binlog->ready, batch);
+    if (!binlog->deferred)
+    {
+        binlog->deferred = 1;
+        Z_TRY_ADDREF_P(binlog->object);
+        SwooleG.main_reactor->defer(SwooleG.main_reactor, mysql_binlog_onDefer, binlog);
+    }
+}
+
+static void mysql_binlog_fail(mysql_binlog *binlog, long code, const char *msg)
+{
+    zval zerror;
+
+    if (binlog->stopped)
+    {
+        return;
+    }
+    binlog->stopped = 1;
+    zend_update_property_long(swoole_mysql_binlog_ce, binlog->object, ZEND_STRL("errCode"), code);
+    zend_update_property_string(swoole_mysql_binlog_ce, binlog->object, ZEND_STRL("errMsg"), msg);
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "binlog stream failed, errno=%ld, error=%s", code, msg);
+
+    // the response of the connection may still be parsed, it is closed on the next tick
+    ZVAL_FALSE(&zerror);
+    mysql_binlog_deliver(binlog, &zerror);
+}
+
+/**
+ * the error of the last request of the connection
+ */
+static void mysql_binlog_fail_request(mysql_binlog *binlog, const char *what)
+{
+    zval *error = sw_zend_read_property(swoole_mysql_ce, &binlog->connection, ZEND_STRL("error"), 1);
+    zval *errcode = sw_zend_read_property(swoole_mysql_ce, &binlog->connection, ZEND_STRL("errno"), 1);
+    char buf[1024];
+
+    snprintf(buf, sizeof(buf), "%s failed: %s", what, Z_TYPE_P(error) == IS_STRING ? Z_STRVAL_P(error) : "unknown error");
+    mysql_binlog_fail(binlog, zval_get_long(errcode), buf);
+}
+
+/**
+ * the changes received so far, with the checkpoint of the last transaction
+ */
+static void mysql_binlog_flush(mysql_binlog *binlog)
+{
+    zval batch;
+
+    mysql_binlog_position(binlog, &batch);
+    add_assoc_zval_ex(&batch, ZEND_STRL("changes"), &binlog->changes);
+    array_init(&binlog->changes);
+    binlog->num_changes = 0;
+    mysql_binlog_deliver(binlog, &batch);
+}
+
+static void mysql_binlog_commit(mysql_binlog *binlog, uint32_t log_pos)
+{
+    if (binlog->gtid_set && binlog->gno > 0)
+    {
+        mysql_binlog_sid_add(mysql_binlog_sid_get(binlog->gtid_set, binlog->uuid), binlog->gno, binlog->gno);
+    }
+    binlog->gno = 0;
+    if (log_pos > 0)
+    {
+        binlog->position = log_pos;
+    }
+    // the transactions without a change of the tables move the checkpoint of the next batch only
+    if (binlog->num_changes > 0)
+    {
+        mysql_binlog_flush(binlog);
+    }
+}
+
+static void mysql_binlog_add_change(mysql_binlog *binlog, zval *change)
+{
+    add_next_index_zval(&binlog->changes, change);
+    // a large transaction is delivered in several batches, they have the checkpoint of the previous one
+    if (++binlog->num_changes >= binlog->batch_size && binlog->batch_size > 0)
+    {
+        mysql_binlog_flush(binlog);
+    }
+}
+
+static sw_inline uint64_t mysql_binlog_be(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static sw_inline uint64_t mysql_binlog_le(const uint8_t *p, int n)
+{
+    uint64_t v = 0;
+    int i;
+    for (i = n - 1; i >= 0; i--)
+    {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+/**
+ * the fractional seconds of the temporal types, in microseconds
+ */
+static sw_inline int64_t mysql_binlog_frac(const uint8_t *p, uint8_t fsp)
+{
+    switch (fsp)
+    {
+    case 1:
+    case 2:
+        return p[0] * 10000;
+    case 3:
+    case 4:
+        return mysql_binlog_be(p, 2) * 100;
+    case 5:
+    case 6:
+        return mysql_binlog_be(p, 3);
+    default:
+        return 0;
+    }
+}
+
+static int mysql_binlog_format_frac(char *buf, size_t size, int64_t usec, uint8_t fsp)
+{
+    static const int64_t divisors[] = { 1000000, 100000, 10000, 1000, 100, 10, 1 };
+    if (fsp == 0 || fsp > 6)
+    {
+        return 0;
+    }
+    return snprintf(buf, size, ".%0*" PRId64, fsp, usec / divisors[fsp]);
+}
+
+/**
+ * the binary format of DECIMAL, groups of 9 digits in 4 bytes big-endian, the sign in the first bit
+ */
+static ssize_t mysql_binlog_decode_decimal(const uint8_t *p, size_t length, uint8_t precision, uint8_t scale, zval *zv)
+{
+    static const int dig2bytes[10] = { 0, 1, 1, 2, 2, 3, 3, 4, 4, 4 };
+    int intg = precision - scale;
+    int intg0 = intg / 9, intg0x = intg % 9, frac0 = scale / 9, frac0x = scale % 9;
+    size_t size = intg0 * 4 + dig2bytes[intg0x] + frac0 * 4 + dig2bytes[frac0x];
+    uint8_t buf[40];
+    char out[96], *o = out;
+    const uint8_t *q = buf;
+    uint32_t mask, v;
+    zend_bool leading = 1;
+    int i;
+
+    if (intg < 0 || size > length || size > sizeof(buf) || size == 0)
+    {
+        return SW_ERR;
+    }
+    memcpy(buf, p, size);
+    mask = (buf[0] & 0x80) ? 0 : 0xffffffff;
+    buf[0] ^= 0x80;
+    if (mask)
+    {
+        *o++ = '-';
+    }
+
+    if (intg0x > 0)
+    {
+        v = (uint32_t) mysql_binlog_be(q, dig2bytes[intg0x]) ^ (mask >> (32 - 8 * dig2bytes[intg0x]));
+        q += dig2bytes[intg0x];
+        if (v > 0)
+        {
+            o += sprintf(o, "%u", v);
+            leading = 0;
+        }
+    }
+    for (i = 0; i < intg0; i++, q += 4)
+    {
+        v = (uint32_t) mysql_binlog_be(q, 4) ^ mask;
+        if (!leading)
+        {
+            o += sprintf(o, "%09u", v);
+        }
+        else if (v > 0)
+        {
+            o += sprintf(o, "%u", v);
+            leading = 0;
+        }
+    }
+    if (leading)
+    {
+        *o++ = '0';
+    }
+    if (scale > 0)
+    {
+        *o++ = '.';
+        for (i = 0; i < frac0; i++, q += 4)
+        {
+            o += sprintf(o, "%09u", (uint32_t) mysql_binlog_be(q, 4) ^ mask);
+        }
+        if (frac0x > 0)
+        {
+            v = (uint32_t) mysql_binlog_be(q, dig2bytes[frac0x]) ^ (mask >> (32 - 8 * dig2bytes[frac0x]));
+            o += sprintf(o, "%0*u", frac0x, v);
+        }
+    }
+    ZVAL_STRINGL(zv, out, o - out);
+    return size;
+}
+
+/**
+ * int<1..5> with 7 bits in each byte, the lengths of the binary JSON
+ */
+static int mysql_binlog_json_length(const uint8_t *p, size_t length, uint32_t *value)
+{
+    uint32_t v = 0;
+    size_t i;
+
+    for (i = 0; i < 5 && i < length; i++)
+    {
+        v |= (uint32_t) (p[i] & 0x7f) << (7 * i);
+        if (!(p[i] & 0x80))
+        {
+            *value = v;
+            return i + 1;
+        }
+    }
+    return SW_ERR;
+}
+
+static int mysql_binlog_decode_json_value(uint8_t type, const uint8_t *p, size_t length, zval *zv, int depth);
+
+/**
+ * object or array: int<2|4> count, int<2|4> size, the keys then the values, the small ones are inlined
+ */
+static int mysql_binlog_decode_json_container(const uint8_t *p, size_t length, zend_bool large, zend_bool object, zval *zv, int depth)
+{
+    int osz = large ? 4 : 2;
+    uint32_t count, size, i, offset, key_offset, key_length;
+    const uint8_t *entry;
+    uint8_t type;
+    zval value;
+
+    // the caller destroys zv when the container is rejected, even before it is an array
+    ZVAL_UNDEF(zv);
+    if (length < (size_t) 2 * osz)
+    {
+        return SW_ERR;
+    }
+    count = mysql_binlog_le(p, osz);
+    size = mysql_binlog_le(p + osz, osz);
+    if (size > length || 2 * osz + (size_t) count * ((object ? osz + 2 : 0) + 1 + osz) > size)
+    {
+        return SW_ERR;
+    }
+
+    array_init(zv);
+    for (i = 0; i < count; i++)
+    {
+        entry = p + 2 * osz + (object ? count * (osz + 2) : 0) + i * (1 + osz);
+        type = entry[0];
+        // literal, int16 and uint16, int32 and uint32 too in the large containers
+        if (type == 0x04 || type == 0x05 || type == 0x06 || (large && (type == 0x07 || type == 0x08)))
+        {
+            if (mysql_binlog_decode_json_value(type, entry + 1, osz, &value, depth + 1) < 0)
+            {
+                return SW_ERR;
+            }
+        }
+        else
+        {
+            offset = mysql_binlog_le(entry + 1, osz);
+            if (offset >= size || mysql_binlog_decode_json_value(type, p + offset, size - offset, &value, depth + 1) < 0)
+            {
+                return SW_ERR;
+            }
+        }
+        if (!object)
+        {
+            add_next_index_zval(zv, &value);
+            continue;
+        }
+        key_offset = mysql_binlog_le(p + 2 * osz + i * (osz + 2), osz);
+        key_length = mysql_uint2korr(p + 2 * osz + i * (osz + 2) + osz);
+        if ((size_t) key_offset + key_length > size)
+        {
+            zval_ptr_dtor(&value);
+            return SW_ERR;
+        }
+        zend_symtable_str_update(Z_ARRVAL_P(zv), (char *) p + key_offset, key_length, &value);
+    }
+    return SW_OK;
+}
+
+static int mysql_binlog_decode_json_value(uint8_t type, const uint8_t *p, size_t length, zval *zv, int depth)
+{
+    uint32_t n;
+    int ret;
+    double d;
+
+    // the server refuses deeper documents
+    if (depth > 100)
+    {
+        return SW_ERR;
+    }
+    switch (type)
+    {
+    case 0x00:
+    case 0x01:
+    case 0x02:
+    case 0x03:
+        if (mysql_binlog_decode_json_container(p, length, type & 0x01, type < 0x02, zv, depth) < 0)
+        {
+            zval_ptr_dtor(zv);
+            ZVAL_UNDEF(zv);
+            return SW_ERR;
+        }
+        return SW_OK;
+    case 0x04:
+        if (length < 1)
+        {
+            return SW_ERR;
+        }
+        if (p[0] == 0x01)
+        {
+            ZVAL_TRUE(zv);
+        }
+        else if (p[0] == 0x02)
+        {
+            ZVAL_FALSE(zv);
+        }
+        else
+        {
+            ZVAL_NULL(zv);
+        }
+        return SW_OK;
+    case 0x05:
+    case 0x06:
+        if (length < 2)
+        {
+            return SW_ERR;
+        }
+        ZVAL_LONG(zv, type == 0x05 ? (zend_long) (int16_t) mysql_uint2korr(p) : (zend_long) mysql_uint2korr(p));
+        return SW_OK;
+    case 0x07:
+    case 0x08:
+        if (length < 4)
+        {
+            return SW_ERR;
+        }
+        ZVAL_LONG(zv, type == 0x07 ? (zend_long) (int32_t) mysql_uint4korr(p) : (zend_long) mysql_uint4korr(p));
+        return SW_OK;
+    case 0x09:
+    case 0x0a:
+        if (length < 8)
+        {
+            return SW_ERR;
+        }
+        if (type == 0x0a && mysql_uint8korr(p) > ZEND_LONG_MAX)
+        {
+            ZVAL_DOUBLE(zv, (double) mysql_uint8korr(p));
+        }
+        else
+        {
+            ZVAL_LONG(zv, (zend_long) mysql_uint8korr(p));
+        }
+        return SW_OK;
+    case 0x0b:
+        if (length < 8)
+        {
+            return SW_ERR;
+        }
+        memcpy(&d, p, sizeof(d));
+        ZVAL_DOUBLE(zv, d);
+        return SW_OK;
+    case 0x0c:
+        if ((ret = mysql_binlog_json_length(p, length, &n)) < 0 || ret + n > length)
+        {
+            return SW_ERR;
+        }
+        ZVAL_STRINGL(zv, (char *) p + ret, n);
+        return SW_OK;
+    case 0x0f:
+        // opaque: the field type, then the value as stored in the column
+        if (length < 1 || (ret = mysql_binlog_json_length(p + 1, length - 1, &n)) < 0 || 1 + ret + n > length)
+        {
+            return SW_ERR;
+        }
+        ZVAL_STRINGL(zv, (char *) p + 1 + ret, n);
+        return SW_OK;
+    default:
+        return SW_ERR;
+    }
+}
+
+/**
+ * TIME2: int<3> big-endian hh:mm:ss with 0x800000 added, then the fraction, negative values are in two's complement
+ */
+static void mysql_binlog_decode_time2(const uint8_t *p, uint8_t fsp, char *buf, size_t size)
+{
+    int64_t intpart, frac = 0, packed, hms;
+    int n;
+
+    switch (fsp)
+    {
+    case 1:
+    case 2:
+        intpart = (int64_t) mysql_binlog_be(p, 3) - 0x800000;
+        frac = (int8_t) p[3];
+        if (intpart < 0 && frac)
+        {
+            intpart++;
+            frac -= 0x100;
+        }
+        packed = intpart * (1 << 24) + frac * 10000;
+        break;
+    case 3:
+    case 4:
+        intpart = (int64_t) mysql_binlog_be(p, 3) - 0x800000;
+        frac = (int64_t) mysql_binlog_be(p + 3, 2);
+        if (intpart < 0 && frac)
+        {
+            intpart++;
+            frac -= 0x10000;
+        }
+        packed = intpart * (1 << 24) + frac * 100;
+        break;
+    case 5:
+    case 6:
+        packed = (int64_t) mysql_binlog_be(p, 6) - 0x800000000000LL;
+        break;
+    default:
+        packed = ((int64_t) mysql_binlog_be(p, 3) - 0x800000) * (1 << 24);
+        break;
+    }
+
+    n = 0;
+    if (packed < 0)
+    {
+        buf[n++] = '-';
+        packed = -packed;
+    }
+    hms = packed >> 24;
+    frac = packed % (1 << 24);
+    n += snprintf(buf + n, size - n, "%02d:%02d:%02d", (int) ((hms >> 12) % (1 << 10)), (int) ((hms >> 6) % (1 << 6)), (int) (hms % (1 << 6)));
+    mysql_binlog_format_frac(buf + n, size - n, frac, fsp);
+}
+
+/**
+ * a column of a row image, the values are not in the format of the binary protocol
+ */
+static ssize_t mysql_binlog_decode_value(mysql_binlog_table *table, uint32_t column, const uint8_t *p, size_t length, zval *zv)
+{
+    uint8_t type = table->types[column];
+    uint16_t meta = table->meta[column];
+    zend_bool is_unsigned = table->unsigned_flags[column];
+    char buf[64];
+    uint64_t v;
+    uint32_t size, max_length;
+    int n;
+    float f;
+    double d;
+
+#define SW_BINLOG_NEED(n)  if (length < (size_t) (n)) { return SW_ERR; }
+
+    switch (type)
+    {
+    case SW_MYSQL_TYPE_TINY:
+        SW_BINLOG_NEED(1);
+        ZVAL_LONG(zv, is_unsigned ? (zend_long) p[0] : (zend_long) (int8_t) p[0]);
+        return 1;
+    case SW_MYSQL_TYPE_SHORT:
+        SW_BINLOG_NEED(2);
+        ZVAL_LONG(zv, is_unsigned ? (zend_long) mysql_uint2korr(p) : (zend_long) (int16_t) mysql_uint2korr(p));
+        return 2;
+    case SW_MYSQL_TYPE_INT24:
+        SW_BINLOG_NEED(3);
+        v = mysql_uint3korr(p);
+        ZVAL_LONG(zv, (is_unsigned || !(v & 0x800000)) ? (zend_long) v : (zend_long) v - 0x1000000);
+        return 3;
+    case SW_MYSQL_TYPE_LONG:
+        SW_BINLOG_NEED(4);
+        ZVAL_LONG(zv, is_unsigned ? (zend_long) mysql_uint4korr(p) : (zend_long) (int32_t) mysql_uint4korr(p));
+        return 4;
+    case SW_MYSQL_TYPE_LONGLONG:
+        SW_BINLOG_NEED(8);
+        v = mysql_uint8korr(p);
+        if (is_unsigned && v > ZEND_LONG_MAX)
+        {
+            ZVAL_STRINGL(zv, buf, snprintf(buf, sizeof(buf), "%" PRIu64, v));
+        }
+        else
+        {
+            ZVAL_LONG(zv, (zend_long) (int64_t) v);
+        }
+        return 8;
+    case SW_MYSQL_TYPE_FLOAT:
+        SW_BINLOG_NEED(4);
+        memcpy(&f, p, sizeof(f));
+        ZVAL_DOUBLE(zv, f);
+        return 4;
+    case SW_MYSQL_TYPE_DOUBLE:
+        SW_BINLOG_NEED(8);
+        memcpy(&d, p, sizeof(d));
+        ZVAL_DOUBLE(zv, d);
+        return 8;
+    case SW_MYSQL_TYPE_NULL:
+        ZVAL_NULL(zv);
+        return 0;
+    case SW_MYSQL_TYPE_YEAR:
+        SW_BINLOG_NEED(1);
+        ZVAL_LONG(zv, p[0] ? 1900 + p[0] : 0);
+        return 1;
+    case SW_MYSQL_TYPE_DATE:
+    case SW_MYSQL_TYPE_NEWDATE:
+        SW_BINLOG_NEED(3);
+        v = mysql_uint3korr(p);
+        ZVAL_STRINGL(zv, buf, snprintf(buf, sizeof(buf), "%04d-%02d-%02d", (int) (v >> 9), (int) ((v >> 5) & 15), (int) (v & 31)));
+        return 3;
+    case SW_MYSQL_TYPE_TIME:
+        SW_BINLOG_NEED(3);
+        v = mysql_uint3korr(p);
+        ZVAL_STRINGL(zv, buf, snprintf(buf, sizeof(buf), "%02d:%02d:%02d", (int) (v / 10000), (int) (v % 10000 / 100), (int) (v % 100)));
+        return 3;
+    case SW_MYSQL_TYPE_DATETIME:
+        SW_BINLOG_NEED(8);
+        v = mysql_uint8korr(p);
+        ZVAL_STRINGL(zv, buf, snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d",
+                (int) (v / 10000000000ULL), (int) (v / 100000000 % 100), (int) (v / 1000000 % 100),
+                (int) (v / 10000 % 100), (int) (v / 100 % 100), (int) (v % 100)));
+        return 8;
+    // without the time zone of the session, the timestamps are given as they are stored
+    case SW_MYSQL_TYPE_TIMESTAMP:
+        SW_BINLOG_NEED(4);
+        ZVAL_LONG(zv, mysql_uint4korr(p));
+        return 4;
+    case SW_MYSQL_TYPE_TIMESTAMP2:
+        size = 4 + (meta + 1) / 2;
+        SW_BINLOG_NEED(size);
+        if (meta == 0)
+        {
+            ZVAL_LONG(zv, mysql_binlog_be(p, 4));
+        }
+        else
+        {
+            ZVAL_DOUBLE(zv, mysql_binlog_be(p, 4) + mysql_binlog_frac(p + 4, meta) / 1000000.0);
+        }
+        return size;
+    case SW_MYSQL_TYPE_DATETIME2:
+    {
+        int64_t ym;
+        size = 5 + (meta + 1) / 2;
+        SW_BINLOG_NEED(size);
+        v = mysql_binlog_be(p, 5) - 0x8000000000ULL;
+        ym = (v >> 22) & 0x1ffff;
+        n = snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d", (int) (ym / 13), (int) (ym % 13),
+                (int) ((v >> 17) & 31), (int) ((v >> 12) & 31), (int) ((v >> 6) & 63), (int) (v & 63));
+        n += mysql_binlog_format_frac(buf + n, sizeof(buf) - n, mysql_binlog_frac(p + 5, meta), meta);
+        ZVAL_STRINGL(zv, buf, n);
+        return size;
+    }
+    case SW_MYSQL_TYPE_TIME2:
+        size = 3 + (meta + 1) / 2;
+        SW_BINLOG_NEED(size);
+        mysql_binlog_decode_time2(p, meta, buf, sizeof(buf));
+        ZVAL_STRING(zv, buf);
+        return size;
+    case SW_MYSQL_TYPE_NEWDECIMAL:
+        return mysql_binlog_decode_decimal(p, length, meta >> 8, meta & 0xff, zv);
+    case SW_MYSQL_TYPE_BIT:
+        size = ((meta >> 8) * 8 + (meta & 0xff) + 7) / 8;
+        SW_BINLOG_NEED(size);
+        ZVAL_LONG(zv, (zend_long) mysql_binlog_be(p, size));
+        return size;
+    case SW_MYSQL_TYPE_VARCHAR:
+    case SW_MYSQL_TYPE_VAR_STRING:
+        n = meta < 256 ? 1 : 2;
+        SW_BINLOG_NEED(n);
+        size = n + mysql_binlog_le(p, n);
+        SW_BINLOG_NEED(size);
+        ZVAL_STRINGL(zv, (char *) p + n, size - n);
+        return size;
+    case SW_MYSQL_TYPE_STRING:
+    case SW_MYSQL_TYPE_ENUM:
+    case SW_MYSQL_TYPE_SET:
+    {
+        // the real type and the length share the metadata
+        uint8_t real_type = meta >> 8;
+        max_length = meta & 0xff;
+        if ((real_type & 0x30) != 0x30)
+        {
+            max_length |= ((real_type & 0x30) ^ 0x30) << 4;
+            real_type |= 0x30;
+        }
+        // the index of the member, or the bits of the members
+        if (real_type == SW_MYSQL_TYPE_ENUM || real_type == SW_MYSQL_TYPE_SET)
+        {
+            SW_BINLOG_NEED(max_length);
+            ZVAL_LONG(zv, (zend_long) mysql_binlog_le(p, MIN(max_length, 8)));
+            return max_length;
+        }
+        n = max_length > 255 ? 2 : 1;
+        SW_BINLOG_NEED(n);
+        size = n + mysql_binlog_le(p, n);
+        SW_BINLOG_NEED(size);
+        ZVAL_STRINGL(zv, (char *) p + n, size - n);
+        return size;
+    }
+    case SW_MYSQL_TYPE_TINY_BLOB:
+    case SW_MYSQL_TYPE_MEDIUM_BLOB:
+    case SW_MYSQL_TYPE_LONG_BLOB:
+    case SW_MYSQL_TYPE_BLOB:
+    case SW_MYSQL_TYPE_GEOMETRY:
+    case SW_MYSQL_TYPE_JSON:
+        if (meta < 1 || meta > 4)
+        {
+            return SW_ERR;
+        }
+        SW_BINLOG_NEED(meta);
+        size = meta + mysql_binlog_le(p, meta);
+        SW_BINLOG_NEED(size);
+        if (type != SW_MYSQL_TYPE_JSON)
+        {
+            ZVAL_STRINGL(zv, (char *) p + meta, size - meta);
+        }
+        // the same as json_decode($value, true)
+        else if (size == meta)
+        {
+            ZVAL_NULL(zv);
+        }
+        else if (mysql_binlog_decode_json_value(p[meta], p + meta + 1, size - meta - 1, zv, 0) < 0)
+        {
+            return SW_ERR;
+        }
+        return size;
+    default:
+        return SW_ERR;
+    }
+#undef SW_BINLOG_NEED
+}
+
+/**
+ * null-bitmap, then the values of the columns present in the image
+ */
+static ssize_t mysql_binlog_decode_image(mysql_binlog_table *table, const uint8_t *p, size_t length, const uint8_t *present, uint32_t num_columns, zval *row)
+{
+    const uint8_t *start = p, *nulls;
+    uint32_t i, k, num_present = 0;
+    ssize_t ret;
+    zval value;
+
+    for (i = 0; i < num_columns; i++)
+    {
+        num_present += (present[i / 8] >> (i % 8)) & 1;
+    }
+    if (length < (num_present + 7) / 8)
+    {
+        return SW_ERR;
+    }
+    nulls = p;
+    p += (num_present + 7) / 8;
+    length -= (num_present + 7) / 8;
+
+    array_init(row);
+    for (i = 0, k = 0; i < num_columns; i++)
+    {
+        if (!((present[i / 8] >> (i % 8)) & 1))
+        {
+            continue;
+        }
+        if ((nulls[k / 8] >> (k % 8)) & 1)
+        {
+            ZVAL_NULL(&value);
+        }
+        else
+        {
+            if ((ret = mysql_binlog_decode_value(table, i, p, length, &value)) < 0)
+            {
+                zval_ptr_dtor(row);
+                return SW_ERR;
+            }
+            p += ret;
+            length -= ret;
+        }
+        k++;
+        if (table->names && table->names[i])
+        {
+            zend_symtable_update(Z_ARRVAL_P(row), table->names[i], &value);
+        }
+        else
+        {
+            add_index_zval(row, i, &value);
+        }
+    }
+    return p - start;
+}
+
+static sw_inline uint64_t mysql_binlog_table_id(mysql_binlog *binlog, const uint8_t *p)
+{
+    return mysql_binlog_le(p, binlog->table_id_size);
+}
+
+static zend_bool mysql_binlog_table_wanted(mysql_binlog *binlog, mysql_binlog_table *table)
+{
+    char buf[512];
+    int n;
+
+    if (Z_TYPE(binlog->tables) != IS_ARRAY)
+    {
+        return 1;
+    }
+    n = snprintf(buf, sizeof(buf), "%s.%s", ZSTR_VAL(table->schema), ZSTR_VAL(table->table));
+    if (zend_hash_str_exists(Z_ARRVAL(binlog->tables), buf, MIN(n, (int) sizeof(buf) - 1)))
+    {
+        return 1;
+    }
+    n = snprintf(buf, sizeof(buf), "%s.*", ZSTR_VAL(table->schema));
+    return zend_hash_str_exists(Z_ARRVAL(binlog->tables), buf, MIN(n, (int) sizeof(buf) - 1));
+}
+
+static sw_inline zend_bool mysql_binlog_is_numeric(uint8_t type)
+{
+    switch (type)
+    {
+    case SW_MYSQL_TYPE_TINY:
+    case SW_MYSQL_TYPE_SHORT:
+    case SW_MYSQL_TYPE_INT24:
+    case SW_MYSQL_TYPE_LONG:
+    case SW_MYSQL_TYPE_LONGLONG:
+    case SW_MYSQL_TYPE_NEWDECIMAL:
+    case SW_MYSQL_TYPE_FLOAT:
+    case SW_MYSQL_TYPE_DOUBLE:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * the optional metadata of MySQL 8.0, type<1> length<lenenc> value
+ */
+static void mysql_binlog_table_metadata(mysql_binlog_table *table, const uint8_t *p, const uint8_t *end)
+{
+    ulong_t length, name_length;
+    uint32_t i, k;
+    uint8_t type;
+    char nul;
+    int ret;
+
+    while (p < end)
+    {
+        type = *p++;
+        ret = mysql_length_coded_binary((char *) p, &length, &nul, end - p);
+        if (ret < 0 || p + ret + length > end)
+        {
+            return;
+        }
+        p += ret;
+        if (type == SW_BINLOG_METADATA_SIGNEDNESS)
+        {
+            // one bit for each numeric column, the most significant bit first
+            for (i = 0, k = 0; i < table->num_columns; i++)
+            {
+                if (!mysql_binlog_is_numeric(table->types[i]))
+                {
+                    continue;
+                }
+                if (k / 8 < length)
+                {
+                    table->unsigned_flags[i] = (p[k / 8] >> (7 - k % 8)) & 1;
+                }
+                k++;
+            }
+        }
+        else if (type == SW_BINLOG_METADATA_COLUMN_NAME)
+        {
+            const uint8_t *q = p, *q_end = p + length;
+            table->names = ecalloc(table->num_columns, sizeof(zend_string *));
+            for (i = 0; i < table->num_columns && q < q_end; i++)
+            {
+                ret = mysql_length_coded_binary((char *) q, &name_length, &nul, q_end - q);
+                if (ret < 0 || q + ret + name_length > q_end)
+                {
+                    break;
+                }
+                table->names[i] = zend_string_init((char *) q + ret, name_length, 0);
+                q += ret + name_length;
+            }
+        }
+        p += length;
+    }
+}
+
+/**
+ * table_id<6> flags<2> schema<1+n+1> table<1+n+1> columns<lenenc> types<n> metadata<lenenc+n> nullable<bitmap> optional metadata
+ */
+static int mysql_binlog_table_map(mysql_binlog *binlog, const uint8_t *p, size_t length)
+{
+    const uint8_t *end = p + length, *meta, *meta_end;
+    mysql_binlog_table *table;
+    uint64_t id;
+    ulong_t num_columns, meta_length;
+    uint32_t i;
+    uint8_t n;
+    char nul;
+    int ret;
+
+    if (length < (size_t) binlog->table_id_size + 3)
+    {
+        return SW_ERR;
+    }
+    id = mysql_binlog_table_id(binlog, p);
+    p += binlog->table_id_size + 2;
+
+    table = ecalloc(1, sizeof(mysql_binlog_table));
+    n = *p++;
+    if (p + n + 2 > end)
+    {
+        efree(table);
+        return SW_ERR;
+    }
+    table->schema = zend_string_init((char *) p, n, 0);
+    p += n + 1;
+    n = *p++;
+    if (p + n + 1 > end)
+    {
+        zend_string_release(table->schema);
+        efree(table);
+        return SW_ERR;
+    }
+    table->table = zend_string_init((char *) p, n, 0);
+    p += n + 1;
+
+    ret = mysql_length_coded_binary((char *) p, &num_columns, &nul, end - p);
+    if (ret < 0 || p + ret + num_columns > end)
+    {
+        goto _error;
+    }
+    p += ret;
+    table->num_columns = num_columns;
+    table->types = emalloc(num_columns + 1);
+    table->meta = ecalloc(num_columns + 1, sizeof(uint16_t));
+    table->unsigned_flags = ecalloc(num_columns + 1, sizeof(zend_bool));
+    memcpy(table->types, p, num_columns);
+    p += num_columns;
+
+    ret = mysql_length_coded_binary((char *) p, &meta_length, &nul, end - p);
+    if (ret < 0 || p + ret + meta_length > end)
+    {
+        goto _error;
+    }
+    meta = p + ret;
+    meta_end = meta + meta_length;
+    for (i = 0; i < table->num_columns; i++)
+    {
+        switch (table->types[i])
+        {
+        case SW_MYSQL_TYPE_FLOAT:
+        case SW_MYSQL_TYPE_DOUBLE:
+        case SW_MYSQL_TYPE_TINY_BLOB:
+        case SW_MYSQL_TYPE_MEDIUM_BLOB:
+        case SW_MYSQL_TYPE_LONG_BLOB:
+        case SW_MYSQL_TYPE_BLOB:
+        case SW_MYSQL_TYPE_GEOMETRY:
+        case SW_MYSQL_TYPE_JSON:
+        case SW_MYSQL_TYPE_TIMESTAMP2:
+        case SW_MYSQL_TYPE_DATETIME2:
+        case SW_MYSQL_TYPE_TIME2:
+            if (meta + 1 > meta_end)
+            {
+                goto _error;
+            }
+            table->meta[i] = meta[0];
+            meta += 1;
+            break;
+        case SW_MYSQL_TYPE_VARCHAR:
+        case SW_MYSQL_TYPE_VAR_STRING:
+            if (meta + 2 > meta_end)
+            {
+                goto _error;
+            }
+            table->meta[i] = mysql_uint2korr(meta);
+            meta += 2;
+            break;
+        case SW_MYSQL_TYPE_BIT:
+            if (meta + 2 > meta_end)
+            {
+                goto _error;
+            }
+            // bits % 8, then bytes
+            table->meta[i] = meta[0] | (meta[1] << 8);
+            meta += 2;
+            break;
+        case SW_MYSQL_TYPE_NEWDECIMAL:
+        case SW_MYSQL_TYPE_STRING:
+        case SW_MYSQL_TYPE_ENUM:
+        case SW_MYSQL_TYPE_SET:
+            if (meta + 2 > meta_end)
+            {
+                goto _error;
+            }
+            // precision and scale, or the real type and the length
+            table->meta[i] = (meta[0] << 8) | meta[1];
+            meta += 2;
+            break;
+        default:
+            break;
+        }
+    }
+    p = meta_end + (table->num_columns + 7) / 8;
+    if (p < end)
+    {
+        mysql_binlog_table_metadata(table, p, end);
+    }
+
+    table->skip = !mysql_binlog_table_wanted(binlog, table);
+    zend_hash_index_update_ptr(binlog->tables_map, id, table);
+    return SW_OK;
+
+    _error:
+    {
+        zval ztable;
+        ZVAL_PTR(&ztable, table);
+        mysql_binlog_table_dtor(&ztable);
+    }
+    return SW_ERR;
+}
+
+/**
+ * table_id<6> flags<2> [extra<2+n>] columns<lenenc> present<bitmap> [present after update<bitmap>] rows
+ */
+static int mysql_binlog_rows(mysql_binlog *binlog, uint8_t type, uint32_t timestamp, const uint8_t *p, size_t length)
+{
+    const uint8_t *end = p + length, *present, *present_after = NULL;
+    mysql_binlog_table *table;
+    zend_bool v2 = type >= SW_BINLOG_WRITE_ROWS_EVENT;
+    zend_bool update = type == SW_BINLOG_UPDATE_ROWS_EVENT || type == SW_BINLOG_UPDATE_ROWS_EVENT_V1;
+    const char *name;
+    ulong_t num_columns;
+    uint16_t extra;
+    ssize_t ret;
+    char nul;
+    zval change, rows, row, after, pair;
+
+    if (length < (size_t) binlog->table_id_size + 2)
+    {
+        return SW_ERR;
+    }
+    table = zend_hash_index_find_ptr(binlog->tables_map, mysql_binlog_table_id(binlog, p));
+    if (!table)
+    {
+        return SW_ERR;
+    }
+    if (table->skip)
+    {
+        return SW_OK;
+    }
+    p += binlog->table_id_size + 2;
+    if (v2)
+    {
+        if (p + 2 > end || p + (extra = mysql_uint2korr(p)) > end || extra < 2)
+        {
+            return SW_ERR;
+        }
+        p += extra;
+    }
+    ret = mysql_length_coded_binary((char *) p, &num_columns, &nul, end - p);
+    if (ret < 0 || num_columns > table->num_columns || p + ret + (num_columns + 7) / 8 * (update ? 2 : 1) > end)
+    {
+        return SW_ERR;
+    }
+    p += ret;
+    present = p;
+    p += (num_columns + 7) / 8;
+    if (update)
+    {
+        present_after = p;
+        p += (num_columns + 7) / 8;
+    }
+
+    array_init(&rows);
+    while (p < end)
+    {
+        if ((ret = mysql_binlog_decode_image(table, p, end - p, present, num_columns, &row)) < 0)
+        {
+            zval_ptr_dtor(&rows);
+            return SW_ERR;
+        }
+        p += ret;
+        if (!update)
+        {
+            add_next_index_zval(&rows, &row);
+            continue;
+        }
+        if ((ret = mysql_binlog_decode_image(table, p, end - p, present_after, num_columns, &after)) < 0)
+        {
+            zval_ptr_dtor(&row);
+            zval_ptr_dtor(&rows);
+            return SW_ERR;
+        }
+        p += ret;
+        array_init(&pair);
+        add_assoc_zval_ex(&pair, ZEND_STRL("before"), &row);
+        add_assoc_zval_ex(&pair, ZEND_STRL("after"), &after);
+        add_next_index_zval(&rows, &pair);
+    }
+
+    if (type == SW_BINLOG_WRITE_ROWS_EVENT || type == SW_BINLOG_WRITE_ROWS_EVENT_V1)
+    {
+        name = "insert";
+    }
+    else if (update)
+    {
+        name = "update";
+    }
+    else
+    {
+        name = "delete";
+    }
+    array_init(&change);
+    add_assoc_string_ex(&change, ZEND_STRL("type"), (char *) name);
+    add_assoc_str_ex(&change, ZEND_STRL("schema"), zend_string_copy(table->schema));
+    add_assoc_str_ex(&change, ZEND_STRL("table"), zend_string_copy(table->table));
+    add_assoc_long_ex(&change, ZEND_STRL("timestamp"), timestamp);
+    add_assoc_zval_ex(&change, ZEND_STRL("rows"), &rows);
+    mysql_binlog_add_change(binlog, &change);
+    return SW_OK;
+}
+
+/**
+ * thread_id<4> exec_time<4> schema_length<1> error_code<2> status_vars_length<2> status_vars schema<n+1> query
+ */
+static int mysql_binlog_query(mysql_binlog *binlog, uint32_t timestamp, uint32_t log_pos, const uint8_t *p, size_t length)
+{
+    const uint8_t *end = p + length;
+    uint8_t schema_length;
+    uint16_t status_length;
+    size_t query_length;
+    const char *query;
+    zval change;
+
+    if (length < 13)
+    {
+        return SW_ERR;
+    }
+    schema_length = p[8];
+    status_length = mysql_uint2korr(p + 11);
+    p += 13 + status_length;
+    if (p + schema_length + 1 > end)
+    {
+        return SW_ERR;
+    }
+    query = (const char *) p + schema_length + 1;
+    query_length = end - (const uint8_t *) query;
+
+    if (query_length == 5 && strncasecmp(query, "BEGIN", 5) == 0)
+    {
+        return SW_OK;
+    }
+    // the statements which are not in the row format, e.g. the DDL
+    if (!(query_length == 6 && strncasecmp(query, "COMMIT", 6) == 0))
+    {
+        array_init(&change);
+        add_assoc_string_ex(&change, ZEND_STRL("type"), (char *) "query");
+        add_assoc_stringl_ex(&change, ZEND_STRL("schema"), (char *) p, schema_length);
+        add_assoc_long_ex(&change, ZEND_STRL("timestamp"), timestamp);
+        add_assoc_stringl_ex(&change, ZEND_STRL("query"), (char *) query, query_length);
+        mysql_binlog_add_change(binlog, &change);
+    }
+    mysql_binlog_commit(binlog, log_pos);
+    return SW_OK;
+}
+
+/**
+ * timestamp<4> type<1> server_id<4> event_size<4> log_pos<4> flags<2>, then the body and the checksum
+ */
+static int mysql_binlog_event(mysql_binlog *binlog, const uint8_t *data, size_t length)
+{
+    uint32_t timestamp, log_pos;
+    uint8_t type;
+    const uint8_t *body;
+    size_t body_length;
+
+    if (length < SW_BINLOG_EVENT_HEADER_SIZE + (binlog->checksum ? SW_BINLOG_CHECKSUM_SIZE : 0))
+    {
+        return SW_ERR;
+    }
+    timestamp = mysql_uint4korr(data);
+    type = data[4];
+    log_pos = mysql_uint4korr(data + 13);
+    body = data + SW_BINLOG_EVENT_HEADER_SIZE;
+    body_length = length - SW_BINLOG_EVENT_HEADER_SIZE - (binlog->checksum ? SW_BINLOG_CHECKSUM_SIZE : 0);
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "binlog event, type=%d, length=%zu, log_pos=%u", type, length, log_pos);
+
+    switch (type)
+    {
+    case SW_BINLOG_ROTATE_EVENT:
+        // position<8> file
+        if (body_length < 8)
+        {
+            return SW_ERR;
+        }
+        if (binlog->file)
+        {
+            zend_string_release(binlog->file);
+        }
+        binlog->file = zend_string_init((char *) body + 8, body_length - 8, 0);
+        binlog->position = mysql_uint8korr(body);
+        return SW_OK;
+    case SW_BINLOG_FORMAT_DESCRIPTION_EVENT:
+        // binlog_version<2> server_version<50> timestamp<4> header_length<1>, then the post-header lengths
+        if (body_length > 57 + SW_BINLOG_TABLE_MAP_EVENT - 1)
+        {
+            binlog->table_id_size = body[57 + SW_BINLOG_TABLE_MAP_EVENT - 1] == 6 ? 4 : 6;
+        }
+        return SW_OK;
+    case SW_BINLOG_GTID_LOG_EVENT:
+        // flags<1> uuid<16> gno<8>
+        if (body_length < 25)
+        {
+            return SW_ERR;
+        }
+        memcpy(binlog->uuid, body + 1, 16);
+        binlog->gno = (int64_t) mysql_uint8korr(body + 17);
+        return SW_OK;
+    case SW_BINLOG_ANONYMOUS_GTID_LOG_EVENT:
+        binlog->gno = 0;
+        return SW_OK;
+    case SW_BINLOG_QUERY_EVENT:
+        return mysql_binlog_query(binlog, timestamp, log_pos, body, body_length);
+    case SW_BINLOG_XID_EVENT:
+        mysql_binlog_commit(binlog, log_pos);
+        return SW_OK;
+    case SW_BINLOG_TABLE_MAP_EVENT:
+        return mysql_binlog_table_map(binlog, body, body_length);
+    case SW_BINLOG_WRITE_ROWS_EVENT_V1:
+    case SW_BINLOG_UPDATE_ROWS_EVENT_V1:
+    case SW_BINLOG_DELETE_ROWS_EVENT_V1:
+    case SW_BINLOG_WRITE_ROWS_EVENT:
+    case SW_BINLOG_UPDATE_ROWS_EVENT:
+    case SW_BINLOG_DELETE_ROWS_EVENT:
+        return mysql_binlog_rows(binlog, type, timestamp, body, body_length);
+    // the heartbeats keep the connection alive, the other events are not about the rows
+    default:
+        return SW_OK;
+    }
+}
+
+static void mysql_binlog_onEvent(mysql_client *client, char *data, size_t length, int more)
+{
+    mysql_binlog *binlog = client->hooks.data;
+
+    if (binlog->stopped)
+    {
+        return;
+    }
+    if (more || binlog->event->length > 0)
+    {
+        swString_append_ptr(binlog->event, data, length);
+        if (more)
+        {
+            return;
+        }
+        data = binlog->event->str;
+        length = binlog->event->length;
+    }
+    if (mysql_binlog_event(binlog, (uint8_t *) data, length) < 0)
+    {
+        char buf[128];
+        snprintf(buf, sizeof(buf), "failed to decode the binlog event of type %d.", length > 4 ? (uint8_t) data[4] : -1);
+        mysql_binlog_fail(binlog, SW_ERR, buf);
+    }
+    swString_clear(binlog->event);
+}
+
+/**
+ * the stream only ends with an error or with the connection
+ */
+static void mysql_binlog_onDumpEnd(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_binlog *binlog = request->data;
+    if (!binlog->stopped)
+    {
+        mysql_binlog_fail_request(binlog, "binlog dump");
+    }
+}
+
+/**
+ * COM_BINLOG_DUMP_GTID from the GTID set, or COM_BINLOG_DUMP from the file and the position
+ */
+static void mysql_binlog_dump(mysql_binlog *binlog)
+{
+    swString *payload = swString_new(SW_BUFFER_SIZE_STD);
+    char buf[16];
+    uint8_t cmd;
+    int ret;
+
+    if (binlog->gtid_set)
+    {
+        cmd = SW_MYSQL_COM_BINLOG_DUMP_GTID;
+        // flags<2> server_id<4> file_length<4> file position<8> data_size<4> data
+        mysql_int2store(buf, SW_BINLOG_THROUGH_GTID);
+        mysql_int4store(buf + 2, binlog->server_id);
+        mysql_int4store(buf + 6, 0);
+        mysql_int8store(buf + 10, 4);
+        swString_append_ptr(payload, buf, 18);
+        swString_append_ptr(payload, buf, 4);
+        mysql_binlog_gtid_set_encode(binlog->gtid_set, payload);
+        mysql_int4store(payload->str + 18, payload->length - 22);
+    }
+    else
+    {
+        cmd = SW_MYSQL_COM_BINLOG_DUMP;
+        // position<4> flags<2> server_id<4> file
+        mysql_int4store(buf, binlog->position);
+        mysql_int2store(buf + 4, 0);
+        mysql_int4store(buf + 6, binlog->server_id);
+        swString_append_ptr(payload, buf, 10);
+        swString_append_ptr(payload, ZSTR_VAL(binlog->file), ZSTR_LEN(binlog->file));
+    }
+
+    swTraceLog(SW_TRACE_MYSQL_CLIENT, "binlog dump, server_id=%u, gtid=%d", binlog->server_id, binlog->gtid_set != NULL);
+    ret = mysql_send_internal(&binlog->connection, binlog->client, cmd, payload->str, payload->length, mysql_binlog_onDumpEnd, binlog);
+    swString_free(payload);
+    if (ret < 0)
+    {
+        mysql_binlog_fail_request(binlog, "binlog dump");
+    }
+}
+
+static void mysql_binlog_onRegister(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_binlog *binlog = request->data;
+    if (binlog->stopped)
+    {
+        return;
+    }
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        mysql_binlog_fail_request(binlog, "COM_REGISTER_SLAVE");
+        return;
+    }
+    mysql_binlog_dump(binlog);
+}
+
+/**
+ * server_id<4> hostname<1+n> user<1+n> password<1+n> port<2> rank<4> master_id<4>, the replica has nothing to report
+ */
+static void mysql_binlog_register(mysql_binlog *binlog)
+{
+    char buf[18];
+
+    bzero(buf, sizeof(buf));
+    mysql_int4store(buf, binlog->server_id);
+    if (mysql_send_internal(&binlog->connection, binlog->client, SW_MYSQL_COM_REGISTER_SLAVE, buf, sizeof(buf), mysql_binlog_onRegister, binlog) < 0)
+    {
+        mysql_binlog_fail_request(binlog, "COM_REGISTER_SLAVE");
+    }
+}
+
+static void mysql_binlog_onSettings(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_binlog *binlog = request->data;
+    if (binlog->stopped)
+    {
+        return;
+    }
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        mysql_binlog_fail_request(binlog, "the settings of the replica");
+        return;
+    }
+    mysql_binlog_register(binlog);
+}
+
+static zval* mysql_binlog_first_row(zval *result)
+{
+    zval *row;
+    if (Z_TYPE_P(result) != IS_ARRAY || !(row = zend_hash_index_find(Z_ARRVAL_P(result), 0)) || Z_TYPE_P(row) != IS_ARRAY)
+    {
+        return NULL;
+    }
+    return row;
+}
+
+/**
+ * the events come with the checksum of the server, the heartbeats keep an idle stream alive
+ */
+static void mysql_binlog_onChecksum(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_binlog *binlog = request->data;
+    zval *row, *value;
+    char sql[256];
+    size_t n = 0;
+
+    if (binlog->stopped)
+    {
+        return;
+    }
+    // before MySQL 5.6 there is no checksum
+    if ((row = mysql_binlog_first_row(result)) && (value = zend_hash_str_find(Z_ARRVAL_P(row), ZEND_STRL("checksum"))))
+    {
+        binlog->checksum = Z_TYPE_P(value) == IS_STRING && strcasecmp(Z_STRVAL_P(value), "NONE") != 0;
+        n = snprintf(sql, sizeof(sql), "SET @master_binlog_checksum = @@GLOBAL.binlog_checksum, @source_binlog_checksum = @@GLOBAL.binlog_checksum");
+    }
+    if (binlog->heartbeat_period > 0)
+    {
+        n += snprintf(sql + n, sizeof(sql) - n, "%s @master_heartbeat_period = %" PRIu64 ", @source_heartbeat_period = %" PRIu64,
+                n > 0 ? "," : "SET", (uint64_t) (binlog->heartbeat_period * 1e9), (uint64_t) (binlog->heartbeat_period * 1e9));
+    }
+    if (n == 0)
+    {
+        mysql_binlog_register(binlog);
+        return;
+    }
+    if (mysql_send_internal(&binlog->connection, binlog->client, SW_MYSQL_COM_QUERY, sql, n, mysql_binlog_onSettings, binlog) < 0)
+    {
+        mysql_binlog_fail_request(binlog, "the settings of the replica");
+    }
+}
+
+static void mysql_binlog_checksum(mysql_binlog *binlog)
+{
+    static char sql[] = "SELECT @@GLOBAL.binlog_checksum AS checksum";
+    if (mysql_send_internal(&binlog->connection, binlog->client, SW_MYSQL_COM_QUERY, sql, sizeof(sql) - 1, mysql_binlog_onChecksum, binlog) < 0)
+    {
+        mysql_binlog_fail_request(binlog, "the query of binlog_checksum");
+    }
+}
+
+/**
+ * without a position the stream starts from the current one, from the GTIDs when they are enabled
+ */
+static void mysql_binlog_onMasterStatus(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_binlog *binlog = request->data;
+    zval *row, *file, *position, *gtid;
+
+    if (binlog->stopped)
+    {
+        return;
+    }
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        mysql_binlog_fail_request(binlog, "SHOW MASTER STATUS");
+        return;
+    }
+    if (!(row = mysql_binlog_first_row(result)) || !(file = zend_hash_str_find(Z_ARRVAL_P(row), ZEND_STRL("File")))
+            || !(position = zend_hash_str_find(Z_ARRVAL_P(row), ZEND_STRL("Position"))))
+    {
+        mysql_binlog_fail(binlog, SW_ERR, "the binary log is not enabled.");
+        return;
+    }
+    binlog->file = zval_get_string(file);
+    binlog->position = zval_get_long(position);
+    gtid = zend_hash_str_find(Z_ARRVAL_P(row), ZEND_STRL("Executed_Gtid_Set"));
+    if (gtid && Z_TYPE_P(gtid) == IS_STRING && Z_STRLEN_P(gtid) > 0)
+    {
+        ALLOC_HASHTABLE(binlog->gtid_set);
+        zend_hash_init(binlog->gtid_set, 8, NULL, mysql_binlog_sid_dtor, 0);
+        if (mysql_binlog_parse_gtid_set(binlog->gtid_set, Z_STRVAL_P(gtid), Z_STRLEN_P(gtid)) < 0)
+        {
+            mysql_binlog_fail(binlog, SW_ERR, "invalid Executed_Gtid_Set.");
+            return;
+        }
+    }
+    mysql_binlog_checksum(binlog);
+}
+
+static void mysql_binlog_onConnect(mysql_client *client, int success)
+{
+    mysql_binlog *binlog = client->hooks.data;
+    static char sql[] = "SHOW MASTER STATUS";
+
+    if (binlog->stopped)
+    {
+        return;
+    }
+    if (!success)
+    {
+        zval *error = sw_zend_read_property(swoole_mysql_ce, &binlog->connection, ZEND_STRL("connect_error"), 1);
+        zval *errcode = sw_zend_read_property(swoole_mysql_ce, &binlog->connection, ZEND_STRL("connect_errno"), 1);
+        zend_string *msg = zval_get_string(error);
+        mysql_binlog_fail(binlog, zval_get_long(errcode), ZSTR_VAL(msg));
+        zend_string_release(msg);
+        return;
+    }
+    if (!binlog->file && !binlog->gtid_set)
+    {
+        if (mysql_send_internal(&binlog->connection, client, SW_MYSQL_COM_QUERY, sql, sizeof(sql) - 1, mysql_binlog_onMasterStatus, binlog) < 0)
+        {
+            mysql_binlog_fail_request(binlog, "SHOW MASTER STATUS");
+        }
+        return;
+    }
+    mysql_binlog_checksum(binlog);
+}
+
+static void mysql_binlog_onClose(mysql_client *client)
+{
+    mysql_binlog *binlog = client->hooks.data;
+    bzero(&client->hooks, sizeof(client->hooks));
+    binlog->client = NULL;
+}
+
+/**
+ * the state of the events of the previous connection, the checkpoint is kept
+ */
+static void mysql_binlog_reset(mysql_binlog *binlog)
+{
+    zend_hash_clean(binlog->tables_map);
+    zval_ptr_dtor(&binlog->changes);
+    array_init(&binlog->changes);
+    binlog->num_changes = 0;
+    binlog->gno = 0;
+    binlog->checksum = 0;
+    binlog->table_id_size = 6;
+    swString_clear(binlog->event);
+    if (Z_TYPE(binlog->connection) != IS_UNDEF)
+    {
+        zval_ptr_dtor(&binlog->connection);
+        ZVAL_UNDEF(&binlog->connection);
+    }
+}
+
+static PHP_METHOD(swoole_mysql_binlog, __construct)
+{
+    zval *config;
+    zval *options = NULL;
+    zval *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a|a", &config, &options) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_binlog *binlog = ecalloc(1, sizeof(mysql_binlog));
+    binlog->server_id = SW_MYSQL_BINLOG_SERVER_ID + (getpid() & 0xffff);
+    binlog->position = 4;
+    binlog->table_id_size = 6;
+    ZVAL_UNDEF(&binlog->connection);
+    ZVAL_UNDEF(&binlog->tables);
+
+    // the replication protocol has no compressed variant here, and the GTIDs of the session are not needed
+    ZVAL_DUP(&binlog->config, config);
+    add_assoc_bool_ex(&binlog->config, ZEND_STRL("compression"), 0);
+    add_assoc_bool_ex(&binlog->config, ZEND_STRL("track_gtids"), 0);
+
+    if (options)
+    {
+        HashTable *_ht = Z_ARRVAL_P(options);
+        if (php_swoole_array_get_value(_ht, "server_id", value))
+        {
+            binlog->server_id = (uint32_t) zval_get_long(value);
+        }
+        if (php_swoole_array_get_value(_ht, "file", value))
+        {
+            binlog->file = zval_get_string(value);
+        }
+        if (php_swoole_array_get_value(_ht, "position", value))
+        {
+            binlog->position = (uint64_t) zval_get_long(value);
+        }
+        if (php_swoole_array_get_value(_ht, "gtid", value))
+        {
+            zend_string *gtid = zval_get_string(value);
+            ALLOC_HASHTABLE(binlog->gtid_set);
+            zend_hash_init(binlog->gtid_set, 8, NULL, mysql_binlog_sid_dtor, 0);
+            if (mysql_binlog_parse_gtid_set(binlog->gtid_set, ZSTR_VAL(gtid), ZSTR_LEN(gtid)) < 0)
+            {
+                php_swoole_fatal_error(E_WARNING, "invalid GTID set[%s].", ZSTR_VAL(gtid));
+            }
+            zend_string_release(gtid);
+        }
+        if (php_swoole_array_get_value(_ht, "tables", value) && Z_TYPE_P(value) == IS_ARRAY)
+        {
+            zval *table;
+            array_init(&binlog->tables);
+            ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(value), table)
+            {
+                zend_string *name = zval_get_string(table);
+                add_assoc_bool_ex(&binlog->tables, ZSTR_VAL(name), ZSTR_LEN(name), 1);
+                zend_string_release(name);
+            }
+            ZEND_HASH_FOREACH_END();
+        }
+        if (php_swoole_array_get_value(_ht, "batch_size", value))
+        {
+            binlog->batch_size = (uint32_t) zval_get_long(value);
+        }
+        if (php_swoole_array_get_value(_ht, "heartbeat_period", value))
+        {
+            binlog->heartbeat_period = zval_get_double(value);
+        }
+    }
+
+    ALLOC_HASHTABLE(binlog->tables_map);
+    zend_hash_init(binlog->tables_map, 16, NULL, mysql_binlog_table_dtor, 0);
+    binlog->event = swString_new(SW_BUFFER_SIZE_STD);
+    array_init(&binlog->changes);
+    array_init(&binlog->ready);
+
+    binlog->object = getThis();
+    sw_copy_to_stack(binlog->object, binlog->_object);
+    swoole_set_object(getThis(), binlog);
+}
+
+/**
+ * the callback gets the batches of changes, each one with the checkpoint to start again from, false once the stream fails
+ */
+static PHP_METHOD(swoole_mysql_binlog, start)
+{
+    zval *callback;
+    zval retval, zcallback;
+    mysql_client *client;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_binlog *binlog = swoole_get_object(getThis());
+    if (!binlog)
+    {
+        RETURN_FALSE;
+    }
+    if (binlog->started && !binlog->stopped)
+    {
+        php_swoole_error(E_WARNING, "binlog stream is already started.");
+        RETURN_FALSE;
+    }
+
+    // it goes on from the last checkpoint
+    mysql_binlog_reset(binlog);
+    if (binlog->callback)
+    {
+        sw_zval_free(binlog->callback);
+    }
+    Z_TRY_ADDREF_P(callback);
+    binlog->callback = sw_zval_dup(callback);
+    binlog->started = 1;
+    binlog->stopped = 0;
+
+    object_init_ex(&binlog->connection, swoole_mysql_ce);
+    sw_zend_call_method_with_0_params(&binlog->connection, swoole_mysql_ce, NULL, "__construct", NULL);
+    client = swoole_get_object(&binlog->connection);
+    client->hooks.data = binlog;
+    client->hooks.onConnect = mysql_binlog_onConnect;
+    client->hooks.onClose = mysql_binlog_onClose;
+    client->hooks.onEvent = mysql_binlog_onEvent;
+    binlog->client = client;
+
+    ZVAL_NULL(&retval);
+    ZVAL_NULL(&zcallback);
+    zend_call_method_with_2_params(&binlog->connection, swoole_mysql_ce, NULL, "connect", &retval, &binlog->config, &zcallback);
+    if (Z_TYPE(retval) == IS_FALSE || UNEXPECTED(EG(exception)))
+    {
+        bzero(&client->hooks, sizeof(client->hooks));
+        binlog->client = NULL;
+        binlog->stopped = 1;
+        RETURN_FALSE;
+    }
+    zval_ptr_dtor(&retval);
+    RETURN_TRUE;
+}
+
+/**
+ * the changes not delivered yet are dropped, start() goes on from the checkpoint of the last batch
+ */
+static PHP_METHOD(swoole_mysql_binlog, stop)
+{
+    mysql_binlog *binlog = swoole_get_object(getThis());
+    if (!binlog || !binlog->started || binlog->stopped)
+    {
+        RETURN_FALSE;
+    }
+    binlog->stopped = 1;
+    zend_hash_clean(Z_ARRVAL(binlog->ready));
+    mysql_binlog_close(binlog);
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_mysql_binlog, getPosition)
+{
+    mysql_binlog *binlog = swoole_get_object(getThis());
+    if (!binlog)
+    {
+        RETURN_FALSE;
+    }
+    mysql_binlog_position(binlog, return_value);
+}
+
+static PHP_METHOD(swoole_mysql_binlog, __destruct)
+{
+    SW_PREVENT_USER_DESTRUCT();
+
+    mysql_binlog *binlog = swoole_get_object(getThis());
+    if (!binlog)
+    {
+        return;
+    }
+    binlog->stopped = 1;
+    mysql_binlog_close(binlog);
+    if (binlog->client)
+    {
+        bzero(&binlog->client->hooks, sizeof(binlog->client->hooks));
+    }
+    mysql_binlog_reset(binlog);
+    zend_hash_destroy(binlog->tables_map);
+    FREE_HASHTABLE(binlog->tables_map);
+    if (binlog->gtid_set)
+    {
+        zend_hash_destroy(binlog->gtid_set);
+        FREE_HASHTABLE(binlog->gtid_set);
+    }
+    if (binlog->file)
+    {
+        zend_string_release(binlog->file);
+    }
+    if (binlog->callback)
+    {
+        sw_zval_free(binlog->callback);
+    }
+    swString_free(binlog->event);
+    zval_ptr_dtor(&binlog->changes);
+    zval_ptr_dtor(&binlog->ready);
+    zval_ptr_dtor(&binlog->tables);
+    zval_ptr_dtor(&binlog->config);
+    efree(binlog);
+    swoole_set_object(getThis(), NULL);
+}
@@ -0,0 +1,472 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole_async.h"
+#include "swoole_mysql_async.h"
+
+/**
+ * the result set of a query, shared by the callbacks it is delivered to
+ */
+typedef struct
+{
+    zval result;
+    double expire;
+    size_t size;
+} mysql_cache_entry;
+
+/**
+ * the same query of another connection, it gets the result of the query in flight
+ */
+typedef struct _mysql_cache_waiter
+{
+    zval object;
+    zval callback;
+    struct _mysql_cache_waiter *next;
+} mysql_cache_waiter;
+
+struct _mysql_cache_flight
+{
+    zend_string *key;
+    double ttl;
+    mysql_cache_waiter *waiters;
+    mysql_cache_waiter **tail;
+};
+
+/**
+ * a result from the cache, delivered on the next tick of the reactor
+ */
+typedef struct
+{
+    zval object;
+    zval callback;
+    zval result;
+} mysql_cache_hit;
+
+static HashTable *mysql_cache_entries = NULL; /* the oldest first */
+static HashTable *mysql_cache_flights = NULL;
+static size_t mysql_cache_memory = 0;
+static size_t mysql_cache_memory_limit = SW_MYSQL_RESULT_CACHE_MEMORY;
+
+static struct
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t coalesced;
+    uint64_t evictions;
+    uint64_t expirations;
+} mysql_cache_counters;
+
+static void mysql_cache_entry_dtor(zval *zv)
+{
+    mysql_cache_entry *entry = Z_PTR_P(zv);
+    mysql_cache_memory -= entry->size;
+    zval_ptr_dtor(&entry->result);
+    efree(entry);
+}
+
+static void mysql_cache_init()
+{
+    if (mysql_cache_entries)
+    {
+        return;
+    }
+    ALLOC_HASHTABLE(mysql_cache_entries);
+    zend_hash_init(mysql_cache_entries, 64, NULL, mysql_cache_entry_dtor, 0);
+    ALLOC_HASHTABLE(mysql_cache_flights);
+    zend_hash_init(mysql_cache_flights, 16, NULL, NULL, 0);
+}
+
+/**
+ * the queries in flight are answered by their connections, which hold their own references
+ */
+void swoole_mysql_cache_free()
+{
+    if (!mysql_cache_entries)
+    {
+        return;
+    }
+    zend_hash_destroy(mysql_cache_entries);
+    FREE_HASHTABLE(mysql_cache_entries);
+    mysql_cache_entries = NULL;
+    zend_hash_destroy(mysql_cache_flights);
+    FREE_HASHTABLE(mysql_cache_flights);
+    mysql_cache_flights = NULL;
+}
+
+void mysql_cache_set_memory(size_t memory)
+{
+    mysql_cache_memory_limit = memory;
+}
+
+/**
+ * whether the SQL contains the keyword, outside of the literals or not
+ */
+static zend_bool mysql_cache_has_keyword(char *sql, size_t length, const char *keyword, size_t keyword_length)
+{
+    size_t i;
+    for (i = 0; i + keyword_length <= length; i++)
+    {
+        if (strncasecmp(sql + i, keyword, keyword_length) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * the temporary tables of a session would be shadowed by the results of the other sessions,
+ * they are looked for in every statement sent, including the ones of the transactions
+ */
+void mysql_cache_track_session(mysql_connector *connector, char *sql, size_t length)
+{
+    if (!connector->temporary_tables && mysql_cache_has_keyword(sql, length, ZEND_STRL("TEMPORARY")))
+    {
+        connector->temporary_tables = 1;
+    }
+}
+
+/**
+ * the server, the user and the database of the connection, the options which change how the rows are decoded,
+ * then the SQL with its runs of whitespace collapsed,
+ * NULL unless the SQL is a single SELECT which neither locks the rows nor depends on the session
+ */
+static zend_string* mysql_cache_key(mysql_connector *connector, char *sql, size_t length)
+{
+    // the same as the statements kept on the primary by the router, and the session values
+    static const char *uncacheable[] =
+    {
+        " FOR UPDATE", " FOR SHARE", " LOCK IN SHARE MODE", "SQL_NO_CACHE", " INTO ", ":=",
+        "GET_LOCK(", "RELEASE_LOCK(", "LAST_INSERT_ID(", "FOUND_ROWS(", "ROW_COUNT(", "CONNECTION_ID(",
+    };
+    char *end = sql + length;
+    char *p, *start;
+    char quote = 0;
+    zend_bool space = 0, variable = 0;
+    size_t i;
+    zend_string *key = zend_string_alloc(connector->user_len + connector->host_len + connector->database_len + MAX_LENGTH_OF_LONG + 32 + length, 0);
+
+    p = ZSTR_VAL(key);
+    p += sprintf(
+        p, "%s@%s:%ld/%s?%u,%d%d%d%d\n", connector->user, connector->host, connector->port, connector->database ? connector->database : "",
+        (uint8_t) connector->character_set, connector->strict_type, connector->fetch_mode,
+        connector->decimal_as_float, connector->datetime_as_timestamp
+    );
+    start = p;
+
+    for (; sql < end; sql++)
+    {
+        if (quote)
+        {
+            *p++ = *sql;
+            if (*sql == '\\' && quote != '`' && sql + 1 < end)
+            {
+                *p++ = *++sql;
+            }
+            else if (*sql == quote)
+            {
+                quote = 0;
+            }
+            continue;
+        }
+        if (isspace((unsigned char) *sql))
+        {
+            space = 1;
+            continue;
+        }
+        // the statements after the first one would not be executed
+        if (*sql == ';')
+        {
+            for (; sql < end; sql++)
+            {
+                if (*sql != ';' && !isspace((unsigned char) *sql))
+                {
+                    zend_string_release(key);
+                    return NULL;
+                }
+            }
+            break;
+        }
+        if (space && p != start)
+        {
+            *p++ = ' ';
+        }
+        space = 0;
+        if (*sql == '\'' || *sql == '"' || *sql == '`')
+        {
+            quote = *sql;
+        }
+        // @var and @@session_var
+        else if (*sql == '@')
+        {
+            variable = 1;
+        }
+        *p++ = *sql;
+    }
+    *p = '\0';
+    ZSTR_LEN(key) = p - ZSTR_VAL(key);
+
+    if (variable || p - start < 7 || strncasecmp(start, "SELECT", 6) != 0 || isalnum((unsigned char) start[6]) || start[6] == '_')
+    {
+        zend_string_release(key);
+        return NULL;
+    }
+    for (i = 0; i < sizeof(uncacheable) / sizeof(uncacheable[0]); i++)
+    {
+        if (mysql_cache_has_keyword(start, p - start, uncacheable[i], strlen(uncacheable[i])))
+        {
+            zend_string_release(key);
+            return NULL;
+        }
+    }
+    return key;
+}
+
+/**
+ * the memory of the result beyond its zval, roughly
+ */
+static size_t mysql_cache_sizeof(zval *zv)
+{
+    zend_string *key;
+    zval *value;
+    size_t size;
+
+    switch (Z_TYPE_P(zv))
+    {
+    case IS_STRING:
+        return ZSTR_IS_INTERNED(Z_STR_P(zv)) ? 0 : _ZSTR_STRUCT_SIZE(Z_STRLEN_P(zv));
+    case IS_ARRAY:
+        size = sizeof(zend_array) + Z_ARRVAL_P(zv)->nTableSize * (sizeof(Bucket) + sizeof(uint32_t));
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(zv), key, value)
+        {
+            if (key && !ZSTR_IS_INTERNED(key))
+            {
+                size += _ZSTR_STRUCT_SIZE(ZSTR_LEN(key));
+            }
+            size += mysql_cache_sizeof(value);
+        }
+        ZEND_HASH_FOREACH_END();
+        return size;
+    default:
+        return 0;
+    }
+}
+
+static void mysql_cache_add(zend_string *key, zval *result, double ttl)
+{
+    mysql_cache_entry *entry;
+    size_t size = sizeof(mysql_cache_entry) + _ZSTR_STRUCT_SIZE(ZSTR_LEN(key)) + mysql_cache_sizeof(result);
+    Bucket *oldest;
+
+    if (size > mysql_cache_memory_limit)
+    {
+        return;
+    }
+    zend_hash_del(mysql_cache_entries, key);
+    while (mysql_cache_memory + size > mysql_cache_memory_limit)
+    {
+        ZEND_HASH_FOREACH_BUCKET(mysql_cache_entries, oldest)
+        {
+            zend_hash_del_bucket(mysql_cache_entries, oldest);
+            break;
+        }
+        ZEND_HASH_FOREACH_END();
+        mysql_cache_counters.evictions++;
+    }
+
+    entry = emalloc(sizeof(mysql_cache_entry));
+    ZVAL_COPY(&entry->result, result);
+    entry->expire = swoole_microtime() + ttl;
+    entry->size = size;
+    mysql_cache_memory += size;
+    zend_hash_add_ptr(mysql_cache_entries, key, entry);
+}
+
+static void mysql_cache_onDefer(void *data)
+{
+    mysql_cache_hit *hit = data;
+    zval args[2];
+
+    args[0] = hit->object;
+    args[1] = hit->result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, &hit->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    zval_ptr_dtor(&hit->object);
+    zval_ptr_dtor(&hit->callback);
+    zval_ptr_dtor(&hit->result);
+    efree(hit);
+}
+
+/**
+ * @return SW_OK if the callback gets the result from the cache or from the same query in flight,
+ *         otherwise the query is to be sent, with the flight when it is cacheable
+ */
+int mysql_cache_lookup(zval *zobject, mysql_client *client, char *sql, size_t length, zval *callback, mysql_cache_flight **flight)
+{
+    mysql_cache_entry *entry;
+    mysql_cache_flight *f;
+    zend_string *key;
+
+    if (client->connector.temporary_tables || !(key = mysql_cache_key(&client->connector, sql, length)))
+    {
+        return SW_ERR;
+    }
+    mysql_cache_init();
+
+    if ((entry = zend_hash_find_ptr(mysql_cache_entries, key)))
+    {
+        if (entry->expire > swoole_microtime())
+        {
+            mysql_cache_hit *hit = emalloc(sizeof(mysql_cache_hit));
+            ZVAL_COPY(&hit->object, zobject);
+            ZVAL_COPY(&hit->callback, callback);
+            ZVAL_COPY(&hit->result, &entry->result);
+            SwooleG.main_reactor->defer(SwooleG.main_reactor, mysql_cache_onDefer, hit);
+            mysql_cache_counters.hits++;
+            zend_string_release(key);
+            return SW_OK;
+        }
+        zend_hash_del(mysql_cache_entries, key);
+        mysql_cache_counters.expirations++;
+    }
+
+    if ((f = zend_hash_find_ptr(mysql_cache_flights, key)))
+    {
+        mysql_cache_waiter *waiter = emalloc(sizeof(mysql_cache_waiter));
+        ZVAL_COPY(&waiter->object, zobject);
+        ZVAL_COPY(&waiter->callback, callback);
+        waiter->next = NULL;
+        *f->tail = waiter;
+        f->tail = &waiter->next;
+        mysql_cache_counters.coalesced++;
+        zend_string_release(key);
+        return SW_OK;
+    }
+
+    f = ecalloc(1, sizeof(mysql_cache_flight));
+    f->key = key;
+    f->ttl = client->connector.result_cache_ttl;
+    f->tail = &f->waiters;
+    zend_hash_add_ptr(mysql_cache_flights, key, f);
+    mysql_cache_counters.misses++;
+    *flight = f;
+    return SW_ERR;
+}
+
+/**
+ * the query could not be sent, nothing has joined it yet
+ */
+void mysql_cache_flight_free(mysql_cache_flight *flight)
+{
+    if (mysql_cache_flights)
+    {
+        zend_hash_del(mysql_cache_flights, flight->key);
+    }
+    zend_string_release(flight->key);
+    efree(flight);
+}
+
+/**
+ * the handler of a cacheable query, the result set is kept and delivered to the same queries in flight
+ */
+void mysql_cache_onResponse(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_cache_flight *flight = request->data;
+    mysql_cache_waiter *waiter, *next;
+    zval *error, *errcode;
+    zval args[2];
+
+    if (mysql_cache_flights)
+    {
+        zend_hash_del(mysql_cache_flights, flight->key);
+        if (Z_TYPE_P(result) == IS_ARRAY)
+        {
+            mysql_cache_add(flight->key, result, flight->ttl);
+        }
+    }
+
+    // unless it has timed out
+    if (request->callback && client->cli && !client->cli->destroyed)
+    {
+        args[0] = *client->object;
+        args[1] = *result;
+        if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+        {
+            php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+        }
+        if (UNEXPECTED(EG(exception)))
+        {
+            zend_exception_error(EG(exception), E_ERROR);
+        }
+    }
+
+    // they get the error of the query too
+    error = sw_zend_read_property(swoole_mysql_ce, client->object, ZEND_STRL("error"), 1);
+    errcode = sw_zend_read_property(swoole_mysql_ce, client->object, ZEND_STRL("errno"), 1);
+    for (waiter = flight->waiters; waiter; waiter = next)
+    {
+        next = waiter->next;
+        if (Z_TYPE_P(result) == IS_FALSE)
+        {
+            zend_update_property(swoole_mysql_ce, &waiter->object, ZEND_STRL("error"), error);
+            zend_update_property(swoole_mysql_ce, &waiter->object, ZEND_STRL("errno"), errcode);
+        }
+        args[0] = waiter->object;
+        args[1] = *result;
+        if (sw_call_user_function_ex(EG(function_table), NULL, &waiter->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+        {
+            php_swoole_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+        }
+        if (UNEXPECTED(EG(exception)))
+        {
+            zend_exception_error(EG(exception), E_ERROR);
+        }
+        zval_ptr_dtor(&waiter->object);
+        zval_ptr_dtor(&waiter->callback);
+        efree(waiter);
+    }
+
+    zend_string_release(flight->key);
+    efree(flight);
+}
+
+/**
+ * the coalesced queries are counted as hits in the ratio, they have not been sent either
+ */
+void mysql_cache_stats(zval *return_value)
+{
+    uint64_t lookups = mysql_cache_counters.hits + mysql_cache_counters.coalesced + mysql_cache_counters.misses;
+
+    array_init(return_value);
+    add_assoc_long(return_value, "hits", mysql_cache_counters.hits);
+    add_assoc_long(return_value, "misses", mysql_cache_counters.misses);
+    add_assoc_long(return_value, "coalesced", mysql_cache_counters.coalesced);
+    add_assoc_double(return_value, "hit_ratio", lookups ? (double) (mysql_cache_counters.hits + mysql_cache_counters.coalesced) / lookups : 0);
+    add_assoc_long(return_value, "expirations", mysql_cache_counters.expirations);
+    add_assoc_long(return_value, "evictions", mysql_cache_counters.evictions);
+    add_assoc_long(return_value, "entries", mysql_cache_entries ? zend_hash_num_elements(mysql_cache_entries) : 0);
+    add_assoc_long(return_value, "in_flight", mysql_cache_flights ? zend_hash_num_elements(mysql_cache_flights) : 0);
+    add_assoc_long(return_value, "memory", mysql_cache_memory);
+    add_assoc_long(return_value, "memory_limit", mysql_cache_memory_limit);
+}
@@ -0,0 +1,791 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole_async.h"
+#include "swoole_mysql_async.h"
+
+static PHP_METHOD(swoole_mysql_pool, __construct);
+static PHP_METHOD(swoole_mysql_pool, __destruct);
+static PHP_METHOD(swoole_mysql_pool, query);
+static PHP_METHOD(swoole_mysql_pool, begin);
+static PHP_METHOD(swoole_mysql_pool, getStats);
+static PHP_METHOD(swoole_mysql_pool, close);
+
+zend_class_entry *swoole_mysql_pool_ce;
+static zend_object_handlers swoole_mysql_pool_handlers;
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_void, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_pool_construct, 0, 0, 1)
+    ZEND_ARG_ARRAY_INFO(0, server_config, 0)
+    ZEND_ARG_ARRAY_INFO(0, options, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_pool_query, 0, 0, 2)
+    ZEND_ARG_INFO(0, sql)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_pool_begin, 0, 0, 1)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry swoole_mysql_pool_methods[] =
+{
+    PHP_ME(swoole_mysql_pool, __construct, arginfo_swoole_mysql_pool_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_pool, __destruct, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_pool, query, arginfo_swoole_mysql_pool_query, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_pool, begin, arginfo_swoole_mysql_pool_begin, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_pool, getStats, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_pool, close, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+static int mysql_pool_connect(mysql_pool *pool);
+static void mysql_pool_grow(mysql_pool *pool);
+static void mysql_pool_release(mysql_pool_connection *conn);
+static void mysql_pool_waiter_free(mysql_pool_waiter *waiter);
+static void mysql_pool_onConnect(mysql_client *client, int success);
+static void mysql_pool_onResponse(mysql_client *client, int error);
+static void mysql_pool_onClose(mysql_client *client);
+static void mysql_pool_onTimer(swTimer *timer, swTimer_node *tnode);
+static void mysql_pool_onWaitTimeout(swTimer *timer, swTimer_node *tnode);
+
+void swoole_mysql_pool_init(int module_number)
+{
+    SW_INIT_CLASS_ENTRY(swoole_mysql_pool, "Swoole\\MySQL\\Pool", "swoole_mysql_pool", NULL, swoole_mysql_pool_methods);
+    SW_SET_CLASS_SERIALIZABLE(swoole_mysql_pool, zend_class_serialize_deny, zend_class_unserialize_deny);
+    SW_SET_CLASS_CLONEABLE(swoole_mysql_pool, sw_zend_class_clone_deny);
+    SW_SET_CLASS_UNSET_PROPERTY_HANDLER(swoole_mysql_pool, sw_zend_class_unset_property_deny);
+
+    zend_declare_property_long(swoole_mysql_pool_ce, ZEND_STRL("errCode"), 0, ZEND_ACC_PUBLIC);
+    zend_declare_property_string(swoole_mysql_pool_ce, ZEND_STRL("errMsg"), "", ZEND_ACC_PUBLIC);
+}
+
+static sw_inline void mysql_pool_list_remove(swLinkedList *list, void *data)
+{
+    swLinkedList_node *node = swLinkedList_find(list, data);
+    if (node)
+    {
+        swLinkedList_remove_node(list, node);
+    }
+}
+
+static void mysql_pool_connection_free(void *data)
+{
+    mysql_pool_connection *conn = data;
+    if (conn->gtid)
+    {
+        zend_string_release(conn->gtid);
+    }
+    zval_ptr_dtor(&conn->_object);
+    efree(conn);
+}
+
+static void mysql_pool_connection_close(mysql_pool_connection *conn)
+{
+    zval *zobject = &conn->_object;
+    sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "close", NULL);
+}
+
+static mysql_pool_waiter* mysql_pool_waiter_new(mysql_pool *pool, zend_string *sql, zval *callback, zend_bool transaction, zend_string *gtid)
+{
+    mysql_pool_waiter *waiter = emalloc(sizeof(mysql_pool_waiter));
+    waiter->pool = pool;
+    waiter->sql = zend_string_copy(sql);
+    Z_TRY_ADDREF_P(callback);
+    waiter->callback = sw_zval_dup(callback);
+    waiter->timer = NULL;
+    waiter->transaction = transaction;
+    waiter->gtid = gtid ? zend_string_copy(gtid) : NULL;
+    return waiter;
+}
+
+static void mysql_pool_waiter_free(mysql_pool_waiter *waiter)
+{
+    if (waiter->timer)
+    {
+        swTimer_del(&SwooleG.timer, waiter->timer);
+    }
+    if (waiter->gtid)
+    {
+        zend_string_release(waiter->gtid);
+    }
+    zend_string_release(waiter->sql);
+    sw_zval_free(waiter->callback);
+    efree(waiter);
+}
+
+/**
+ * the query could not get a connection, its callback receives the pool object and false
+ */
+static void mysql_pool_waiter_fail(mysql_pool_waiter *waiter, zval *zobject)
+{
+    zval args[2];
+
+    args[0] = *zobject;
+    ZVAL_FALSE(&args[1]);
+    if (sw_call_user_function_ex(EG(function_table), NULL, waiter->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_mysql_pool query callback handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    mysql_pool_waiter_free(waiter);
+}
+
+static void mysql_pool_fail_waiters(mysql_pool *pool, zval *zobject)
+{
+    mysql_pool_waiter *waiter;
+    while ((waiter = swLinkedList_shift(pool->waiters)))
+    {
+        mysql_pool_waiter_fail(waiter, zobject);
+    }
+}
+
+static void mysql_pool_onGtidWait(mysql_client *client, mysql_request *request, zval *result);
+
+static void mysql_pool_dispatch(mysql_pool_connection *conn, zend_string *sql, zval *callback, zend_bool transaction, zend_string *gtid)
+{
+    mysql_pool *pool = conn->pool;
+    mysql_pool_waiter *waiter;
+    swString _sql;
+    int ret;
+
+    conn->state = SW_MYSQL_POOL_BUSY;
+    conn->last_used = conn->sent_at = swoole_microtime();
+    if (gtid)
+    {
+        // the query is sent by the handler once the server has executed the GTID set
+        waiter = mysql_pool_waiter_new(pool, sql, callback, transaction, NULL);
+        if ((ret = mysql_wait_gtid(&conn->_object, conn->client, gtid, pool->gtid_wait_timeout, mysql_pool_onGtidWait, waiter)) == SW_OK)
+        {
+            pool->gtid_wait_count++;
+            return;
+        }
+        mysql_pool_waiter_free(waiter);
+    }
+    else
+    {
+        bzero(&_sql, sizeof(_sql));
+        _sql.str = ZSTR_VAL(sql);
+        _sql.length = ZSTR_LEN(sql);
+        ret = mysql_query(&conn->_object, conn->client, &_sql, callback);
+    }
+    if (ret < 0)
+    {
+        // the connection is broken, the query will be dispatched to another one
+        swLinkedList_prepend(pool->waiters, mysql_pool_waiter_new(pool, sql, callback, transaction, gtid));
+        mysql_pool_connection_close(conn);
+        mysql_pool_grow(pool);
+        return;
+    }
+    if (transaction)
+    {
+        conn->client->transaction = 1;
+    }
+    conn->query_count++;
+    pool->query_count++;
+}
+
+static int mysql_pool_connect(mysql_pool *pool)
+{
+    mysql_pool_connection *conn = ecalloc(1, sizeof(mysql_pool_connection));
+    zval *zobject = &conn->_object;
+    zval retval, zcallback;
+
+    object_init_ex(zobject, swoole_mysql_ce);
+    sw_zend_call_method_with_0_params(zobject, swoole_mysql_ce, NULL, "__construct", NULL);
+
+    conn->pool = pool;
+    conn->state = SW_MYSQL_POOL_CONNECTING;
+    conn->created_at = swoole_microtime();
+    conn->client = swoole_get_object(zobject);
+    conn->client->hooks.data = conn;
+    conn->client->hooks.onConnect = mysql_pool_onConnect;
+    conn->client->hooks.onResponse = mysql_pool_onResponse;
+    conn->client->hooks.onClose = mysql_pool_onClose;
+
+    swLinkedList_append(pool->connections, conn);
+    pool->connecting++;
+    pool->connect_count++;
+
+    ZVAL_NULL(&retval);
+    ZVAL_NULL(&zcallback);
+    zend_call_method_with_2_params(zobject, swoole_mysql_ce, NULL, "connect", &retval, &pool->config, &zcallback);
+    if (Z_TYPE(retval) == IS_FALSE || UNEXPECTED(EG(exception)))
+    {
+        bzero(&conn->client->hooks, sizeof(conn->client->hooks));
+        mysql_pool_list_remove(pool->connections, conn);
+        pool->connecting--;
+        pool->connect_failure_count++;
+        mysql_pool_connection_free(conn);
+        return SW_ERR;
+    }
+    zval_ptr_dtor(&retval);
+    return SW_OK;
+}
+
+/**
+ * lazy creation: a new connection is only created when a query has to wait for it,
+ * or when the pool is below its minimum size
+ */
+static void mysql_pool_grow(mysql_pool *pool)
+{
+    if (pool->closed)
+    {
+        return;
+    }
+    while (pool->connections->num < pool->max
+            && (pool->connecting < pool->waiters->num || pool->connections->num < pool->min))
+    {
+        if (mysql_pool_connect(pool) < 0)
+        {
+            if (pool->connections->num == 0)
+            {
+                mysql_pool_fail_waiters(pool, pool->object);
+            }
+            break;
+        }
+    }
+}
+
+static void mysql_pool_release(mysql_pool_connection *conn)
+{
+    mysql_pool *pool = conn->pool;
+    mysql_pool_waiter *waiter;
+
+    if (conn->checking)
+    {
+        conn->checking = 0;
+        conn->last_checked = swoole_microtime();
+    }
+    if (pool->closed)
+    {
+        mysql_pool_connection_close(conn);
+        return;
+    }
+    // the first waiter gets the connection which frees up first
+    if ((waiter = swLinkedList_shift(pool->waiters)))
+    {
+        mysql_pool_dispatch(conn, waiter->sql, waiter->callback, waiter->transaction, waiter->gtid);
+        mysql_pool_waiter_free(waiter);
+        return;
+    }
+    conn->state = SW_MYSQL_POOL_IDLE;
+    swLinkedList_append(pool->idle_connections, conn);
+}
+
+static void mysql_pool_onConnect(mysql_client *client, int success)
+{
+    mysql_pool_connection *conn = client->hooks.data;
+    mysql_pool *pool = conn->pool;
+
+    pool->connecting--;
+    if (success)
+    {
+        conn->last_used = swoole_microtime();
+        mysql_pool_release(conn);
+        return;
+    }
+
+    pool->connect_failure_count++;
+    conn->state = SW_MYSQL_POOL_CLOSED;
+    // nobody is able to serve the waiting queries, the connection object tells them why
+    if (pool->connections->num - 1 == pool->connecting)
+    {
+        mysql_pool_fail_waiters(pool, &conn->_object);
+    }
+}
+
+static void mysql_pool_onResponse(mysql_client *client, int error)
+{
+    mysql_pool_connection *conn = client->hooks.data;
+    mysql_pool *pool = conn->pool;
+    double now = swoole_microtime();
+
+    if (error)
+    {
+        conn->error_count++;
+    }
+    // a new GTID of the session, e.g. a commit
+    if (client->connector.gtid && client->connector.gtid != conn->gtid)
+    {
+        if (conn->gtid)
+        {
+            zend_string_release(conn->gtid);
+        }
+        conn->gtid = zend_string_copy(client->connector.gtid);
+        if (pool->gtid)
+        {
+            zend_string_release(pool->gtid);
+        }
+        pool->gtid = zend_string_copy(client->connector.gtid);
+    }
+    if (conn->sent_at > 0)
+    {
+        pool->latency = pool->latency > 0 ? pool->latency + SW_MYSQL_POOL_LATENCY_WEIGHT * (now - conn->sent_at - pool->latency) : now - conn->sent_at;
+        conn->sent_at = client->requests->num > 0 ? now : 0;
+    }
+    // the connection is held until the user has no more queries in flight on it, and no open transaction
+    if (client->requests->num == 0 && conn->state == SW_MYSQL_POOL_BUSY
+            && !client->transaction && !(client->connector.server_status & SW_MYSQL_SERVER_STATUS_IN_TRANS))
+    {
+        mysql_pool_release(conn);
+    }
+}
+
+/**
+ * the replica has executed the GTID set, or the query goes to the fallback pool
+ */
+static void mysql_pool_onGtidWait(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_pool_waiter *waiter = request->data;
+    mysql_pool_connection *conn = client->hooks.data;
+    mysql_pool *pool = waiter->pool;
+
+    if (mysql_gtid_reached(result))
+    {
+        // the connection stays busy, the query is in flight before the response hook is called
+        mysql_pool_dispatch(conn, waiter->sql, waiter->callback, waiter->transaction, NULL);
+    }
+    else
+    {
+        pool->gtid_timeout_count++;
+        if (!pool->fallback || pool->fallback->closed
+                || mysql_pool_query(pool->fallback, waiter->sql, waiter->callback, pool->fallback->wait_timeout, waiter->transaction, NULL) < 0)
+        {
+            mysql_pool_waiter_fail(waiter, &conn->_object);
+            return;
+        }
+    }
+    mysql_pool_waiter_free(waiter);
+}
+
+/**
+ * the first row of the lag query, Seconds_Behind_Master of SHOW SLAVE STATUS or its first column
+ */
+static void mysql_pool_onLagCheck(mysql_client *client, mysql_request *request, zval *result)
+{
+    mysql_pool *pool = request->data;
+    zval *row, *value = NULL;
+
+    pool->lag = -1;
+    if (Z_TYPE_P(result) != IS_ARRAY || !(row = zend_hash_index_find(Z_ARRVAL_P(result), 0)) || Z_TYPE_P(row) != IS_ARRAY)
+    {
+        return;
+    }
+    if (!(value = zend_hash_str_find(Z_ARRVAL_P(row), ZEND_STRL("Seconds_Behind_Master")))
+            && !(value = zend_hash_str_find(Z_ARRVAL_P(row), ZEND_STRL("Seconds_Behind_Source"))))
+    {
+        zend_hash_internal_pointer_reset(Z_ARRVAL_P(row));
+        value = zend_hash_get_current_data(Z_ARRVAL_P(row));
+    }
+    // NULL when the replication is not running
+    if (value && Z_TYPE_P(value) != IS_NULL)
+    {
+        pool->lag = zval_get_double(value);
+    }
+}
+
+static void mysql_pool_onClose(mysql_client *client)
+{
+    mysql_pool_connection *conn = client->hooks.data;
+    mysql_pool *pool = conn->pool;
+
+    if (conn->state == SW_MYSQL_POOL_CONNECTING)
+    {
+        pool->connecting--;
+    }
+    else if (conn->state == SW_MYSQL_POOL_IDLE)
+    {
+        mysql_pool_list_remove(pool->idle_connections, conn);
+    }
+    conn->state = SW_MYSQL_POOL_CLOSED;
+    mysql_pool_list_remove(pool->connections, conn);
+    bzero(&client->hooks, sizeof(client->hooks));
+    pool->close_count++;
+
+    // we are still in the call stack of the connection object
+    SwooleG.main_reactor->defer(SwooleG.main_reactor, mysql_pool_connection_free, conn);
+
+    if (pool->waiters->num > 0)
+    {
+        mysql_pool_grow(pool);
+    }
+}
+
+/**
+ * idle timeout, health check and minimum size maintenance
+ */
+static void mysql_pool_onTimer(swTimer *timer, swTimer_node *tnode)
+{
+    mysql_pool *pool = tnode->data;
+    swLinkedList_node *node, *next;
+    mysql_pool_connection *conn;
+    double now = swoole_microtime();
+
+    if (pool->lag_query && now - pool->lag_checked_at > pool->lag_check_interval && (conn = swLinkedList_pop(pool->idle_connections)))
+    {
+        pool->lag_checked_at = now;
+        conn->state = SW_MYSQL_POOL_BUSY;
+        conn->checking = 1;
+        if (mysql_send_internal(&conn->_object, conn->client, SW_MYSQL_COM_QUERY, ZSTR_VAL(pool->lag_query), ZSTR_LEN(pool->lag_query), mysql_pool_onLagCheck, pool) < 0)
+        {
+            pool->lag = -1;
+            mysql_pool_connection_close(conn);
+        }
+    }
+
+    for (node = pool->idle_connections->head; node; node = next)
+    {
+        next = node->next;
+        conn = node->data;
+        if (pool->idle_timeout > 0 && pool->connections->num > pool->min && now - conn->last_used > pool->idle_timeout)
+        {
+            swTraceLog(SW_TRACE_MYSQL_CLIENT, "close idle connection#%d", conn->client->fd);
+            mysql_pool_connection_close(conn);
+        }
+        else if (pool->health_check_interval > 0 && now - MAX(conn->last_used, conn->last_checked) > pool->health_check_interval)
+        {
+            swLinkedList_remove_node(pool->idle_connections, node);
+            conn->state = SW_MYSQL_POOL_BUSY;
+            conn->checking = 1;
+            conn->sent_at = now;
+            // a broken connection will be closed and removed by the onClose hook
+            if (mysql_send_command(&conn->_object, conn->client, SW_MYSQL_COM_PING, NULL, 0, NULL) < 0)
+            {
+                mysql_pool_connection_close(conn);
+            }
+        }
+    }
+
+    mysql_pool_grow(pool);
+}
+
+static void mysql_pool_onWaitTimeout(swTimer *timer, swTimer_node *tnode)
+{
+    mysql_pool_waiter *waiter = tnode->data;
+    mysql_pool *pool = waiter->pool;
+
+    waiter->timer = NULL;
+    mysql_pool_list_remove(pool->waiters, waiter);
+    pool->wait_timeout_count++;
+
+    zend_update_property_long(swoole_mysql_pool_ce, pool->object, ZEND_STRL("errCode"), ETIMEDOUT);
+    zend_update_property_string(swoole_mysql_pool_ce, pool->object, ZEND_STRL("errMsg"), "timed out waiting for a free connection");
+    mysql_pool_waiter_fail(waiter, pool->object);
+}
+
+static PHP_METHOD(swoole_mysql_pool, __construct)
+{
+    zval *server_config;
+    zval *options = NULL;
+    zval *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a|a", &server_config, &options) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_pool *pool = ecalloc(1, sizeof(mysql_pool));
+
+    pool->object = getThis();
+    pool->min = 0;
+    pool->max = SW_MYSQL_POOL_MAX_CONNECTIONS;
+    pool->idle_timeout = SW_MYSQL_POOL_IDLE_TIMEOUT;
+    pool->wait_timeout = -1;
+    pool->health_check_interval = SW_MYSQL_POOL_HEALTH_CHECK_INTERVAL;
+
+    if (options)
+    {
+        HashTable *_ht = Z_ARRVAL_P(options);
+        if (php_swoole_array_get_value(_ht, "min", value))
+        {
+            pool->min = MAX(0, zval_get_long(value));
+        }
+        if (php_swoole_array_get_value(_ht, "max", value))
+        {
+            pool->max = MAX(1, zval_get_long(value));
+        }
+        if (php_swoole_array_get_value(_ht, "idle_timeout", value))
+        {
+            pool->idle_timeout = zval_get_double(value);
+        }
+        if (php_swoole_array_get_value(_ht, "wait_timeout", value))
+        {
+            pool->wait_timeout = zval_get_double(value);
+        }
+        if (php_swoole_array_get_value(_ht, "health_check_interval", value))
+        {
+            pool->health_check_interval = zval_get_double(value);
+        }
+    }
+    if (pool->min > pool->max)
+    {
+        pool->min = pool->max;
+    }
+
+    ZVAL_COPY(&pool->config, server_config);
+    pool->connections = swLinkedList_new(0, NULL);
+    pool->idle_connections = swLinkedList_new(0, NULL);
+    pool->waiters = swLinkedList_new(0, NULL);
+
+    sw_copy_to_stack(pool->object, pool->_object);
+    swoole_set_object(getThis(), pool);
+}
+
+/**
+ * the number of queries in flight or waiting for a connection
+ */
+uint32_t mysql_pool_load(mysql_pool *pool)
+{
+    return pool->connections->num - pool->idle_connections->num - pool->connecting + pool->waiters->num;
+}
+
+/**
+ * run the query on an idle connection, or wait for one, timeout <= 0 waits forever
+ */
+int mysql_pool_query(mysql_pool *pool, zend_string *sql, zval *callback, double timeout, zend_bool transaction, zend_string *gtid)
+{
+    mysql_pool_connection *conn;
+
+    if (pool->closed)
+    {
+        php_swoole_error(E_WARNING, "mysql pool is closed.");
+        return SW_ERR;
+    }
+
+    // the pool keeps itself alive until it is closed
+    if (!pool->timer)
+    {
+        php_swoole_check_reactor();
+        pool->timer = swTimer_add(&SwooleG.timer, SW_MYSQL_POOL_TIMER_INTERVAL, 1, pool, mysql_pool_onTimer);
+        Z_TRY_ADDREF_P(pool->object);
+    }
+
+    if ((conn = swLinkedList_pop(pool->idle_connections)))
+    {
+        mysql_pool_dispatch(conn, sql, callback, transaction, gtid);
+        return SW_OK;
+    }
+
+    mysql_pool_waiter *waiter = mysql_pool_waiter_new(pool, sql, callback, transaction, gtid);
+
+    if (timeout > 0)
+    {
+        waiter->timer = swTimer_add(&SwooleG.timer, (long) (timeout * 1000), 0, waiter, mysql_pool_onWaitTimeout);
+    }
+
+    swLinkedList_append(pool->waiters, waiter);
+    pool->wait_count++;
+    mysql_pool_grow(pool);
+
+    return SW_OK;
+}
+
+static PHP_METHOD(swoole_mysql_pool, query)
+{
+    zend_string *sql;
+    zval *callback;
+    double timeout = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "Sz|d", &sql, &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    if (ZSTR_LEN(sql) == 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_pool *pool = swoole_get_object(getThis());
+    if (!pool)
+    {
+        php_swoole_error(E_WARNING, "mysql pool is closed.");
+        RETURN_FALSE;
+    }
+
+    if (ZEND_NUM_ARGS() < 3)
+    {
+        timeout = pool->wait_timeout;
+    }
+    SW_CHECK_RETURN(mysql_pool_query(pool, sql, callback, timeout, 0, NULL));
+}
+
+/**
+ * the callback gets the connection, which is held by the transaction until commit() or rollback()
+ */
+static PHP_METHOD(swoole_mysql_pool, begin)
+{
+    zval *callback;
+    double timeout = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z|d", &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_pool *pool = swoole_get_object(getThis());
+    if (!pool)
+    {
+        php_swoole_error(E_WARNING, "mysql pool is closed.");
+        RETURN_FALSE;
+    }
+
+    if (ZEND_NUM_ARGS() < 2)
+    {
+        timeout = pool->wait_timeout;
+    }
+    zend_string *sql = zend_string_init(ZEND_STRL("START TRANSACTION"), 0);
+    int ret = mysql_pool_query(pool, sql, callback, timeout, 1, NULL);
+    zend_string_release(sql);
+    SW_CHECK_RETURN(ret);
+}
+
+static PHP_METHOD(swoole_mysql_pool, getStats)
+{
+    mysql_pool *pool = swoole_get_object(getThis());
+    swLinkedList_node *node;
+    mysql_pool_connection *conn;
+    zval zconnections, zconn;
+
+    if (!pool)
+    {
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+    add_assoc_long_ex(return_value, ZEND_STRL("connection_num"), pool->connections->num);
+    add_assoc_long_ex(return_value, ZEND_STRL("idle_num"), pool->idle_connections->num);
+    add_assoc_long_ex(return_value, ZEND_STRL("connecting_num"), pool->connecting);
+    add_assoc_long_ex(return_value, ZEND_STRL("waiting_num"), pool->waiters->num);
+    add_assoc_long_ex(return_value, ZEND_STRL("query_num"), pool->query_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("wait_num"), pool->wait_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("wait_timeout_num"), pool->wait_timeout_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("connect_num"), pool->connect_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("connect_failure_num"), pool->connect_failure_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("close_num"), pool->close_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("gtid_wait_num"), pool->gtid_wait_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("gtid_timeout_num"), pool->gtid_timeout_count);
+    add_assoc_double_ex(return_value, ZEND_STRL("latency"), pool->latency);
+    if (pool->lag_query)
+    {
+        add_assoc_double_ex(return_value, ZEND_STRL("lag"), pool->lag);
+    }
+    if (pool->gtid)
+    {
+        add_assoc_str_ex(return_value, ZEND_STRL("gtid"), zend_string_copy(pool->gtid));
+    }
+
+    array_init(&zconnections);
+    for (node = pool->connections->head; node; node = node->next)
+    {
+        conn = node->data;
+        array_init(&zconn);
+        add_assoc_long_ex(&zconn, ZEND_STRL("sock"), conn->client->fd);
+        add_assoc_long_ex(&zconn, ZEND_STRL("state"), conn->state);
+        add_assoc_long_ex(&zconn, ZEND_STRL("query_num"), conn->query_count);
+        add_assoc_long_ex(&zconn, ZEND_STRL("error_num"), conn->error_count);
+        add_assoc_double_ex(&zconn, ZEND_STRL("created_at"), conn->created_at);
+        add_assoc_double_ex(&zconn, ZEND_STRL("last_used"), conn->last_used);
+        add_next_index_zval(&zconnections, &zconn);
+    }
+    add_assoc_zval_ex(return_value, ZEND_STRL("connections"), &zconnections);
+}
+
+static void mysql_pool_close(mysql_pool *pool)
+{
+    swLinkedList_node *node, *next;
+
+    pool->closed = 1;
+    if (pool->timer)
+    {
+        swTimer_del(&SwooleG.timer, pool->timer);
+    }
+    mysql_pool_fail_waiters(pool, pool->object);
+    for (node = pool->connections->head; node; node = next)
+    {
+        next = node->next;
+        mysql_pool_connection_close(node->data);
+    }
+}
+
+static PHP_METHOD(swoole_mysql_pool, close)
+{
+    mysql_pool *pool = swoole_get_object(getThis());
+    if (!pool || pool->closed)
+    {
+        RETURN_FALSE;
+    }
+
+    zend_bool referenced = pool->timer != NULL;
+    mysql_pool_close(pool);
+    pool->timer = NULL;
+    if (referenced)
+    {
+        zval_ptr_dtor(pool->object);
+    }
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_mysql_pool, __destruct)
+{
+    SW_PREVENT_USER_DESTRUCT();
+
+    mysql_pool *pool = swoole_get_object(getThis());
+    if (!pool)
+    {
+        return;
+    }
+    if (!pool->closed)
+    {
+        mysql_pool_close(pool);
+    }
+    swLinkedList_free(pool->connections);
+    swLinkedList_free(pool->idle_connections);
+    swLinkedList_free(pool->waiters);
+    zval_ptr_dtor(&pool->config);
+    if (pool->lag_query)
+    {
+        zend_string_release(pool->lag_query);
+    }
+    if (pool->gtid)
+    {
+        zend_string_release(pool->gtid);
+    }
+    efree(pool);
+    swoole_set_object(getThis(), NULL);
+}
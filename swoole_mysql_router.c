@@ -0,0 +1,508 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole_async.h"
+#include "swoole_mysql_async.h"
+
+static PHP_METHOD(swoole_mysql_router, __construct);
+static PHP_METHOD(swoole_mysql_router, __destruct);
+static PHP_METHOD(swoole_mysql_router, query);
+static PHP_METHOD(swoole_mysql_router, begin);
+static PHP_METHOD(swoole_mysql_router, getStats);
+static PHP_METHOD(swoole_mysql_router, close);
+
+static zend_class_entry *swoole_mysql_router_ce;
+static zend_object_handlers swoole_mysql_router_handlers;
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_void, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_router_construct, 0, 0, 1)
+    ZEND_ARG_ARRAY_INFO(0, primary, 0)
+    ZEND_ARG_ARRAY_INFO(0, replicas, 1)
+    ZEND_ARG_ARRAY_INFO(0, options, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_router_query, 0, 0, 2)
+    ZEND_ARG_INFO(0, sql)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_mysql_router_begin, 0, 0, 1)
+    ZEND_ARG_INFO(0, callback)
+    ZEND_ARG_INFO(0, timeout)
+ZEND_END_ARG_INFO()
+
+static const zend_function_entry swoole_mysql_router_methods[] =
+{
+    PHP_ME(swoole_mysql_router, __construct, arginfo_swoole_mysql_router_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_router, __destruct, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_router, query, arginfo_swoole_mysql_router_query, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_router, begin, arginfo_swoole_mysql_router_begin, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_router, getStats, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql_router, close, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void swoole_mysql_router_init(int module_number)
+{
+    SW_INIT_CLASS_ENTRY(swoole_mysql_router, "Swoole\\MySQL\\Router", "swoole_mysql_router", NULL, swoole_mysql_router_methods);
+    SW_SET_CLASS_SERIALIZABLE(swoole_mysql_router, zend_class_serialize_deny, zend_class_unserialize_deny);
+    SW_SET_CLASS_CLONEABLE(swoole_mysql_router, sw_zend_class_clone_deny);
+    SW_SET_CLASS_UNSET_PROPERTY_HANDLER(swoole_mysql_router, sw_zend_class_unset_property_deny);
+}
+
+static sw_inline zend_bool mysql_router_is_word(const char *p, const char *end, const char *word, size_t length)
+{
+    return end - p >= (ssize_t) length && strncasecmp(p, word, length) == 0
+            && (end - p == (ssize_t) length || !(isalnum((uchar) p[length]) || p[length] == '_'));
+}
+
+/**
+ * whether the statement only reads and may run on a replica,
+ * locking reads and the reads of the session state stay on the primary
+ */
+static zend_bool mysql_router_is_read(const char *sql, size_t length)
+{
+    static const char *primary_only[] =
+    {
+        " for update", " for share", " lock in share mode", " into ", ":=",
+        "get_lock(", "release_lock(", "last_insert_id(", "found_rows(", "row_count(",
+    };
+    const char *p = sql, *end = sql + length;
+    char *lower, *q;
+    zend_bool space = 0, read = 1;
+    size_t i;
+
+    // the leading white spaces, comments and parentheses
+    while (p < end)
+    {
+        if (isspace((uchar) *p) || *p == '(')
+        {
+            p++;
+        }
+        else if (end - p > 1 && p[0] == '/' && p[1] == '*')
+        {
+            if (!(p = zend_memnstr(p + 2, "*/", 2, end)))
+            {
+                return 0;
+            }
+            p += 2;
+        }
+        else if (*p == '#' || (end - p > 1 && p[0] == '-' && p[1] == '-'))
+        {
+            while (p < end && *p != '\n')
+            {
+                p++;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (!mysql_router_is_word(p, end, ZEND_STRL("select")) && !mysql_router_is_word(p, end, ZEND_STRL("show"))
+            && !mysql_router_is_word(p, end, ZEND_STRL("desc")) && !mysql_router_is_word(p, end, ZEND_STRL("describe"))
+            && !mysql_router_is_word(p, end, ZEND_STRL("explain")))
+    {
+        return 0;
+    }
+
+    // lower case, with the white spaces collapsed
+    lower = q = emalloc(end - p + 1);
+    for (; p < end; p++)
+    {
+        if (isspace((uchar) *p))
+        {
+            if (!space)
+            {
+                *q++ = ' ';
+            }
+            space = 1;
+            continue;
+        }
+        space = 0;
+        *q++ = tolower((uchar) *p);
+    }
+    *q = ' ';
+    for (i = 0; i < sizeof(primary_only) / sizeof(primary_only[0]); i++)
+    {
+        if (zend_memnstr(lower, primary_only[i], strlen(primary_only[i]), q + 1))
+        {
+            read = 0;
+            break;
+        }
+    }
+    efree(lower);
+
+    return read;
+}
+
+static sw_inline mysql_pool* mysql_router_get_pool(zval *zpool)
+{
+    mysql_pool *pool = swoole_get_object(zpool);
+    return pool && !pool->closed ? pool : NULL;
+}
+
+static zend_bool mysql_router_available(mysql_router *router, mysql_pool *pool)
+{
+    if (router->max_latency > 0 && pool->latency > router->max_latency)
+    {
+        // no connection is left to measure it again, give the replica another chance
+        if (pool->connections->num == 0)
+        {
+            pool->latency = 0;
+            return 1;
+        }
+        return 0;
+    }
+    if (pool->lag_query && (pool->lag < 0 || (router->max_lag > 0 && pool->lag > router->max_lag)))
+    {
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * the least loaded of the available replicas, relative to their size, the fastest one when they are even
+ */
+static mysql_pool* mysql_router_select(mysql_router *router)
+{
+    mysql_pool *pool, *selected = NULL;
+    double load, min_load = 0;
+    zval *zpool;
+
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(router->replicas), zpool)
+    {
+        if (!(pool = mysql_router_get_pool(zpool)) || !mysql_router_available(router, pool))
+        {
+            continue;
+        }
+        load = (double) mysql_pool_load(pool) / pool->max;
+        if (!selected || load < min_load || (load == min_load && pool->latency < selected->latency))
+        {
+            selected = pool;
+            min_load = load;
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+
+    return selected;
+}
+
+static void mysql_router_pool_new(zval *zpool, zval *config, zval *options)
+{
+    object_init_ex(zpool, swoole_mysql_pool_ce);
+    zend_call_method_with_2_params(zpool, swoole_mysql_pool_ce, NULL, "__construct", NULL, config, options);
+}
+
+static PHP_METHOD(swoole_mysql_router, __construct)
+{
+    zval *primary;
+    zval *replicas = NULL;
+    zval *options = NULL;
+    zval *value, zoptions, zpool, zprimary;
+    zend_string *lag_query = NULL;
+    double lag_check_interval = SW_MYSQL_ROUTER_LAG_CHECK_INTERVAL;
+    double gtid_wait_timeout = SW_MYSQL_ROUTER_GTID_WAIT_TIMEOUT;
+    mysql_pool *primary_pool;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a|aa", &primary, &replicas, &options) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_router *router = ecalloc(1, sizeof(mysql_router));
+
+    // the options of the pools are shared by all of them
+    if (options)
+    {
+        ZVAL_COPY(&zoptions, options);
+        HashTable *_ht = Z_ARRVAL_P(options);
+        if (php_swoole_array_get_value(_ht, "max_latency", value))
+        {
+            router->max_latency = zval_get_double(value);
+        }
+        if (php_swoole_array_get_value(_ht, "max_lag", value))
+        {
+            router->max_lag = zval_get_double(value);
+        }
+        if (php_swoole_array_get_value(_ht, "lag_query", value))
+        {
+            lag_query = zval_get_string(value);
+        }
+        if (php_swoole_array_get_value(_ht, "lag_check_interval", value))
+        {
+            lag_check_interval = zval_get_double(value);
+        }
+        if (php_swoole_array_get_value(_ht, "read_your_writes", value))
+        {
+            router->read_your_writes = zval_is_true(value);
+        }
+        if (php_swoole_array_get_value(_ht, "gtid_wait_timeout", value))
+        {
+            gtid_wait_timeout = zval_get_double(value);
+        }
+    }
+    else
+    {
+        array_init(&zoptions);
+    }
+    if (router->max_lag > 0 && !lag_query)
+    {
+        lag_query = zend_string_init(ZEND_STRL(SW_MYSQL_ROUTER_LAG_QUERY), 0);
+    }
+
+    // the commits on the primary report their GTID
+    ZVAL_DUP(&zprimary, primary);
+    if (router->read_your_writes)
+    {
+        add_assoc_bool_ex(&zprimary, ZEND_STRL("track_gtids"), 1);
+    }
+    mysql_router_pool_new(&router->primary, &zprimary, &zoptions);
+    zval_ptr_dtor(&zprimary);
+    primary_pool = swoole_get_object(&router->primary);
+
+    array_init(&router->replicas);
+    if (replicas)
+    {
+        ZEND_HASH_FOREACH_VAL(Z_ARRVAL_P(replicas), value)
+        {
+            if (Z_TYPE_P(value) != IS_ARRAY)
+            {
+                php_swoole_fatal_error(E_WARNING, "the config of a replica must be an array.");
+                continue;
+            }
+            mysql_router_pool_new(&zpool, value, &zoptions);
+            mysql_pool *pool = swoole_get_object(&zpool);
+            if (pool && lag_query)
+            {
+                pool->lag_query = zend_string_copy(lag_query);
+                pool->lag_check_interval = lag_check_interval;
+            }
+            if (pool)
+            {
+                pool->fallback = primary_pool;
+                pool->gtid_wait_timeout = gtid_wait_timeout;
+            }
+            add_next_index_zval(&router->replicas, &zpool);
+        }
+        ZEND_HASH_FOREACH_END();
+    }
+
+    if (lag_query)
+    {
+        zend_string_release(lag_query);
+    }
+    zval_ptr_dtor(&zoptions);
+
+    router->object = getThis();
+    sw_copy_to_stack(router->object, router->_object);
+    swoole_set_object(getThis(), router);
+}
+
+/**
+ * reads go to the least loaded replica, the other statements and the reads without a replica go to the primary
+ */
+static PHP_METHOD(swoole_mysql_router, query)
+{
+    zend_string *sql;
+    zval *callback;
+    double timeout = 0;
+    mysql_pool *pool = NULL, *primary;
+    zend_string *gtid = NULL;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "Sz|d", &sql, &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    if (ZSTR_LEN(sql) == 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_router *router = swoole_get_object(getThis());
+    if (!router || router->closed)
+    {
+        php_swoole_error(E_WARNING, "mysql router is closed.");
+        RETURN_FALSE;
+    }
+
+    if (mysql_router_is_read(ZSTR_VAL(sql), ZSTR_LEN(sql)))
+    {
+        if ((pool = mysql_router_select(router)))
+        {
+            router->read_count++;
+            // the replica must have executed the last write of the primary first
+            if (router->read_your_writes && (primary = mysql_router_get_pool(&router->primary)))
+            {
+                gtid = primary->gtid;
+            }
+        }
+        else
+        {
+            router->fallback_count++;
+        }
+    }
+    else
+    {
+        router->write_count++;
+    }
+    if (!pool && !(pool = mysql_router_get_pool(&router->primary)))
+    {
+        php_swoole_error(E_WARNING, "mysql pool is closed.");
+        RETURN_FALSE;
+    }
+
+    if (ZEND_NUM_ARGS() < 3)
+    {
+        timeout = pool->wait_timeout;
+    }
+    SW_CHECK_RETURN(mysql_pool_query(pool, sql, callback, timeout, 0, gtid));
+}
+
+/**
+ * the transaction runs on a connection of the primary, which is given to the callback
+ */
+static PHP_METHOD(swoole_mysql_router, begin)
+{
+    zval *callback;
+    double timeout = 0;
+    mysql_pool *pool;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z|d", &callback, &timeout) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    mysql_router *router = swoole_get_object(getThis());
+    if (!router || router->closed || !(pool = mysql_router_get_pool(&router->primary)))
+    {
+        php_swoole_error(E_WARNING, "mysql router is closed.");
+        RETURN_FALSE;
+    }
+
+    if (ZEND_NUM_ARGS() < 2)
+    {
+        timeout = pool->wait_timeout;
+    }
+    router->write_count++;
+    zend_string *sql = zend_string_init(ZEND_STRL("START TRANSACTION"), 0);
+    int ret = mysql_pool_query(pool, sql, callback, timeout, 1, NULL);
+    zend_string_release(sql);
+    SW_CHECK_RETURN(ret);
+}
+
+static PHP_METHOD(swoole_mysql_router, getStats)
+{
+    mysql_router *router = swoole_get_object(getThis());
+    mysql_pool *pool;
+    zval *zpool, zstats, zreplicas;
+
+    if (!router)
+    {
+        RETURN_FALSE;
+    }
+
+    array_init(return_value);
+    add_assoc_long_ex(return_value, ZEND_STRL("read_num"), router->read_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("write_num"), router->write_count);
+    add_assoc_long_ex(return_value, ZEND_STRL("fallback_num"), router->fallback_count);
+
+    ZVAL_NULL(&zstats);
+    zend_call_method_with_0_params(&router->primary, swoole_mysql_pool_ce, NULL, "getstats", &zstats);
+    add_assoc_zval_ex(return_value, ZEND_STRL("primary"), &zstats);
+
+    array_init(&zreplicas);
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(router->replicas), zpool)
+    {
+        ZVAL_NULL(&zstats);
+        zend_call_method_with_0_params(zpool, swoole_mysql_pool_ce, NULL, "getstats", &zstats);
+        if (Z_TYPE(zstats) == IS_ARRAY)
+        {
+            pool = mysql_router_get_pool(zpool);
+            add_assoc_bool_ex(&zstats, ZEND_STRL("available"), pool && mysql_router_available(router, pool));
+        }
+        add_next_index_zval(&zreplicas, &zstats);
+    }
+    ZEND_HASH_FOREACH_END();
+    add_assoc_zval_ex(return_value, ZEND_STRL("replicas"), &zreplicas);
+}
+
+static void mysql_router_close(mysql_router *router)
+{
+    zval *zpool;
+
+    router->closed = 1;
+    if (mysql_router_get_pool(&router->primary))
+    {
+        zend_call_method_with_0_params(&router->primary, swoole_mysql_pool_ce, NULL, "close", NULL);
+    }
+    ZEND_HASH_FOREACH_VAL(Z_ARRVAL(router->replicas), zpool)
+    {
+        if (mysql_router_get_pool(zpool))
+        {
+            zend_call_method_with_0_params(zpool, swoole_mysql_pool_ce, NULL, "close", NULL);
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+}
+
+static PHP_METHOD(swoole_mysql_router, close)
+{
+    mysql_router *router = swoole_get_object(getThis());
+    if (!router || router->closed)
+    {
+        RETURN_FALSE;
+    }
+    mysql_router_close(router);
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_mysql_router, __destruct)
+{
+    SW_PREVENT_USER_DESTRUCT();
+
+    mysql_router *router = swoole_get_object(getThis());
+    if (!router)
+    {
+        return;
+    }
+    if (!router->closed)
+    {
+        mysql_router_close(router);
+    }
+    zval_ptr_dtor(&router->primary);
+    zval_ptr_dtor(&router->replicas);
+    efree(router);
+    swoole_set_object(getThis(), NULL);
+}
@@ -15,47 +15,9 @@
 */
 
 #include "php_swoole_async.h"
+#include "swoole_redis_async.h"
 
-#include "thirdparty/hiredis/hiredis.h"
-#include "thirdparty/hiredis/async.h"
-
-#define SW_REDIS_COMMAND_BUFFER_SIZE   64
-#define SW_REDIS_COMMAND_KEY_SIZE      128
-
-typedef struct
-{
-    redisAsyncContext *context;
-    uint8_t state;
-    uint8_t connected;
-    uint8_t subscribe;
-    uint8_t connecting;
-    uint32_t reqnum;
-
-    zval *object;
-    zval *message_callback;
-
-    double timeout;
-    swTimer_node *timer;
-
-    char *password;
-    uint8_t password_len;
-    int8_t database;
-    uint8_t failure;
-    uint8_t wait_count;
-
-    zval _message_callback;
-    zval _object;
-
-} swRedisClient;
-
-enum swoole_redis_state
-{
-    SWOOLE_REDIS_STATE_CONNECT,
-    SWOOLE_REDIS_STATE_READY,
-    SWOOLE_REDIS_STATE_WAIT_RESULT,
-    SWOOLE_REDIS_STATE_SUBSCRIBE,
-    SWOOLE_REDIS_STATE_CLOSED,
-};
+#include <sys/uio.h>
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_construct, 0, 0, 0)
     ZEND_ARG_ARRAY_INFO(0, setting, 1)
@@ -72,6 +34,11 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_call, 0, 0, 2)
     ZEND_ARG_INFO(0, params)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_batch, 0, 0, 2)
+    ZEND_ARG_ARRAY_INFO(0, commands, 0)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_on, 0, 0, 2)
     ZEND_ARG_INFO(0, event_name)
     ZEND_ARG_INFO(0, callback)
@@ -86,27 +53,23 @@ static PHP_METHOD(swoole_redis, on);
 static PHP_METHOD(swoole_redis, connect);
 static PHP_METHOD(swoole_redis, getState);
 static PHP_METHOD(swoole_redis, __call);
+static PHP_METHOD(swoole_redis, batch);
+static PHP_METHOD(swoole_redis, getCacheStats);
 static PHP_METHOD(swoole_redis, close);
 
-static void swoole_redis_onConnect(const redisAsyncContext *c, int status);
-static void swoole_redis_onClose(const redisAsyncContext *c, int status);
+static void swoole_redis_onConnect(swRedisClient *redis, int error);
 static int swoole_redis_onRead(swReactor *reactor, swEvent *event);
 static int swoole_redis_onWrite(swReactor *reactor, swEvent *event);
 static int swoole_redis_onError(swReactor *reactor, swEvent *event);
-static void swoole_redis_onResult(redisAsyncContext *c, void *r, void *privdata);
-static void swoole_redis_parse_result(swRedisClient *redis, zval* return_value, redisReply* reply);
-static void swoole_redis_onCompleted(redisAsyncContext *c, void *r, void *privdata);
+static void swoole_redis_onResult(swRedisClient *redis, zval *result);
+static void swoole_redis_onPush(swRedisClient *redis, zval *message);
 static void swoole_redis_onTimeout(swTimer *timer, swTimer_node *tnode);
 
-static void swoole_redis_event_AddRead(void *privdata);
-static void swoole_redis_event_AddWrite(void *privdata);
-static void swoole_redis_event_DelRead(void *privdata);
-static void swoole_redis_event_DelWrite(void *privdata);
-static void swoole_redis_event_Cleanup(void *privdata);
-
-static zend_class_entry *swoole_redis_ce;
+zend_class_entry *swoole_redis_ce;
 static zend_object_handlers swoole_redis_handlers;
 
+static swString *redis_command_buffer;
+
 static const zend_function_entry swoole_redis_methods[] =
 {
     PHP_ME(swoole_redis, __construct, arginfo_swoole_redis_construct, ZEND_ACC_PUBLIC)
@@ -116,44 +79,27 @@ static const zend_function_entry swoole_redis_methods[] =
     PHP_ME(swoole_redis, close, arginfo_swoole_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_redis, getState, arginfo_swoole_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_redis, __call, arginfo_swoole_redis_call, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_redis, batch, arginfo_swoole_redis_batch, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_redis, getCacheStats, arginfo_swoole_void, ZEND_ACC_PUBLIC)
     PHP_FE_END
 };
 
-static sw_inline int swoole_redis_is_message_command(char *command, int command_len)
-{
-    if (strncasecmp("subscribe", command, command_len) == 0)
-    {
-        return SW_TRUE;
-    }
-    else if (strncasecmp("psubscribe", command, command_len) == 0)
-    {
-        return SW_TRUE;
-    }
-    else if (strncasecmp("unsubscribe", command, command_len) == 0)
-    {
-        return SW_TRUE;
-    }
-    else if (strncasecmp("punsubscribe", command, command_len) == 0)
-    {
-        return SW_TRUE;
-    }
-    else
-    {
-        return SW_FALSE;
-    }
-}
-
 static sw_inline void redis_execute_connect_callback(swRedisClient *redis, int success)
 {
     zval *retval;
 
+    if (redis->hooks.onConnect)
+    {
+        redis->hooks.onConnect(redis, success);
+        return;
+    }
+
     zval args[2];
     zval *zcallback = sw_zend_read_property(swoole_redis_ce, redis->object, ZEND_STRL("onConnect"), 0);
 
     args[0] = *redis->object;
     ZVAL_BOOL(&args[1], success);
 
-    redis->connecting = 1;
     if (sw_call_user_function_ex(EG(function_table), NULL, zcallback, &retval, 2, args, 0, NULL) != SUCCESS)
     {
         php_swoole_fatal_error(E_WARNING, "swoole_async_redis connect_callback handler error.");
@@ -166,7 +112,6 @@ static sw_inline void redis_execute_connect_callback(swRedisClient *redis, int s
     {
         zval_ptr_dtor(retval);
     }
-    redis->connecting = 0;
 }
 
 void swoole_redis_init(int module_number)
@@ -192,6 +137,383 @@ void swoole_redis_init(int module_number)
     zend_declare_class_constant_long(swoole_redis_ce, ZEND_STRL("STATE_WAIT_RESULT"), SWOOLE_REDIS_STATE_WAIT_RESULT);
     zend_declare_class_constant_long(swoole_redis_ce, ZEND_STRL("STATE_SUBSCRIBE"), SWOOLE_REDIS_STATE_SUBSCRIBE);
     zend_declare_class_constant_long(swoole_redis_ce, ZEND_STRL("STATE_CLOSED"), SWOOLE_REDIS_STATE_CLOSED);
+
+    redis_command_buffer = swString_new(SW_BUFFER_SIZE_STD);
+}
+
+static void redis_request_free(void *data)
+{
+    swRedisRequest *request = data;
+    if (request->callback)
+    {
+        sw_zval_free(request->callback);
+    }
+    if (request->dtor)
+    {
+        request->dtor(request->data);
+    }
+    zval_ptr_dtor(&request->results);
+    efree(request);
+}
+
+static swRedisRequest* redis_request_new(zval *callback, swRedisReplyHandler handler, void *data)
+{
+    swRedisRequest *request = ecalloc(1, sizeof(swRedisRequest));
+    if (callback)
+    {
+        Z_TRY_ADDREF_P(callback);
+        request->callback = sw_zval_dup(callback);
+    }
+    request->handler = handler;
+    request->data = data;
+    return request;
+}
+
+static void redis_reader_reset(swRedisReader *reader)
+{
+    swRedisFrame *frame;
+
+    while (reader->depth > 0)
+    {
+        frame = &reader->stack[--reader->depth];
+        zval_ptr_dtor(&frame->value);
+        zval_ptr_dtor(&frame->key);
+    }
+    if (reader->bulk)
+    {
+        zend_string_free(reader->bulk);
+        reader->bulk = NULL;
+    }
+    reader->bulk_filled = 0;
+    reader->push = 0;
+    if (reader->error)
+    {
+        zend_string_release(reader->error);
+        reader->error = NULL;
+    }
+}
+
+/**
+ * add the field to the map, its key is converted like the keys of the PHP arrays
+ */
+static void redis_reader_map_add(swRedisFrame *frame, zval *value)
+{
+    HashTable *ht = Z_ARRVAL(frame->value);
+    zval *key = &frame->key;
+
+    switch (Z_TYPE_P(key))
+    {
+    case IS_LONG:
+        zend_hash_index_update(ht, Z_LVAL_P(key), value);
+        break;
+    case IS_STRING:
+        zend_symtable_update(ht, Z_STR_P(key), value);
+        break;
+    case IS_ARRAY:
+        zend_hash_next_index_insert(ht, value);
+        break;
+    default:
+    {
+        zend_string *str = zval_get_string(key);
+        zend_symtable_update(ht, str, value);
+        zend_string_release(str);
+        break;
+    }
+    }
+    zval_ptr_dtor(key);
+    ZVAL_UNDEF(key);
+}
+
+/**
+ * add the value to the aggregate reply being filled, the completed ones to their parents
+ * @return whether the reply is complete
+ */
+static int redis_reader_push(swRedisReader *reader, zval *value, zval *reply)
+{
+    swRedisFrame *frame;
+
+    while (reader->depth > 0)
+    {
+        frame = &reader->stack[reader->depth - 1];
+        if (frame->type == '%' || frame->type == '|')
+        {
+            if (Z_ISUNDEF(frame->key))
+            {
+                ZVAL_COPY_VALUE(&frame->key, value);
+                frame->remaining--;
+                return SW_FALSE;
+            }
+            redis_reader_map_add(frame, value);
+        }
+        else
+        {
+            zend_hash_next_index_insert_new(Z_ARRVAL(frame->value), value);
+        }
+        if (--frame->remaining > 0)
+        {
+            return SW_FALSE;
+        }
+        ZVAL_COPY_VALUE(value, &frame->value);
+        reader->depth--;
+        // the attributes describe the value after them, they are not kept
+        if (frame->type == '|')
+        {
+            zval_ptr_dtor(value);
+            return SW_FALSE;
+        }
+        if (frame->type == '>' && reader->depth == 0)
+        {
+            reader->push = 1;
+        }
+    }
+    ZVAL_COPY_VALUE(reply, value);
+    return SW_TRUE;
+}
+
+/**
+ * the room for the next data of the bulk string
+ */
+static sw_inline void redis_reader_bulk_grow(swRedisReader *reader)
+{
+    if (reader->bulk_filled == ZSTR_LEN(reader->bulk) && ZSTR_LEN(reader->bulk) < reader->bulk_length)
+    {
+        reader->bulk = zend_string_extend(reader->bulk, MIN(reader->bulk_length, ZSTR_LEN(reader->bulk) * 2), 0);
+    }
+}
+
+/**
+ * the error of the whole reply is kept for the internal handlers until the reply is dispatched
+ */
+static void redis_reader_error(swRedisClient *redis, char type, char *msg, size_t length)
+{
+    swRedisReader *reader = &redis->reader;
+
+    zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), -1);
+    zend_update_property_stringl(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), msg, length);
+    if (reader->depth == 0)
+    {
+        if (reader->error)
+        {
+            zend_string_release(reader->error);
+        }
+        reader->error_type = type;
+        reader->error = zend_string_init(msg, length, 0);
+    }
+}
+
+/**
+ * the value of a bulk string, a verbatim string without its format or false for a blob error
+ */
+static void redis_reader_bulk(swRedisClient *redis, char type, zend_string *str, zval *value)
+{
+    switch (type)
+    {
+    case '!':
+        redis_reader_error(redis, '!', ZSTR_VAL(str), ZSTR_LEN(str));
+        zend_string_release(str);
+        ZVAL_FALSE(value);
+        break;
+    case '=':
+        // e.g. "txt:" before the text
+        if (ZSTR_LEN(str) >= 4)
+        {
+            memmove(ZSTR_VAL(str), ZSTR_VAL(str) + 4, ZSTR_LEN(str) - 4 + 1);
+            ZSTR_LEN(str) -= 4;
+        }
+        ZVAL_STR(value, str);
+        break;
+    default:
+        ZVAL_STR(value, str);
+        break;
+    }
+}
+
+/**
+ * decode a reply from the buffer into zvals, the arrays are sized by the aggregate lengths,
+ * a partial reply is kept in the reader and goes on with the next data
+ * @return SW_OK with the reply, SW_AGAIN for more data, SW_ERR on a protocol error
+ */
+static int redis_reader_parse(swRedisClient *redis, zval *reply)
+{
+    swRedisReader *reader = &redis->reader;
+    swString *buffer = redis->buffer;
+    swRedisFrame *frame;
+    zval _value, *value = &_value;
+    char *p, *eol;
+    size_t available, n, line_length;
+    long length;
+
+    while (1)
+    {
+        available = buffer->length - buffer->offset;
+        p = buffer->str + buffer->offset;
+
+        if (reader->bulk)
+        {
+            while (available > 0 && reader->bulk_filled < reader->bulk_length)
+            {
+                redis_reader_bulk_grow(reader);
+                n = MIN(available, ZSTR_LEN(reader->bulk) - reader->bulk_filled);
+                memcpy(ZSTR_VAL(reader->bulk) + reader->bulk_filled, p, n);
+                reader->bulk_filled += n;
+                buffer->offset += n;
+                available -= n;
+                p += n;
+            }
+            // the CRLF
+            n = MIN(available, reader->bulk_length + 2 - reader->bulk_filled);
+            reader->bulk_filled += n;
+            buffer->offset += n;
+            if (reader->bulk_filled < reader->bulk_length + 2)
+            {
+                return SW_AGAIN;
+            }
+            ZSTR_VAL(reader->bulk)[ZSTR_LEN(reader->bulk)] = '\0';
+            redis_reader_bulk(redis, reader->bulk_type, reader->bulk, value);
+            reader->bulk = NULL;
+            reader->bulk_filled = 0;
+            goto _push;
+        }
+
+        if (available == 0 || !(eol = memchr(p, '\n', available)))
+        {
+            return SW_AGAIN;
+        }
+        // a line without its type, or without the CR
+        if (eol == p || eol[-1] != '\r' || eol - p == 1)
+        {
+            return SW_ERR;
+        }
+        line_length = eol - p - 1;
+        buffer->offset += line_length + 2;
+
+        switch (*p)
+        {
+        case '+':
+            if (line_length > 1)
+            {
+                ZVAL_STRINGL(value, p + 1, line_length - 1);
+            }
+            else
+            {
+                ZVAL_TRUE(value);
+            }
+            break;
+        case '-':
+            redis_reader_error(redis, '-', p + 1, line_length - 1);
+            ZVAL_FALSE(value);
+            break;
+        case ':':
+            ZVAL_LONG(value, ZEND_STRTOL(p + 1, NULL, 10));
+            break;
+        /**
+         * RESP3
+         */
+        case '_':
+            ZVAL_NULL(value);
+            break;
+        case '#':
+            ZVAL_BOOL(value, p[1] == 't');
+            break;
+        case ',':
+            if (line_length == 4 && strncmp(p + 1, "inf", 3) == 0)
+            {
+                ZVAL_DOUBLE(value, ZEND_INFINITY);
+            }
+            else if (line_length == 5 && strncmp(p + 1, "-inf", 4) == 0)
+            {
+                ZVAL_DOUBLE(value, -ZEND_INFINITY);
+            }
+            else if (line_length == 4 && strncasecmp(p + 1, "nan", 3) == 0)
+            {
+                ZVAL_DOUBLE(value, ZEND_NAN);
+            }
+            else
+            {
+                ZVAL_DOUBLE(value, zend_strtod(p + 1, NULL));
+            }
+            break;
+        case '(':
+            // a big number may not fit in an integer
+            ZVAL_STRINGL(value, p + 1, line_length - 1);
+            break;
+        case '$':
+        case '=':
+        case '!':
+            length = ZEND_STRTOL(p + 1, NULL, 10);
+            if (length < 0)
+            {
+                ZVAL_NULL(value);
+                break;
+            }
+            available = buffer->length - buffer->offset;
+            // the whole string is in the buffer
+            if (available >= (size_t) length + 2)
+            {
+                redis_reader_bulk(redis, *p, zend_string_init(buffer->str + buffer->offset, length, 0), value);
+                buffer->offset += length + 2;
+                break;
+            }
+            reader->bulk = zend_string_alloc(MIN(length, SW_REDIS_BULK_PREALLOC_SIZE), 0);
+            reader->bulk_length = length;
+            reader->bulk_filled = 0;
+            reader->bulk_type = *p;
+            continue;
+        case '*':
+        case '~':
+        case '>':
+        case '%':
+        case '|':
+            length = ZEND_STRTOL(p + 1, NULL, 10);
+            if (length < 0)
+            {
+                ZVAL_NULL(value);
+                break;
+            }
+            if (length == 0)
+            {
+                if (*p == '|')
+                {
+                    continue;
+                }
+                if (*p == '>' && reader->depth == 0)
+                {
+                    reader->push = 1;
+                }
+                array_init(value);
+                break;
+            }
+            if (reader->depth == SW_REDIS_REPLY_MAX_DEPTH || length > UINT32_MAX / 2)
+            {
+                return SW_ERR;
+            }
+            frame = &reader->stack[reader->depth];
+            frame->type = *p;
+            ZVAL_UNDEF(&frame->key);
+            array_init_size(&frame->value, MIN(length, SW_REDIS_ARRAY_PREALLOC_SIZE));
+            // the fields of a map are a key and a value each
+            if (*p == '%' || *p == '|')
+            {
+                zend_hash_real_init(Z_ARRVAL(frame->value), 0);
+                frame->remaining = length * 2;
+            }
+            else
+            {
+                zend_hash_real_init(Z_ARRVAL(frame->value), 1);
+                frame->remaining = length;
+            }
+            reader->depth++;
+            continue;
+        default:
+            return SW_ERR;
+        }
+
+        _push:
+        if (redis_reader_push(reader, value, reply))
+        {
+            return SW_OK;
+        }
+    }
 }
 
 static PHP_METHOD(swoole_redis, __construct)
@@ -254,6 +576,28 @@ static PHP_METHOD(swoole_redis, __construct)
                 redis->database = (int8_t) zval_get_long(ztmp);
             }
         }
+        /**
+         * RESP3
+         */
+        if (php_swoole_array_get_value(vht, "protocol", ztmp))
+        {
+            long protocol = zval_get_long(ztmp);
+            if (protocol != 2 && protocol != 3)
+            {
+                php_swoole_fatal_error(E_WARNING, "redis protocol must be 2 or 3.");
+            }
+            else if (protocol == 3)
+            {
+                redis->protocol = 3;
+            }
+        }
+        /**
+         * client-side cache
+         */
+        if (php_swoole_array_get_value(vht, "cache_memory", ztmp) && zval_get_long(ztmp) > 0)
+        {
+            redis->cache = redis_cache_new(vht);
+        }
     }
 
     sw_copy_to_stack(redis->object, redis->_object);
@@ -272,7 +616,7 @@ static PHP_METHOD(swoole_redis, on)
     }
 
     swRedisClient *redis = swoole_get_object(getThis());
-    if (redis->context != NULL)
+    if (redis->cli != NULL)
     {
         php_swoole_fatal_error(E_WARNING, "Must be called before connecting.");
         RETURN_FALSE;
@@ -298,52 +642,34 @@ static PHP_METHOD(swoole_redis, on)
     RETURN_TRUE;
 }
 
-static PHP_METHOD(swoole_redis, connect)
+/**
+ * start connecting, the result is given to the onConnect callback or hook
+ */
+int redis_connect(swRedisClient *redis, char *host, long port)
 {
-    char *host;
-    size_t host_len;
-    long port;
-    zval *callback;
-
-    if (zend_parse_parameters(ZEND_NUM_ARGS(), "slz", &host, &host_len, &port, &callback) == FAILURE)
+    if (redis->cli)
     {
-        RETURN_FALSE;
-    }
-
-    if (host_len == 0)
-    {
-        php_swoole_fatal_error(E_WARNING, "redis server host is empty.");
-        RETURN_FALSE;
+        php_swoole_error(E_WARNING, "redis client is already connected.");
+        return SW_ERR;
     }
 
-    swRedisClient *redis = swoole_get_object(getThis());
-    redisAsyncContext *context;
-
+    int type = SW_SOCK_TCP;
     if (strncasecmp(host, ZEND_STRL("unix:/")) == 0)
     {
-        context = redisAsyncConnectUnix(host + 5);
+        host += 5;
+        type = SW_SOCK_UNIX_STREAM;
     }
     else
     {
         if (port <= 1 || port > 65535)
         {
             php_swoole_error(E_WARNING, "redis server port is invalid.");
-            RETURN_FALSE;
+            return SW_ERR;
+        }
+        if (strchr(host, ':'))
+        {
+            type = SW_SOCK_TCP6;
         }
-        context = redisAsyncConnect(host, (int) port);
-    }
-
-    if (context == NULL)
-    {
-        php_swoole_error(E_WARNING, "redisAsyncConnect() failed.");
-        RETURN_FALSE;
-    }
-
-    if (context->err)
-    {
-        redisAsyncFree(context);
-        php_swoole_error(E_WARNING, "failed to connect to the redis-server[%s:%d], Erorr: %s[%d]", host, (int) port, context->errstr, context->err);
-        RETURN_FALSE;
     }
 
     php_swoole_check_reactor();
@@ -354,29 +680,46 @@ static PHP_METHOD(swoole_redis, connect)
         swReactor_set_handler(SwooleG.main_reactor, PHP_SWOOLE_FD_REDIS | SW_EVENT_ERROR, swoole_redis_onError);
     }
 
-    redisAsyncSetConnectCallback(context, swoole_redis_onConnect);
-    redisAsyncSetDisconnectCallback(context, swoole_redis_onClose);
-
-    zend_update_property_long(swoole_redis_ce, getThis(), ZEND_STRL("sock"), context->c.fd);
-    zend_update_property(swoole_redis_ce, getThis(), ZEND_STRL("onConnect"), callback);
-
-    redis->context = context;
-    context->ev.addRead = swoole_redis_event_AddRead;
-    context->ev.delRead = swoole_redis_event_DelRead;
-    context->ev.addWrite = swoole_redis_event_AddWrite;
-    context->ev.delWrite = swoole_redis_event_DelWrite;
-    context->ev.cleanup = swoole_redis_event_Cleanup;
-    context->ev.data = redis;
-
-    zend_update_property_string(swoole_redis_ce, getThis(), ZEND_STRL("host"), host);
-    zend_update_property_long(swoole_redis_ce, getThis(), ZEND_STRL("port"), port);
+    swClient *cli = emalloc(sizeof(swClient));
+    if (swClient_create(cli, type, 0) < 0)
+    {
+        efree(cli);
+        php_swoole_error(E_WARNING, "swClient_create() failed.");
+        return SW_ERR;
+    }
+    if (type != SW_SOCK_UNIX_STREAM)
+    {
+        int tcp_nodelay = 1;
+        if (setsockopt(cli->socket->fd, IPPROTO_TCP, TCP_NODELAY, (const void *) &tcp_nodelay, sizeof(int)) != 0)
+        {
+            php_swoole_sys_error(E_WARNING, "setsockopt(%d, IPPROTO_TCP, TCP_NODELAY) failed.", cli->socket->fd);
+        }
+    }
 
-    if (SwooleG.main_reactor->add(SwooleG.main_reactor, redis->context->c.fd, PHP_SWOOLE_FD_REDIS | SW_EVENT_WRITE) < 0)
+    int ret = cli->connect(cli, host, port, redis->timeout, 1);
+    if ((ret < 0 && errno != EINPROGRESS)
+            || SwooleG.main_reactor->add(SwooleG.main_reactor, cli->socket->fd, PHP_SWOOLE_FD_REDIS | SW_EVENT_WRITE) < 0)
     {
-        php_swoole_fatal_error(E_WARNING, "swoole_event_add failed. Erorr: %s[%d].", redis->context->errstr, redis->context->err);
-        RETURN_FALSE;
+        php_swoole_error(E_WARNING, "failed to connect to the redis-server[%s:%d], Erorr: %s[%d]", host, (int) port, strerror(errno), errno);
+        cli->close(cli);
+        swClient_free(cli);
+        efree(cli);
+        return SW_ERR;
     }
 
+    redis->cli = cli;
+    redis->fd = cli->socket->fd;
+    redis->state = SWOOLE_REDIS_STATE_CONNECT;
+    redis->closing = 0;
+    redis->failure = 0;
+    redis->wait_count = 0;
+    redis->buffer = swString_new(SW_BUFFER_SIZE_STD);
+    redis->requests = swLinkedList_new(0, redis_request_free);
+
+    zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("sock"), redis->fd);
+    zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("host"), host);
+    zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("port"), port);
+
     if (redis->timeout > 0)
     {
         redis->timer = swTimer_add(&SwooleG.timer, (long) (redis->timeout * 1000), 0, redis, swoole_redis_onTimeout);
@@ -384,53 +727,171 @@ static PHP_METHOD(swoole_redis, connect)
 
     Z_TRY_ADDREF_P(redis->object);
 
-    swConnection *conn = swReactor_get(SwooleG.main_reactor, redis->context->c.fd);
+    swConnection *conn = swReactor_get(SwooleG.main_reactor, redis->fd);
     conn->object = redis;
+    conn->active = 0;
+    return SW_OK;
 }
 
-static void redis_close(void* data)
-{
-    swRedisClient *redis = data;
-    if (redis->context)
-    {
-        redisAsyncDisconnect(redis->context);
-    }
-}
-
-static void redis_free_object(void *data)
+static PHP_METHOD(swoole_redis, connect)
 {
-    zval *object = (zval*) data;
-    zval_ptr_dtor(object);
-}
+    char *host;
+    size_t host_len;
+    long port;
+    zval *callback;
 
-static void inline redis_free_memory(int argc, char **argv, size_t *argvlen, swRedisClient *redis, zend_bool free_mm)
-{
-    int i;
-    for (i = 1; i < argc; i++)
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "slz", &host, &host_len, &port, &callback) == FAILURE)
     {
-        efree((void* )argv[i]);
+        RETURN_FALSE;
     }
 
-    if (redis->state == SWOOLE_REDIS_STATE_SUBSCRIBE)
+    if (host_len == 0)
     {
-        efree(argv[argc]);
+        php_swoole_fatal_error(E_WARNING, "redis server host is empty.");
+        RETURN_FALSE;
     }
 
-    if (free_mm)
+    swRedisClient *redis = swoole_get_object(getThis());
+    if (redis_connect(redis, host, port) < 0)
     {
-        efree(argvlen);
-        efree(argv);
+        RETURN_FALSE;
+    }
+    zend_update_property(swoole_redis_ce, getThis(), ZEND_STRL("onConnect"), callback);
+    RETURN_TRUE;
+}
+
+/**
+ * release the socket and the buffers, the object is released by the caller
+ */
+static void redis_free_connection(swRedisClient *redis)
+{
+    if (redis->timer)
+    {
+        swTimer_del(&SwooleG.timer, redis->timer);
+        redis->timer = NULL;
+    }
+    redis_reader_reset(&redis->reader);
+    if (redis->buffer)
+    {
+        swString_free(redis->buffer);
+        redis->buffer = NULL;
+    }
+    if (redis->requests)
+    {
+        swLinkedList_free(redis->requests);
+        redis->requests = NULL;
+    }
+    if (redis->cli)
+    {
+        swConnection *socket = swReactor_get(SwooleG.main_reactor, redis->fd);
+        if (socket)
+        {
+            socket->object = NULL;
+        }
+        SwooleG.main_reactor->del(SwooleG.main_reactor, redis->fd);
+        redis->cli->close(redis->cli);
+        swClient_free(redis->cli);
+        efree(redis->cli);
+        redis->cli = NULL;
+    }
+    redis->connected = 0;
+    if (redis->cache)
+    {
+        redis_cache_reset(redis);
+    }
+}
+
+/**
+ * the connection is gone, every command still waiting for its reply gets false
+ */
+static void redis_requests_fail(swRedisClient *redis)
+{
+    swRedisRequest *request;
+    zval result;
+
+    if (redis->requests->num == 0)
+    {
+        return;
+    }
+    zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), ECONNRESET);
+    zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), "connection closed before the reply");
+
+    while ((request = swLinkedList_shift(redis->requests)))
+    {
+        ZVAL_FALSE(&result);
+        if (request->handler)
+        {
+            request->handler(redis, request, &result);
+        }
+        else if (request->callback)
+        {
+            zval args[2];
+            args[0] = *redis->object;
+            args[1] = result;
+            if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+            {
+                php_swoole_fatal_error(E_WARNING, "swoole_redis callback[Result] handler error.");
+            }
+            if (UNEXPECTED(EG(exception)))
+            {
+                zend_exception_error(EG(exception), E_ERROR);
+            }
+        }
+        redis_request_free(request);
+    }
+}
+
+void redis_close(swRedisClient *redis)
+{
+    zval *zobject = redis->object;
+    zend_bool connected = redis->connected;
+
+    if (!redis->cli || redis->state == SWOOLE_REDIS_STATE_CLOSED)
+    {
+        return;
+    }
+    redis->state = SWOOLE_REDIS_STATE_CLOSED;
+    redis->connected = 0;
+
+    redis_requests_fail(redis);
+    redis_free_connection(redis);
+
+    zval *zcallback = sw_zend_read_property(swoole_redis_ce, zobject, ZEND_STRL("onClose"), 1);
+    if (redis->hooks.onClose)
+    {
+        redis->hooks.onClose(redis);
+    }
+    else if (connected && zcallback && !ZVAL_IS_NULL(zcallback))
+    {
+        zval *retval = NULL;
+        zval args[1];
+        args[0] = *zobject;
+        if (sw_call_user_function_ex(EG(function_table), NULL, zcallback, &retval, 1, args, 0, NULL) != SUCCESS)
+        {
+            php_swoole_fatal_error(E_WARNING, "swoole_async_redis close_callback handler error.");
+        }
+        if (UNEXPECTED(EG(exception)))
+        {
+            zend_exception_error(EG(exception), E_ERROR);
+        }
+        if (retval)
+        {
+            zval_ptr_dtor(retval);
+        }
     }
-}
+
+    zval_ptr_dtor(zobject);
+}
 
 static PHP_METHOD(swoole_redis, close)
 {
     swRedisClient *redis = swoole_get_object(getThis());
-    if (redis && redis->context && redis->state != SWOOLE_REDIS_STATE_CLOSED)
+    if (redis && redis->cli && redis->state != SWOOLE_REDIS_STATE_CLOSED)
     {
-        if (redis->connecting)
+        // as the replies of the sent commands are still expected, the connection is closed after them
+        if (redis->state != SWOOLE_REDIS_STATE_SUBSCRIBE && redis->requests->num > 0)
         {
-            SwooleG.main_reactor->defer(SwooleG.main_reactor, redis_close, redis);
+            redis->closing = 1;
         }
         else
         {
@@ -446,19 +907,226 @@ static PHP_METHOD(swoole_redis, __destruct)
     swRedisClient *redis = swoole_get_object(getThis());
     if (redis)
     {
-        if (redis->context && redis->state != SWOOLE_REDIS_STATE_CLOSED)
+        if (redis->cli)
         {
-            redisAsyncDisconnect(redis->context);
+            redis_free_connection(redis);
         }
         if (redis->password)
         {
             efree(redis->password);
         }
+        if (redis->cache)
+        {
+            redis_cache_free(redis->cache);
+        }
         efree(redis);
         swoole_set_object(getThis(), NULL);
     }
 }
 
+/**
+ * append the command to the buffer as a multi-bulk request
+ */
+static int redis_command_pack(swString *buffer, int argc, char **argv, size_t *argvlen)
+{
+    char header[32];
+    int i, n;
+
+    n = sw_snprintf(header, sizeof(header), "*%d\r\n", argc);
+    if (swString_append_ptr(buffer, header, n) < 0)
+    {
+        return SW_ERR;
+    }
+    for (i = 0; i < argc; i++)
+    {
+        n = sw_snprintf(header, sizeof(header), "$%zu\r\n", argvlen[i]);
+        if (swString_append_ptr(buffer, header, n) < 0 || swString_append_ptr(buffer, argv[i], argvlen[i]) < 0
+                || swString_append_ptr(buffer, ZEND_STRL("\r\n")) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
+/**
+ * append a command given as an array of its name and arguments, the strings are appended as they are
+ */
+static int redis_command_pack_array(swString *buffer, HashTable *command)
+{
+    char header[32];
+    zval *value;
+    int n;
+
+    n = sw_snprintf(header, sizeof(header), "*%u\r\n", zend_hash_num_elements(command));
+    if (swString_append_ptr(buffer, header, n) < 0)
+    {
+        return SW_ERR;
+    }
+    SW_HASHTABLE_FOREACH_START(command, value)
+        zend_string *str = zval_get_string(value);
+        n = sw_snprintf(header, sizeof(header), "$%zu\r\n", ZSTR_LEN(str));
+        if (swString_append_ptr(buffer, header, n) < 0 || swString_append_ptr(buffer, ZSTR_VAL(str), ZSTR_LEN(str)) < 0
+                || swString_append_ptr(buffer, ZEND_STRL("\r\n")) < 0)
+        {
+            zend_string_release(str);
+            return SW_ERR;
+        }
+        zend_string_release(str);
+    SW_HASHTABLE_FOREACH_END();
+    return SW_OK;
+}
+
+/**
+ * write the parts of the request, what cannot be written now is copied into the output buffer of the socket
+ */
+static int redis_writev(swRedisClient *redis, struct iovec *iov, int iovcnt)
+{
+    swConnection *socket = swReactor_get(SwooleG.main_reactor, redis->fd);
+    ssize_t n = 0;
+    int i;
+
+    // the data already buffered goes first
+    if (swBuffer_empty(socket->out_buffer))
+    {
+        do
+        {
+            n = writev(redis->fd, iov, iovcnt);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0)
+        {
+            if (swConnection_error(errno) != SW_WAIT)
+            {
+                return SW_ERR;
+            }
+            n = 0;
+        }
+    }
+    for (i = 0; i < iovcnt; i++)
+    {
+        if ((size_t) n >= iov[i].iov_len)
+        {
+            n -= iov[i].iov_len;
+            continue;
+        }
+        if (SwooleG.main_reactor->write(SwooleG.main_reactor, redis->fd, (char *) iov[i].iov_base + n, iov[i].iov_len - n) < 0)
+        {
+            return SW_ERR;
+        }
+        n = 0;
+    }
+    return SW_OK;
+}
+
+/**
+ * send the command with the first n_params of the params, which are encoded from their strings:
+ * the long ones are written from the zend_string with writev(), the others are copied into the command buffer
+ */
+static int redis_send_params(swRedisClient *redis, char *command, size_t command_len, HashTable *params, uint32_t n_params)
+{
+    swString *buffer = redis_command_buffer;
+    struct iovec iov[SW_REDIS_COMMAND_REFS_MAX * 2 + 1];
+    size_t splits[SW_REDIS_COMMAND_REFS_MAX];
+    zend_string *refs[SW_REDIS_COMMAND_REFS_MAX];
+    uint32_t i = 0, n_refs = 0;
+    size_t offset = 0;
+    char header[32];
+    zval *value;
+    int n;
+
+    swString_clear(buffer);
+    n = sw_snprintf(header, sizeof(header), "*%u\r\n$%zu\r\n", n_params + 1, command_len);
+    if (swString_append_ptr(buffer, header, n) < 0 || swString_append_ptr(buffer, command, command_len) < 0
+            || swString_append_ptr(buffer, ZEND_STRL("\r\n")) < 0)
+    {
+        return SW_ERR;
+    }
+
+    SW_HASHTABLE_FOREACH_START(params, value)
+        if (i++ == n_params)
+        {
+            break;
+        }
+        if (Z_TYPE_P(value) == IS_STRING && Z_STRLEN_P(value) >= SW_REDIS_ZERO_COPY_SIZE && n_refs < SW_REDIS_COMMAND_REFS_MAX)
+        {
+            n = sw_snprintf(header, sizeof(header), "$%zu\r\n", Z_STRLEN_P(value));
+            if (swString_append_ptr(buffer, header, n) < 0)
+            {
+                return SW_ERR;
+            }
+            // the params hold the string during the call
+            splits[n_refs] = buffer->length;
+            refs[n_refs++] = Z_STR_P(value);
+        }
+        else
+        {
+            zend_string *str = zval_get_string(value);
+            n = sw_snprintf(header, sizeof(header), "$%zu\r\n", ZSTR_LEN(str));
+            if (swString_append_ptr(buffer, header, n) < 0 || swString_append_ptr(buffer, ZSTR_VAL(str), ZSTR_LEN(str)) < 0)
+            {
+                zend_string_release(str);
+                return SW_ERR;
+            }
+            zend_string_release(str);
+        }
+        if (swString_append_ptr(buffer, ZEND_STRL("\r\n")) < 0)
+        {
+            return SW_ERR;
+        }
+    SW_HASHTABLE_FOREACH_END();
+
+    if (n_refs == 0)
+    {
+        return SwooleG.main_reactor->write(SwooleG.main_reactor, redis->fd, buffer->str, buffer->length);
+    }
+    for (i = 0; i < n_refs; i++)
+    {
+        iov[i * 2].iov_base = buffer->str + offset;
+        iov[i * 2].iov_len = splits[i] - offset;
+        iov[i * 2 + 1].iov_base = ZSTR_VAL(refs[i]);
+        iov[i * 2 + 1].iov_len = ZSTR_LEN(refs[i]);
+        offset = splits[i];
+    }
+    iov[n_refs * 2].iov_base = buffer->str + offset;
+    iov[n_refs * 2].iov_len = buffer->length - offset;
+    return redis_writev(redis, iov, n_refs * 2 + 1);
+}
+
+static int redis_send_command(swRedisClient *redis, int argc, char **argv, size_t *argvlen)
+{
+    swString *buffer = redis_command_buffer;
+
+    swString_clear(buffer);
+    if (redis_command_pack(buffer, argc, argv, argvlen) < 0)
+    {
+        return SW_ERR;
+    }
+    return SwooleG.main_reactor->write(SwooleG.main_reactor, redis->fd, buffer->str, buffer->length);
+}
+
+/**
+ * send a command given as an array of its name and arguments for the internal owner of the connection,
+ * the reply is given to the handler
+ */
+int redis_send_array(swRedisClient *redis, HashTable *command, swRedisReplyHandler handler, void *data)
+{
+    swString *buffer = redis_command_buffer;
+
+    if (!redis->cli || redis->closing || (redis->state != SWOOLE_REDIS_STATE_READY && redis->state != SWOOLE_REDIS_STATE_WAIT_RESULT))
+    {
+        return SW_ERR;
+    }
+    swString_clear(buffer);
+    if (redis_command_pack_array(buffer, command) < 0
+            || SwooleG.main_reactor->write(SwooleG.main_reactor, redis->fd, buffer->str, buffer->length) < 0)
+    {
+        return SW_ERR;
+    }
+    redis->state = SWOOLE_REDIS_STATE_WAIT_RESULT;
+    swLinkedList_append(redis->requests, redis_request_new(NULL, handler, data));
+    return SW_OK;
+}
+
 static PHP_METHOD(swoole_redis, __call)
 {
     zval *params;
@@ -483,6 +1151,9 @@ static PHP_METHOD(swoole_redis, __call)
         RETURN_FALSE;
     }
 
+    // with RESP3, the subscriptions do not take the connection
+    zend_bool is_push = redis->protocol == 3 && swoole_redis_is_message_command(command, command_len);
+
     switch (redis->state)
     {
     case SWOOLE_REDIS_STATE_CONNECT:
@@ -490,7 +1161,7 @@ static PHP_METHOD(swoole_redis, __call)
         RETURN_FALSE;
         break;
     case SWOOLE_REDIS_STATE_WAIT_RESULT:
-        if (swoole_redis_is_message_command(command, command_len))
+        if (!is_push && swoole_redis_is_message_command(command, command_len))
         {
             php_swoole_error(E_WARNING, "redis client is waiting for response.");
             RETURN_FALSE;
@@ -510,63 +1181,32 @@ static PHP_METHOD(swoole_redis, __call)
     default:
         break;
     }
-
-    int argc = zend_hash_num_elements(Z_ARRVAL_P(params));
-    size_t stack_argvlen[SW_REDIS_COMMAND_BUFFER_SIZE];
-    char *stack_argv[SW_REDIS_COMMAND_BUFFER_SIZE];
-
-    size_t *argvlen;
-    char **argv;
-    zend_bool free_mm = 0;
-
-    if (argc > SW_REDIS_COMMAND_BUFFER_SIZE)
-    {
-        argvlen = emalloc(sizeof(size_t) * argc);
-        argv = emalloc(sizeof(char*) * argc);
-        free_mm = 1;
-    }
-    else
+    if (redis->closing)
     {
-        argvlen = stack_argvlen;
-        argv = stack_argv;
+        php_swoole_error(E_WARNING, "redis client connection is closing.");
+        RETURN_FALSE;
     }
 
-
-    assert(command_len < SW_REDIS_COMMAND_KEY_SIZE - 1);
-
-    char command_name[SW_REDIS_COMMAND_KEY_SIZE];
-    memcpy(command_name, command, command_len);
-    command_name[command_len] = '\0';
-
-    argv[0] = command_name;
-    argvlen[0] = command_len;
-
-    zval *value;
-    int i = 1;
+    uint32_t argc = zend_hash_num_elements(Z_ARRVAL_P(params));
 
     /**
-     * subscribe command
+     * subscribe command, its replies are pushed with the messages
      */
-    if (redis->state == SWOOLE_REDIS_STATE_SUBSCRIBE || (redis->subscribe && swoole_redis_is_message_command(command, command_len)))
+    if (is_push)
+    {
+        if (redis_send_params(redis, command, command_len, Z_ARRVAL_P(params), argc) < 0)
+        {
+            php_swoole_error(E_WARNING, "failed to send the redis command.");
+            RETURN_FALSE;
+        }
+    }
+    else if (redis->state == SWOOLE_REDIS_STATE_SUBSCRIBE || (redis->subscribe && swoole_redis_is_message_command(command, command_len)))
     {
         redis->state = SWOOLE_REDIS_STATE_SUBSCRIBE;
 
-        SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(params), value)
-            zend_string *str = zval_get_string(value);
-            argvlen[i] = ZSTR_LEN(str);
-            argv[i] = estrndup(ZSTR_VAL(str), ZSTR_LEN(str));
-            zend_string_release(str);
-            if (i == argc)
-            {
-                break;
-            }
-            i++;
-        SW_HASHTABLE_FOREACH_END();
-
-        if (redisAsyncCommandArgv(redis->context, swoole_redis_onResult, NULL, argc + 1, (const char **) argv, (const size_t *) argvlen) < 0)
+        if (redis_send_params(redis, command, command_len, Z_ARRVAL_P(params), argc) < 0)
         {
-            php_swoole_error(E_WARNING, "redisAsyncCommandArgv() failed.");
-            redis_free_memory(argc, argv, argvlen, redis, free_mm);
+            php_swoole_error(E_WARNING, "failed to send the redis command.");
             RETURN_FALSE;
         }
     }
@@ -575,125 +1215,178 @@ static PHP_METHOD(swoole_redis, __call)
      */
     else
     {
-        redis->state = SWOOLE_REDIS_STATE_WAIT_RESULT;
-        redis->reqnum++;
-
-        zval *callback = zend_hash_index_find(Z_ARRVAL_P(params), zend_hash_num_elements(Z_ARRVAL_P(params)) - 1);
+        zval *callback = zend_hash_index_find(Z_ARRVAL_P(params), argc - 1);
         if (callback == NULL)
         {
             php_swoole_error(E_WARNING, "index out of array bounds.");
-            redis_free_memory(argc, argv, argvlen, redis, free_mm);
             RETURN_FALSE;
         }
 
         if (!php_swoole_is_callable(callback))
         {
-            redis_free_memory(argc, argv, argvlen, redis, free_mm);
             RETURN_FALSE;
         }
 
-        Z_TRY_ADDREF_P(callback);
-        callback = sw_zval_dup(callback);
+        swRedisCacheFlight *flight = NULL;
+        if (redis->cache && redis_cache_lookup(redis, command, command_len, Z_ARRVAL_P(params), argc - 1, callback, &flight) == SW_OK)
+        {
+            RETURN_TRUE;
+        }
 
-        SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(params), value)
-            if (i == argc)
+        if (redis_send_params(redis, command, command_len, Z_ARRVAL_P(params), argc - 1) < 0)
+        {
+            if (flight)
             {
-                break;
+                redis_cache_flight_free(flight);
             }
-            zend_string *str = zval_get_string(value);
-            argvlen[i] = ZSTR_LEN(str);
-            argv[i] = estrndup(ZSTR_VAL(str), ZSTR_LEN(str));
-            zend_string_release(str);
-            i++;
-        SW_HASHTABLE_FOREACH_END();
-
-        if (redisAsyncCommandArgv(redis->context, swoole_redis_onResult, callback, argc, (const char **) argv, (const size_t *) argvlen) < 0)
-        {
-            php_swoole_error(E_WARNING, "redisAsyncCommandArgv() failed.");
-            redis_free_memory(argc, argv, argvlen, redis, free_mm);
+            php_swoole_error(E_WARNING, "failed to send the redis command.");
             RETURN_FALSE;
         }
+        redis->state = SWOOLE_REDIS_STATE_WAIT_RESULT;
+        if (flight)
+        {
+            swRedisRequest *request = redis_request_new(callback, redis_cache_onReply, flight);
+            request->dtor = redis_cache_flight_free;
+            swLinkedList_append(redis->requests, request);
+        }
+        else
+        {
+            swLinkedList_append(redis->requests, redis_request_new(callback, NULL, NULL));
+        }
     }
 
-    redis_free_memory(argc, argv, argvlen, redis, free_mm);
     RETURN_TRUE;
 }
 
-static PHP_METHOD(swoole_redis, getState)
+/**
+ * the commands are sent with a single write, the callback gets the array of their replies
+ */
+static PHP_METHOD(swoole_redis, batch)
 {
+    zval *commands;
+    zval *callback;
+    zval *command;
+    swString *buffer = redis_command_buffer;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "az", &commands, &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
     swRedisClient *redis = swoole_get_object(getThis());
     if (!redis)
     {
-        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_redis.");
+        php_swoole_fatal_error(E_WARNING, "the object is not an instance of swoole_redis.");
         RETURN_FALSE;
     }
-    RETURN_LONG(redis->state);
-}
-
-static void swoole_redis_set_error(swRedisClient *redis, zval* return_value, redisReply* reply)
-{
-    char *str = malloc(reply->len + 1);
-    memcpy(str, reply->str, reply->len);
-    str[reply->len] = 0;
-
-    ZVAL_FALSE(return_value);
-    zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), -1);
-    zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), str);
-    free(str);
-}
-
-static void swoole_redis_parse_result(swRedisClient *redis, zval* return_value, redisReply* reply)
-{
-    int j;
-    zval _val, *val = &_val;
-
-    switch (reply->type)
+    switch (redis->state)
     {
-    case REDIS_REPLY_INTEGER:
-        ZVAL_LONG(return_value, reply->integer);
-        break;
-
-    case REDIS_REPLY_ERROR:
-        swoole_redis_set_error(redis, return_value, reply);
+    case SWOOLE_REDIS_STATE_READY:
+    case SWOOLE_REDIS_STATE_WAIT_RESULT:
         break;
+    case SWOOLE_REDIS_STATE_SUBSCRIBE:
+        php_swoole_error(E_WARNING, "redis client is waiting for subscribed messages.");
+        RETURN_FALSE;
+    case SWOOLE_REDIS_STATE_CLOSED:
+        php_swoole_error(E_WARNING, "redis client connection is closed.");
+        RETURN_FALSE;
+    default:
+        php_swoole_error(E_WARNING, "redis client is not connected.");
+        RETURN_FALSE;
+    }
+    if (redis->closing)
+    {
+        php_swoole_error(E_WARNING, "redis client connection is closing.");
+        RETURN_FALSE;
+    }
+    if (zend_hash_num_elements(Z_ARRVAL_P(commands)) == 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "no command is given.");
+        RETURN_FALSE;
+    }
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
 
-    case REDIS_REPLY_STATUS:
-        if (redis->context->err == 0)
+    swString_clear(buffer);
+    SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(commands), command)
+        zval *name;
+        if (Z_TYPE_P(command) != IS_ARRAY || !(name = zend_hash_index_find(Z_ARRVAL_P(command), 0)))
         {
-            if (reply->len > 0)
-            {
-                ZVAL_STRINGL(return_value, reply->str, reply->len);
-            }
-            else
-            {
-                ZVAL_TRUE(return_value);
-            }
+            php_swoole_fatal_error(E_WARNING, "a command must be an array of its name and arguments.");
+            RETURN_FALSE;
         }
-        else
+        if (Z_TYPE_P(name) == IS_STRING && swoole_redis_is_message_command(Z_STRVAL_P(name), Z_STRLEN_P(name)))
         {
-            zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), redis->context->err);
-            zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), redis->context->errstr);
+            php_swoole_fatal_error(E_WARNING, "%s cannot be batched.", Z_STRVAL_P(name));
+            RETURN_FALSE;
         }
-        break;
-
-    case REDIS_REPLY_STRING:
-        ZVAL_STRINGL(return_value, reply->str, reply->len);
-        break;
-
-    case REDIS_REPLY_ARRAY:
-        array_init(return_value);
-        for (j = 0; j < reply->elements; j++)
+        if (redis_command_pack_array(buffer, Z_ARRVAL_P(command)) < 0)
         {
-            swoole_redis_parse_result(redis, val, reply->element[j]);
-            add_next_index_zval(return_value, val);
+            php_swoole_fatal_error(E_WARNING, "failed to pack the redis commands.");
+            RETURN_FALSE;
         }
-        break;
+        if (redis->cache)
+        {
+            redis_cache_onBatch(redis, Z_ARRVAL_P(command));
+        }
+    SW_HASHTABLE_FOREACH_END();
 
-    case REDIS_REPLY_NIL:
-    default:
-        ZVAL_NULL(return_value);
-        return;
+    if (SwooleG.main_reactor->write(SwooleG.main_reactor, redis->fd, buffer->str, buffer->length) < 0)
+    {
+        php_swoole_error(E_WARNING, "failed to send the redis commands.");
+        RETURN_FALSE;
+    }
+
+    swRedisRequest *request = redis_request_new(callback, NULL, NULL);
+    request->batch = zend_hash_num_elements(Z_ARRVAL_P(commands));
+    array_init_size(&request->results, request->batch);
+    redis->state = SWOOLE_REDIS_STATE_WAIT_RESULT;
+    swLinkedList_append(redis->requests, request);
+    RETURN_TRUE;
+}
+
+/**
+ * the commands in the subscribe state have no request, their replies are messages
+ */
+int redis_send_subscribe(swRedisClient *redis, HashTable *command)
+{
+    swString *buffer = redis_command_buffer;
+
+    if (!redis->cli || redis->state == SWOOLE_REDIS_STATE_CONNECT || redis->state == SWOOLE_REDIS_STATE_CLOSED || redis->requests->num > 0)
+    {
+        return SW_ERR;
+    }
+    swString_clear(buffer);
+    if (redis_command_pack_array(buffer, command) < 0
+            || SwooleG.main_reactor->write(SwooleG.main_reactor, redis->fd, buffer->str, buffer->length) < 0)
+    {
+        return SW_ERR;
+    }
+    redis->state = SWOOLE_REDIS_STATE_SUBSCRIBE;
+    return SW_OK;
+}
+
+static PHP_METHOD(swoole_redis, getCacheStats)
+{
+    swRedisClient *redis = swoole_get_object(getThis());
+    if (!redis || !redis->cache)
+    {
+        RETURN_FALSE;
+    }
+    redis_cache_stats(redis->cache, return_value);
+}
+
+static PHP_METHOD(swoole_redis, getState)
+{
+    swRedisClient *redis = swoole_get_object(getThis());
+    if (!redis)
+    {
+        php_swoole_fatal_error(E_WARNING, "object is not instanceof swoole_redis.");
+        RETURN_FALSE;
     }
+    RETURN_LONG(redis->state);
 }
 
 static void swoole_redis_onTimeout(swTimer *timer, swTimer_node *tnode)
@@ -703,49 +1396,25 @@ static void swoole_redis_onTimeout(swTimer *timer, swTimer_node *tnode)
     zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), ETIMEDOUT);
     zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), strerror(ETIMEDOUT));
     redis->state = SWOOLE_REDIS_STATE_CLOSED;
+    redis_free_connection(redis);
     redis_execute_connect_callback(redis, 0);
-    if (redis->context)
-    {
-        redisAsyncDisconnect(redis->context);
-    }
     zval_ptr_dtor(redis->object);
 }
 
-static void swoole_redis_onCompleted(redisAsyncContext *c, void *r, void *privdata)
+/**
+ * the reply of AUTH or SELECT, sent on connecting
+ */
+void swoole_redis_onCompleted(swRedisClient *redis, swRedisRequest *request, zval *result)
 {
-    swRedisClient *redis = c->ev.data;
     if (redis->state == SWOOLE_REDIS_STATE_CLOSED)
     {
         return;
     }
 
-    if (redis->failure == 0)
+    if (redis->failure == 0 && Z_TYPE_P(result) == IS_FALSE)
     {
-        redisReply *reply = r;
-        switch (reply->type)
-        {
-        case REDIS_REPLY_ERROR:
-            zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), 0);
-            zend_update_property_stringl(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), reply->str,
-                    reply->len);
-            redis->failure = 1;
-            break;
-
-        case REDIS_REPLY_STATUS:
-            if (redis->context->err == 0)
-            {
-                break;
-            }
-            else
-            {
-                zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"),
-                        redis->context->err);
-                zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"),
-                        redis->context->errstr);
-                redis->failure = 1;
-            }
-            break;
-        }
+        zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), 0);
+        redis->failure = 1;
     }
 
     redis->wait_count--;
@@ -754,7 +1423,6 @@ static void swoole_redis_onCompleted(redisAsyncContext *c, void *r, void *privda
         if (redis->failure)
         {
             redis_execute_connect_callback(redis, 0);
-            redis->connecting = 0;
             zval *zobject = redis->object;
             sw_zend_call_method_with_0_params(zobject, swoole_redis_ce, NULL, "close", NULL);
             return;
@@ -766,42 +1434,61 @@ static void swoole_redis_onCompleted(redisAsyncContext *c, void *r, void *privda
     }
 }
 
-static void swoole_redis_onResult(redisAsyncContext *c, void *r, void *privdata)
+static void swoole_redis_onResult(swRedisClient *redis, zval *result)
 {
-    redisReply *reply = r;
-    if (reply == NULL)
-    {
-        return;
-    }
-
     zend_bool is_subscribe = 0;
     char *callback_type;
-    swRedisClient *redis = c->ev.data;
-    zval result, *retval, *callback;
-
-    swoole_redis_parse_result(redis, &result, reply);
+    zval *retval, *callback;
+    swRedisRequest *request = NULL;
 
     if (redis->state == SWOOLE_REDIS_STATE_SUBSCRIBE)
     {
+        if (redis->hooks.onMessage)
+        {
+            redis->hooks.onMessage(redis, result);
+            return;
+        }
         callback = redis->message_callback;
         callback_type = "Message";
         is_subscribe = 1;
     }
     else
     {
-        callback = (zval *)privdata;
-        callback_type = "Result";
-        assert(redis->reqnum > 0 && redis->state == SWOOLE_REDIS_STATE_WAIT_RESULT);
-        redis->reqnum--;
-        if (redis->reqnum == 0)
+        if (redis->requests->num == 0)
+        {
+            swWarn("unexpected reply of redis connection#%d.", redis->fd);
+            return;
+        }
+        request = redis->requests->head->data;
+        // a batch is done with the reply of its last command
+        if (request->batch)
+        {
+            Z_TRY_ADDREF_P(result);
+            zend_hash_next_index_insert_new(Z_ARRVAL(request->results), result);
+            if (zend_hash_num_elements(Z_ARRVAL(request->results)) < request->batch)
+            {
+                return;
+            }
+            result = &request->results;
+        }
+        swLinkedList_shift(redis->requests);
+        if (redis->requests->num == 0 && redis->state == SWOOLE_REDIS_STATE_WAIT_RESULT)
         {
             redis->state = SWOOLE_REDIS_STATE_READY;
         }
+        if (request->handler)
+        {
+            request->handler(redis, request, result);
+            redis_request_free(request);
+            return;
+        }
+        callback = request->callback;
+        callback_type = "Result";
     }
 
     zval args[2];
     args[0] = *redis->object;
-    args[1] = result;
+    args[1] = *result;
 
     if (sw_call_user_function_ex(EG(function_table), NULL, callback, &retval, 2, args, 0, NULL) != SUCCESS)
     {
@@ -815,30 +1502,70 @@ static void swoole_redis_onResult(redisAsyncContext *c, void *r, void *privdata)
     {
         zval_ptr_dtor(retval);
     }
-    zval_ptr_dtor(&result);
     if (!is_subscribe)
     {
-        sw_zval_free(callback);
+        redis_request_free(request);
     }
 }
 
-void swoole_redis_onConnect(const redisAsyncContext *c, int status)
+/**
+ * a push message of RESP3, out of the order of the replies:
+ * an invalidation of the cache or a message of the subscribed channels
+ */
+static void swoole_redis_onPush(swRedisClient *redis, zval *message)
 {
-    swRedisClient *redis = c->ev.data;
+    zval *type, *retval = NULL;
+
+    if (redis->cache && Z_TYPE_P(message) == IS_ARRAY && (type = zend_hash_index_find(Z_ARRVAL_P(message), 0))
+            && Z_TYPE_P(type) == IS_STRING && zend_string_equals_literal(Z_STR_P(type), "invalidate"))
+    {
+        redis_cache_onInvalidate(redis->cache, zend_hash_index_find(Z_ARRVAL_P(message), 1));
+        return;
+    }
+    if (redis->hooks.onMessage)
+    {
+        redis->hooks.onMessage(redis, message);
+        return;
+    }
+    if (!redis->message_callback)
+    {
+        return;
+    }
+
+    zval args[2];
+    args[0] = *redis->object;
+    args[1] = *message;
+
+    if (sw_call_user_function_ex(EG(function_table), NULL, redis->message_callback, &retval, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_redis callback[Message] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    if (retval)
+    {
+        zval_ptr_dtor(retval);
+    }
+}
 
+static void swoole_redis_onConnect(swRedisClient *redis, int error)
+{
     if (redis->timer)
     {
         swTimer_del(&SwooleG.timer, redis->timer);
         redis->timer = NULL;
     }
 
-    if (status != REDIS_OK)
+    if (error)
     {
-        zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), errno);
-        zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), c->errstr);
+        zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), error);
+        zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), strerror(error));
         redis->state = SWOOLE_REDIS_STATE_CLOSED;
+        redis_free_connection(redis);
         redis_execute_connect_callback(redis, 0);
-        SwooleG.main_reactor->defer(SwooleG.main_reactor, redis_free_object, redis->object);
+        zval_ptr_dtor(redis->object);
         return;
     }
     else
@@ -847,148 +1574,223 @@ void swoole_redis_onConnect(const redisAsyncContext *c, int status)
         redis->connected = 1;
     }
 
-    if (redis->password)
+    // the password is given to HELLO with RESP3
+    if (redis->protocol == 3)
     {
-        redisAsyncCommand((redisAsyncContext *) c, swoole_redis_onCompleted, NULL, "AUTH %b", redis->password, redis->password_len);
+        char *argv[] = { "HELLO", "3", "AUTH", "default", redis->password };
+        size_t argvlen[] = { 5, 1, 4, 7, redis->password_len };
+        redis_send_command(redis, redis->password ? 5 : 2, argv, argvlen);
+        swLinkedList_append(redis->requests, redis_request_new(NULL, swoole_redis_onCompleted, NULL));
         redis->wait_count++;
     }
-    if (redis->database >= 0)
+    else if (redis->password)
     {
-        redisAsyncCommand((redisAsyncContext *) c, swoole_redis_onCompleted, (char*) "end-1", "SELECT %d", redis->database);
+        char *argv[] = { "AUTH", redis->password };
+        size_t argvlen[] = { 4, redis->password_len };
+        redis_send_command(redis, 2, argv, argvlen);
+        swLinkedList_append(redis->requests, redis_request_new(NULL, swoole_redis_onCompleted, NULL));
         redis->wait_count++;
     }
-    if (redis->wait_count == 0)
+    if (redis->database >= 0)
     {
-        redis_execute_connect_callback(redis, 1);
+        char database[8];
+        char *argv[] = { "SELECT", database };
+        size_t argvlen[] = { 6, sw_snprintf(database, sizeof(database), "%d", redis->database) };
+        redis_send_command(redis, 2, argv, argvlen);
+        swLinkedList_append(redis->requests, redis_request_new(NULL, swoole_redis_onCompleted, NULL));
+        redis->wait_count++;
     }
-}
-
-void swoole_redis_onClose(const redisAsyncContext *c, int status)
-{
-    swRedisClient *redis = c->ev.data;
-    redis->state = SWOOLE_REDIS_STATE_CLOSED;
-    redis->context = NULL;
-
-    zval *zcallback = sw_zend_read_property(swoole_redis_ce, redis->object, ZEND_STRL("onClose"), 1);
-    if (zcallback && !ZVAL_IS_NULL(zcallback))
+    // the tracking of the cached keys is enabled with the connection of the invalidations
+    if (redis->cache)
     {
-        zval *retval = NULL;
-        zval args[1];
-        args[0] = *redis->object;
-        if (sw_call_user_function_ex(EG(function_table), NULL, zcallback, &retval, 1, args, 0, NULL) != SUCCESS)
+        if (redis_cache_start(redis) == SW_OK)
         {
-            php_swoole_fatal_error(E_WARNING, "swoole_async_redis close_callback handler error.");
+            redis->wait_count++;
         }
-        if (UNEXPECTED(EG(exception)))
+        else
         {
-            zend_exception_error(EG(exception), E_ERROR);
+            redis->failure = 1;
         }
-        if (retval)
+    }
+    if (redis->wait_count == 0)
+    {
+        if (redis->failure)
         {
-            zval_ptr_dtor(retval);
+            redis_execute_connect_callback(redis, 0);
+            redis_close(redis);
+            return;
         }
+        redis_execute_connect_callback(redis, 1);
     }
-
-    zval_ptr_dtor(redis->object);
 }
 
 static int swoole_redis_onError(swReactor *reactor, swEvent *event)
 {
     swRedisClient *redis = event->socket->object;
-    zval *zcallback = sw_zend_read_property(swoole_redis_ce, redis->object, ZEND_STRL("onConnect"), 0);
-
-    if (!ZVAL_IS_NULL(zcallback))
+    if (!redis)
     {
-        const redisAsyncContext *c = redis->context;
-
-        zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), c->err);
-        zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), c->errstr);
-
-        redis->state = SWOOLE_REDIS_STATE_CLOSED;
-
-        zval args[2];
-
-        args[0] = *redis->object;
-        ZVAL_FALSE(&args[1]);
-
-        redis->connecting = 1;
-        if (sw_call_user_function_ex(EG(function_table), NULL, zcallback, NULL, 2, args, 0, NULL) != SUCCESS)
-        {
-            php_swoole_fatal_error(E_WARNING, "swoole_async_redis connect_callback handler error.");
-        }
-        if (UNEXPECTED(EG(exception)))
-        {
-            zend_exception_error(EG(exception), E_ERROR);
-        }
-        redis->connecting = 0;
-        zval *zobject = redis->object;
-        sw_zend_call_method_with_0_params(zobject, swoole_redis_ce, NULL, "close", NULL);
+        return SW_OK;
+    }
+    if (!event->socket->active)
+    {
+        return swoole_redis_onWrite(reactor, event);
     }
+    redis_close(redis);
     return SW_OK;
 }
 
-static void swoole_redis_event_AddRead(void *privdata)
+/**
+ * parse and dispatch the replies in the buffer, the callbacks may close the connection
+ * @return SW_ERR if the connection has been closed
+ */
+static int redis_read_replies(swRedisClient *redis)
 {
-    swRedisClient *redis = (swRedisClient*) privdata;
-    if (redis->context && SwooleG.main_reactor)
+    swString *buffer = redis->buffer;
+    zval result;
+
+    while (1)
     {
-        swReactor_add_event(SwooleG.main_reactor, redis->context->c.fd, SW_EVENT_READ);
+        switch (redis_reader_parse(redis, &result))
+        {
+        case SW_OK:
+            if (redis->reader.push)
+            {
+                redis->reader.push = 0;
+                swoole_redis_onPush(redis, &result);
+            }
+            else
+            {
+                swoole_redis_onResult(redis, &result);
+            }
+            zval_ptr_dtor(&result);
+            if (redis->reader.error)
+            {
+                zend_string_release(redis->reader.error);
+                redis->reader.error = NULL;
+            }
+            if (!redis->cli)
+            {
+                return SW_ERR;
+            }
+            if (redis->closing && redis->requests->num == 0)
+            {
+                redis_close(redis);
+                return SW_ERR;
+            }
+            break;
+        case SW_AGAIN:
+            // keep the partial line or bulk header only
+            if (buffer->offset == buffer->length)
+            {
+                swString_clear(buffer);
+            }
+            else if (buffer->offset > 0)
+            {
+                memmove(buffer->str, buffer->str + buffer->offset, buffer->length - buffer->offset);
+                buffer->length -= buffer->offset;
+                buffer->offset = 0;
+            }
+            return SW_OK;
+        default:
+            swWarn("redis connection#%d protocol error.", redis->fd);
+            zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), SW_ERROR_PROTOCOL_ERROR);
+            zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), "protocol error");
+            redis_close(redis);
+            return SW_ERR;
+        }
     }
 }
 
-static void swoole_redis_event_DelRead(void *privdata)
+static int swoole_redis_onRead(swReactor *reactor, swEvent *event)
 {
-    swRedisClient *redis = (swRedisClient*) privdata;
-    if (redis->context && SwooleG.main_reactor)
+    swRedisClient *redis = event->socket->object;
+    swRedisReader *reader;
+    swString *buffer;
+    zval *zobject;
+    ssize_t n;
+
+    if (!redis || !redis->cli)
     {
-        swReactor_del_event(SwooleG.main_reactor, redis->context->c.fd, SW_EVENT_READ);
+        return SW_OK;
     }
-}
+    reader = &redis->reader;
+    buffer = redis->buffer;
 
-static void swoole_redis_event_AddWrite(void *privdata)
-{
-    swRedisClient *redis = (swRedisClient*) privdata;
-    if (redis->context && SwooleG.main_reactor)
+    // the body of a long bulk string goes to its string directly
+    if (reader->bulk && buffer->length == buffer->offset && reader->bulk_filled < reader->bulk_length)
     {
-        swReactor_add_event(SwooleG.main_reactor, redis->context->c.fd, SW_EVENT_WRITE);
+        swString_clear(buffer);
+        redis_reader_bulk_grow(reader);
+        n = recv(redis->fd, ZSTR_VAL(reader->bulk) + reader->bulk_filled, ZSTR_LEN(reader->bulk) - reader->bulk_filled, 0);
+        if (n > 0)
+        {
+            reader->bulk_filled += n;
+            return SW_OK;
+        }
     }
-}
-
-static void swoole_redis_event_DelWrite(void *privdata)
-{
-    swRedisClient *redis = (swRedisClient*) privdata;
-    if (redis->context && SwooleG.main_reactor)
+    else
     {
-        swReactor_del_event(SwooleG.main_reactor, redis->context->c.fd, SW_EVENT_WRITE);
+        if (buffer->length == buffer->size && swString_extend(buffer, buffer->size * 2) < 0)
+        {
+            redis_close(redis);
+            return SW_OK;
+        }
+        n = recv(redis->fd, buffer->str + buffer->length, buffer->size - buffer->length, 0);
     }
-}
 
-static void swoole_redis_event_Cleanup(void *privdata)
-{
-    swRedisClient *redis = (swRedisClient*) privdata;
-    redis->state = SWOOLE_REDIS_STATE_CLOSED;
-    if (redis->context && SwooleG.main_reactor)
+    if (n < 0)
     {
-        SwooleG.main_reactor->del(SwooleG.main_reactor, redis->context->c.fd);
+        switch (swConnection_error(errno))
+        {
+        case SW_ERROR:
+            swSysError("Read from socket[%d] failed.", redis->fd);
+            break;
+        case SW_WAIT:
+            return SW_OK;
+        default:
+            break;
+        }
+        redis_close(redis);
+        return SW_OK;
     }
-}
-
-static int swoole_redis_onRead(swReactor *reactor, swEvent *event)
-{
-    swRedisClient *redis = event->socket->object;
-    if (redis->context && SwooleG.main_reactor)
+    else if (n == 0)
     {
-        redisAsyncHandleRead(redis->context);
+        redis_close(redis);
+        return SW_OK;
     }
+
+    buffer->length += n;
+    zobject = redis->object;
+    // the callbacks may release the last reference
+    Z_TRY_ADDREF_P(zobject);
+    redis_read_replies(redis);
+    zval_ptr_dtor(zobject);
     return SW_OK;
 }
 
 static int swoole_redis_onWrite(swReactor *reactor, swEvent *event)
 {
     swRedisClient *redis = event->socket->object;
-    if (redis->context && SwooleG.main_reactor)
+    if (event->socket->active)
+    {
+        return swReactor_onWrite(SwooleG.main_reactor, event);
+    }
+    if (!redis)
+    {
+        return SW_OK;
+    }
+
+    socklen_t len = sizeof(SwooleG.error);
+    if (getsockopt(event->fd, SOL_SOCKET, SO_ERROR, &SwooleG.error, &len) < 0)
+    {
+        swWarn("getsockopt(%d) failed. Error: %s[%d]", event->fd, strerror(errno), errno);
+        return SW_ERR;
+    }
+    if (SwooleG.error == 0)
     {
-        redisAsyncHandleWrite(redis->context);
+        SwooleG.main_reactor->set(SwooleG.main_reactor, event->fd, PHP_SWOOLE_FD_REDIS | SW_EVENT_READ);
+        event->socket->active = 1;
     }
+    swoole_redis_onConnect(redis, SwooleG.error);
     return SW_OK;
 }
@@ -0,0 +1,175 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#ifndef SWOOLE_REDIS_ASYNC_H_
+#define SWOOLE_REDIS_ASYNC_H_
+
+BEGIN_EXTERN_C()
+
+#define SW_REDIS_REPLY_MAX_DEPTH       32
+#define SW_REDIS_ZERO_COPY_SIZE        (16 * 1024)  /* the params as long as this are not copied into the command buffer */
+#define SW_REDIS_COMMAND_REFS_MAX      32
+#define SW_REDIS_BULK_PREALLOC_SIZE    (1024 * 1024) /* the lengths sent by the server are not trusted for the allocations */
+#define SW_REDIS_ARRAY_PREALLOC_SIZE   1024
+
+typedef struct _swRedisClient swRedisClient;
+typedef struct _swRedisRequest swRedisRequest;
+typedef void (*swRedisReplyHandler)(swRedisClient *redis, swRedisRequest *request, zval *result);
+
+/**
+ * a command waiting for its reply, the replies come in the order of the commands
+ */
+struct _swRedisRequest
+{
+    zval *callback;
+    swRedisReplyHandler handler; /* instead of the callback, for the commands sent by the client itself */
+    void *data; /* of the handler */
+    void (*dtor)(void *data); /* of the data, when the request is freed */
+    uint32_t batch; /* the number of commands of a batch, their replies are collected into results */
+    zval results;
+};
+
+/**
+ * an aggregate reply being filled: an array, a set, a push, or a map or attributes with their key pending
+ */
+typedef struct
+{
+    zval value;
+    zval key;
+    uint32_t remaining;
+    char type;
+} swRedisFrame;
+
+/**
+ * the state of the reply being parsed, kept between the reads
+ */
+typedef struct
+{
+    swRedisFrame stack[SW_REDIS_REPLY_MAX_DEPTH];
+    uint8_t depth;
+    zend_string *bulk; /* the bulk string being received, grown up to its length as the data comes */
+    size_t bulk_length;
+    size_t bulk_filled; /* including the CRLF */
+    char bulk_type; /* a bulk string, a verbatim string or a blob error */
+    uint8_t push; /* the reply is a push message, it does not answer a request */
+    char error_type; /* of the reply being dispatched when it is an error, a simple or a blob error */
+    zend_string *error;
+} swRedisReader;
+
+/**
+ * callbacks of the internal owner of a connection (e.g. Swoole\Redis\Cluster),
+ * they are called instead of the user callbacks
+ */
+typedef struct
+{
+    void *data;
+    void (*onConnect)(swRedisClient *redis, int success);
+    void (*onClose)(swRedisClient *redis);
+    void (*onMessage)(swRedisClient *redis, zval *message); /* of the subscribed channels */
+} swRedisClientHooks;
+
+typedef struct _swRedisCache swRedisCache;
+typedef struct _swRedisCacheFlight swRedisCacheFlight;
+
+struct _swRedisClient
+{
+    swClient *cli;
+    int fd;
+    uint8_t state;
+    uint8_t connected;
+    uint8_t subscribe;
+    uint8_t closing; /* close() has been called, the connection is closed after the pending replies */
+
+    zval *object;
+    zval *message_callback;
+
+    double timeout;
+    swTimer_node *timer;
+
+    char *password;
+    uint8_t password_len;
+    int8_t database;
+    uint8_t protocol; /* 3 after HELLO 3, the messages come out-of-band as pushes */
+    uint8_t failure;
+    uint8_t wait_count;
+
+    swString *buffer;
+    swLinkedList *requests;
+    swRedisReader reader;
+    swRedisClientHooks hooks;
+    swRedisCache *cache; /* of the reads, with the invalidations of the server-assisted tracking */
+
+    zval _message_callback;
+    zval _object;
+};
+
+enum swoole_redis_state
+{
+    SWOOLE_REDIS_STATE_CONNECT,
+    SWOOLE_REDIS_STATE_READY,
+    SWOOLE_REDIS_STATE_WAIT_RESULT,
+    SWOOLE_REDIS_STATE_SUBSCRIBE,
+    SWOOLE_REDIS_STATE_CLOSED,
+};
+
+static sw_inline int swoole_redis_is_message_command(char *command, int command_len)
+{
+    if (strncasecmp("subscribe", command, command_len) == 0)
+    {
+        return SW_TRUE;
+    }
+    else if (strncasecmp("psubscribe", command, command_len) == 0)
+    {
+        return SW_TRUE;
+    }
+    else if (strncasecmp("unsubscribe", command, command_len) == 0)
+    {
+        return SW_TRUE;
+    }
+    else if (strncasecmp("punsubscribe", command, command_len) == 0)
+    {
+        return SW_TRUE;
+    }
+    else
+    {
+        return SW_FALSE;
+    }
+}
+
+extern zend_class_entry *swoole_redis_ce;
+
+int redis_connect(swRedisClient *redis, char *host, long port);
+int redis_send_array(swRedisClient *redis, HashTable *command, swRedisReplyHandler handler, void *data);
+int redis_send_subscribe(swRedisClient *redis, HashTable *command);
+void redis_close(swRedisClient *redis);
+void swoole_redis_onCompleted(swRedisClient *redis, swRedisRequest *request, zval *result);
+
+swRedisCache* redis_cache_new(HashTable *settings);
+void redis_cache_free(swRedisCache *cache);
+int redis_cache_start(swRedisClient *redis);
+void redis_cache_reset(swRedisClient *redis);
+int redis_cache_lookup(swRedisClient *redis, char *command, size_t command_len, HashTable *params, uint32_t n_params, zval *callback, swRedisCacheFlight **flight);
+void redis_cache_flight_free(void *data);
+void redis_cache_onBatch(swRedisClient *redis, HashTable *command);
+void redis_cache_onReply(swRedisClient *redis, swRedisRequest *request, zval *result);
+void redis_cache_onInvalidate(swRedisCache *cache, zval *keys);
+void redis_cache_stats(swRedisCache *cache, zval *return_value);
+
+END_EXTERN_C()
+
+#endif /* SWOOLE_REDIS_ASYNC_H_ */
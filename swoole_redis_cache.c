@@ -0,0 +1,840 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole_async.h"
+#include "swoole_redis_async.h"
+
+#include "zend_smart_str.h"
+
+#define SW_REDIS_CACHE_INVALIDATE_CHANNEL   "__redis__:invalidate"
+
+/**
+ * the reply of a read command
+ */
+typedef struct
+{
+    zval result;
+    zend_string *key; /* the key read by the command */
+    size_t size;
+    swRedisCache *cache;
+} swRedisCacheEntry;
+
+/**
+ * the entries of a key, they are all dropped by its invalidation
+ */
+typedef struct
+{
+    HashTable commands;
+    uint32_t flights; /* the reads of the key waiting for their replies */
+    uint32_t version; /* changed by each invalidation, the replies read before it are not kept */
+} swRedisCacheKey;
+
+struct _swRedisCacheFlight
+{
+    swRedisCache *cache;
+    zend_string *command;
+    zend_string *key;
+    uint32_t version;
+};
+
+struct _swRedisCache
+{
+    size_t memory;
+    size_t memory_limit;
+    uint8_t broadcast;
+    uint8_t tracking; /* the server tracks the keys and the invalidations are received */
+    zval prefixes;
+    HashTable *entries; /* the oldest first */
+    HashTable *keys;
+    swRedisClient *invalidation; /* the subscriber of the invalidations */
+    zval _invalidation;
+
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+    uint64_t evictions;
+};
+
+/**
+ * a reply from the cache, delivered on the next tick of the reactor
+ */
+typedef struct
+{
+    zval object;
+    zval callback;
+    zval result;
+} swRedisCacheHit;
+
+/**
+ * the commands which only read their first argument as the key
+ */
+static const char *redis_cache_commands[] =
+{
+    "GET", "GETRANGE", "STRLEN", "TYPE",
+    "HGET", "HMGET", "HGETALL", "HEXISTS", "HLEN", "HKEYS", "HVALS", "HSTRLEN",
+    "LRANGE", "LLEN", "LINDEX",
+    "SMEMBERS", "SISMEMBER", "SCARD",
+    "ZRANGE", "ZREVRANGE", "ZRANGEBYSCORE", "ZSCORE", "ZCARD", "ZRANK", "ZCOUNT",
+    NULL
+};
+
+enum swRedisCacheKeySpec
+{
+    SW_REDIS_CACHE_KEYS_NONE, /* the command does not change any key */
+    SW_REDIS_CACHE_KEYS_FIRST,
+    SW_REDIS_CACHE_KEYS_SECOND,
+    SW_REDIS_CACHE_KEYS_ALL, /* the arguments which are not keys are invalidated too, harmlessly */
+    SW_REDIS_CACHE_KEYS_EVEN, /* key value [key value ...] */
+};
+
+typedef struct
+{
+    const char *name;
+    enum swRedisCacheKeySpec keys;
+} swRedisCacheWrite;
+
+/**
+ * the keys changed by the other commands, the unknown ones may change any key
+ */
+static const swRedisCacheWrite redis_cache_writes[] =
+{
+    { "PING", SW_REDIS_CACHE_KEYS_NONE }, { "ECHO", SW_REDIS_CACHE_KEYS_NONE },
+    { "PUBLISH", SW_REDIS_CACHE_KEYS_NONE }, { "EXISTS", SW_REDIS_CACHE_KEYS_NONE },
+    { "MGET", SW_REDIS_CACHE_KEYS_NONE }, { "TTL", SW_REDIS_CACHE_KEYS_NONE },
+    { "PTTL", SW_REDIS_CACHE_KEYS_NONE }, { "KEYS", SW_REDIS_CACHE_KEYS_NONE },
+    { "SCAN", SW_REDIS_CACHE_KEYS_NONE }, { "HSCAN", SW_REDIS_CACHE_KEYS_NONE },
+    { "SSCAN", SW_REDIS_CACHE_KEYS_NONE }, { "ZSCAN", SW_REDIS_CACHE_KEYS_NONE },
+    { "INFO", SW_REDIS_CACHE_KEYS_NONE }, { "TIME", SW_REDIS_CACHE_KEYS_NONE },
+    { "DBSIZE", SW_REDIS_CACHE_KEYS_NONE }, { "RANDOMKEY", SW_REDIS_CACHE_KEYS_NONE },
+    { "SRANDMEMBER", SW_REDIS_CACHE_KEYS_NONE }, { "ZREVRANK", SW_REDIS_CACHE_KEYS_NONE },
+    { "ZREVRANGEBYSCORE", SW_REDIS_CACHE_KEYS_NONE }, { "ZRANGEBYLEX", SW_REDIS_CACHE_KEYS_NONE },
+    { "ZREVRANGEBYLEX", SW_REDIS_CACHE_KEYS_NONE }, { "ZLEXCOUNT", SW_REDIS_CACHE_KEYS_NONE },
+    { "ZMSCORE", SW_REDIS_CACHE_KEYS_NONE }, { "ZRANDMEMBER", SW_REDIS_CACHE_KEYS_NONE },
+    { "ZINTER", SW_REDIS_CACHE_KEYS_NONE }, { "ZUNION", SW_REDIS_CACHE_KEYS_NONE },
+    { "ZDIFF", SW_REDIS_CACHE_KEYS_NONE }, { "ZINTERCARD", SW_REDIS_CACHE_KEYS_NONE },
+    { "GETBIT", SW_REDIS_CACHE_KEYS_NONE }, { "BITCOUNT", SW_REDIS_CACHE_KEYS_NONE },
+    { "BITPOS", SW_REDIS_CACHE_KEYS_NONE }, { "BITFIELD_RO", SW_REDIS_CACHE_KEYS_NONE },
+    { "SUBSTR", SW_REDIS_CACHE_KEYS_NONE }, { "LCS", SW_REDIS_CACHE_KEYS_NONE },
+    { "LPOS", SW_REDIS_CACHE_KEYS_NONE }, { "SMISMEMBER", SW_REDIS_CACHE_KEYS_NONE },
+    { "SINTER", SW_REDIS_CACHE_KEYS_NONE }, { "SUNION", SW_REDIS_CACHE_KEYS_NONE },
+    { "SDIFF", SW_REDIS_CACHE_KEYS_NONE }, { "SINTERCARD", SW_REDIS_CACHE_KEYS_NONE },
+    { "HRANDFIELD", SW_REDIS_CACHE_KEYS_NONE }, { "XRANGE", SW_REDIS_CACHE_KEYS_NONE },
+    { "XREVRANGE", SW_REDIS_CACHE_KEYS_NONE }, { "XLEN", SW_REDIS_CACHE_KEYS_NONE },
+    { "XREAD", SW_REDIS_CACHE_KEYS_NONE }, { "XINFO", SW_REDIS_CACHE_KEYS_NONE },
+    { "PFCOUNT", SW_REDIS_CACHE_KEYS_NONE }, { "GEOPOS", SW_REDIS_CACHE_KEYS_NONE },
+    { "GEODIST", SW_REDIS_CACHE_KEYS_NONE }, { "GEOHASH", SW_REDIS_CACHE_KEYS_NONE },
+    { "GEOSEARCH", SW_REDIS_CACHE_KEYS_NONE }, { "GEORADIUS_RO", SW_REDIS_CACHE_KEYS_NONE },
+    { "GEORADIUSBYMEMBER_RO", SW_REDIS_CACHE_KEYS_NONE }, { "OBJECT", SW_REDIS_CACHE_KEYS_NONE },
+    { "DUMP", SW_REDIS_CACHE_KEYS_NONE }, { "TOUCH", SW_REDIS_CACHE_KEYS_NONE },
+    { "EXPIRETIME", SW_REDIS_CACHE_KEYS_NONE }, { "PEXPIRETIME", SW_REDIS_CACHE_KEYS_NONE },
+
+    { "SET", SW_REDIS_CACHE_KEYS_FIRST }, { "SETEX", SW_REDIS_CACHE_KEYS_FIRST },
+    { "PSETEX", SW_REDIS_CACHE_KEYS_FIRST }, { "SETNX", SW_REDIS_CACHE_KEYS_FIRST },
+    { "SETRANGE", SW_REDIS_CACHE_KEYS_FIRST }, { "APPEND", SW_REDIS_CACHE_KEYS_FIRST },
+    { "INCR", SW_REDIS_CACHE_KEYS_FIRST }, { "INCRBY", SW_REDIS_CACHE_KEYS_FIRST },
+    { "INCRBYFLOAT", SW_REDIS_CACHE_KEYS_FIRST }, { "DECR", SW_REDIS_CACHE_KEYS_FIRST },
+    { "DECRBY", SW_REDIS_CACHE_KEYS_FIRST }, { "GETSET", SW_REDIS_CACHE_KEYS_FIRST },
+    { "GETDEL", SW_REDIS_CACHE_KEYS_FIRST }, { "GETEX", SW_REDIS_CACHE_KEYS_FIRST },
+    { "SETBIT", SW_REDIS_CACHE_KEYS_FIRST }, { "EXPIRE", SW_REDIS_CACHE_KEYS_FIRST },
+    { "PEXPIRE", SW_REDIS_CACHE_KEYS_FIRST }, { "EXPIREAT", SW_REDIS_CACHE_KEYS_FIRST },
+    { "PEXPIREAT", SW_REDIS_CACHE_KEYS_FIRST }, { "PERSIST", SW_REDIS_CACHE_KEYS_FIRST },
+    { "HSET", SW_REDIS_CACHE_KEYS_FIRST }, { "HSETNX", SW_REDIS_CACHE_KEYS_FIRST },
+    { "HMSET", SW_REDIS_CACHE_KEYS_FIRST }, { "HDEL", SW_REDIS_CACHE_KEYS_FIRST },
+    { "HINCRBY", SW_REDIS_CACHE_KEYS_FIRST }, { "HINCRBYFLOAT", SW_REDIS_CACHE_KEYS_FIRST },
+    { "LPUSH", SW_REDIS_CACHE_KEYS_FIRST }, { "RPUSH", SW_REDIS_CACHE_KEYS_FIRST },
+    { "LPUSHX", SW_REDIS_CACHE_KEYS_FIRST }, { "RPUSHX", SW_REDIS_CACHE_KEYS_FIRST },
+    { "LPOP", SW_REDIS_CACHE_KEYS_FIRST }, { "RPOP", SW_REDIS_CACHE_KEYS_FIRST },
+    { "LSET", SW_REDIS_CACHE_KEYS_FIRST }, { "LREM", SW_REDIS_CACHE_KEYS_FIRST },
+    { "LTRIM", SW_REDIS_CACHE_KEYS_FIRST }, { "LINSERT", SW_REDIS_CACHE_KEYS_FIRST },
+    { "SADD", SW_REDIS_CACHE_KEYS_FIRST }, { "SREM", SW_REDIS_CACHE_KEYS_FIRST },
+    { "SPOP", SW_REDIS_CACHE_KEYS_FIRST }, { "ZADD", SW_REDIS_CACHE_KEYS_FIRST },
+    { "ZREM", SW_REDIS_CACHE_KEYS_FIRST }, { "ZINCRBY", SW_REDIS_CACHE_KEYS_FIRST },
+    { "ZREMRANGEBYSCORE", SW_REDIS_CACHE_KEYS_FIRST }, { "ZREMRANGEBYRANK", SW_REDIS_CACHE_KEYS_FIRST },
+    { "ZREMRANGEBYLEX", SW_REDIS_CACHE_KEYS_FIRST }, { "ZPOPMIN", SW_REDIS_CACHE_KEYS_FIRST },
+    { "ZPOPMAX", SW_REDIS_CACHE_KEYS_FIRST }, { "PFADD", SW_REDIS_CACHE_KEYS_FIRST },
+    { "GEOADD", SW_REDIS_CACHE_KEYS_FIRST }, { "XADD", SW_REDIS_CACHE_KEYS_FIRST },
+    { "XDEL", SW_REDIS_CACHE_KEYS_FIRST }, { "XTRIM", SW_REDIS_CACHE_KEYS_FIRST },
+    // only the destination of the stores is changed
+    { "SINTERSTORE", SW_REDIS_CACHE_KEYS_FIRST }, { "SUNIONSTORE", SW_REDIS_CACHE_KEYS_FIRST },
+    { "SDIFFSTORE", SW_REDIS_CACHE_KEYS_FIRST }, { "ZINTERSTORE", SW_REDIS_CACHE_KEYS_FIRST },
+    { "ZUNIONSTORE", SW_REDIS_CACHE_KEYS_FIRST }, { "ZDIFFSTORE", SW_REDIS_CACHE_KEYS_FIRST },
+    { "ZRANGESTORE", SW_REDIS_CACHE_KEYS_FIRST },
+
+    { "BITOP", SW_REDIS_CACHE_KEYS_SECOND },
+
+    { "DEL", SW_REDIS_CACHE_KEYS_ALL }, { "UNLINK", SW_REDIS_CACHE_KEYS_ALL },
+    { "RENAME", SW_REDIS_CACHE_KEYS_ALL }, { "RENAMENX", SW_REDIS_CACHE_KEYS_ALL },
+    { "COPY", SW_REDIS_CACHE_KEYS_ALL }, { "SMOVE", SW_REDIS_CACHE_KEYS_ALL },
+    { "RPOPLPUSH", SW_REDIS_CACHE_KEYS_ALL }, { "BRPOPLPUSH", SW_REDIS_CACHE_KEYS_ALL },
+    { "LMOVE", SW_REDIS_CACHE_KEYS_ALL }, { "BLMOVE", SW_REDIS_CACHE_KEYS_ALL },
+    { "BLPOP", SW_REDIS_CACHE_KEYS_ALL }, { "BRPOP", SW_REDIS_CACHE_KEYS_ALL },
+    { "BZPOPMIN", SW_REDIS_CACHE_KEYS_ALL }, { "BZPOPMAX", SW_REDIS_CACHE_KEYS_ALL },
+
+    { "MSET", SW_REDIS_CACHE_KEYS_EVEN }, { "MSETNX", SW_REDIS_CACHE_KEYS_EVEN },
+    { NULL, SW_REDIS_CACHE_KEYS_NONE }
+};
+
+static void redis_cache_entry_dtor(zval *zv)
+{
+    swRedisCacheEntry *entry = Z_PTR_P(zv);
+    entry->cache->memory -= entry->size;
+    zval_ptr_dtor(&entry->result);
+    zend_string_release(entry->key);
+    efree(entry);
+}
+
+static void redis_cache_key_dtor(zval *zv)
+{
+    swRedisCacheKey *k = Z_PTR_P(zv);
+    zend_hash_destroy(&k->commands);
+    efree(k);
+}
+
+swRedisCache* redis_cache_new(HashTable *settings)
+{
+    swRedisCache *cache = ecalloc(1, sizeof(swRedisCache));
+    zval *ztmp;
+
+    if (php_swoole_array_get_value(settings, "cache_memory", ztmp))
+    {
+        cache->memory_limit = zval_get_long(ztmp);
+    }
+    if (php_swoole_array_get_value(settings, "cache_broadcast", ztmp))
+    {
+        cache->broadcast = zval_is_true(ztmp);
+    }
+    if (php_swoole_array_get_value(settings, "cache_prefixes", ztmp) && ZVAL_IS_ARRAY(ztmp))
+    {
+        ZVAL_COPY(&cache->prefixes, ztmp);
+    }
+    ALLOC_HASHTABLE(cache->entries);
+    zend_hash_init(cache->entries, 64, NULL, redis_cache_entry_dtor, 0);
+    ALLOC_HASHTABLE(cache->keys);
+    zend_hash_init(cache->keys, 64, NULL, redis_cache_key_dtor, 0);
+    return cache;
+}
+
+/**
+ * the connection is closed before, the reads in flight have been released
+ */
+void redis_cache_free(swRedisCache *cache)
+{
+    if (cache->invalidation)
+    {
+        bzero(&cache->invalidation->hooks, sizeof(cache->invalidation->hooks));
+        zval_ptr_dtor(&cache->_invalidation);
+    }
+    zend_hash_destroy(cache->entries);
+    FREE_HASHTABLE(cache->entries);
+    zend_hash_destroy(cache->keys);
+    FREE_HASHTABLE(cache->keys);
+    zval_ptr_dtor(&cache->prefixes);
+    efree(cache);
+}
+
+static int redis_cache_key_apply_flush(zval *zv)
+{
+    swRedisCacheKey *k = Z_PTR_P(zv);
+    k->version++;
+    zend_hash_clean(&k->commands);
+    return k->flights > 0 ? ZEND_HASH_APPLY_KEEP : ZEND_HASH_APPLY_REMOVE;
+}
+
+static void redis_cache_flush(swRedisCache *cache)
+{
+    zend_hash_clean(cache->entries);
+    zend_hash_apply(cache->keys, redis_cache_key_apply_flush);
+}
+
+static sw_inline void redis_cache_key_release(swRedisCache *cache, zend_string *key, swRedisCacheKey *k)
+{
+    if (k->flights == 0 && zend_hash_num_elements(&k->commands) == 0)
+    {
+        zend_hash_del(cache->keys, key);
+    }
+}
+
+static void redis_cache_invalidate(swRedisCache *cache, zend_string *key)
+{
+    swRedisCacheKey *k = zend_hash_find_ptr(cache->keys, key);
+    zend_string *command;
+
+    if (!k)
+    {
+        return;
+    }
+    k->version++;
+    ZEND_HASH_FOREACH_STR_KEY(&k->commands, command)
+    {
+        zend_hash_del(cache->entries, command);
+    }
+    ZEND_HASH_FOREACH_END();
+    zend_hash_clean(&k->commands);
+    cache->invalidations++;
+    redis_cache_key_release(cache, key, k);
+}
+
+/**
+ * the memory of the reply beyond its zval, roughly
+ */
+static size_t redis_cache_sizeof(zval *zv)
+{
+    zend_string *key;
+    zval *value;
+    size_t size;
+
+    switch (Z_TYPE_P(zv))
+    {
+    case IS_STRING:
+        return ZSTR_IS_INTERNED(Z_STR_P(zv)) ? 0 : _ZSTR_STRUCT_SIZE(Z_STRLEN_P(zv));
+    case IS_ARRAY:
+        size = sizeof(zend_array) + Z_ARRVAL_P(zv)->nTableSize * (sizeof(Bucket) + sizeof(uint32_t));
+        ZEND_HASH_FOREACH_STR_KEY_VAL(Z_ARRVAL_P(zv), key, value)
+        {
+            if (key && !ZSTR_IS_INTERNED(key))
+            {
+                size += _ZSTR_STRUCT_SIZE(ZSTR_LEN(key));
+            }
+            size += redis_cache_sizeof(value);
+        }
+        ZEND_HASH_FOREACH_END();
+        return size;
+    default:
+        return 0;
+    }
+}
+
+static void redis_cache_add(swRedisCache *cache, swRedisCacheKey *k, swRedisCacheFlight *flight, zval *result)
+{
+    swRedisCacheEntry *entry;
+    swRedisCacheKey *oldest_key;
+    Bucket *oldest;
+    size_t size = sizeof(swRedisCacheEntry) + _ZSTR_STRUCT_SIZE(ZSTR_LEN(flight->command)) * 2 + redis_cache_sizeof(result);
+
+    if (size > cache->memory_limit)
+    {
+        return;
+    }
+    zend_hash_del(cache->entries, flight->command);
+    while (cache->memory + size > cache->memory_limit)
+    {
+        ZEND_HASH_FOREACH_BUCKET(cache->entries, oldest)
+        {
+            entry = Z_PTR(oldest->val);
+            zend_string *oldest_command = zend_string_copy(oldest->key);
+            zend_string *oldest_name = zend_string_copy(entry->key);
+            zend_hash_del_bucket(cache->entries, oldest);
+            // the key being added is kept by its read in flight
+            if ((oldest_key = zend_hash_find_ptr(cache->keys, oldest_name)))
+            {
+                zend_hash_del(&oldest_key->commands, oldest_command);
+                redis_cache_key_release(cache, oldest_name, oldest_key);
+            }
+            zend_string_release(oldest_command);
+            zend_string_release(oldest_name);
+            break;
+        }
+        ZEND_HASH_FOREACH_END();
+        cache->evictions++;
+    }
+
+    entry = emalloc(sizeof(swRedisCacheEntry));
+    ZVAL_COPY(&entry->result, result);
+    entry->key = zend_string_copy(flight->key);
+    entry->size = size;
+    entry->cache = cache;
+    cache->memory += size;
+    zend_hash_add_ptr(cache->entries, flight->command, entry);
+    zend_hash_add_empty_element(&k->commands, flight->command);
+}
+
+/**
+ * the command name in upper case and the params, as a multi-bulk request
+ */
+static zend_string* redis_cache_command_key(char *command, size_t command_len, HashTable *params, uint32_t n_params)
+{
+    smart_str buffer = {0};
+    uint32_t i = 0;
+    zval *value;
+    size_t j;
+
+    smart_str_appendc(&buffer, '*');
+    smart_str_append_unsigned(&buffer, n_params + 1);
+    smart_str_appendl(&buffer, "\r\n$", 3);
+    smart_str_append_unsigned(&buffer, command_len);
+    smart_str_appendl(&buffer, "\r\n", 2);
+    for (j = 0; j < command_len; j++)
+    {
+        smart_str_appendc(&buffer, toupper((unsigned char) command[j]));
+    }
+    SW_HASHTABLE_FOREACH_START(params, value)
+        if (i++ == n_params)
+        {
+            break;
+        }
+        zend_string *str = zval_get_string(value);
+        smart_str_appendl(&buffer, "\r\n$", 3);
+        smart_str_append_unsigned(&buffer, ZSTR_LEN(str));
+        smart_str_appendl(&buffer, "\r\n", 2);
+        smart_str_append(&buffer, str);
+        zend_string_release(str);
+    SW_HASHTABLE_FOREACH_END();
+
+    smart_str_0(&buffer);
+    return buffer.s;
+}
+
+static zend_bool redis_cache_is_readonly(char *command, size_t command_len)
+{
+    const char **name;
+    for (name = redis_cache_commands; *name; name++)
+    {
+        if (strlen(*name) == command_len && strncasecmp(*name, command, command_len) == 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * the invalidations of the writes of the connection itself may come after its next reads,
+ * so the keys they change are invalidated before they are sent
+ */
+static void redis_cache_onWrite(swRedisCache *cache, char *command, size_t command_len, HashTable *params, uint32_t offset, uint32_t n_params)
+{
+    const swRedisCacheWrite *write;
+    zend_string *key;
+    zval *value;
+    uint32_t i = 0, j;
+
+    for (write = redis_cache_writes; write->name; write++)
+    {
+        if (strlen(write->name) == command_len && strncasecmp(write->name, command, command_len) == 0)
+        {
+            break;
+        }
+    }
+    // e.g. FLUSHALL, SELECT or EVAL
+    if (!write->name)
+    {
+        redis_cache_flush(cache);
+        return;
+    }
+
+    SW_HASHTABLE_FOREACH_START(params, value)
+        if (i++ < offset)
+        {
+            continue;
+        }
+        j = i - offset - 1;
+        if (j == n_params)
+        {
+            break;
+        }
+        if ((write->keys == SW_REDIS_CACHE_KEYS_FIRST && j == 0) || (write->keys == SW_REDIS_CACHE_KEYS_SECOND && j == 1)
+                || write->keys == SW_REDIS_CACHE_KEYS_ALL || (write->keys == SW_REDIS_CACHE_KEYS_EVEN && j % 2 == 0))
+        {
+            key = zval_get_string(value);
+            redis_cache_invalidate(cache, key);
+            zend_string_release(key);
+        }
+    SW_HASHTABLE_FOREACH_END();
+}
+
+/**
+ * a command of a batch, its name then its arguments: the reads are sent without the cache,
+ * the keys of the writes are invalidated as for the single commands
+ */
+void redis_cache_onBatch(swRedisClient *redis, HashTable *command)
+{
+    zend_string *name;
+    uint32_t n_params = zend_hash_num_elements(command) - 1;
+
+    if (!redis->cache->tracking)
+    {
+        return;
+    }
+    name = zval_get_string(zend_hash_index_find(command, 0));
+    if (!redis_cache_is_readonly(ZSTR_VAL(name), ZSTR_LEN(name)))
+    {
+        redis_cache_onWrite(redis->cache, ZSTR_VAL(name), ZSTR_LEN(name), command, 1, n_params);
+    }
+    zend_string_release(name);
+}
+
+static void redis_cache_onDefer(void *data)
+{
+    swRedisCacheHit *hit = data;
+    zval args[2];
+
+    args[0] = hit->object;
+    args[1] = hit->result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, &hit->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_redis callback[Result] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    zval_ptr_dtor(&hit->object);
+    zval_ptr_dtor(&hit->callback);
+    zval_ptr_dtor(&hit->result);
+    efree(hit);
+}
+
+/**
+ * @return SW_OK if the callback gets the reply from the cache,
+ *         otherwise the command is to be sent, with the flight when it is cacheable
+ */
+int redis_cache_lookup(swRedisClient *redis, char *command, size_t command_len, HashTable *params, uint32_t n_params, zval *callback, swRedisCacheFlight **flight)
+{
+    swRedisCache *cache = redis->cache;
+    swRedisCacheEntry *entry;
+    swRedisCacheKey *k;
+    swRedisCacheFlight *f;
+    zend_string *key, *ckey;
+    zval *zkey;
+
+    if (!cache->tracking)
+    {
+        return SW_ERR;
+    }
+    if (!redis_cache_is_readonly(command, command_len))
+    {
+        redis_cache_onWrite(cache, command, command_len, params, 0, n_params);
+        return SW_ERR;
+    }
+    if (n_params == 0 || !(zkey = zend_hash_index_find(params, 0)))
+    {
+        return SW_ERR;
+    }
+    key = zval_get_string(zkey);
+
+    ckey = redis_cache_command_key(command, command_len, params, n_params);
+    if ((entry = zend_hash_find_ptr(cache->entries, ckey)))
+    {
+        swRedisCacheHit *hit = emalloc(sizeof(swRedisCacheHit));
+        ZVAL_COPY(&hit->object, redis->object);
+        ZVAL_COPY(&hit->callback, callback);
+        ZVAL_COPY(&hit->result, &entry->result);
+        SwooleG.main_reactor->defer(SwooleG.main_reactor, redis_cache_onDefer, hit);
+        cache->hits++;
+        zend_string_release(ckey);
+        zend_string_release(key);
+        return SW_OK;
+    }
+
+    if (!(k = zend_hash_find_ptr(cache->keys, key)))
+    {
+        k = ecalloc(1, sizeof(swRedisCacheKey));
+        zend_hash_init(&k->commands, 4, NULL, NULL, 0);
+        zend_hash_add_ptr(cache->keys, key, k);
+    }
+    k->flights++;
+
+    f = emalloc(sizeof(swRedisCacheFlight));
+    f->cache = cache;
+    f->command = ckey;
+    f->key = key;
+    f->version = k->version;
+    cache->misses++;
+    *flight = f;
+    return SW_ERR;
+}
+
+void redis_cache_flight_free(void *data)
+{
+    swRedisCacheFlight *flight = data;
+    swRedisCacheKey *k = zend_hash_find_ptr(flight->cache->keys, flight->key);
+
+    if (k)
+    {
+        k->flights--;
+        redis_cache_key_release(flight->cache, flight->key, k);
+    }
+    zend_string_release(flight->command);
+    zend_string_release(flight->key);
+    efree(flight);
+}
+
+/**
+ * the handler of a cacheable read, the reply is kept unless the key has been invalidated in the meantime
+ */
+void redis_cache_onReply(swRedisClient *redis, swRedisRequest *request, zval *result)
+{
+    swRedisCacheFlight *flight = request->data;
+    swRedisCache *cache = flight->cache;
+    swRedisCacheKey *k;
+    zval args[2];
+
+    if (Z_TYPE_P(result) != IS_FALSE && cache->tracking && (k = zend_hash_find_ptr(cache->keys, flight->key))
+            && k->version == flight->version)
+    {
+        redis_cache_add(cache, k, flight, result);
+    }
+
+    args[0] = *redis->object;
+    args[1] = *result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, NULL, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_redis callback[Result] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+}
+
+static void redis_cache_fail(swRedisClient *redis, long code, char *msg)
+{
+    zval result;
+
+    zend_update_property_long(swoole_redis_ce, redis->object, ZEND_STRL("errCode"), code);
+    zend_update_property_string(swoole_redis_ce, redis->object, ZEND_STRL("errMsg"), msg);
+    ZVAL_FALSE(&result);
+    swoole_redis_onCompleted(redis, NULL, &result);
+}
+
+/**
+ * the reply of CLIENT TRACKING, the connection is ready with it
+ */
+static void redis_cache_onTracking(swRedisClient *redis, swRedisRequest *request, zval *result)
+{
+    swRedisCache *cache = redis->cache;
+
+    if (Z_TYPE_P(result) != IS_FALSE && (redis->protocol == 3 || (cache->invalidation && cache->invalidation->connected)))
+    {
+        cache->tracking = 1;
+    }
+    swoole_redis_onCompleted(redis, request, result);
+}
+
+/**
+ * CLIENT TRACKING ON [REDIRECT <id>] [BCAST] [PREFIX <prefix>]...
+ * the invalidations are pushed to the connection itself without the client id
+ */
+static int redis_cache_track(swRedisClient *redis, zval *client_id)
+{
+    swRedisCache *cache = redis->cache;
+    zval command, *prefix;
+    int ret;
+
+    array_init(&command);
+    add_next_index_stringl(&command, ZEND_STRL("CLIENT"));
+    add_next_index_stringl(&command, ZEND_STRL("TRACKING"));
+    add_next_index_stringl(&command, ZEND_STRL("ON"));
+    if (client_id)
+    {
+        add_next_index_stringl(&command, ZEND_STRL("REDIRECT"));
+        add_next_index_long(&command, Z_LVAL_P(client_id));
+    }
+    if (cache->broadcast)
+    {
+        add_next_index_stringl(&command, ZEND_STRL("BCAST"));
+        if (Z_TYPE(cache->prefixes) == IS_ARRAY)
+        {
+            SW_HASHTABLE_FOREACH_START(Z_ARRVAL(cache->prefixes), prefix)
+                add_next_index_stringl(&command, ZEND_STRL("PREFIX"));
+                Z_TRY_ADDREF_P(prefix);
+                add_next_index_zval(&command, prefix);
+            SW_HASHTABLE_FOREACH_END();
+        }
+    }
+    ret = redis_send_array(redis, Z_ARRVAL(command), redis_cache_onTracking, NULL);
+    zval_ptr_dtor(&command);
+    return ret;
+}
+
+/**
+ * the invalidations are redirected to the subscriber by its client id
+ */
+static void redis_cache_onClientId(swRedisClient *invalidation, swRedisRequest *request, zval *result)
+{
+    swRedisClient *redis = invalidation->hooks.data;
+    zval command;
+    int ret;
+
+    if (Z_TYPE_P(result) != IS_LONG)
+    {
+        redis_cache_fail(redis, SW_ERROR_PROTOCOL_ERROR, "failed to get the client id of the invalidations");
+        return;
+    }
+
+    array_init(&command);
+    add_next_index_stringl(&command, ZEND_STRL("SUBSCRIBE"));
+    add_next_index_stringl(&command, ZEND_STRL(SW_REDIS_CACHE_INVALIDATE_CHANNEL));
+    ret = redis_send_subscribe(invalidation, Z_ARRVAL(command));
+    zval_ptr_dtor(&command);
+    if (ret < 0)
+    {
+        redis_cache_fail(redis, ECONNRESET, "failed to subscribe the invalidations");
+        return;
+    }
+
+    if (redis_cache_track(redis, result) < 0)
+    {
+        redis_cache_fail(redis, ECONNRESET, "failed to enable the tracking");
+    }
+}
+
+static void redis_cache_onConnect(swRedisClient *invalidation, int success)
+{
+    swRedisClient *redis = invalidation->hooks.data;
+    zval command;
+    int ret;
+
+    if (!success)
+    {
+        redis_cache_fail(redis, ECONNREFUSED, "failed to connect for the invalidations");
+        return;
+    }
+    array_init(&command);
+    add_next_index_stringl(&command, ZEND_STRL("CLIENT"));
+    add_next_index_stringl(&command, ZEND_STRL("ID"));
+    ret = redis_send_array(invalidation, Z_ARRVAL(command), redis_cache_onClientId, NULL);
+    zval_ptr_dtor(&command);
+    if (ret < 0)
+    {
+        redis_cache_fail(redis, ECONNRESET, "failed to get the client id of the invalidations");
+    }
+}
+
+/**
+ * the keys of an invalidation, or null for all of them, e.g. on FLUSHALL
+ */
+void redis_cache_onInvalidate(swRedisCache *cache, zval *keys)
+{
+    zval *key;
+
+    if (!keys || Z_TYPE_P(keys) != IS_ARRAY)
+    {
+        redis_cache_flush(cache);
+        cache->invalidations++;
+        return;
+    }
+    SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(keys), key)
+        if (Z_TYPE_P(key) == IS_STRING)
+        {
+            redis_cache_invalidate(cache, Z_STR_P(key));
+        }
+    SW_HASHTABLE_FOREACH_END();
+}
+
+/**
+ * a message of the invalidation channel: ["message", "__redis__:invalidate", keys]
+ */
+static void redis_cache_onMessage(swRedisClient *invalidation, zval *message)
+{
+    swRedisClient *redis = invalidation->hooks.data;
+    zval *type, *keys;
+
+    if (Z_TYPE_P(message) != IS_ARRAY || !(type = zend_hash_index_find(Z_ARRVAL_P(message), 0)) || Z_TYPE_P(type) != IS_STRING
+            || !zend_string_equals_literal(Z_STR_P(type), "message") || !(keys = zend_hash_index_find(Z_ARRVAL_P(message), 2)))
+    {
+        return;
+    }
+    redis_cache_onInvalidate(redis->cache, keys);
+}
+
+/**
+ * nothing can be cached without the invalidations
+ */
+static void redis_cache_onClose(swRedisClient *invalidation)
+{
+    swRedisClient *redis = invalidation->hooks.data;
+    redis->cache->tracking = 0;
+    redis_cache_flush(redis->cache);
+}
+
+/**
+ * enable the tracking on the connection itself with RESP3,
+ * otherwise connect the subscriber of the invalidations to the server of the connection
+ */
+int redis_cache_start(swRedisClient *redis)
+{
+    swRedisCache *cache = redis->cache;
+    if (redis->protocol == 3)
+    {
+        return redis_cache_track(redis, NULL);
+    }
+    zval *zhost = sw_zend_read_property(swoole_redis_ce, redis->object, ZEND_STRL("host"), 1);
+    zval *zport = sw_zend_read_property(swoole_redis_ce, redis->object, ZEND_STRL("port"), 1);
+    char host[256];
+
+    if (Z_TYPE_P(zhost) != IS_STRING || Z_STRLEN_P(zhost) >= sizeof(host) - 5)
+    {
+        return SW_ERR;
+    }
+    if (!cache->invalidation)
+    {
+        zval settings;
+        zval *zobject = &cache->_invalidation;
+
+        array_init(&settings);
+        add_assoc_double(&settings, "timeout", redis->timeout);
+        if (redis->password)
+        {
+            add_assoc_stringl(&settings, "password", redis->password, redis->password_len);
+        }
+        object_init_ex(zobject, swoole_redis_ce);
+        zend_call_method_with_1_params(zobject, swoole_redis_ce, NULL, "__construct", NULL, &settings);
+        zval_ptr_dtor(&settings);
+
+        cache->invalidation = swoole_get_object(zobject);
+        cache->invalidation->hooks.data = redis;
+        cache->invalidation->hooks.onConnect = redis_cache_onConnect;
+        cache->invalidation->hooks.onClose = redis_cache_onClose;
+        cache->invalidation->hooks.onMessage = redis_cache_onMessage;
+    }
+    // the path of a unix socket has lost its scheme
+    sw_snprintf(host, sizeof(host), Z_STRVAL_P(zhost)[0] == '/' ? "unix:%s" : "%s", Z_STRVAL_P(zhost));
+    return redis_connect(cache->invalidation, host, zval_get_long(zport));
+}
+
+/**
+ * the connection is closed, the tracking of its keys is over
+ */
+void redis_cache_reset(swRedisClient *redis)
+{
+    swRedisCache *cache = redis->cache;
+
+    cache->tracking = 0;
+    redis_cache_flush(cache);
+    if (cache->invalidation && cache->invalidation->cli)
+    {
+        redis_close(cache->invalidation);
+    }
+}
+
+void redis_cache_stats(swRedisCache *cache, zval *return_value)
+{
+    uint64_t lookups = cache->hits + cache->misses;
+
+    array_init(return_value);
+    add_assoc_bool(return_value, "tracking", cache->tracking);
+    add_assoc_long(return_value, "hits", cache->hits);
+    add_assoc_long(return_value, "misses", cache->misses);
+    add_assoc_double(return_value, "hit_ratio", lookups ? (double) cache->hits / lookups : 0);
+    add_assoc_long(return_value, "invalidations", cache->invalidations);
+    add_assoc_long(return_value, "evictions", cache->evictions);
+    add_assoc_long(return_value, "entries", zend_hash_num_elements(cache->entries));
+    add_assoc_long(return_value, "memory", cache->memory);
+    add_assoc_long(return_value, "memory_limit", cache->memory_limit);
+}
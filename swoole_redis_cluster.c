@@ -0,0 +1,1193 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole_async.h"
+#include "swoole_redis_async.h"
+
+#define SW_REDIS_CLUSTER_SLOTS           16384
+#define SW_REDIS_CLUSTER_MAX_REDIRECTS   5
+
+enum swRedisClusterState
+{
+    SW_REDIS_CLUSTER_CLOSED,
+    SW_REDIS_CLUSTER_CONNECT,
+    SW_REDIS_CLUSTER_READY,
+};
+
+enum swRedisClusterNodeState
+{
+    SW_REDIS_CLUSTER_NODE_CLOSED,
+    SW_REDIS_CLUSTER_NODE_CONNECTING,
+    SW_REDIS_CLUSTER_NODE_READY,
+};
+
+/**
+ * how the replies of the parts of a command split by slot are put together
+ */
+enum swRedisClusterReply
+{
+    SW_REDIS_CLUSTER_REPLY_ONE, /* not split */
+    SW_REDIS_CLUSTER_REPLY_VALUES, /* MGET, the values are put back to the positions of their keys */
+    SW_REDIS_CLUSTER_REPLY_SUM, /* DEL, UNLINK, EXISTS, TOUCH */
+    SW_REDIS_CLUSTER_REPLY_OK, /* MSET */
+};
+
+typedef struct _swRedisCluster swRedisCluster;
+
+typedef struct
+{
+    swRedisCluster *cluster;
+    swRedisClient *redis; /* created with the first connection, then reused */
+    char *host;
+    long port;
+    uint8_t state;
+    swLinkedList *waiting; /* the commands waiting for the connection */
+    zval _object;
+} swRedisClusterNode;
+
+typedef struct
+{
+    zval *callback;
+    uint8_t reply;
+    uint8_t failed;
+    uint32_t remaining; /* the parts waiting for their replies */
+    zval result;
+    zval *values;
+    uint32_t n_values;
+    long sum;
+} swRedisClusterRequest;
+
+/**
+ * the part of a request with the keys of a slot, CLUSTER SLOTS has no request
+ */
+typedef struct
+{
+    swRedisClusterRequest *request;
+    zval command;
+    uint16_t slot;
+    uint8_t redirects;
+    uint8_t asking; /* ASKING is sent before the command */
+    uint32_t *positions; /* of the keys of MGET */
+    uint32_t n_positions;
+} swRedisClusterCommand;
+
+struct _swRedisCluster
+{
+    uint8_t state;
+    uint8_t refreshing;
+    zval *object;
+    zval *callback;
+    zval settings; /* of the node connections */
+    zend_string **seeds;
+    uint32_t seed_count;
+    uint32_t seed_index;
+    HashTable *nodes;
+    swRedisClusterNode **slots;
+    zval _object;
+};
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_cluster_construct, 0, 0, 1)
+    ZEND_ARG_ARRAY_INFO(0, seeds, 0)
+    ZEND_ARG_ARRAY_INFO(0, setting, 1)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_cluster_connect, 0, 0, 1)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_redis_cluster_call, 0, 0, 2)
+    ZEND_ARG_INFO(0, command)
+    ZEND_ARG_INFO(0, params)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_void, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+static PHP_METHOD(swoole_redis_cluster, __construct);
+static PHP_METHOD(swoole_redis_cluster, __destruct);
+static PHP_METHOD(swoole_redis_cluster, connect);
+static PHP_METHOD(swoole_redis_cluster, __call);
+static PHP_METHOD(swoole_redis_cluster, close);
+
+static void redis_cluster_dispatch(swRedisCluster *cluster, swRedisClusterNode *node, swRedisClusterCommand *command);
+static void redis_cluster_onReply(swRedisClient *redis, swRedisRequest *request, zval *result);
+
+zend_class_entry *swoole_redis_cluster_ce;
+static zend_object_handlers swoole_redis_cluster_handlers;
+
+static uint16_t redis_cluster_crc16_table[256];
+
+static const zend_function_entry swoole_redis_cluster_methods[] =
+{
+    PHP_ME(swoole_redis_cluster, __construct, arginfo_swoole_redis_cluster_construct, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_redis_cluster, __destruct, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_redis_cluster, connect, arginfo_swoole_redis_cluster_connect, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_redis_cluster, __call, arginfo_swoole_redis_cluster_call, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_redis_cluster, close, arginfo_swoole_void, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void swoole_redis_cluster_init(int module_number)
+{
+    int i, j;
+    uint16_t crc;
+
+    SW_INIT_CLASS_ENTRY(swoole_redis_cluster, "Swoole\\Redis\\Cluster", "swoole_redis_cluster", NULL, swoole_redis_cluster_methods);
+    SW_SET_CLASS_SERIALIZABLE(swoole_redis_cluster, zend_class_serialize_deny, zend_class_unserialize_deny);
+    SW_SET_CLASS_CLONEABLE(swoole_redis_cluster, sw_zend_class_clone_deny);
+    SW_SET_CLASS_UNSET_PROPERTY_HANDLER(swoole_redis_cluster, sw_zend_class_unset_property_deny);
+
+    zend_declare_property_null(swoole_redis_cluster_ce, ZEND_STRL("setting"), ZEND_ACC_PUBLIC);
+    zend_declare_property_long(swoole_redis_cluster_ce, ZEND_STRL("errCode"), 0, ZEND_ACC_PUBLIC);
+    zend_declare_property_string(swoole_redis_cluster_ce, ZEND_STRL("errMsg"), "", ZEND_ACC_PUBLIC);
+
+    // CRC16-CCITT (XMODEM), as the key hash slot of the cluster
+    for (i = 0; i < 256; i++)
+    {
+        crc = i << 8;
+        for (j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+        redis_cluster_crc16_table[i] = crc;
+    }
+}
+
+/**
+ * only the part of the key in the first {...} is hashed, if it is not empty
+ */
+static uint16_t redis_cluster_key_slot(char *key, size_t length)
+{
+    char *start, *end;
+    uint16_t crc = 0;
+    size_t i;
+
+    if ((start = memchr(key, '{', length)) && (end = memchr(start + 1, '}', length - (start + 1 - key))) && end > start + 1)
+    {
+        key = start + 1;
+        length = end - key;
+    }
+    for (i = 0; i < length; i++)
+    {
+        crc = (crc << 8) ^ redis_cluster_crc16_table[((crc >> 8) ^ (uint8_t) key[i]) & 0xff];
+    }
+    return crc & (SW_REDIS_CLUSTER_SLOTS - 1);
+}
+
+static uint16_t redis_cluster_zval_slot(zval *key)
+{
+    zend_string *str = zval_get_string(key);
+    uint16_t slot = redis_cluster_key_slot(ZSTR_VAL(str), ZSTR_LEN(str));
+    zend_string_release(str);
+    return slot;
+}
+
+static sw_inline int redis_cluster_is_command(char *name, size_t name_len, const char *command)
+{
+    return name_len == strlen(command) && strncasecmp(name, command, name_len) == 0;
+}
+
+/**
+ * the slot of a command which is not split, -1 if it has no key and can be sent to any node
+ */
+static int redis_cluster_command_slot(char *name, size_t name_len, zval **args, uint32_t n_args)
+{
+    uint32_t key = 0;
+
+    if (redis_cluster_is_command(name, name_len, "EVAL") || redis_cluster_is_command(name, name_len, "EVALSHA"))
+    {
+        // script numkeys key [key ...] arg [arg ...]
+        if (n_args < 3 || zval_get_long(args[1]) <= 0)
+        {
+            return -1;
+        }
+        key = 2;
+    }
+    else if (redis_cluster_is_command(name, name_len, "XREAD") || redis_cluster_is_command(name, name_len, "XREADGROUP"))
+    {
+        for (key = 0; key < n_args; key++)
+        {
+            if (Z_TYPE_P(args[key]) == IS_STRING && redis_cluster_is_command(Z_STRVAL_P(args[key]), Z_STRLEN_P(args[key]), "STREAMS"))
+            {
+                break;
+            }
+        }
+        key++;
+    }
+    else if (redis_cluster_is_command(name, name_len, "OBJECT") || redis_cluster_is_command(name, name_len, "MEMORY"))
+    {
+        key = 1;
+    }
+    else if (redis_cluster_is_command(name, name_len, "ECHO") || redis_cluster_is_command(name, name_len, "INFO")
+            || redis_cluster_is_command(name, name_len, "SCRIPT") || redis_cluster_is_command(name, name_len, "CLUSTER")
+            || redis_cluster_is_command(name, name_len, "CONFIG") || redis_cluster_is_command(name, name_len, "CLIENT")
+            || redis_cluster_is_command(name, name_len, "COMMAND"))
+    {
+        return -1;
+    }
+    if (key >= n_args)
+    {
+        return -1;
+    }
+    return redis_cluster_zval_slot(args[key]);
+}
+
+/**
+ * the multi-key commands which are split by slot, with the number of the arguments of each key
+ */
+static uint32_t redis_cluster_split_step(char *name, size_t name_len, uint8_t *reply)
+{
+    if (redis_cluster_is_command(name, name_len, "MGET"))
+    {
+        *reply = SW_REDIS_CLUSTER_REPLY_VALUES;
+        return 1;
+    }
+    if (redis_cluster_is_command(name, name_len, "DEL") || redis_cluster_is_command(name, name_len, "UNLINK")
+            || redis_cluster_is_command(name, name_len, "EXISTS") || redis_cluster_is_command(name, name_len, "TOUCH"))
+    {
+        *reply = SW_REDIS_CLUSTER_REPLY_SUM;
+        return 1;
+    }
+    if (redis_cluster_is_command(name, name_len, "MSET"))
+    {
+        *reply = SW_REDIS_CLUSTER_REPLY_OK;
+        return 2;
+    }
+    *reply = SW_REDIS_CLUSTER_REPLY_ONE;
+    return 0;
+}
+
+static void redis_cluster_error(swRedisCluster *cluster, long code, char *msg)
+{
+    zend_update_property_long(swoole_redis_cluster_ce, cluster->object, ZEND_STRL("errCode"), code);
+    zend_update_property_string(swoole_redis_cluster_ce, cluster->object, ZEND_STRL("errMsg"), msg);
+}
+
+/**
+ * the error of a node connection is the error of the cluster
+ */
+static void redis_cluster_node_error(swRedisCluster *cluster, swRedisClusterNode *node)
+{
+    zval *zerrcode = sw_zend_read_property(swoole_redis_ce, &node->_object, ZEND_STRL("errCode"), 1);
+    zval *zerrmsg = sw_zend_read_property(swoole_redis_ce, &node->_object, ZEND_STRL("errMsg"), 1);
+    zend_update_property_long(swoole_redis_cluster_ce, cluster->object, ZEND_STRL("errCode"), zval_get_long(zerrcode));
+    zend_update_property(swoole_redis_cluster_ce, cluster->object, ZEND_STRL("errMsg"), zerrmsg);
+}
+
+static swRedisClusterNode* redis_cluster_node_get(swRedisCluster *cluster, char *host, size_t host_len, long port)
+{
+    swRedisClusterNode *node;
+    char name[256];
+    int n;
+
+    if (host_len == 0 || host_len > 200 || port <= 0 || port > 65535)
+    {
+        return NULL;
+    }
+    n = sw_snprintf(name, sizeof(name), "%.*s:%ld", (int) host_len, host, port);
+    if ((node = zend_hash_str_find_ptr(cluster->nodes, name, n)))
+    {
+        return node;
+    }
+    node = ecalloc(1, sizeof(swRedisClusterNode));
+    node->cluster = cluster;
+    node->host = estrndup(host, host_len);
+    node->port = port;
+    node->waiting = swLinkedList_new(0, NULL);
+    zend_hash_str_add_ptr(cluster->nodes, name, n, node);
+    return node;
+}
+
+/**
+ * the node of an address as "host:port"
+ */
+static swRedisClusterNode* redis_cluster_node_get_address(swRedisCluster *cluster, char *address, size_t length)
+{
+    char *colon = zend_memrchr(address, ':', length);
+    if (!colon)
+    {
+        return NULL;
+    }
+    return redis_cluster_node_get(cluster, address, colon - address, ZEND_STRTOL(colon + 1, NULL, 10));
+}
+
+static swRedisClusterNode* redis_cluster_node_ready(swRedisCluster *cluster)
+{
+    swRedisClusterNode *node;
+
+    ZEND_HASH_FOREACH_PTR(cluster->nodes, node)
+    {
+        if (node->state == SW_REDIS_CLUSTER_NODE_READY)
+        {
+            return node;
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+    return NULL;
+}
+
+static void redis_cluster_node_free(swRedisClusterNode *node)
+{
+    if (node->redis)
+    {
+        bzero(&node->redis->hooks, sizeof(node->redis->hooks));
+        zval_ptr_dtor(&node->_object);
+    }
+    swLinkedList_free(node->waiting);
+    efree(node->host);
+    efree(node);
+}
+
+static swRedisClusterCommand* redis_cluster_command_new(swRedisClusterRequest *request, char *name, size_t name_len)
+{
+    swRedisClusterCommand *command = ecalloc(1, sizeof(swRedisClusterCommand));
+    command->request = request;
+    array_init(&command->command);
+    add_next_index_stringl(&command->command, name, name_len);
+    return command;
+}
+
+static void redis_cluster_command_free(swRedisClusterCommand *command)
+{
+    zval_ptr_dtor(&command->command);
+    if (command->positions)
+    {
+        efree(command->positions);
+    }
+    efree(command);
+}
+
+static swRedisClusterRequest* redis_cluster_request_new(zval *callback, uint8_t reply)
+{
+    swRedisClusterRequest *request = ecalloc(1, sizeof(swRedisClusterRequest));
+    Z_TRY_ADDREF_P(callback);
+    request->callback = sw_zval_dup(callback);
+    request->reply = reply;
+    return request;
+}
+
+static void redis_cluster_request_free(swRedisClusterRequest *request)
+{
+    uint32_t i;
+
+    if (request->values)
+    {
+        for (i = 0; i < request->n_values; i++)
+        {
+            zval_ptr_dtor(&request->values[i]);
+        }
+        efree(request->values);
+    }
+    zval_ptr_dtor(&request->result);
+    sw_zval_free(request->callback);
+    efree(request);
+}
+
+/**
+ * a part of the request has got its reply, the callback is called with the whole result after the last one
+ */
+static void redis_cluster_request_done(swRedisCluster *cluster, swRedisClusterRequest *request)
+{
+    zval *retval = NULL;
+    zval result;
+    uint32_t i;
+
+    if (--request->remaining > 0)
+    {
+        return;
+    }
+
+    if (request->failed)
+    {
+        ZVAL_FALSE(&result);
+    }
+    else
+    {
+        switch (request->reply)
+        {
+        case SW_REDIS_CLUSTER_REPLY_VALUES:
+            array_init_size(&result, request->n_values);
+            for (i = 0; i < request->n_values; i++)
+            {
+                if (Z_TYPE(request->values[i]) == IS_UNDEF)
+                {
+                    add_next_index_null(&result);
+                }
+                else
+                {
+                    add_next_index_zval(&result, &request->values[i]);
+                    ZVAL_UNDEF(&request->values[i]);
+                }
+            }
+            break;
+        case SW_REDIS_CLUSTER_REPLY_SUM:
+            ZVAL_LONG(&result, request->sum);
+            break;
+        case SW_REDIS_CLUSTER_REPLY_OK:
+            ZVAL_TRUE(&result);
+            break;
+        default:
+            ZVAL_COPY_VALUE(&result, &request->result);
+            ZVAL_UNDEF(&request->result);
+            break;
+        }
+    }
+
+    zval args[2];
+    args[0] = *cluster->object;
+    args[1] = result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, &retval, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_redis_cluster callback[Result] handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    if (retval)
+    {
+        zval_ptr_dtor(retval);
+    }
+    zval_ptr_dtor(&result);
+    redis_cluster_request_free(request);
+}
+
+static void redis_cluster_execute_connect_callback(swRedisCluster *cluster, int success)
+{
+    zval *retval = NULL;
+    zval *callback = cluster->callback;
+    zval args[2];
+
+    cluster->callback = NULL;
+    args[0] = *cluster->object;
+    ZVAL_BOOL(&args[1], success);
+    if (sw_call_user_function_ex(EG(function_table), NULL, callback, &retval, 2, args, 0, NULL) != SUCCESS)
+    {
+        php_swoole_fatal_error(E_WARNING, "swoole_redis_cluster connect_callback handler error.");
+    }
+    if (UNEXPECTED(EG(exception)))
+    {
+        zend_exception_error(EG(exception), E_ERROR);
+    }
+    if (retval)
+    {
+        zval_ptr_dtor(retval);
+    }
+    sw_zval_free(callback);
+}
+
+/**
+ * close the connections of all the nodes, the commands without reply get false
+ */
+static void redis_cluster_close(swRedisCluster *cluster)
+{
+    swRedisClusterNode *node;
+
+    cluster->state = SW_REDIS_CLUSTER_CLOSED;
+    cluster->refreshing = 0;
+    ZEND_HASH_FOREACH_PTR(cluster->nodes, node)
+    {
+        if (node->redis && node->state != SW_REDIS_CLUSTER_NODE_CLOSED)
+        {
+            redis_close(node->redis);
+        }
+    }
+    ZEND_HASH_FOREACH_END();
+}
+
+static int redis_cluster_load_slots(swRedisCluster *cluster, swRedisClusterNode *source, zval *reply)
+{
+    swRedisClusterNode *node;
+    zval *entry, *zstart, *zend, *zmaster, *zhost, *zport;
+    long start, end, i;
+    int n = 0;
+
+    // [[start, end, [host, port, id], [replica host, port, id]...]...]
+    SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(reply), entry)
+        if (Z_TYPE_P(entry) != IS_ARRAY || !(zstart = zend_hash_index_find(Z_ARRVAL_P(entry), 0))
+                || !(zend = zend_hash_index_find(Z_ARRVAL_P(entry), 1)) || !(zmaster = zend_hash_index_find(Z_ARRVAL_P(entry), 2))
+                || Z_TYPE_P(zmaster) != IS_ARRAY || !(zhost = zend_hash_index_find(Z_ARRVAL_P(zmaster), 0))
+                || Z_TYPE_P(zhost) != IS_STRING || !(zport = zend_hash_index_find(Z_ARRVAL_P(zmaster), 1)))
+        {
+            continue;
+        }
+        start = zval_get_long(zstart);
+        end = zval_get_long(zend);
+        if (start < 0 || end >= SW_REDIS_CLUSTER_SLOTS || start > end)
+        {
+            continue;
+        }
+        // an empty host is the host which has given the map
+        if (Z_STRLEN_P(zhost) > 0)
+        {
+            node = redis_cluster_node_get(cluster, Z_STRVAL_P(zhost), Z_STRLEN_P(zhost), zval_get_long(zport));
+        }
+        else
+        {
+            node = redis_cluster_node_get(cluster, source->host, strlen(source->host), zval_get_long(zport));
+        }
+        if (!node)
+        {
+            continue;
+        }
+        for (i = start; i <= end; i++)
+        {
+            cluster->slots[i] = node;
+        }
+        n++;
+    SW_HASHTABLE_FOREACH_END();
+
+    return n > 0 ? SW_OK : SW_ERR;
+}
+
+static swRedisClusterCommand* redis_cluster_slots_command_new()
+{
+    swRedisClusterCommand *command = redis_cluster_command_new(NULL, ZEND_STRL("CLUSTER"));
+    add_next_index_stringl(&command->command, ZEND_STRL("SLOTS"));
+    return command;
+}
+
+/**
+ * load the slot map from the first seed node which gives it
+ */
+static void redis_cluster_connect_seed(swRedisCluster *cluster)
+{
+    zend_string *seed = cluster->seeds[cluster->seed_index];
+    swRedisClusterNode *node = redis_cluster_node_get_address(cluster, ZSTR_VAL(seed), ZSTR_LEN(seed));
+    redis_cluster_dispatch(cluster, node, redis_cluster_slots_command_new());
+}
+
+/**
+ * the map is loaded again on a MOVED redirection or a lost node, from a connected node
+ */
+static void redis_cluster_refresh(swRedisCluster *cluster)
+{
+    swRedisClusterNode *node;
+
+    if (cluster->refreshing || cluster->state != SW_REDIS_CLUSTER_READY || !(node = redis_cluster_node_ready(cluster)))
+    {
+        return;
+    }
+    cluster->refreshing = 1;
+    redis_cluster_dispatch(cluster, node, redis_cluster_slots_command_new());
+}
+
+static void redis_cluster_onSlots(swRedisCluster *cluster, swRedisClusterNode *source, zval *result)
+{
+    int ret = SW_ERR;
+
+    if (Z_TYPE_P(result) == IS_ARRAY)
+    {
+        ret = redis_cluster_load_slots(cluster, source, result);
+        if (ret < 0)
+        {
+            redis_cluster_error(cluster, SW_ERROR_PROTOCOL_ERROR, "no slot is served by the cluster");
+        }
+    }
+    cluster->refreshing = 0;
+    if (cluster->state != SW_REDIS_CLUSTER_CONNECT)
+    {
+        return;
+    }
+    if (ret == SW_OK)
+    {
+        cluster->state = SW_REDIS_CLUSTER_READY;
+        redis_cluster_execute_connect_callback(cluster, 1);
+    }
+    else if (++cluster->seed_index < cluster->seed_count)
+    {
+        redis_cluster_connect_seed(cluster);
+    }
+    else
+    {
+        zval _zobject = *cluster->object;
+        redis_cluster_close(cluster);
+        redis_cluster_execute_connect_callback(cluster, 0);
+        zval_ptr_dtor(&_zobject);
+    }
+}
+
+/**
+ * the reply of a part, the errors have been set to the cluster
+ */
+static void redis_cluster_command_reply(swRedisCluster *cluster, swRedisClusterNode *node, swRedisClusterCommand *command, zval *result)
+{
+    swRedisClusterRequest *request = command->request;
+    zval *value;
+    uint32_t i = 0;
+
+    if (!request)
+    {
+        redis_cluster_command_free(command);
+        redis_cluster_onSlots(cluster, node, result);
+        return;
+    }
+
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        request->failed = 1;
+    }
+    else
+    {
+        switch (request->reply)
+        {
+        case SW_REDIS_CLUSTER_REPLY_VALUES:
+            if (Z_TYPE_P(result) != IS_ARRAY)
+            {
+                break;
+            }
+            SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(result), value)
+                if (i == command->n_positions)
+                {
+                    break;
+                }
+                ZVAL_COPY(&request->values[command->positions[i++]], value);
+            SW_HASHTABLE_FOREACH_END();
+            break;
+        case SW_REDIS_CLUSTER_REPLY_SUM:
+            request->sum += zval_get_long(result);
+            break;
+        case SW_REDIS_CLUSTER_REPLY_OK:
+            break;
+        default:
+            ZVAL_COPY(&request->result, result);
+            break;
+        }
+    }
+    redis_cluster_command_free(command);
+    redis_cluster_request_done(cluster, request);
+}
+
+static void redis_cluster_onAsking(swRedisClient *redis, swRedisRequest *request, zval *result)
+{
+    // a failed ASKING makes the command get the redirection again
+}
+
+static int redis_cluster_send(swRedisClusterNode *node, swRedisClusterCommand *command)
+{
+    if (command->asking)
+    {
+        zval asking;
+        int ret;
+
+        array_init(&asking);
+        add_next_index_stringl(&asking, ZEND_STRL("ASKING"));
+        ret = redis_send_array(node->redis, Z_ARRVAL(asking), redis_cluster_onAsking, NULL);
+        zval_ptr_dtor(&asking);
+        if (ret < 0)
+        {
+            return SW_ERR;
+        }
+        command->asking = 0;
+    }
+    return redis_send_array(node->redis, Z_ARRVAL(command->command), redis_cluster_onReply, command);
+}
+
+/**
+ * the commands waiting for the connection of the node get false
+ */
+static void redis_cluster_node_fail(swRedisClusterNode *node)
+{
+    swRedisClusterCommand *command;
+    zval result;
+
+    while ((command = swLinkedList_shift(node->waiting)))
+    {
+        ZVAL_FALSE(&result);
+        redis_cluster_command_reply(node->cluster, node, command, &result);
+    }
+}
+
+static void redis_cluster_node_onConnect(swRedisClient *redis, int success)
+{
+    swRedisClusterNode *node = redis->hooks.data;
+    swRedisCluster *cluster = node->cluster;
+    swRedisClusterCommand *command;
+    zval _zobject = *cluster->object;
+    zval result;
+
+    // the callbacks may release the last reference of the cluster
+    Z_TRY_ADDREF(_zobject);
+    if (!success)
+    {
+        node->state = SW_REDIS_CLUSTER_NODE_CLOSED;
+        redis_cluster_node_error(cluster, node);
+        redis_cluster_node_fail(node);
+    }
+    else
+    {
+        node->state = SW_REDIS_CLUSTER_NODE_READY;
+        while ((command = swLinkedList_shift(node->waiting)))
+        {
+            if (redis_cluster_send(node, command) < 0)
+            {
+                ZVAL_FALSE(&result);
+                redis_cluster_error(cluster, ECONNRESET, "failed to send the redis command");
+                redis_cluster_command_reply(cluster, node, command, &result);
+            }
+        }
+    }
+    zval_ptr_dtor(&_zobject);
+}
+
+static void redis_cluster_node_onClose(swRedisClient *redis)
+{
+    swRedisClusterNode *node = redis->hooks.data;
+    swRedisCluster *cluster = node->cluster;
+    uint8_t state = node->state;
+    zval _zobject = *cluster->object;
+
+    Z_TRY_ADDREF(_zobject);
+    node->state = SW_REDIS_CLUSTER_NODE_CLOSED;
+    if (node->waiting->num > 0)
+    {
+        redis_cluster_error(cluster, ECONNRESET, "connection closed before the reply");
+        redis_cluster_node_fail(node);
+    }
+    // the node may have failed over to a replica
+    if (state == SW_REDIS_CLUSTER_NODE_READY)
+    {
+        redis_cluster_refresh(cluster);
+    }
+    zval_ptr_dtor(&_zobject);
+}
+
+static int redis_cluster_node_connect(swRedisClusterNode *node)
+{
+    if (!node->redis)
+    {
+        zval *zobject = &node->_object;
+        object_init_ex(zobject, swoole_redis_ce);
+        zend_call_method_with_1_params(zobject, swoole_redis_ce, NULL, "__construct", NULL, &node->cluster->settings);
+        node->redis = swoole_get_object(zobject);
+        node->redis->hooks.data = node;
+        node->redis->hooks.onConnect = redis_cluster_node_onConnect;
+        node->redis->hooks.onClose = redis_cluster_node_onClose;
+    }
+    if (redis_connect(node->redis, node->host, node->port) < 0)
+    {
+        return SW_ERR;
+    }
+    node->state = SW_REDIS_CLUSTER_NODE_CONNECTING;
+    return SW_OK;
+}
+
+/**
+ * send the command to the node, or any node if it is not known, the node is connected on demand
+ */
+static void redis_cluster_dispatch(swRedisCluster *cluster, swRedisClusterNode *node, swRedisClusterCommand *command)
+{
+    zval result;
+
+    // a connected node for the commands without key, or when the slot is not served
+    if (!node && !(node = redis_cluster_node_ready(cluster)))
+    {
+        redis_cluster_error(cluster, SW_ERROR_PROTOCOL_ERROR, "no node serves the slot");
+        goto _fail;
+    }
+
+    switch (node->state)
+    {
+    case SW_REDIS_CLUSTER_NODE_READY:
+        if (redis_cluster_send(node, command) == SW_OK)
+        {
+            return;
+        }
+        redis_cluster_error(cluster, ECONNRESET, "failed to send the redis command");
+        goto _fail;
+    case SW_REDIS_CLUSTER_NODE_CONNECTING:
+        swLinkedList_append(node->waiting, command);
+        return;
+    default:
+        if (redis_cluster_node_connect(node) < 0)
+        {
+            redis_cluster_error(cluster, ECONNREFUSED, "failed to connect to the redis node");
+            goto _fail;
+        }
+        swLinkedList_append(node->waiting, command);
+        return;
+    }
+
+    _fail:
+    ZVAL_FALSE(&result);
+    redis_cluster_command_reply(cluster, node, command, &result);
+}
+
+/**
+ * MOVED updates the slot map, ASK is only for the next command,
+ * the command is sent to the node given by the redirection
+ * @return whether the error reply is a redirection
+ */
+static int redis_cluster_redirect(swRedisCluster *cluster, swRedisClusterCommand *command, zend_string *error)
+{
+    swRedisClusterNode *target;
+    zend_bool moved;
+    char *msg, *address;
+    long slot;
+
+    if (!error || command->redirects == SW_REDIS_CLUSTER_MAX_REDIRECTS)
+    {
+        return SW_FALSE;
+    }
+    msg = ZSTR_VAL(error);
+    if (ZSTR_LEN(error) > 6 && strncmp(msg, "MOVED ", 6) == 0)
+    {
+        moved = 1;
+        msg += 6;
+    }
+    else if (ZSTR_LEN(error) > 4 && strncmp(msg, "ASK ", 4) == 0)
+    {
+        moved = 0;
+        msg += 4;
+    }
+    else
+    {
+        return SW_FALSE;
+    }
+
+    // <slot> <host>:<port>
+    slot = ZEND_STRTOL(msg, &address, 10);
+    if (*address != ' ' || slot < 0 || slot >= SW_REDIS_CLUSTER_SLOTS)
+    {
+        return SW_FALSE;
+    }
+    address++;
+    if (!(target = redis_cluster_node_get_address(cluster, address, ZSTR_VAL(error) + ZSTR_LEN(error) - address)))
+    {
+        return SW_FALSE;
+    }
+
+    command->redirects++;
+    if (moved)
+    {
+        cluster->slots[slot] = target;
+        redis_cluster_refresh(cluster);
+    }
+    else
+    {
+        command->asking = 1;
+    }
+    redis_cluster_dispatch(cluster, target, command);
+    return SW_TRUE;
+}
+
+static void redis_cluster_onReply(swRedisClient *redis, swRedisRequest *request, zval *result)
+{
+    swRedisClusterNode *node = redis->hooks.data;
+    swRedisCluster *cluster = node->cluster;
+    swRedisClusterCommand *command = request->data;
+    zval _zobject = *cluster->object;
+
+    Z_TRY_ADDREF(_zobject);
+    if (Z_TYPE_P(result) == IS_FALSE)
+    {
+        // the simple and the blob errors of RESP3 alike
+        if (cluster->state != SW_REDIS_CLUSTER_CLOSED && redis_cluster_redirect(cluster, command, redis->reader.error))
+        {
+            goto _end;
+        }
+        redis_cluster_node_error(cluster, node);
+    }
+    redis_cluster_command_reply(cluster, node, command, result);
+
+    _end:
+    zval_ptr_dtor(&_zobject);
+}
+
+static PHP_METHOD(swoole_redis_cluster, __construct)
+{
+    zval *seeds;
+    zval *options = NULL;
+    zval *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "a|a", &seeds, &options) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    swRedisCluster *cluster = ecalloc(1, sizeof(swRedisCluster));
+    cluster->object = getThis();
+
+    // the settings of the node connections
+    array_init(&cluster->settings);
+    if (options)
+    {
+        zend_update_property(swoole_redis_cluster_ce, getThis(), ZEND_STRL("setting"), options);
+        HashTable *vht = Z_ARRVAL_P(options);
+        if (php_swoole_array_get_value(vht, "timeout", value))
+        {
+            add_assoc_double(&cluster->settings, "timeout", zval_get_double(value));
+        }
+        if (php_swoole_array_get_value(vht, "password", value))
+        {
+            Z_TRY_ADDREF_P(value);
+            add_assoc_zval(&cluster->settings, "password", value);
+        }
+    }
+
+    cluster->seeds = emalloc(sizeof(zend_string *) * MAX(1, zend_hash_num_elements(Z_ARRVAL_P(seeds))));
+    SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(seeds), value)
+        zend_string *seed = zval_get_string(value);
+        char *colon = zend_memrchr(ZSTR_VAL(seed), ':', ZSTR_LEN(seed));
+        if (!colon || colon == ZSTR_VAL(seed) || ZEND_STRTOL(colon + 1, NULL, 10) <= 0)
+        {
+            php_swoole_fatal_error(E_WARNING, "invalid seed node[%s], it must be host:port.", ZSTR_VAL(seed));
+            zend_string_release(seed);
+            continue;
+        }
+        cluster->seeds[cluster->seed_count++] = seed;
+    SW_HASHTABLE_FOREACH_END();
+
+    ALLOC_HASHTABLE(cluster->nodes);
+    zend_hash_init(cluster->nodes, 8, NULL, NULL, 0);
+    cluster->slots = ecalloc(SW_REDIS_CLUSTER_SLOTS, sizeof(swRedisClusterNode *));
+
+    sw_copy_to_stack(cluster->object, cluster->_object);
+    swoole_set_object(getThis(), cluster);
+}
+
+static PHP_METHOD(swoole_redis_cluster, connect)
+{
+    zval *callback;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    swRedisCluster *cluster = swoole_get_object(getThis());
+    if (cluster->state != SW_REDIS_CLUSTER_CLOSED)
+    {
+        php_swoole_error(E_WARNING, "redis cluster is already connected.");
+        RETURN_FALSE;
+    }
+    if (cluster->seed_count == 0)
+    {
+        php_swoole_fatal_error(E_WARNING, "no seed node is given.");
+        RETURN_FALSE;
+    }
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    Z_TRY_ADDREF_P(callback);
+    cluster->callback = sw_zval_dup(callback);
+    cluster->state = SW_REDIS_CLUSTER_CONNECT;
+    cluster->seed_index = 0;
+    // the cluster keeps itself alive until it is closed
+    Z_TRY_ADDREF_P(cluster->object);
+
+    redis_cluster_connect_seed(cluster);
+    RETURN_TRUE;
+}
+
+/**
+ * split the keys of the command by slot, or send it to the node of its key
+ */
+static void redis_cluster_execute(swRedisCluster *cluster, char *name, size_t name_len, zval **args, uint32_t n_args, zval *callback)
+{
+    swRedisClusterCommand *command;
+    uint8_t reply;
+    uint32_t step = redis_cluster_split_step(name, name_len, &reply);
+    uint32_t i, j;
+    int slot;
+
+    if (step == 0 || n_args <= step || n_args % step != 0)
+    {
+        reply = SW_REDIS_CLUSTER_REPLY_ONE;
+    }
+
+    swRedisClusterRequest *request = redis_cluster_request_new(callback, reply);
+    // the request is held until all the parts are sent, as a part may fail at once
+    request->remaining = 1;
+
+    if (reply == SW_REDIS_CLUSTER_REPLY_ONE)
+    {
+        command = redis_cluster_command_new(request, name, name_len);
+        for (i = 0; i < n_args; i++)
+        {
+            Z_TRY_ADDREF_P(args[i]);
+            add_next_index_zval(&command->command, args[i]);
+        }
+        slot = redis_cluster_command_slot(name, name_len, args, n_args);
+        request->remaining++;
+        redis_cluster_dispatch(cluster, slot < 0 ? NULL : cluster->slots[slot], command);
+    }
+    else
+    {
+        HashTable parts;
+        zend_hash_init(&parts, 8, NULL, NULL, 0);
+
+        if (reply == SW_REDIS_CLUSTER_REPLY_VALUES)
+        {
+            request->n_values = n_args;
+            request->values = ecalloc(n_args, sizeof(zval));
+        }
+        for (i = 0; i < n_args; i += step)
+        {
+            slot = redis_cluster_zval_slot(args[i]);
+            if (!(command = zend_hash_index_find_ptr(&parts, slot)))
+            {
+                command = redis_cluster_command_new(request, name, name_len);
+                command->slot = slot;
+                if (reply == SW_REDIS_CLUSTER_REPLY_VALUES)
+                {
+                    command->positions = emalloc(sizeof(uint32_t) * n_args);
+                }
+                zend_hash_index_add_new_ptr(&parts, slot, command);
+            }
+            if (command->positions)
+            {
+                command->positions[command->n_positions++] = i;
+            }
+            for (j = 0; j < step; j++)
+            {
+                Z_TRY_ADDREF_P(args[i + j]);
+                add_next_index_zval(&command->command, args[i + j]);
+            }
+        }
+        request->remaining += zend_hash_num_elements(&parts);
+        ZEND_HASH_FOREACH_PTR(&parts, command)
+        {
+            redis_cluster_dispatch(cluster, cluster->slots[command->slot], command);
+        }
+        ZEND_HASH_FOREACH_END();
+        zend_hash_destroy(&parts);
+    }
+
+    redis_cluster_request_done(cluster, request);
+}
+
+static PHP_METHOD(swoole_redis_cluster, __call)
+{
+    zval *params;
+    char *command;
+    size_t command_len;
+    zval *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS(), "sz", &command, &command_len, &params) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (Z_TYPE_P(params) != IS_ARRAY)
+    {
+        php_swoole_fatal_error(E_WARNING, "invalid params.");
+        RETURN_FALSE;
+    }
+
+    swRedisCluster *cluster = swoole_get_object(getThis());
+    if (!cluster)
+    {
+        php_swoole_fatal_error(E_WARNING, "the object is not an instance of swoole_redis_cluster.");
+        RETURN_FALSE;
+    }
+    if (cluster->state != SW_REDIS_CLUSTER_READY)
+    {
+        php_swoole_error(E_WARNING, "redis cluster is not connected.");
+        RETURN_FALSE;
+    }
+    if (swoole_redis_is_message_command(command, command_len))
+    {
+        php_swoole_fatal_error(E_WARNING, "%s is not supported by the cluster client.", command);
+        RETURN_FALSE;
+    }
+
+    uint32_t argc = zend_hash_num_elements(Z_ARRVAL_P(params));
+    zval *callback = zend_hash_index_find(Z_ARRVAL_P(params), argc - 1);
+    if (callback == NULL)
+    {
+        php_swoole_error(E_WARNING, "index out of array bounds.");
+        RETURN_FALSE;
+    }
+    if (!php_swoole_is_callable(callback))
+    {
+        RETURN_FALSE;
+    }
+
+    uint32_t n_args = 0;
+    zval **args = emalloc(sizeof(zval *) * argc);
+    SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(params), value)
+        if (n_args == argc - 1)
+        {
+            break;
+        }
+        args[n_args++] = value;
+    SW_HASHTABLE_FOREACH_END();
+
+    redis_cluster_execute(cluster, command, command_len, args, n_args, callback);
+    efree(args);
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_redis_cluster, close)
+{
+    swRedisCluster *cluster = swoole_get_object(getThis());
+    if (!cluster || cluster->state == SW_REDIS_CLUSTER_CLOSED)
+    {
+        RETURN_FALSE;
+    }
+
+    redis_cluster_close(cluster);
+    if (cluster->callback)
+    {
+        sw_zval_free(cluster->callback);
+        cluster->callback = NULL;
+    }
+    zval_ptr_dtor(cluster->object);
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_redis_cluster, __destruct)
+{
+    SW_PREVENT_USER_DESTRUCT();
+
+    swRedisCluster *cluster = swoole_get_object(getThis());
+    swRedisClusterNode *node;
+    uint32_t i;
+
+    if (!cluster)
+    {
+        return;
+    }
+    if (cluster->state != SW_REDIS_CLUSTER_CLOSED)
+    {
+        redis_cluster_close(cluster);
+    }
+    ZEND_HASH_FOREACH_PTR(cluster->nodes, node)
+    {
+        redis_cluster_node_free(node);
+    }
+    ZEND_HASH_FOREACH_END();
+    zend_hash_destroy(cluster->nodes);
+    FREE_HASHTABLE(cluster->nodes);
+    for (i = 0; i < cluster->seed_count; i++)
+    {
+        zend_string_release(cluster->seeds[i]);
+    }
+    efree(cluster->seeds);
+    efree(cluster->slots);
+    zval_ptr_dtor(&cluster->settings);
+    if (cluster->callback)
+    {
+        sw_zval_free(cluster->callback);
+    }
+    efree(cluster);
+    swoole_set_object(getThis(), NULL);
+}
@@ -0,0 +1,56 @@
+--TEST--
+swoole_mysql: values spanning several packets
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+// 18M, longer than a packet (16M)
+$count = 3 * 1024 * 1024;
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], function (\swoole_mysql $swoole_mysql, $result) use ($count)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $sql = "SELECT 'head' AS a, REPEAT('swoole', ?) AS b, 'tail' AS c, REPEAT('x', ?) AS d";
+    $swoole_mysql->query(str_replace('?', $count, $sql), function (\swoole_mysql $swoole_mysql, $result) use ($sql, $count)
+    {
+        assert($result[0]['a'] === 'head');
+        assert($result[0]['b'] === str_repeat('swoole', $count));
+        assert($result[0]['c'] === 'tail');
+        assert($result[0]['d'] === str_repeat('x', $count));
+        $swoole_mysql->prepare($sql, function (\swoole_mysql $swoole_mysql, $stmt_id) use ($count)
+        {
+            $swoole_mysql->execute($stmt_id, [$count, $count], function (\swoole_mysql $swoole_mysql, $result) use ($count)
+            {
+                assert($result[0]['a'] === 'head');
+                assert($result[0]['b'] === str_repeat('swoole', $count));
+                assert($result[0]['c'] === 'tail');
+                assert($result[0]['d'] === str_repeat('x', $count));
+                // the buffer is usable afterwards
+                $swoole_mysql->query("SELECT 1 AS n", function (\swoole_mysql $swoole_mysql, $result)
+                {
+                    assert(intval($result[0]['n']) === 1);
+                    echo "SUCCESS\n";
+                    $swoole_mysql->close();
+                });
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,122 @@
+--TEST--
+swoole_mysql: binlog stream of the row changes
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$config = [
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+];
+
+$stream = null;
+$changes = [];
+
+function binlog_changes(\swoole_mysql $swoole_mysql)
+{
+    $swoole_mysql->query("INSERT INTO `binlog_stream` VALUES (1, 'swoole', 9.99)", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        $swoole_mysql->query("UPDATE `binlog_stream` SET `name` = 'binlog', `price` = -0.5 WHERE `id` = 1", function (\swoole_mysql $swoole_mysql, $result)
+        {
+            $swoole_mysql->query("DELETE FROM `binlog_stream` WHERE `id` = 1", function (\swoole_mysql $swoole_mysql, $result)
+            {
+                assert($result === true);
+            });
+        });
+    });
+}
+
+function binlog_check(\swoole_mysql $swoole_mysql, array $changes)
+{
+    assert($changes[0]['type'] === 'insert');
+    assert($changes[0]['table'] === 'binlog_stream');
+    assert(array_values($changes[0]['rows'][0]) === [1, 'swoole', '9.99']);
+    echo "insert\n";
+    assert($changes[1]['type'] === 'update');
+    assert(array_values($changes[1]['rows'][0]['before']) === [1, 'swoole', '9.99']);
+    assert(array_values($changes[1]['rows'][0]['after']) === [1, 'binlog', '-0.50']);
+    echo "update\n";
+    assert($changes[2]['type'] === 'delete');
+    assert(array_values($changes[2]['rows'][0]) === [1, 'binlog', '-0.50']);
+    echo "delete\n";
+    $swoole_mysql->query("DROP TABLE `binlog_stream`", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        $swoole_mysql->close();
+    });
+}
+
+function binlog_skip(\swoole_mysql $swoole_mysql)
+{
+    echo "insert\nupdate\ndelete\n";
+    $swoole_mysql->close();
+}
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect($config, function (\swoole_mysql $swoole_mysql, $result) use ($config, &$stream, &$changes)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $swoole_mysql->query("SELECT @@GLOBAL.log_bin AS log_bin, @@GLOBAL.binlog_format AS format", function (\swoole_mysql $swoole_mysql, $result) use ($config, &$stream, &$changes)
+    {
+        // the stream needs the row format, and the privileges of a replica
+        if ($result === false || !$result[0]['log_bin'] || $result[0]['format'] !== 'ROW')
+        {
+            binlog_skip($swoole_mysql);
+            return;
+        }
+        $sql = "CREATE TABLE IF NOT EXISTS `binlog_stream` (`id` INT PRIMARY KEY, `name` VARCHAR(32), `price` DECIMAL(10, 2))";
+        $swoole_mysql->query($sql, function (\swoole_mysql $swoole_mysql, $result) use ($config, &$stream, &$changes)
+        {
+            assert($result === true);
+            $swoole_mysql->query("SHOW MASTER STATUS", function (\swoole_mysql $swoole_mysql, $result) use ($config, &$stream, &$changes)
+            {
+                if (!$result)
+                {
+                    binlog_skip($swoole_mysql);
+                    return;
+                }
+                // from the current position, the changes made below are the first ones of the stream
+                $stream = new Swoole\MySQL\BinlogStream($config, [
+                    'file' => $result[0]['File'],
+                    'position' => intval($result[0]['Position']),
+                    'tables' => [MYSQL_SERVER_DB . '.binlog_stream'],
+                ]);
+                $stream->start(function (Swoole\MySQL\BinlogStream $stream, $batch) use ($swoole_mysql, &$changes)
+                {
+                    if ($batch === false)
+                    {
+                        echo "stream error [errno=$stream->errCode, error=$stream->errMsg]\n";
+                        $swoole_mysql->close();
+                        return;
+                    }
+                    assert(is_string($batch['file']) && $batch['position'] > 4);
+                    foreach ($batch['changes'] as $change)
+                    {
+                        $changes[] = $change;
+                    }
+                    if (count($changes) === 3)
+                    {
+                        $stream->stop();
+                        binlog_check($swoole_mysql, $changes);
+                    }
+                });
+                binlog_changes($swoole_mysql);
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+insert
+update
+delete
@@ -0,0 +1,41 @@
+--TEST--
+swoole_mysql: compressed protocol
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "compression" => true,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    // big enough to be compressed and split into several packets
+    $swoole_mysql->query("SELECT REPEAT('swoole', 100000) AS s, 1 AS n", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert($result[0]['s'] === str_repeat('swoole', 100000));
+        assert(intval($result[0]['n']) === 1);
+        $swoole_mysql->query("SELECT 2 AS n", function (\swoole_mysql $swoole_mysql, $result)
+        {
+            assert(intval($result[0]['n']) === 2);
+            echo "SUCCESS\n";
+            $swoole_mysql->close();
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,52 @@
+--TEST--
+swoole_mysql: prepared statement cursor
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $sql = "SELECT * FROM (SELECT 1 AS n UNION SELECT 2 UNION SELECT 3 UNION SELECT 4 UNION SELECT 5) t WHERE n >= ?";
+    $swoole_mysql->prepare($sql, function (\swoole_mysql $swoole_mysql, $stmt_id)
+    {
+        assert(is_int($stmt_id));
+        $rows = [];
+        $swoole_mysql->execute($stmt_id, [1], function (\swoole_mysql $swoole_mysql, $result) use ($stmt_id, &$rows)
+        {
+            if (is_array($result))
+            {
+                assert(count($result) <= 2);
+                echo "batch: " . count($result) . "\n";
+                $rows = array_merge($rows, $result);
+                return;
+            }
+            assert($result === true);
+            assert(array_column($rows, 'n') === [1, 2, 3, 4, 5]);
+            assert($swoole_mysql->closeStatement($stmt_id));
+            echo "SUCCESS\n";
+            $swoole_mysql->close();
+        }, ['fetch_size' => 2]);
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+batch: 2
+batch: 2
+batch: 1
+SUCCESS
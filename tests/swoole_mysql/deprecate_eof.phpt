@@ -0,0 +1,73 @@
+--TEST--
+swoole_mysql: result sets without the EOF packets
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    // the end of the rows comes right after the column definitions
+    $swoole_mysql->query("SELECT 1 AS n FROM DUAL WHERE 0", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert($result === []);
+        echo "empty\n";
+        $swoole_mysql->query("SELECT 'a' AS s UNION ALL SELECT '' UNION ALL SELECT NULL", function (\swoole_mysql $swoole_mysql, $result)
+        {
+            assert($result === [['s' => 'a'], ['s' => ''], ['s' => null]]);
+            echo "rows\n";
+            // neither parameters nor columns
+            $swoole_mysql->prepare("DO 1", function (\swoole_mysql $swoole_mysql, $stmt_id)
+            {
+                assert(is_int($stmt_id));
+                $swoole_mysql->execute($stmt_id, [], function (\swoole_mysql $swoole_mysql, $result)
+                {
+                    assert($result === true);
+                    $swoole_mysql->prepare("SELECT ? AS a, ? AS b", function (\swoole_mysql $swoole_mysql, $stmt_id)
+                    {
+                        $swoole_mysql->execute($stmt_id, [1, 'swoole'], function (\swoole_mysql $swoole_mysql, $result)
+                        {
+                            assert(count($result) === 1 && $result[0]['b'] === 'swoole');
+                            echo "prepared\n";
+                            // the cursor is reported after the column definitions all the same
+                            $rows = [];
+                            $swoole_mysql->execute($stmt_id, [2, 'cursor'], function (\swoole_mysql $swoole_mysql, $result) use (&$rows)
+                            {
+                                if (is_array($result))
+                                {
+                                    $rows = array_merge($rows, $result);
+                                    return;
+                                }
+                                assert($result === true);
+                                assert(count($rows) === 1 && $rows[0]['b'] === 'cursor');
+                                echo "cursor\n";
+                                $swoole_mysql->close();
+                            }, ['fetch_size' => 1]);
+                        });
+                    });
+                });
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+empty
+rows
+prepared
+cursor
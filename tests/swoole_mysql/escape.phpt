@@ -0,0 +1,41 @@
+--TEST--
+swoole_mysql: escape and escapeArray
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "charset" => "utf8mb4",
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    assert($result);
+    // longer than a vector, the special bytes at both ends
+    $str = "'" . str_repeat("swoole\"\\\0\n\r\x1a中文", 20) . "'";
+    $expect = strtr(addcslashes($str, "'\"\\"), ["\0" => "\\0", "\n" => "\\n", "\r" => "\\r", "\x1a" => "\\Z"]);
+    assert($swoole_mysql->escape($str) === $expect);
+    $values = $swoole_mysql->escapeArray([$str, 1, null, true, 0.5]);
+    $swoole_mysql->query("SELECT $values", function (\swoole_mysql $swoole_mysql, $result) use ($str)
+    {
+        $row = array_values($result[0]);
+        assert($row[0] === $str);
+        assert(intval($row[1]) === 1);
+        assert($row[2] === null);
+        assert(intval($row[3]) === 1);
+        assert(floatval($row[4]) === 0.5);
+        echo "SUCCESS\n";
+        $swoole_mysql->close();
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
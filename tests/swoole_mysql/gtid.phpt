@@ -0,0 +1,60 @@
+--TEST--
+swoole_mysql: session tracked GTID
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->on("close", function ()
+{
+    echo "closed\n";
+});
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "track_gtids" => true,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $swoole_mysql->query("SELECT @@GLOBAL.gtid_mode AS mode", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        // nothing is tracked without GTIDs
+        if ($result === false || $result[0]['mode'] !== 'ON')
+        {
+            echo "gtid\nreached\n";
+            $swoole_mysql->close();
+            return;
+        }
+        $sql = "INSERT INTO `userinfo` (`name`, `level`, `passwd`, `regtime`, `big_n`, `data`, `lastlogin_ip`, `price`, `mdate`, `mtime`, `mdatetime`, `year`, `int8_t`, `mshort`, `mtext`) "
+            . "VALUES ('gtid', 1, 'gtid', '2015-01-01 18:00:00', 1, 'null', 1270, 0.22, '1997-06-04', '21:52:33', '2018-04-17 04:16:20', 1989, 127, 32767, '')";
+        $swoole_mysql->query($sql, function (\swoole_mysql $swoole_mysql, $result)
+        {
+            assert($result === true);
+            assert(preg_match('/^[0-9a-f-]{36}:\d+$/', $swoole_mysql->gtid) === 1);
+            echo "gtid\n";
+            assert($swoole_mysql->waitForGtid($swoole_mysql->gtid, function (\swoole_mysql $swoole_mysql, $reached)
+            {
+                assert($reached === true);
+                echo "reached\n";
+                $swoole_mysql->close();
+            }, 0.5));
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+gtid
+reached
+closed
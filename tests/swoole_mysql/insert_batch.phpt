@@ -0,0 +1,59 @@
+--TEST--
+swoole_mysql: insert batch
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->on("close", function ()
+{
+    echo "closed\n";
+});
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    // small enough to split the rows into several statements
+    "max_allowed_packet" => 4096,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $swoole_mysql->query("CREATE TEMPORARY TABLE insert_batch (id INT, name VARCHAR(64), score DOUBLE NULL)", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert($result === true);
+        $rows = (function ()
+        {
+            for ($i = 0; $i < 1000; $i++)
+            {
+                yield [$i, "it's row \"{$i}\"\\", $i % 2 ? $i / 4 : null];
+            }
+        })();
+        assert($swoole_mysql->insertBatch("insert_batch", ["id", "name", "score"], $rows, function (\swoole_mysql $swoole_mysql, $result)
+        {
+            assert($result === true);
+            assert($swoole_mysql->affected_rows === 1000);
+            $swoole_mysql->query("SELECT COUNT(*) AS n, SUM(score) AS s FROM insert_batch WHERE name LIKE 'it''s row%'", function (\swoole_mysql $swoole_mysql, $result)
+            {
+                assert(intval($result[0]['n']) === 1000);
+                assert(floatval($result[0]['s']) === 62500.0);
+                echo "inserted\n";
+                $swoole_mysql->close();
+            });
+        }));
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+inserted
+closed
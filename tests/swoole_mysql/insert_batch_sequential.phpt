@@ -0,0 +1,53 @@
+--TEST--
+swoole_mysql: insert batch without pipelining stops at the first failed statement
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    // small enough to split the rows into several statements
+    "max_allowed_packet" => 4096,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    assert($result);
+    $swoole_mysql->query("CREATE TEMPORARY TABLE insert_batch (id INT PRIMARY KEY, name VARCHAR(64))", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert($result === true);
+        $swoole_mysql->query("INSERT INTO insert_batch VALUES (0, 'first')", function (\swoole_mysql $swoole_mysql, $result)
+        {
+            assert($result === true);
+            $rows = [];
+            for ($i = 0; $i < 1000; $i++)
+            {
+                $rows[] = [$i, "row {$i}"];
+            }
+            // the first statement fails on the duplicate key, the next ones are not sent
+            assert($swoole_mysql->insertBatch("insert_batch", ["id", "name"], $rows, function (\swoole_mysql $swoole_mysql, $result)
+            {
+                assert($result === false);
+                assert($swoole_mysql->errno === 1062);
+                echo "failed\n";
+                $swoole_mysql->query("SELECT COUNT(*) AS n FROM insert_batch", function (\swoole_mysql $swoole_mysql, $result)
+                {
+                    assert(intval($result[0]['n']) === 1);
+                    echo "stopped\n";
+                    $swoole_mysql->close();
+                });
+            }));
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+failed
+stopped
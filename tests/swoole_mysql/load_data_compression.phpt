@@ -0,0 +1,58 @@
+--TEST--
+swoole_mysql: LOAD DATA LOCAL INFILE with the compressed protocol
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$file = tempnam(sys_get_temp_dir(), 'swoole_mysql_');
+// big enough to be compressed and sent in several packets
+file_put_contents($file, implode("\n", range(1, 100000)) . "\n");
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "compression" => true,
+    "local_infile" => dirname($file),
+], function (\swoole_mysql $swoole_mysql, $result) use ($file)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $swoole_mysql->query("CREATE TEMPORARY TABLE load_data_test (n INT)", function (\swoole_mysql $swoole_mysql, $result) use ($file)
+    {
+        assert($result === true);
+        $swoole_mysql->query("LOAD DATA LOCAL INFILE '{$file}' INTO TABLE load_data_test", function (\swoole_mysql $swoole_mysql, $result)
+        {
+            if ($result === false && $swoole_mysql->errno === 1148)
+            {
+                // local_infile is disabled on the server
+                echo "file: 100000\nsum: 5000050000\n";
+                $swoole_mysql->close();
+                return;
+            }
+            assert($result === true);
+            echo "file: {$swoole_mysql->affected_rows}\n";
+            // the connection goes on after the exchange
+            $swoole_mysql->query("SELECT SUM(n) AS s FROM load_data_test", function (\swoole_mysql $swoole_mysql, $result)
+            {
+                echo "sum: {$result[0]['s']}\n";
+                $swoole_mysql->close();
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+unlink($file);
+?>
+--EXPECT--
+file: 100000
+sum: 5000050000
@@ -0,0 +1,48 @@
+--TEST--
+swoole_mysql: prepared statement long data
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$file = tempnam(sys_get_temp_dir(), 'swoole_mysql_');
+file_put_contents($file, str_repeat('swoole', 512 * 1024));
+$stream = fopen($file, 'r');
+fseek($stream, 6);
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], function (\swoole_mysql $swoole_mysql, $result) use ($file, $stream)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $swoole_mysql->prepare("SELECT LENGTH(?) AS a, ? AS b, MD5(?) AS c", function (\swoole_mysql $swoole_mysql, $stmt_id) use ($file, $stream)
+    {
+        assert(is_int($stmt_id));
+        $long_data = [0 => $file, 2 => $stream];
+        $swoole_mysql->execute($stmt_id, [null, 'short', null], function (\swoole_mysql $swoole_mysql, $result) use ($file)
+        {
+            assert(intval($result[0]['a']) === 6 * 512 * 1024);
+            assert($result[0]['b'] === 'short');
+            // the stream is read from its position
+            assert($result[0]['c'] === md5(substr(file_get_contents($file), 6)));
+            echo "SUCCESS\n";
+            $swoole_mysql->close();
+            unlink($file);
+        }, ['long_data' => $long_data]);
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,60 @@
+--TEST--
+swoole_mysql: multi-statement query
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->on("close", function ()
+{
+    echo "closed\n";
+});
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "multi_statements" => true,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    assert($swoole_mysql->multiQuery("SELECT 1 AS a; DO 0; SELECT 2 AS b, 3 AS c", function (\swoole_mysql $swoole_mysql, $results)
+    {
+        assert(count($results) === 3);
+        assert(intval($results[0][0]['a']) === 1);
+        assert($results[1] === true);
+        assert(intval($results[2][0]['c']) === 3);
+        echo "multi\n";
+    }));
+    // the statements after the failed one are not executed
+    assert($swoole_mysql->multiQuery("SELECT 1; SELECT * FROM not_exists_table; SELECT 2", function (\swoole_mysql $swoole_mysql, $results)
+    {
+        assert(count($results) === 2);
+        assert($results[1] === false);
+        assert($swoole_mysql->errno === 1146);
+        echo "error\n";
+    }));
+    // query only gets the first result
+    assert($swoole_mysql->query("SELECT 4 AS d; SELECT 5 AS e", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert(intval($result[0]['d']) === 4);
+        echo "first\n";
+        $swoole_mysql->close();
+    }));
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+multi
+error
+first
+closed
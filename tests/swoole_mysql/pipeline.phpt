@@ -0,0 +1,60 @@
+--TEST--
+swoole_mysql: query pipeline
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->on("close", function ()
+{
+    echo "closed\n";
+});
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "pipeline" => true,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    for ($i = 0; $i < 3; $i++)
+    {
+        assert($swoole_mysql->query("SELECT {$i} AS n", function (\swoole_mysql $swoole_mysql, $result) use ($i)
+        {
+            assert(intval($result[0]['n']) === $i);
+            echo "result#{$i}\n";
+        }));
+    }
+    // an error only fails its own query
+    assert($swoole_mysql->query("SELECT * FROM not_exists_table", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert($result === false);
+        assert($swoole_mysql->errno === 1146);
+        echo "error\n";
+    }));
+    assert($swoole_mysql->query("SELECT 3 AS n", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert(intval($result[0]['n']) === 3);
+        echo "result#3\n";
+        $swoole_mysql->close();
+    }));
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+result#0
+result#1
+result#2
+error
+result#3
+closed
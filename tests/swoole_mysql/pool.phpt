@@ -0,0 +1,41 @@
+--TEST--
+swoole_mysql: connection pool
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$pool = new Swoole\MySQL\Pool([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], [
+    "max" => 2,
+    "wait_timeout" => 5,
+]);
+
+$n = 0;
+for ($i = 0; $i < 6; $i++)
+{
+    assert($pool->query("SELECT {$i} AS n", function (\swoole_mysql $mysql, $result) use ($pool, $i, &$n)
+    {
+        assert(intval($result[0]['n']) === $i);
+        if (++$n == 6)
+        {
+            $stats = $pool->getStats();
+            assert($stats['connection_num'] === 2);
+            assert($stats['query_num'] === 6);
+            // the connections are opened on demand, no query of the burst finds an idle one
+            assert($stats['wait_num'] === 6);
+            echo "done\n";
+            $pool->close();
+        }
+    }));
+}
+Swoole\Event::wait();
+?>
+--EXPECT--
+done
@@ -0,0 +1,51 @@
+--TEST--
+swoole_mysql: query timeout
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->on("close", function ()
+{
+    echo "closed\n";
+});
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $start = microtime(true);
+    assert($swoole_mysql->query("SELECT SLEEP(5)", function (\swoole_mysql $swoole_mysql, $result) use ($start)
+    {
+        assert($result === false);
+        assert($swoole_mysql->errno === 110);
+        assert(microtime(true) - $start < 1);
+        echo "timeout\n";
+    }, 0.5));
+    // the server stops the sleeping query, the connection is kept
+    assert($swoole_mysql->query("SELECT 1 AS a", function (\swoole_mysql $swoole_mysql, $result) use ($start)
+    {
+        assert(intval($result[0]['a']) === 1);
+        assert(microtime(true) - $start < 2);
+        echo "next\n";
+        $swoole_mysql->close();
+    }));
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+timeout
+next
+closed
@@ -0,0 +1,57 @@
+--TEST--
+swoole_mysql: reset and change user
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $swoole_mysql->query("SET @swoole = 1", function (\swoole_mysql $swoole_mysql, $result)
+    {
+        assert($result === true);
+        $swoole_mysql->prepare("SELECT 1", function (\swoole_mysql $swoole_mysql, $stmt_id)
+        {
+            assert(is_int($stmt_id));
+            $swoole_mysql->reset(function (\swoole_mysql $swoole_mysql, $result) use ($stmt_id)
+            {
+                assert($result === true);
+                // the statements of the session have been released
+                assert(@$swoole_mysql->execute($stmt_id, [], function () {}) === false);
+                $swoole_mysql->query("SELECT @swoole AS v", function (\swoole_mysql $swoole_mysql, $result)
+                {
+                    assert($result[0]['v'] === null);
+                    $swoole_mysql->changeUser(MYSQL_SERVER_USER, MYSQL_SERVER_PWD, function (\swoole_mysql $swoole_mysql, $result)
+                    {
+                        assert($result === true);
+                        $swoole_mysql->query("SELECT CURRENT_USER() AS u, DATABASE() AS d", function (\swoole_mysql $swoole_mysql, $result)
+                        {
+                            assert(strpos($result[0]['u'], MYSQL_SERVER_USER . '@') === 0);
+                            assert($result[0]['d'] === MYSQL_SERVER_DB);
+                            echo "SUCCESS\n";
+                            $swoole_mysql->close();
+                        });
+                    });
+                });
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,60 @@
+--TEST--
+swoole_mysql: result cache of the SELECT queries
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$server = [
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "result_cache_ttl" => 10,
+];
+
+$db1 = new \swoole_mysql();
+$db2 = new \swoole_mysql();
+
+$db1->connect($server, function (\swoole_mysql $db1, $result) use ($db2, $server)
+{
+    assert($result);
+    $db2->connect($server, function (\swoole_mysql $db2, $result) use ($db1)
+    {
+        assert($result);
+        $sql = "SELECT 'swoole' AS name, UUID() AS id";
+        $db1->query($sql, function (\swoole_mysql $db1, $result) use ($db2, $sql)
+        {
+            $id = $result[0]['id'];
+            assert($result[0]['name'] === 'swoole');
+            // served from the cache
+            $db2->query("select  'swoole' AS name,\n UUID() AS id", function (\swoole_mysql $db2, $result) use ($db1, $id)
+            {
+                assert($result[0]['id'] === $id);
+                $stats = \swoole_mysql::getCacheStats();
+                assert($stats['misses'] === 1);
+                assert($stats['hits'] === 1);
+                assert($stats['coalesced'] === 1);
+                // not cacheable
+                $db1->query("SELECT UUID() AS id FOR UPDATE", function (\swoole_mysql $db1, $result) use ($db2)
+                {
+                    assert(\swoole_mysql::getCacheStats()['misses'] === 1);
+                    echo "SUCCESS\n";
+                    $db1->close();
+                    $db2->close();
+                });
+            });
+        });
+        // coalesced with the query in flight
+        $db2->query($sql, function (\swoole_mysql $db2, $result)
+        {
+            assert($result[0]['name'] === 'swoole');
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,61 @@
+--TEST--
+swoole_mysql: result cache skips the SELECT queries which depend on the session
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$server = [
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "result_cache_ttl" => 10,
+];
+
+$db1 = new \swoole_mysql();
+$db2 = new \swoole_mysql();
+
+$db1->connect($server, function (\swoole_mysql $db1, $result) use ($db2, $server)
+{
+    assert($result);
+    $db2->connect($server, function (\swoole_mysql $db2, $result) use ($db1)
+    {
+        assert($result);
+        $stats = \swoole_mysql::getCacheStats();
+        $sql = "SELECT GET_LOCK('swoole_result_cache', 0) AS locked";
+        $db1->query($sql, function (\swoole_mysql $db1, $result) use ($db2, $sql, $stats)
+        {
+            assert(intval($result[0]['locked']) === 1);
+            // the lock is held by the first session, the second one does not get it from the cache
+            $db2->query($sql, function (\swoole_mysql $db2, $result) use ($db1, $stats)
+            {
+                assert(intval($result[0]['locked']) === 0);
+                echo "lock\n";
+                $db2->query("SELECT 1 INTO @swoole", function (\swoole_mysql $db2, $result) use ($db1, $stats)
+                {
+                    $db2->query("SELECT @swoole AS v", function (\swoole_mysql $db2, $result) use ($db1, $stats)
+                    {
+                        assert(intval($result[0]['v']) === 1);
+                        $now = \swoole_mysql::getCacheStats();
+                        assert($now['hits'] === $stats['hits'] && $now['misses'] === $stats['misses']);
+                        echo "variable\n";
+                        $db1->query("SELECT RELEASE_LOCK('swoole_result_cache') AS released", function (\swoole_mysql $db1, $result) use ($db2)
+                        {
+                            assert(intval($result[0]['released']) === 1);
+                            $db1->close();
+                            $db2->close();
+                        });
+                    });
+                });
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+lock
+variable
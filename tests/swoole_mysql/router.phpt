@@ -0,0 +1,51 @@
+--TEST--
+swoole_mysql: read/write splitting router
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$config = [
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+];
+
+// the same server plays the primary and the replica
+$router = new Swoole\MySQL\Router($config, [$config], ["max" => 2]);
+
+$router->query("SELECT 1 AS n", function (\swoole_mysql $mysql, $result) use ($router)
+{
+    assert(intval($result[0]['n']) === 1);
+    $router->query("SELECT 2 AS n FOR UPDATE", function (\swoole_mysql $mysql, $result) use ($router)
+    {
+        assert(intval($result[0]['n']) === 2);
+        $router->begin(function (\swoole_mysql $mysql, $result) use ($router)
+        {
+            assert($result === true);
+            $mysql->query("SELECT 3 AS n", function (\swoole_mysql $mysql, $result) use ($router)
+            {
+                assert(intval($result[0]['n']) === 3);
+                // held by the transaction
+                assert($router->getStats()['primary']['idle_num'] === 0);
+                $mysql->commit(function (\swoole_mysql $mysql, $result) use ($router)
+                {
+                    assert($result === true);
+                    $stats = $router->getStats();
+                    assert($stats['read_num'] === 1);
+                    assert($stats['write_num'] === 2);
+                    assert($stats['replicas'][0]['available'] === true);
+                    echo "done\n";
+                    $router->close();
+                });
+            });
+        });
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+done
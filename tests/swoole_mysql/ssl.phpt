@@ -0,0 +1,59 @@
+--TEST--
+swoole_mysql: TLS connections
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; skip_if_no_ssl(); ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$config = [
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "ssl" => true,
+];
+
+function ssl_connect(array $config, int $times)
+{
+    $swoole_mysql = new \swoole_mysql();
+    $swoole_mysql->connect($config, function (\swoole_mysql $swoole_mysql, $result) use ($config, $times)
+    {
+        if (!$result)
+        {
+            // CR_SSL_CONNECTION_ERROR, the server is not configured for TLS
+            if ($swoole_mysql->connect_errno === 2026)
+            {
+                echo "SUCCESS\n";
+                return;
+            }
+            echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+            return;
+        }
+        $info = $swoole_mysql->tlsInfo;
+        assert(strpos($info['version'], 'TLS') === 0);
+        assert(is_string($info['cipher']) && is_bool($info['session_reused']));
+        assert(is_bool($info['ktls_send']) && is_bool($info['ktls_recv']));
+        $swoole_mysql->query("SHOW SESSION STATUS LIKE 'Ssl_version'", function (\swoole_mysql $swoole_mysql, $result) use ($config, $times, $info)
+        {
+            assert($result[0]['Value'] === $info['version']);
+            $swoole_mysql->close();
+            if ($times > 1)
+            {
+                // with the cached session of the previous connection
+                ssl_connect($config, $times - 1);
+            }
+            else
+            {
+                echo "SUCCESS\n";
+            }
+        });
+    });
+}
+
+ssl_connect($config, 2);
+Swoole\Event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,53 @@
+--TEST--
+swoole_mysql: strict type decoding
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$swoole_mysql = new \swoole_mysql();
+
+$swoole_mysql->on("close", function ()
+{
+    echo "closed\n";
+});
+
+$swoole_mysql->connect([
+    "host" => MYSQL_SERVER_HOST,
+    "port" => MYSQL_SERVER_PORT,
+    "user" => MYSQL_SERVER_USER,
+    "password" => MYSQL_SERVER_PWD,
+    "database" => MYSQL_SERVER_DB,
+    "strict_type" => true,
+    "decimal_as_float" => true,
+    "datetime_as_timestamp" => true,
+], function (\swoole_mysql $swoole_mysql, $result)
+{
+    if (!$result)
+    {
+        echo "connect error [errno=$swoole_mysql->connect_errno, error=$swoole_mysql->connect_error]";
+        return;
+    }
+    $sql = "SELECT CAST(-42 AS SIGNED) AS i, CAST(18446744073709551615 AS UNSIGNED) AS u, " .
+        "CAST(0.25 AS DOUBLE) AS d, CAST(12.50 AS DECIMAL(10,2)) AS m, " .
+        "CAST('2000-02-29 12:34:56' AS DATETIME) AS t, CAST('2000-02-29 12:34:56.5' AS DATETIME(1)) AS f";
+    $swoole_mysql->query($sql, function (\swoole_mysql $swoole_mysql, $result)
+    {
+        $row = $result[0];
+        assert($row['i'] === -42);
+        // does not fit in a PHP integer
+        assert($row['u'] === '18446744073709551615');
+        assert($row['d'] === 0.25);
+        assert($row['m'] === 12.5);
+        assert($row['t'] === 951827696);
+        assert($row['f'] === 951827696.5);
+        echo "decoded\n";
+        $swoole_mysql->close();
+    });
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+decoded
+closed
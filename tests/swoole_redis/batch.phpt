@@ -0,0 +1,52 @@
+--TEST--
+swoole_redis: batch of commands
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$redis = new swoole_redis;
+$redis->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $redis, $result) {
+    assert($result);
+    $commands = [];
+    for ($i = 0; $i < 1000; $i++)
+    {
+        $commands[] = ['SET', "batch_key_{$i}", $i];
+    }
+    $redis->batch($commands, function (swoole_redis $redis, $result) {
+        assert(count($result) === 1000 && $result[999] === 'OK');
+        echo "set\n";
+        $redis->batch([
+            ['GET', 'batch_key_1'],
+            ['HINCRBY', 'batch_key_2', 'field', 1],
+            ['MGET', 'batch_key_3', 'batch_key_none'],
+        ], function (swoole_redis $redis, $result) {
+            assert($result[0] === '1');
+            // the error of a command does not fail the others
+            assert($result[1] === false && strpos($redis->errMsg, 'WRONGTYPE') === 0);
+            assert($result[2] === ['3', null]);
+            echo "get\n";
+        });
+        // the replies come in the order of the requests
+        $redis->get('batch_key_4', function (swoole_redis $redis, $result) {
+            assert($result === '4');
+            $keys = [];
+            for ($i = 0; $i < 1000; $i++)
+            {
+                $keys[] = "batch_key_{$i}";
+            }
+            $redis->batch([array_merge(['DEL'], $keys)], function (swoole_redis $redis, $result) {
+                assert($result === [1000]);
+                echo "del\n";
+                $redis->close();
+            });
+        });
+    });
+});
+swoole_event::wait();
+?>
+--EXPECT--
+set
+get
+del
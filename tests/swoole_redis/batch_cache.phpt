@@ -0,0 +1,43 @@
+--TEST--
+swoole_redis: the writes of a batch invalidate the client-side cache
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$redis = new swoole_redis(['cache_memory' => 1024 * 1024]);
+$redis->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $redis, $result) {
+    assert($result);
+    $redis->set('batch_cache_key', 'v1', function (swoole_redis $redis, $result) {
+        assert($result === 'OK');
+    });
+    $redis->get('batch_cache_key', function (swoole_redis $redis, $result) {
+        assert($result === 'v1');
+        // the reads which are not cached do not flush the cache
+        $redis->getbit('batch_cache_key', 0, function (swoole_redis $redis, $result) {
+            assert($result === 0);
+        });
+        $redis->get('batch_cache_key', function (swoole_redis $redis, $result) {
+            assert($result === 'v1');
+            $stats = $redis->getCacheStats();
+            assert($stats['hits'] === 1 && $stats['entries'] === 1);
+            echo "cached\n";
+            $redis->batch([['SET', 'batch_cache_key', 'v2']], function (swoole_redis $redis, $result) {
+                assert($result === ['OK']);
+            });
+            $redis->get('batch_cache_key', function (swoole_redis $redis, $result) {
+                assert($result === 'v2');
+                echo "invalidated\n";
+                $redis->del('batch_cache_key', function (swoole_redis $redis, $result) {
+                    $redis->close();
+                });
+            });
+        });
+    });
+});
+swoole_event::wait();
+?>
+--EXPECT--
+cached
+invalidated
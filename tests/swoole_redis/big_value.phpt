@@ -0,0 +1,36 @@
+--TEST--
+swoole_redis: commands with long values
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$redis = new swoole_redis;
+$redis->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $redis, $result) {
+    assert($result);
+    // more long values than can be written from their strings at once, and short ones between them
+    $params = [];
+    $values = [];
+    for ($i = 0; $i < 80; $i++)
+    {
+        $values["big_value_{$i}"] = $i % 2 ? str_repeat(chr(ord('a') + $i % 26), 64 * 1024) : (string) $i;
+        $params[] = "big_value_{$i}";
+        $params[] = $values["big_value_{$i}"];
+    }
+    $params[] = function (swoole_redis $redis, $result) use ($values) {
+        assert($result === 'OK');
+        $redis->mGet(...array_merge(array_keys($values), [function (swoole_redis $redis, $result) use ($values) {
+            assert($result === array_values($values));
+            echo "SUCCESS\n";
+            $redis->del(...array_merge(array_keys($values), [function (swoole_redis $redis, $result) {
+                $redis->close();
+            }]));
+        }]));
+    };
+    $redis->mSet(...$params);
+});
+swoole_event::wait();
+?>
+--EXPECT--
+SUCCESS
@@ -0,0 +1,59 @@
+--TEST--
+swoole_redis: client-side cache invalidated by the server
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$writer = new swoole_redis;
+$writer->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $writer, $result) {
+    assert($result);
+    $writer->set('client_cache_key', 'v1', function (swoole_redis $writer, $result) {
+        assert($result === 'OK');
+        $redis = new swoole_redis(['cache_memory' => 1024 * 1024]);
+        $redis->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $redis, $result) use ($writer) {
+            assert($result);
+            assert($redis->getCacheStats()['tracking'] === true);
+            $redis->get('client_cache_key', function (swoole_redis $redis, $result) use ($writer) {
+                assert($result === 'v1');
+                $redis->get('client_cache_key', function (swoole_redis $redis, $result) use ($writer) {
+                    assert($result === 'v1');
+                    $stats = $redis->getCacheStats();
+                    assert($stats['hits'] === 1 && $stats['misses'] === 1 && $stats['entries'] === 1);
+                    echo "cached\n";
+                    // the write of another connection invalidates the key
+                    $writer->set('client_cache_key', 'v2', function (swoole_redis $writer, $result) use ($redis) {
+                        assert($result === 'OK');
+                        swoole_timer_after(100, function () use ($redis, $writer) {
+                            $stats = $redis->getCacheStats();
+                            assert($stats['invalidations'] === 1 && $stats['entries'] === 0);
+                            $redis->get('client_cache_key', function (swoole_redis $redis, $result) use ($writer) {
+                                assert($result === 'v2');
+                                echo "invalidated\n";
+                                // every key of a write of the connection itself is invalidated at once
+                                $redis->mset('client_cache_other', 'x', 'client_cache_key', 'v3', function (swoole_redis $redis, $result) {
+                                    assert($result === 'OK');
+                                });
+                                $redis->get('client_cache_key', function (swoole_redis $redis, $result) use ($writer) {
+                                    assert($result === 'v3');
+                                    echo "written\n";
+                                    $writer->del('client_cache_key', 'client_cache_other', function (swoole_redis $writer, $result) use ($redis) {
+                                        $writer->close();
+                                        $redis->close();
+                                    });
+                                });
+                            });
+                        });
+                    });
+                });
+            });
+        });
+    });
+});
+swoole_event::wait();
+?>
+--EXPECT--
+cached
+invalidated
+written
@@ -0,0 +1,53 @@
+--TEST--
+swoole_redis: cluster with the keys split by slot
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; skip_if_no_redis_cluster(); ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$cluster = new Swoole\Redis\Cluster([REDIS_CLUSTER_HOST . ':' . REDIS_CLUSTER_PORT], ['timeout' => 3]);
+$cluster->connect(function (Swoole\Redis\Cluster $cluster, $result) {
+    if (!$result)
+    {
+        echo "connect error [errno=$cluster->errCode, error=$cluster->errMsg]\n";
+        return;
+    }
+    $keys = [];
+    $pairs = [];
+    for ($i = 0; $i < 100; $i++)
+    {
+        $keys[] = "cluster_key_{$i}";
+        $pairs[] = "cluster_key_{$i}";
+        $pairs[] = $i;
+    }
+    // the keys are on all the masters
+    call_user_func_array([$cluster, 'mset'], array_merge($pairs, [function (Swoole\Redis\Cluster $cluster, $result) use ($keys) {
+        assert($result === true);
+        echo "mset\n";
+        call_user_func_array([$cluster, 'mget'], array_merge($keys, ['cluster_key_none', function (Swoole\Redis\Cluster $cluster, $result) use ($keys) {
+            assert(count($result) === 101 && $result[0] === '0' && $result[99] === '99' && $result[100] === null);
+            echo "mget\n";
+            // the keys of a hash tag are in the same slot
+            $cluster->eval("return redis.call('incrby', KEYS[1], ARGV[1]) + redis.call('incrby', KEYS[2], ARGV[1])", 2, '{cluster}.a', '{cluster}.b', 2, function (Swoole\Redis\Cluster $cluster, $result) use ($keys) {
+                assert($result === 4);
+                echo "eval\n";
+                call_user_func_array([$cluster, 'del'], array_merge($keys, ['{cluster}.a', '{cluster}.b', function (Swoole\Redis\Cluster $cluster, $result) {
+                    assert($result === 102);
+                    echo "del\n";
+                    $cluster->get('cluster_key_1', function (Swoole\Redis\Cluster $cluster, $result) {
+                        assert($result === null);
+                        $cluster->close();
+                    });
+                }]));
+            });
+        }]));
+    }]));
+});
+Swoole\Event::wait();
+?>
+--EXPECT--
+mset
+mget
+eval
+del
@@ -0,0 +1,45 @@
+--TEST--
+swoole_redis: large and nested replies
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+// more than a read, the replies come in several parts
+$blob = str_repeat('swoole', 256 * 1024);
+$count = 10000;
+
+$redis = new swoole_redis;
+$redis->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $redis, $result) use ($blob, $count) {
+    assert($result);
+    $redis->set('large_reply_blob', $blob, function (swoole_redis $redis, $result) use ($blob, $count) {
+        assert($result === 'OK');
+        $redis->get('large_reply_blob', function (swoole_redis $redis, $result) use ($blob, $count) {
+            assert($result === $blob);
+            echo "bulk\n";
+            $redis->del('large_reply_list', function (swoole_redis $redis, $result) use ($count) {
+                $redis->rPush('large_reply_list', ...array_merge(range(1, $count), [function (swoole_redis $redis, $result) use ($count) {
+                    assert($result === $count);
+                    $redis->lRange('large_reply_list', 0, -1, function (swoole_redis $redis, $result) use ($count) {
+                        assert(count($result) === $count && $result[0] === '1' && $result[$count - 1] === (string) $count);
+                        echo "multi-bulk\n";
+                        $redis->eval("return {1, {'a', {}, redis.call('get', 'large_reply_none')}, 'b'}", 0, function (swoole_redis $redis, $result) {
+                            assert($result === [1, ['a', [], null], 'b']);
+                            echo "nested\n";
+                            $redis->del('large_reply_blob', 'large_reply_list', function (swoole_redis $redis, $result) {
+                                $redis->close();
+                            });
+                        });
+                    });
+                }]));
+            });
+        });
+    });
+});
+swoole_event::wait();
+?>
+--EXPECT--
+bulk
+multi-bulk
+nested
@@ -0,0 +1,66 @@
+--TEST--
+swoole_redis: malformed replies of the server
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+// a line without its type, then lengths which must not be allocated up front
+$replies = ["\n", "*2147483647\r\n", "\$2147483647\r\nabc"];
+
+$server = stream_socket_server('tcp://127.0.0.1:0', $errno, $errstr);
+list(, $port) = explode(':', stream_socket_get_name($server, false));
+swoole_event_add($server, function ($server) use (&$replies) {
+    $conn = stream_socket_accept($server);
+    $reply = array_shift($replies);
+    swoole_event_add($conn, function ($conn) use ($reply) {
+        if (fread($conn, 8192))
+        {
+            fwrite($conn, $reply);
+            // the partial bulk string is kept by the client until the connection is closed
+            swoole_timer_after(100, function () use ($conn) {
+                if (is_resource($conn))
+                {
+                    swoole_event_del($conn);
+                    fclose($conn);
+                }
+            });
+        }
+        else
+        {
+            swoole_event_del($conn);
+            fclose($conn);
+        }
+    });
+});
+
+$test = function () use (&$test, &$replies, $server, $port) {
+    $redis = new swoole_redis;
+    $redis->on('close', function (swoole_redis $redis) use (&$test, &$replies, $server) {
+        if ($replies)
+        {
+            $test();
+        }
+        else
+        {
+            swoole_event_del($server);
+            fclose($server);
+        }
+    });
+    $redis->connect('127.0.0.1', $port, function (swoole_redis $redis, $result) {
+        assert($result);
+        $redis->get('key', function (swoole_redis $redis, $result) {
+            // the pending request fails when the connection is closed
+            assert($result === false);
+            echo "failed\n";
+        });
+    });
+};
+$test();
+swoole_event::wait();
+?>
+--EXPECT--
+failed
+failed
+failed
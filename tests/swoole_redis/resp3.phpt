@@ -0,0 +1,61 @@
+--TEST--
+swoole_redis: RESP3 replies and pushed messages on one connection
+--SKIPIF--
+<?php require __DIR__ . '/../include/skipif.inc'; ?>
+--FILE--
+<?php
+require __DIR__ . '/../include/bootstrap.php';
+
+$redis = new swoole_redis(['protocol' => 3]);
+$redis->on('message', function (swoole_redis $redis, $message) {
+    if ($message[0] !== 'message')
+    {
+        echo "{$message[0]}d\n";
+        return;
+    }
+    assert($message === ['message', 'resp3_channel', 'payload']);
+    echo "message\n";
+    $redis->unsubscribe('resp3_channel');
+    $redis->del('resp3_hash', 'resp3_set', function (swoole_redis $redis, $result) {
+        assert($result === 2);
+        $redis->close();
+    });
+});
+$redis->connect(REDIS_SERVER_HOST, REDIS_SERVER_PORT, function (swoole_redis $redis, $result) {
+    assert($result);
+    $redis->hmset('resp3_hash', 'a', '1', 'b', '2', function (swoole_redis $redis, $result) {
+        assert($result === 'OK');
+    });
+    // a map is an associative array
+    $redis->hgetall('resp3_hash', function (swoole_redis $redis, $result) {
+        assert($result === ['a' => '1', 'b' => '2']);
+        echo "map\n";
+    });
+    $redis->sadd('resp3_set', 'x', function (swoole_redis $redis, $result) {
+        assert($result === 1);
+    });
+    $redis->smembers('resp3_set', function (swoole_redis $redis, $result) {
+        assert($result === ['x']);
+    });
+    $redis->exists('resp3_none', function (swoole_redis $redis, $result) {
+        assert($result === 0);
+    });
+    $redis->get('resp3_none', function (swoole_redis $redis, $result) {
+        assert($result === null);
+        echo "null\n";
+        // the commands go on while the connection is subscribed
+        $redis->subscribe('resp3_channel');
+        $redis->publish('resp3_channel', 'payload', function (swoole_redis $redis, $result) {
+            // the message may be pushed before or after this reply
+            assert($result === 1);
+        });
+    });
+});
+swoole_event::wait();
+?>
+--EXPECT--
+map
+null
+subscribed
+message
+unsubscribed